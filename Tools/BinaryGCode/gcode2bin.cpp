@@ -0,0 +1,457 @@
+/*
+ * gcode2bin.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host tool to convert a text G-code file to the binary format defined in src/GCodes/BinaryGCode.h.
+ *
+ *  Build:	g++ -std=c++17 -O2 -o gcode2bin gcode2bin.cpp
+ *  Usage:	gcode2bin [-n] input.gcode output.gcode
+ *			-n	don't add a CRC to each block
+ *
+ *  Only commands in the list below whose parameters are all single numbers are encoded. Everything else, including comment lines,
+ *  is passed through as text so that the firmware's file info parser can still find the slicer comments.
+ *  G0/G1 moves with a Z parameter and G90/G91 are also kept as text, because the file info parser uses them to find layer and object heights.
+ *  Such lines are preceded by an empty line so that the parser finds them at the start of a line.
+ *  Comments at the end of encoded commands are dropped.
+ */
+
+#include "../../src/GCodes/BinaryGCode.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace BinaryGCode;
+
+namespace
+{
+	// Codes that take nothing but numeric parameters, so that they can be executed from a pre-parsed command
+	const int EncodableGCodes[] = { 0, 1, 2, 3, 4, 10, 11, 17, 18, 19, 20, 21, 92 };
+	const int EncodableMCodes[] = { 3, 4, 5, 42, 82, 83, 104, 106, 107, 109, 140, 141, 190, 191, 204, 220, 221, 280, 300, 400, 572 };
+
+	uint32_t crcTable[256];
+
+	void InitCrcTable()
+	{
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; ++k)
+			{
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			crcTable[i] = c;
+		}
+	}
+
+	uint32_t Crc32(const std::vector<uint8_t>& data)
+	{
+		uint32_t crc = 0xFFFFFFFFu;
+		for (uint8_t b : data)
+		{
+			crc = crcTable[(crc ^ b) & 0xFF] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+
+	void PutVarint(std::vector<uint8_t>& out, uint64_t v)
+	{
+		while (v >= 0x80)
+		{
+			out.push_back((uint8_t)(v | 0x80));
+			v >>= 7;
+		}
+		out.push_back((uint8_t)v);
+	}
+
+	size_t VarintLength(uint64_t v)
+	{
+		size_t n = 1;
+		while (v >= 0x80)
+		{
+			v >>= 7;
+			++n;
+		}
+		return n;
+	}
+
+	bool Contains(const int *begin, const int *end, int n)
+	{
+		for (const int *p = begin; p != end; ++p)
+		{
+			if (*p == n)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Parse a decimal number exactly into a fixed-point value with the given scale. Return false if it can't be represented exactly.
+	bool ParseFixed(const std::string& s, int32_t scale, int64_t& result)
+	{
+		size_t i = 0;
+		const bool negative = (i < s.size() && s[i] == '-');
+		if (i < s.size() && (s[i] == '-' || s[i] == '+'))
+		{
+			++i;
+		}
+		int64_t intPart = 0;
+		bool sawDigit = false;
+		while (i < s.size() && isdigit((unsigned char)s[i]))
+		{
+			intPart = intPart * 10 + (s[i++] - '0');
+			sawDigit = true;
+			if (intPart > (int64_t)1 << 40)
+			{
+				return false;
+			}
+		}
+		int64_t fracPart = 0;
+		int32_t fracScale = 1;
+		if (i < s.size() && s[i] == '.')
+		{
+			++i;
+			while (i < s.size() && isdigit((unsigned char)s[i]))
+			{
+				sawDigit = true;
+				if (fracScale < scale)
+				{
+					fracPart = fracPart * 10 + (s[i] - '0');
+					fracScale *= 10;
+				}
+				else if (s[i] != '0')
+				{
+					return false;					// too many significant decimal places
+				}
+				++i;
+			}
+		}
+		if (!sawDigit || i != s.size())
+		{
+			return false;
+		}
+		result = intPart * scale + fracPart * (scale / fracScale);
+		if (negative)
+		{
+			result = -result;
+		}
+		return true;
+	}
+
+	struct Command
+	{
+		char letter;
+		uint32_t number;
+		std::vector<std::pair<char, int64_t>> params;
+	};
+
+	// Try to parse the command part of a line (without comment) into something we can encode
+	bool ParseCommand(const std::string& text, Command& cmd)
+	{
+		std::vector<std::string> words;
+		size_t i = 0;
+		while (i < text.size())
+		{
+			while (i < text.size() && (text[i] == ' ' || text[i] == '\t'))
+			{
+				++i;
+			}
+			const size_t start = i;
+			while (i < text.size() && text[i] != ' ' && text[i] != '\t')
+			{
+				++i;
+			}
+			if (i > start)
+			{
+				words.push_back(text.substr(start, i - start));
+			}
+		}
+		if (words.empty())
+		{
+			return false;
+		}
+
+		const char letter = (char)toupper((unsigned char)words[0][0]);
+		const std::string numberText = words[0].substr(1);
+		if (numberText.empty() || numberText.size() > 5 || numberText.find_first_not_of("0123456789") != std::string::npos)
+		{
+			return false;
+		}
+		cmd.letter = letter;
+		cmd.number = (uint32_t)std::stoul(numberText);
+		cmd.params.clear();
+		switch (letter)
+		{
+		case 'G':
+			if (!Contains(std::begin(EncodableGCodes), std::end(EncodableGCodes), (int)cmd.number))
+			{
+				return false;
+			}
+			break;
+
+		case 'M':
+			if (!Contains(std::begin(EncodableMCodes), std::end(EncodableMCodes), (int)cmd.number))
+			{
+				return false;
+			}
+			break;
+
+		case 'T':
+			break;
+
+		default:
+			return false;
+		}
+
+		if (words.size() - 1 > ParsedGCode::MaxParameters)
+		{
+			return false;
+		}
+		for (size_t w = 1; w < words.size(); ++w)
+		{
+			const char pl = (char)toupper((unsigned char)words[w][0]);
+			if (pl < 'A' || pl > 'Z' || pl == 'G' || pl == 'M' || pl == 'N')
+			{
+				return false;
+			}
+			for (const auto& p : cmd.params)
+			{
+				if (p.first == pl)
+				{
+					return false;
+				}
+			}
+			int64_t value;
+			if (!ParseFixed(words[w].substr(1), ParameterScale(pl), value))
+			{
+				return false;
+			}
+			if (letter == 'G' && cmd.number <= 1 && pl == 'Z')
+			{
+				return false;				// keep Z moves as text for the file info parser
+			}
+			cmd.params.emplace_back(pl, value);
+		}
+		return true;
+	}
+
+	class Writer
+	{
+	public:
+		Writer(std::ofstream& f, bool crc) : file(f), useCrc(crc), fileOffset(HeaderLength) { ResetBlockState(); }
+
+		void Header()
+		{
+			const uint8_t header[HeaderLength] = { (uint8_t)Magic[0], (uint8_t)Magic[1], (uint8_t)Magic[2], (uint8_t)Magic[3], FormatVersion, (uint8_t)((useCrc) ? FlagBlockCrc : 0), 0, 0 };
+			file.write(reinterpret_cast<const char *>(header), sizeof(header));
+		}
+
+		// Add a binary record, returning false if it is too big to encode
+		bool AddCommand(const Command& cmd)
+		{
+			std::vector<uint8_t> rec;
+			for (int attempt = 0; attempt < 2; ++attempt)
+			{
+				rec = EncodeCommand(cmd);
+				if (rec.size() > MaxBlockPayload)
+				{
+					return false;
+				}
+				if (payload.size() + rec.size() <= MaxBlockPayload)
+				{
+					break;
+				}
+				FlushBlock();						// the encoding depends on the block state, so encode it again
+			}
+			CommitCommand(cmd);
+			payload.insert(payload.end(), rec.begin(), rec.end());
+			++binaryRecords;
+			return true;
+		}
+
+		// Add text, splitting it into as many records as necessary.
+		// Text that fits in one record is never split, because the file info parser scans the raw file and wouldn't find a key that was split by a record header.
+		void AddText(const std::string& text)
+		{
+			size_t done = 0;
+			while (done < text.size())
+			{
+				size_t room = (MaxBlockPayload > payload.size() + 3) ? MaxBlockPayload - payload.size() - 3 : 0;
+				if (room < text.size() - done && (room < 8 || text.size() - done <= MaxBlockPayload - 3) && !payload.empty())
+				{
+					FlushBlock();
+					continue;
+				}
+				const size_t len = std::min(room, text.size() - done);
+				payload.push_back(RecordTypeText);
+				PutVarint(payload, len);
+				payload.insert(payload.end(), text.begin() + done, text.begin() + done + len);
+				done += len;
+				++textRecords;
+			}
+		}
+
+		void FlushBlock()
+		{
+			if (payload.empty())
+			{
+				return;
+			}
+			const size_t blockLength = 1 + payload.size() + ((useCrc) ? BlockCrcLength : 0);
+			const size_t sectorOffset = fileOffset % SectorSize;
+			if (sectorOffset + blockLength > SectorSize)
+			{
+				// Pad to the end of the sector so that the block doesn't straddle the boundary
+				const std::string padding(SectorSize - sectorOffset, '\0');
+				file.write(padding.data(), padding.size());
+				fileOffset += padding.size();
+			}
+			std::vector<uint8_t> block;
+			block.push_back((uint8_t)payload.size());
+			block.insert(block.end(), payload.begin(), payload.end());
+			if (useCrc)
+			{
+				const uint32_t crc = Crc32(block);
+				for (size_t i = 0; i < BlockCrcLength; ++i)
+				{
+					block.push_back((uint8_t)(crc >> (8 * i)));
+				}
+			}
+			file.write(reinterpret_cast<const char *>(block.data()), block.size());
+			fileOffset += block.size();
+			payload.clear();
+			ResetBlockState();
+		}
+
+		size_t binaryRecords = 0, textRecords = 0;
+
+	private:
+		std::vector<uint8_t> EncodeCommand(const Command& cmd) const
+		{
+			const unsigned int type = (cmd.letter == 'G') ? RecordTypeG : (cmd.letter == 'M') ? RecordTypeM : RecordTypeT;
+			std::vector<uint8_t> rec;
+			const bool sameNumber = (lastNumbers[type] == cmd.number);
+			rec.push_back((uint8_t)(type | ((sameNumber) ? RecordSameNumber : 0) | (cmd.params.size() << RecordParamCountShift)));
+			if (!sameNumber)
+			{
+				PutVarint(rec, cmd.number);
+			}
+			for (const auto& p : cmd.params)
+			{
+				const int64_t last = lastValues[p.first - 'A'];
+				const uint64_t absolute = ZigZagEncode(p.second), delta = ZigZagEncode(p.second - last);
+				const bool useDelta = VarintLength(delta) < VarintLength(absolute);
+				rec.push_back((uint8_t)(p.first | ((useDelta) ? ParamDelta : 0)));
+				PutVarint(rec, (useDelta) ? delta : absolute);
+			}
+			return rec;
+		}
+
+		void CommitCommand(const Command& cmd)
+		{
+			const unsigned int type = (cmd.letter == 'G') ? RecordTypeG : (cmd.letter == 'M') ? RecordTypeM : RecordTypeT;
+			lastNumbers[type] = cmd.number;
+			for (const auto& p : cmd.params)
+			{
+				lastValues[p.first - 'A'] = p.second;
+			}
+		}
+
+		void ResetBlockState()
+		{
+			memset(lastValues, 0, sizeof(lastValues));
+			memset(lastNumbers, 0, sizeof(lastNumbers));
+		}
+
+		std::ofstream& file;
+		bool useCrc;
+		size_t fileOffset;
+		std::vector<uint8_t> payload;
+		int64_t lastValues[26];
+		uint32_t lastNumbers[3];
+	};
+}
+
+int main(int argc, char *argv[])
+{
+	bool useCrc = true;
+	int arg = 1;
+	if (arg < argc && strcmp(argv[arg], "-n") == 0)
+	{
+		useCrc = false;
+		++arg;
+	}
+	if (argc - arg != 2)
+	{
+		std::cerr << "Usage: gcode2bin [-n] input.gcode output.gcode\n";
+		return 1;
+	}
+
+	std::ifstream in(argv[arg], std::ios::binary);
+	if (!in)
+	{
+		std::cerr << "Can't open " << argv[arg] << "\n";
+		return 1;
+	}
+	std::ofstream out(argv[arg + 1], std::ios::binary);
+	if (!out)
+	{
+		std::cerr << "Can't create " << argv[arg + 1] << "\n";
+		return 1;
+	}
+
+	InitCrcTable();
+	Writer writer(out, useCrc);
+	writer.Header();
+
+	std::string line;
+	size_t inputBytes = 0, lines = 0;
+	bool writingFile = false;
+	while (std::getline(in, line))
+	{
+		inputBytes += line.size() + 1;
+		++lines;
+		while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+		{
+			line.pop_back();
+		}
+		const size_t firstNonBlank = line.find_first_not_of(" \t");
+		if (firstNonBlank == std::string::npos)
+		{
+			continue;
+		}
+
+		// Everything between M28 and M29 is written to a file by the firmware, so it must stay as text
+		const std::string trimmed = line.substr(firstNonBlank);
+		if (writingFile || trimmed.compare(0, 3, "M28") == 0)
+		{
+			writingFile = (trimmed.compare(0, 3, "M29") != 0);
+			writer.AddText(line + "\n");
+			continue;
+		}
+
+		Command cmd;
+		const size_t commentStart = trimmed.find(';');
+		if (commentStart != 0 && ParseCommand(trimmed.substr(0, commentStart), cmd) && writer.AddCommand(cmd))
+		{
+			continue;
+		}
+
+		// G-codes kept as text are preceded by a newline so that the file info parser sees them at the start of a line
+		const bool isGCode = (trimmed[0] == 'G' || trimmed[0] == 'g');
+		writer.AddText(((isGCode) ? "\n" : "") + line + "\n");
+	}
+	writer.FlushBlock();
+
+	const size_t outputBytes = (size_t)out.tellp();
+	printf("%zu lines, %zu binary records, %zu text records\n", lines, writer.binaryRecords, writer.textRecords);
+	printf("%zu bytes in, %zu bytes out (%.1f%%)\n", inputBytes, outputBytes, (inputBytes == 0) ? 0.0 : 100.0 * (double)outputBytes / (double)inputBytes);
+	return 0;
+}
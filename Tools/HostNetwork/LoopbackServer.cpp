@@ -0,0 +1,873 @@
+/*
+ * LoopbackServer.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host build of the firmware's web server, which serves HTTP on the loopback interface of a Linux PC through src/Networking/HostNetwork. It compiles
+ *  the real Network, HttpResponder, HttpRequestParser, NetworkBuffer, OutputMemory and FileListGenerator code, with the stand-ins in Tools/HostNetwork/stubs
+ *  for the platform, RTOS and storage layers. A directory on the host is the SD card, so its www and gcodes subdirectories hold the web interface and
+ *  the G-code files. As in the firmware, a single network task runs Network::Spin in a loop. G-codes that clients send with rr_gcode are answered
+ *  with a short reply through the same path as the GCodes task uses, so that rr_reply works.
+ *
+ *  In server mode it runs until it is interrupted, so that the responders can be load tested with curl, ab or a browser running DWC. With -b the card
+ *  stays busy for a time after each write, as the SD card does, so that uploads exercise the back-pressure in HttpResponder::DoUpload.
+ *
+ *  With -t it runs a self-test instead. It makes a temporary card directory, and a client thread checks web file requests with and without gzip and
+ *  ETags, rr_connect with a password, rr_status, rr_gcode and rr_reply, uploads with good and bad CRCs, rr_download, both kinds of file list, pipelined
+ *  requests on a persistent connection and rr_delete. Then it polls rr_status from several connections during a long upload to a slow card and reports
+ *  the longest time a status request took. At the end it checks that every network buffer and output buffer has been freed and every file closed.
+ *
+ *  Build:	g++ -std=gnu++17 -O2 -pthread -Istubs -I../../src -I../../src/Networking -o LoopbackServer LoopbackServer.cpp
+ *  Usage:	LoopbackServer [-p port] [-w password] [-b card_busy_ns_per_byte] [-d] card_directory
+ *			LoopbackServer -t [-p port]
+ *			The default port is 8080, and by default no password is needed and the card is never busy. -d turns on the webserver debug messages.
+ */
+
+// These must come first, because the real ones would be found before the stubs when a source file in src includes them from its own directory
+#include "RepRapFirmware.h"
+#include "Storage/FileStore.h"
+#include "Storage/MassStorage.h"
+#include "Platform.h"
+#include "RepRap.h"
+
+#include "../../src/OutputMemory.cpp"
+#include "../../src/Storage/CRC32.cpp"
+#include "../../src/Storage/FileListGenerator.cpp"
+#include "../../src/Networking/NetworkBuffer.cpp"
+#include "../../src/Networking/NetworkResponder.cpp"
+#include "../../src/Networking/UploadingNetworkResponder.cpp"
+#include "../../src/Networking/HttpRequestParser.cpp"
+#include "../../src/Networking/HttpResponder.cpp"
+#include "../../src/Networking/Network.cpp"
+#include "../../src/Networking/HostNetwork/HostSocket.cpp"
+#include "../../src/Networking/HostNetwork/HostNetworkInterface.cpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sched.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/time.h>
+
+RepRap reprap;
+
+namespace
+{
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+}
+
+uint32_t millis()
+{
+	return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+extern "C" void debugPrintf(const char* fmt, ...)
+{
+	va_list vargs;
+	va_start(vargs, fmt);
+	vprintf(fmt, vargs);
+	va_end(vargs);
+	fflush(stdout);
+}
+
+//*************************************************************************************************
+// Host versions of the Platform and MassStorage functions that the network code uses
+
+void Platform::Message(MessageType type, const char *message) const
+{
+	if (type != NoDestinationMessage)
+	{
+		fputs(message, stdout);
+		fflush(stdout);
+	}
+}
+
+void Platform::MessageF(MessageType type, const char *fmt, ...) const
+{
+	char buf[FormatStringLength];
+	va_list vargs;
+	va_start(vargs, fmt);
+	SafeVsnprintf(buf, sizeof(buf), fmt, vargs);
+	va_end(vargs);
+	Message(type, buf);
+}
+
+FileStore* Platform::OpenFile(const char* folder, const char* fileName, OpenMode mode, uint32_t preAllocSize) const
+{
+	String<MaxFilenameLength> location;
+	return (MassStorage::CombineName(location.GetRef(), folder, fileName)) ? massStorage->OpenFile(location.c_str(), mode, preAllocSize) : nullptr;
+}
+
+bool Platform::Delete(const char* folder, const char *filename) const
+{
+	String<MaxFilenameLength> location;
+	return MassStorage::CombineName(location.GetRef(), folder, filename) && massStorage->Delete(location.c_str());
+}
+
+// This is the same as the firmware's version
+/*static*/ bool MassStorage::CombineName(const StringRef& outbuf, const char* directory, const char* fileName)
+{
+	bool hadError = false;
+	if (directory != nullptr && directory[0] != 0 && fileName[0] != '/' && (strlen(fileName) < 2 || !isdigit(fileName[0]) || fileName[1] != ':'))
+	{
+		hadError = outbuf.copy(directory);
+		if (!hadError)
+		{
+			const size_t len = outbuf.strlen();
+			if (len != 0 && outbuf[len - 1] != '/')
+			{
+				hadError = outbuf.cat('/');
+			}
+		}
+	}
+	else
+	{
+		outbuf.Clear();
+	}
+	if (!hadError)
+	{
+		hadError = outbuf.cat(fileName);
+	}
+	if (hadError)
+	{
+		reprap.GetPlatform().MessageF(ErrorMessage, "Filename too long: cap=%u, dir=%.12s%s name=%.12s%s\n",
+										(unsigned int)outbuf.Capacity(),
+										directory, (strlen(directory) > 12 ? "..." : ""),
+										fileName, (strlen(fileName) > 12 ? "..." : "")
+									 );
+		outbuf.copy("?????");
+	}
+	return !hadError;
+}
+
+// Convert a path on volume 0 to a path on the host
+std::string MassStorage::HostPath(const char *filePath) const
+{
+	if (isdigit(filePath[0]) && filePath[1] == ':')
+	{
+		filePath += 2;
+	}
+	return (filePath[0] == '/') ? root + filePath : root + '/' + filePath;
+}
+
+FileStore* MassStorage::OpenFile(const char* filePath, OpenMode mode, uint32_t preAllocSize)
+{
+	FileStore * const f = new FileStore;
+	if (f->Open(HostPath(filePath).c_str(), mode))
+	{
+		return f;
+	}
+	delete f;
+	return nullptr;
+}
+
+bool MassStorage::Delete(const char* filePath)
+{
+	const std::string path = HostPath(filePath);
+	return unlink(path.c_str()) == 0 || rmdir(path.c_str()) == 0;
+}
+
+bool MassStorage::MakeDirectory(const char *directory)
+{
+	return mkdir(HostPath(directory).c_str(), 0755) == 0;
+}
+
+bool MassStorage::Rename(const char *oldFilePath, const char *newFilePath)
+{
+	return rename(HostPath(oldFilePath).c_str(), HostPath(newFilePath).c_str()) == 0;
+}
+
+bool MassStorage::FileExists(const char *filePath) const
+{
+	struct stat st;
+	return stat(HostPath(filePath).c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+bool MassStorage::DirectoryExists(const char *path) const
+{
+	struct stat st;
+	return stat(HostPath(path).c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool MassStorage::StatFile(const char *filePath, FileInfo& file_info) const
+{
+	struct stat st;
+	if (stat(HostPath(filePath).c_str(), &st) != 0)
+	{
+		return false;
+	}
+	const char * const lastSlash = strrchr(filePath, '/');
+	file_info.fileName.copy((lastSlash == nullptr) ? filePath : lastSlash + 1);
+	file_info.size = (uint32_t)st.st_size;
+	file_info.lastModified = st.st_mtime;
+	file_info.isDirectory = S_ISDIR(st.st_mode);
+	return true;
+}
+
+bool MassStorage::SetLastModifiedTime(const char *file, time_t time)
+{
+	const timeval times[2] = { { time, 0 }, { time, 0 } };
+	return utimes(HostPath(file).c_str(), times) == 0;
+}
+
+// Start listing a directory from entry startAt, skipping hidden files. FatFS returns the entries in the order they were created, which the host
+// doesn't keep, so we sort them by name. The directory is read at the start, so the listing can be suspended between parts without holding it open.
+bool MassStorage::FindFirstVisible(const char *directory, unsigned int startAt, FileInfo &file_info)
+{
+	listing.clear();
+	String<MaxFilenameLength> dirName;
+	dirName.copy(directory);
+	DIR * const dir = opendir(HostPath(dirName.c_str()).c_str());
+	if (dir != nullptr)
+	{
+		for (const dirent *entry = readdir(dir); entry != nullptr; entry = readdir(dir))
+		{
+			String<MaxFilenameLength> path;
+			if (entry->d_name[0] != '.' && CombineName(path.GetRef(), directory, entry->d_name))
+			{
+				FileInfo info;
+				if (StatFile(path.c_str(), info))
+				{
+					listing.push_back(info);
+				}
+			}
+		}
+		closedir(dir);
+	}
+	std::sort(listing.begin(), listing.end(), [](const FileInfo& a, const FileInfo& b) { return strcmp(a.fileName.c_str(), b.fileName.c_str()) < 0; });
+	listingNext = startAt;
+	return FindNextVisible(file_info);
+}
+
+bool MassStorage::FindNextVisible(FileInfo &file_info)
+{
+	if (listingNext >= listing.size())
+	{
+		return false;
+	}
+	file_info = listing[listingNext++];
+	return true;
+}
+
+//*************************************************************************************************
+// Responses that the real RepRap class generates from the state of the printer. There is no printer, so the status is a short fixed document.
+
+OutputBuffer *RepRap::GetStatusResponse(uint8_t type, ResponseSource source)
+{
+	OutputBuffer *response;
+	if (!OutputBuffer::Allocate(response))
+	{
+		return nullptr;
+	}
+	response->printf("{\"status\":\"I\",\"seq\":%" PRIu32 ",\"statusSeq\":%" PRIu32 ",\"type\":%u,\"upTime\":%" PRIu32 "}",
+						network->GetHttpReplySeq(), ++statusSeq, type, millis()/1000);
+	return response;
+}
+
+// The loopback server always sends the whole status
+OutputBuffer *RepRap::GetStatusDeltaResponse(uint8_t type, uint32_t since)
+{
+	return GetStatusResponse(type, ResponseSource::HTTP);
+}
+
+OutputBuffer *RepRap::GetLegacyStatusResponse(uint8_t type, int seq)
+{
+	return GetStatusResponse(type, ResponseSource::HTTP);
+}
+
+OutputBuffer *RepRap::GetConfigResponse()
+{
+	OutputBuffer *response;
+	if (!OutputBuffer::Allocate(response))
+	{
+		return nullptr;
+	}
+	response->printf("{\"firmwareName\":\"RepRapFirmware\",\"firmwareVersion\":\"%s\",\"boardType\":\"%s\"}", VERSION, platform->GetBoardString());
+	return response;
+}
+
+// This is the same as the firmware's version
+OutputBuffer *RepRap::GetFilesResponse(const char *dir, unsigned int startAt, bool flagsDirs)
+{
+	// Need something to write to...
+	OutputBuffer *response;
+	if (!OutputBuffer::Allocate(response))
+	{
+		return nullptr;
+	}
+
+	FileListGenerator generator;
+	generator.Start(dir, startAt, false, flagsDirs);
+	(void)generator.Generate(response, OutputBuffer::GetBytesLeft(response), true);		// don't write more bytes than we can
+	return response;
+}
+
+// This is the same as the firmware's version
+OutputBuffer *RepRap::GetFilelistResponse(const char *dir, unsigned int startAt)
+{
+	// Need something to write to...
+	OutputBuffer *response;
+	if (!OutputBuffer::Allocate(response))
+	{
+		return nullptr;
+	}
+
+	FileListGenerator generator;
+	generator.Start(dir, startAt, true, false);
+	(void)generator.Generate(response, OutputBuffer::GetBytesLeft(response), true);		// don't write more bytes than we can
+	return response;
+}
+
+// There is no G-code file parser, so this reports only the size and date of the file
+bool RepRap::GetFileInfoResponse(const char *filename, OutputBuffer *&response, bool quitEarly)
+{
+	if (!OutputBuffer::Allocate(response))
+	{
+		return false;
+	}
+
+	String<MaxFilenameLength> filePath;
+	FileInfo info;
+	if (filename != nullptr && filename[0] != 0
+		&& MassStorage::CombineName(filePath.GetRef(), platform->GetGCodeDir(), filename)
+		&& platform->GetMassStorage()->StatFile(filePath.c_str(), info)
+		&& !info.isDirectory)
+	{
+		response->printf("{\"err\":0,\"size\":%" PRIu32 ",\"lastModified\":%" PRIu32 ",\"fileName\":", info.size, (uint32_t)info.lastModified);
+		response->EncodeString(filePath.c_str(), false);
+		response->cat('}');
+	}
+	else
+	{
+		response->copy("{\"err\":1}");
+	}
+	return true;
+}
+
+//*************************************************************************************************
+// The server
+
+namespace
+{
+	std::atomic<bool> stopServer(false);
+
+	void Interrupted(int)
+	{
+		stopServer = true;
+	}
+
+	// Run the network task, and the part of the GCodes task that replies to G-codes from HTTP clients, until stopServer is set
+	void RunServer(Network& network, GCodes& gcodes)
+	{
+		while (!stopServer)
+		{
+			network.Spin(true);
+
+			std::string gcode;
+			while (gcodes.GetHTTPInput()->Get(gcode))
+			{
+				const std::string reply = "Received " + gcode + "\n";
+				network.HandleHttpGCodeReply(reply.c_str());
+			}
+			sched_yield();
+		}
+	}
+
+	//*************************************************************************************************
+	// The self-test client
+
+	struct Response
+	{
+		int status = 0;
+		std::map<std::string, std::string> headers;		// the names are in lower case
+		std::string body;
+
+		std::string Header(const char *name) const
+		{
+			const auto it = headers.find(name);
+			return (it == headers.end()) ? std::string() : it->second;
+		}
+	};
+
+	// A client connection. Responses are read with a timeout, so that a server that doesn't reply makes the test fail instead of hanging.
+	class Client
+	{
+	public:
+		Client(Port port)
+		{
+			fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			const timeval timeout = { 5, 0 };
+			(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+			sockaddr_in addr;
+			memset(&addr, 0, sizeof(addr));
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			addr.sin_port = htons(port);
+			if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+			{
+				close(fd);
+				fd = -1;
+			}
+		}
+
+		~Client()
+		{
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+		}
+
+		bool Send(const std::string& data)
+		{
+			size_t done = 0;
+			while (fd >= 0 && done < data.size())
+			{
+				const ssize_t n = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+				if (n <= 0)
+				{
+					return false;
+				}
+				done += (size_t)n;
+			}
+			return fd >= 0;
+		}
+
+		// Read one response. Anything after it stays in 'pending' for the next one.
+		bool Receive(Response& r)
+		{
+			r = Response();
+			size_t headerEnd;
+			while ((headerEnd = pending.find("\r\n\r\n")) == std::string::npos)
+			{
+				if (!Fill())
+				{
+					return false;
+				}
+			}
+
+			// Status line and headers
+			const std::string headers = pending.substr(0, headerEnd + 2);
+			pending.erase(0, headerEnd + 4);
+			if (sscanf(headers.c_str(), "HTTP/1.%*d %d", &r.status) != 1)
+			{
+				return false;
+			}
+			for (size_t lineStart = headers.find("\r\n") + 2; lineStart < headers.size(); )
+			{
+				const size_t lineEnd = headers.find("\r\n", lineStart);
+				const std::string line = headers.substr(lineStart, lineEnd - lineStart);
+				const size_t colon = line.find(':');
+				if (colon != std::string::npos)
+				{
+					std::string name = line.substr(0, colon);
+					std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)tolower(c); });
+					r.headers[name] = line.substr(line.find_first_not_of(' ', colon + 1));
+				}
+				lineStart = lineEnd + 2;
+			}
+
+			// Body
+			if (r.Header("transfer-encoding") == "chunked")
+			{
+				for (;;)
+				{
+					size_t lineEnd;
+					while ((lineEnd = pending.find("\r\n")) == std::string::npos)
+					{
+						if (!Fill())
+						{
+							return false;
+						}
+					}
+					const size_t chunkLength = strtoul(pending.c_str(), nullptr, 16);
+					while (pending.size() < lineEnd + 2 + chunkLength + 2)
+					{
+						if (!Fill())
+						{
+							return false;
+						}
+					}
+					r.body += pending.substr(lineEnd + 2, chunkLength);
+					pending.erase(0, lineEnd + 2 + chunkLength + 2);
+					if (chunkLength == 0)
+					{
+						return true;
+					}
+				}
+			}
+
+			if (!r.Header("content-length").empty())
+			{
+				const size_t length = strtoul(r.Header("content-length").c_str(), nullptr, 10);
+				while (pending.size() < length)
+				{
+					if (!Fill())
+					{
+						return false;
+					}
+				}
+				r.body = pending.substr(0, length);
+				pending.erase(0, length);
+				return true;
+			}
+
+			// No length, so the body ends when the server closes the connection
+			while (Fill()) { }
+			r.body = pending;
+			pending.clear();
+			return true;
+		}
+
+		bool IsConnected() const { return fd >= 0; }
+
+	private:
+		bool Fill()
+		{
+			char buf[4096];
+			const ssize_t n = (fd >= 0) ? recv(fd, buf, sizeof(buf), 0) : -1;
+			if (n <= 0)
+			{
+				return false;
+			}
+			pending.append(buf, (size_t)n);
+			return true;
+		}
+
+		int fd;
+		std::string pending;
+	};
+
+	Port testPort;
+	std::atomic<unsigned int> failures(0);
+
+	void Check(bool ok, const char *what, const std::string& detail = std::string())
+	{
+		if (ok)
+		{
+			printf("ok   %s\n", what);
+		}
+		else
+		{
+			printf("FAIL %s%s%s\n", what, (detail.empty()) ? "" : ": ", detail.substr(0, 200).c_str());
+			++failures;
+		}
+		fflush(stdout);
+	}
+
+	// Make a request on a new connection and return the response
+	Response Get(const std::string& uri, const std::string& extraHeaders = std::string(), const char *version = "HTTP/1.1")
+	{
+		Client client(testPort);
+		Response r;
+		if (!client.Send("GET " + uri + " " + version + "\r\nHost: 127.0.0.1\r\nConnection: close\r\n" + extraHeaders + "\r\n") || !client.Receive(r))
+		{
+			r.status = 0;
+		}
+		return r;
+	}
+
+	Response Upload(Client& client, const std::string& name, const std::string& data, uint32_t crc)
+	{
+		char uri[200];
+		snprintf(uri, sizeof(uri), "/rr_upload?name=%s&crc32=%08" PRIx32, name.c_str(), crc);
+		Response r;
+		if (!client.Send(std::string("POST ") + uri + " HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: " + std::to_string(data.size())
+						+ "\r\nContent-Type: application/octet-stream\r\n\r\n")
+			|| !client.Send(data)
+			|| !client.Receive(r))
+		{
+			r.status = 0;
+		}
+		return r;
+	}
+
+	std::string MakeData(size_t length, unsigned int seed)
+	{
+		std::string data(length, 0);
+		uint32_t x = seed * 2654435761u + 1;
+		for (char& c : data)
+		{
+			x = x * 1103515245u + 12345u;
+			c = (char)(x >> 16);
+		}
+		return data;
+	}
+
+	uint32_t Crc(const std::string& data)
+	{
+		CRC32 crc;
+		crc.Update(data.data(), data.size());
+		return crc.Get();
+	}
+
+	std::string ReadHostFile(const std::string& path)
+	{
+		std::ifstream f(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	}
+
+	void WriteHostFile(const std::string& path, const std::string& data)
+	{
+		std::ofstream(path, std::ios::binary) << data;
+	}
+
+	void RunTests(const std::string& card)
+	{
+		const std::string index = "<html><body>index</body></html>\n";
+		const std::string gzipped = MakeData(3000, 1);
+		const std::string big = MakeData(300000, 2);
+		WriteHostFile(card + "/www/index.html", index);
+		WriteHostFile(card + "/www/js/app.js.gz", gzipped);
+		WriteHostFile(card + "/www/big.bin", big);
+
+		// Web files
+		Response r = Get("/");
+		Check(r.status == 200 && r.body == index && r.Header("content-type") == "text/html" && !r.Header("etag").empty(), "GET / returns the index page");
+		const std::string etag = r.Header("etag");
+		r = Get("/index.html", "If-None-Match: " + etag + "\r\n");
+		Check(r.status == 304 && r.body.empty(), "GET with a matching ETag returns 304", std::to_string(r.status));
+		r = Get("/js/app.js");
+		Check(r.status == 200 && r.body == gzipped && r.Header("content-encoding") == "gzip" && r.Header("content-type") == "application/javascript",
+				"GET of a file with a gzipped version sends that version");
+		r = Get("/big.bin");
+		Check(r.status == 200 && r.body == big, "GET of a file bigger than all the network buffers", std::to_string(r.body.size()));
+		r = Get("/missing.html");
+		Check(r.status == 404, "GET of a missing page returns 404", std::to_string(r.status));
+
+		// Logging in
+		r = Get("/rr_status?type=2");
+		Check(r.status == 401, "rr_status before logging in is refused", std::to_string(r.status));
+		r = Get("/rr_connect?password=wrong");
+		Check(r.status == 200 && r.body == "{\"err\":1}", "rr_connect with the wrong password", r.body);
+		r = Get("/rr_connect?password=reprap&time=2026-10-19T10:00:00");
+		Check(r.status == 200 && r.body.compare(0, 8, "{\"err\":0") == 0 && r.body.find("\"boardType\":\"loopback\"") != std::string::npos,
+				"rr_connect with the right password", r.body);
+
+		// Status, G-codes and replies
+		r = Get("/rr_status?type=2");
+		Check(r.status == 200 && r.body.compare(0, 10, "{\"status\":") == 0 && r.Header("content-type") == "application/json", "rr_status", r.body);
+		r = Get("/rr_config");
+		Check(r.status == 200 && r.body.find("\"firmwareVersion\":\"" VERSION "\"") != std::string::npos, "rr_config", r.body);
+		r = Get("/rr_gcode?gcode=M115");
+		Check(r.status == 200 && r.body.compare(0, 8, "{\"buff\":") == 0, "rr_gcode", r.body);
+		std::string reply;
+		for (unsigned int i = 0; i < 50 && reply.empty(); ++i)
+		{
+			r = Get("/rr_reply");
+			reply = r.body;
+			if (reply.empty())
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+		Check(reply == "Received M115\n", "rr_reply returns the reply to the G-code", reply);
+
+		// Uploads and downloads
+		const std::string part = MakeData(200000, 3);
+		{
+			Client client(testPort);
+			r = Upload(client, "0:/gcodes/part.gcode", part, Crc(part));
+		}
+		Check(r.status == 200 && r.body == "{\"err\":0}", "rr_upload with the right CRC", r.body);
+		Check(ReadHostFile(card + "/gcodes/part.gcode") == part && !std::filesystem::exists(card + "/gcodes/part.gcode" UPLOAD_EXTENSION),
+				"the uploaded file is on the card");
+		{
+			Client client(testPort);
+			r = Upload(client, "0:/gcodes/bad.gcode", part, Crc(part) ^ 1);
+		}
+		Check(r.status == 200 && r.body == "{\"err\":1}", "rr_upload with the wrong CRC", r.body);
+		Check(!std::filesystem::exists(card + "/gcodes/bad.gcode") && !std::filesystem::exists(card + "/gcodes/bad.gcode" UPLOAD_EXTENSION),
+				"the file with the wrong CRC is deleted");
+		r = Get("/rr_download?name=0:/gcodes/part.gcode");
+		Check(r.status == 200 && r.body == part, "rr_download");
+		r = Get("/rr_fileinfo?name=part.gcode");
+		Check(r.status == 200 && r.body.find("\"size\":200000") != std::string::npos, "rr_fileinfo", r.body);
+
+		// File lists
+		for (unsigned int i = 0; i < 30; ++i)
+		{
+			WriteHostFile(card + "/gcodes/file" + std::to_string(100 + i) + ".gcode", "G28\n");
+		}
+		r = Get("/rr_filelist?dir=0:/gcodes");
+		Check(r.status == 200 && r.Header("transfer-encoding") == "chunked" && r.body.find("\"name\":\"part.gcode\"") != std::string::npos
+				&& r.body.find("\"name\":\"file129.gcode\"") != std::string::npos && r.body.back() == '}',
+				"rr_filelist over HTTP/1.1 is sent in chunks", r.body);
+		r = Get("/rr_files?dir=0:/gcodes", std::string(), "HTTP/1.0");
+		Check(r.status == 200 && r.Header("transfer-encoding").empty() && r.body.find("\"part.gcode\"") != std::string::npos, "rr_files over HTTP/1.0", r.body);
+
+		// Several requests sent together on one persistent connection
+		{
+			Client client(testPort);
+			const std::string request = "GET /rr_status?type=1 HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+			Response r1, r2, r3;
+			const bool ok = client.Send(request + request + "GET /index.html HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n")
+							&& client.Receive(r1) && client.Receive(r2) && client.Receive(r3);
+			Check(ok && r1.status == 200 && r2.status == 200 && r3.body == index && r1.Header("connection") == "keep-alive",
+					"pipelined requests on a persistent connection");
+		}
+
+		r = Get("/rr_delete?name=0:/gcodes/part.gcode");
+		Check(r.status == 200 && r.body == "{\"err\":0}" && !std::filesystem::exists(card + "/gcodes/part.gcode"), "rr_delete", r.body);
+
+		// Poll the status from several connections while a long upload is written to a slow card
+		FileStore::cardBusyNanosPerByte = 1000;						// 1MB/s
+		const std::string large = MakeData(2000000, 4);
+		std::atomic<bool> uploading(true);
+		std::atomic<unsigned int> statusRequests(0), statusFailures(0);
+		std::atomic<uint32_t> longestStatusMillis(0);
+		std::vector<std::thread> pollers;
+		for (unsigned int i = 0; i < NumHttpResponders - 1; ++i)
+		{
+			pollers.emplace_back([&]()
+			{
+				Client client(testPort);
+				while (uploading)
+				{
+					const uint32_t start = millis();
+					Response status;
+					if (!client.Send("GET /rr_status?type=3 HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n") || !client.Receive(status) || status.status != 200)
+					{
+						++statusFailures;
+						return;
+					}
+					const uint32_t taken = millis() - start;
+					uint32_t longest = longestStatusMillis;
+					while (taken > longest && !longestStatusMillis.compare_exchange_weak(longest, taken)) { }
+					++statusRequests;
+					std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				}
+			});
+		}
+		const uint32_t uploadStart = millis();
+		{
+			Client client(testPort);
+			r = Upload(client, "0:/gcodes/large.gcode", large, Crc(large));
+		}
+		const uint32_t uploadMillis = millis() - uploadStart;
+		uploading = false;
+		for (std::thread& t : pollers)
+		{
+			t.join();
+		}
+		FileStore::cardBusyNanosPerByte = 0;
+		Check(r.status == 200 && r.body == "{\"err\":0}" && ReadHostFile(card + "/gcodes/large.gcode") == large, "rr_upload to a slow card", r.body);
+		Check(statusFailures == 0 && statusRequests != 0, "rr_status from other connections during the upload");
+		printf("     %u status requests during a %" PRIu32 "ms upload, longest %" PRIu32 "ms\n",
+				statusRequests.load(), uploadMillis, longestStatusMillis.load());
+	}
+
+	int SelfTest(GCodes& gcodes)
+	{
+		char cardTemplate[] = "/tmp/LoopbackServerXXXXXX";
+		if (mkdtemp(cardTemplate) == nullptr)
+		{
+			printf("Failed to make the card directory\n");
+			return 1;
+		}
+		const std::string card = cardTemplate;
+		for (const char *dir : { "/www", "/www/js", "/gcodes" })
+		{
+			mkdir((card + dir).c_str(), 0755);
+		}
+
+		MassStorage massStorage(card.c_str());
+		Platform platform(&massStorage);
+		Network network(platform);
+		reprap.Init(&platform, &network, &gcodes);
+		reprap.SetPassword("reprap");
+
+		String<100> reply;
+		network.Init();
+		(void)network.EnableProtocol(0, HttpProtocol, testPort, -1, reply.GetRef());
+		(void)network.EnableInterface(0, 1, reply.GetRef(), reply.GetRef());
+		network.Activate();
+
+		std::thread client([&]() { RunTests(card); stopServer = true; });
+		RunServer(network, gcodes);
+		client.join();
+
+		// Disabling the interface terminates every connection and releases the G-code replies and the status that is pushed to clients
+		(void)network.EnableInterface(0, 0, reply.GetRef(), reply.GetRef());
+		Check(NetworkBuffer::CountFree() == NetworkBufferCount, "every network buffer is free", std::to_string(NetworkBuffer::CountFree()));
+		Check(OutputBuffer::GetFreeBuffers() == OUTPUT_BUFFER_COUNT, "every output buffer is free", std::to_string(OutputBuffer::GetFreeBuffers()));
+		Check(FileStore::filesOpen == 0, "every file is closed", std::to_string(FileStore::filesOpen));
+		Check((platform.GetErrorCodeBits() & (uint32_t)ErrorCode::OutputStackOverflow) == 0, "no output stack overflowed");
+
+		std::filesystem::remove_all(card);
+		printf("%s\n", (failures == 0) ? "All tests passed" : "Some tests failed");
+		return (failures == 0) ? 0 : 1;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	Port port = 8080;
+	const char *password = nullptr;
+	bool selfTest = false;
+	bool debug = false;
+	int opt;
+	while ((opt = getopt(argc, argv, "p:w:b:dt")) != -1)
+	{
+		switch (opt)
+		{
+		case 'p':	port = (Port)strtoul(optarg, nullptr, 10); break;
+		case 'w':	password = optarg; break;
+		case 'b':	FileStore::cardBusyNanosPerByte = strtoull(optarg, nullptr, 10); break;
+		case 'd':	debug = true; break;
+		case 't':	selfTest = true; break;
+		default:
+			fprintf(stderr, "Usage: %s [-p port] [-w password] [-b card_busy_ns_per_byte] [-d] card_directory\n"
+							"       %s -t [-p port]\n", argv[0], argv[0]);
+			return 1;
+		}
+	}
+
+	OutputBuffer::Init();
+	reprap.SetDebug(moduleWebserver, debug);
+	reprap.SetDebug(moduleNetwork, debug);
+	GCodes gcodes;
+
+	if (selfTest)
+	{
+		testPort = port;
+		return SelfTest(gcodes);
+	}
+
+	if (optind >= argc)
+	{
+		fprintf(stderr, "No card directory given\n");
+		return 1;
+	}
+
+	MassStorage massStorage(argv[optind]);
+	Platform platform(&massStorage);
+	Network network(platform);
+	reprap.Init(&platform, &network, &gcodes);
+	reprap.SetPassword(password);
+
+	String<100> reply;
+	network.Init();
+	(void)network.EnableProtocol(0, HttpProtocol, port, -1, reply.GetRef());
+	(void)network.EnableInterface(0, 1, reply.GetRef(), reply.GetRef());
+	network.Activate();
+
+	signal(SIGINT, Interrupted);
+	signal(SIGTERM, Interrupted);
+	RunServer(network, gcodes);
+	network.Exit();
+	return 0;
+}
+
+// End
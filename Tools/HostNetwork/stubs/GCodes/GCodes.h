@@ -0,0 +1,65 @@
+/*
+ * GCodes.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for src/GCodes/GCodes.h, for the loopback build in Tools/HostNetwork. The G-codes that HTTP clients send with rr_gcode are queued here,
+ *  and the loopback server takes them from the queue and replies to them through Network::HandleHttpGCodeReply as the GCodes task does.
+ */
+
+#ifndef TOOLS_HOSTNETWORK_STUBS_GCODES_GCODES_H_
+#define TOOLS_HOSTNETWORK_STUBS_GCODES_GCODES_H_
+
+#include "RepRapFirmware.h"
+#include "MessageType.h"
+
+#include <deque>
+#include <string>
+
+// Input from a network client
+class NetworkGCodeInput
+{
+public:
+	static constexpr size_t BufferSize = 512;		// the size of the buffer in the firmware
+
+	void Put(MessageType mtype, const char *buf)
+	{
+		const size_t len = strlen(buf) + 1;
+		if (len <= BufferSpaceLeft())
+		{
+			queued.emplace_back(buf);
+			bytesQueued += len;
+		}
+	}
+
+	size_t BufferSpaceLeft() const { return BufferSize - bytesQueued; }
+
+	// Take the next G-code from the queue, returning false if it is empty
+	bool Get(std::string& gcode)
+	{
+		if (queued.empty())
+		{
+			return false;
+		}
+		gcode = queued.front();
+		queued.pop_front();
+		bytesQueued -= gcode.size() + 1;
+		return true;
+	}
+
+private:
+	std::deque<std::string> queued;
+	size_t bytesQueued = 0;
+};
+
+class GCodes
+{
+public:
+	NetworkGCodeInput *GetHTTPInput() { return &httpInput; }
+
+private:
+	NetworkGCodeInput httpInput;
+};
+
+#endif /* TOOLS_HOSTNETWORK_STUBS_GCODES_GCODES_H_ */
@@ -0,0 +1,32 @@
+/*
+ * IP4String.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for IP4String.h in RRFLibraries, for the loopback build in Tools/HostNetwork.
+ */
+
+#ifndef TOOLS_HOSTNETWORK_STUBS_GENERAL_IP4STRING_H_
+#define TOOLS_HOSTNETWORK_STUBS_GENERAL_IP4STRING_H_
+
+#include "IPAddress.h"
+
+#include <cstdio>
+
+// Class to convert an IPv4 address to a string in dotted decimal format
+class IP4String
+{
+public:
+	IP4String(IPAddress ip)
+	{
+		snprintf(buf, sizeof(buf), "%u.%u.%u.%u", ip.GetQuad(0), ip.GetQuad(1), ip.GetQuad(2), ip.GetQuad(3));
+	}
+
+	const char *c_str() const { return buf; }
+
+private:
+	char buf[16];
+};
+
+#endif /* TOOLS_HOSTNETWORK_STUBS_GENERAL_IP4STRING_H_ */
@@ -0,0 +1,39 @@
+/*
+ * IPAddress.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for the IPAddress class in RRFLibraries, for the loopback build in Tools/HostNetwork. Like the real one, it holds an IPv4 address
+ *  with the first byte of the address in the least significant byte.
+ */
+
+#ifndef TOOLS_HOSTNETWORK_STUBS_GENERAL_IPADDRESS_H_
+#define TOOLS_HOSTNETWORK_STUBS_GENERAL_IPADDRESS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+class IPAddress
+{
+public:
+	constexpr IPAddress() : v4LittleEndian(0) { }
+	explicit IPAddress(const uint8_t ip[4]) { SetV4(ip); }
+
+	bool operator==(const IPAddress& other) const { return v4LittleEndian == other.v4LittleEndian; }
+	bool operator!=(const IPAddress& other) const { return v4LittleEndian != other.v4LittleEndian; }
+
+	bool IsV4() const { return true; }
+	uint32_t GetV4LittleEndian() const { return v4LittleEndian; }
+	uint8_t GetQuad(size_t n) const { return (uint8_t)(v4LittleEndian >> (8 * n)); }
+
+	void SetV4(const uint8_t ip[4])
+	{
+		v4LittleEndian = (uint32_t)ip[0] | ((uint32_t)ip[1] << 8) | ((uint32_t)ip[2] << 16) | ((uint32_t)ip[3] << 24);
+	}
+
+private:
+	uint32_t v4LittleEndian;
+};
+
+#endif /* TOOLS_HOSTNETWORK_STUBS_GENERAL_IPADDRESS_H_ */
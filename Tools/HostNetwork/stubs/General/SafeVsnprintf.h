@@ -0,0 +1,32 @@
+/*
+ * SafeVsnprintf.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for SafeVsnprintf.h in RRFLibraries, for the loopback build in Tools/HostNetwork. The host library functions are safe to use here.
+ */
+
+#ifndef TOOLS_HOSTNETWORK_STUBS_GENERAL_SAFEVSNPRINTF_H_
+#define TOOLS_HOSTNETWORK_STUBS_GENERAL_SAFEVSNPRINTF_H_
+
+#include <cstdarg>
+#include <cstdio>
+
+inline int SafeVsnprintf(char *buffer, size_t maxLen, const char *format, va_list args)
+{
+	return vsnprintf(buffer, maxLen, format, args);
+}
+
+inline int SafeSnprintf(char *buffer, size_t maxLen, const char *format, ...) __attribute__ ((format (printf, 3, 4)));
+
+inline int SafeSnprintf(char *buffer, size_t maxLen, const char *format, ...)
+{
+	va_list vargs;
+	va_start(vargs, format);
+	const int ret = vsnprintf(buffer, maxLen, format, vargs);
+	va_end(vargs);
+	return ret;
+}
+
+#endif /* TOOLS_HOSTNETWORK_STUBS_GENERAL_SAFEVSNPRINTF_H_ */
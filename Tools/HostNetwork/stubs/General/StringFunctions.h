@@ -0,0 +1,55 @@
+/*
+ * StringFunctions.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for StringFunctions.h in RRFLibraries, for the loopback build in Tools/HostNetwork. It provides only the functions that the network code uses.
+ */
+
+#ifndef TOOLS_HOSTNETWORK_STUBS_GENERAL_STRINGFUNCTIONS_H_
+#define TOOLS_HOSTNETWORK_STUBS_GENERAL_STRINGFUNCTIONS_H_
+
+#include <cctype>
+#include <cstring>
+
+// Compare two strings ignoring case, returning true if they are equal. A null string is not equal to anything.
+inline bool StringEqualsIgnoreCase(const char *s1, const char *s2)
+{
+	if (s1 == nullptr || s2 == nullptr)
+	{
+		return false;
+	}
+	while (*s1 != 0 && *s2 != 0)
+	{
+		if (tolower((unsigned char)*s1++) != tolower((unsigned char)*s2++))
+		{
+			return false;
+		}
+	}
+	return *s1 == *s2;
+}
+
+inline bool StringStartsWith(const char *string, const char *starting)
+{
+	return strncmp(string, starting, strlen(starting)) == 0;
+}
+
+inline bool StringEndsWithIgnoreCase(const char *string, const char *ending)
+{
+	const size_t j = strlen(string);
+	const size_t k = strlen(ending);
+	return k <= j && StringEqualsIgnoreCase(string + j - k, ending);
+}
+
+// Copy a string, truncating it if necessary so that the result is always null-terminated
+inline void SafeStrncpy(char *dst, const char *src, size_t length)
+{
+	if (length != 0)
+	{
+		strncpy(dst, src, length);
+		dst[length - 1] = 0;
+	}
+}
+
+#endif /* TOOLS_HOSTNETWORK_STUBS_GENERAL_STRINGFUNCTIONS_H_ */
@@ -0,0 +1,110 @@
+/*
+ * StringRef.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for StringRef.h in RRFLibraries, for the loopback build in Tools/HostNetwork. It provides only the functions that the network code uses.
+ *  As in the real one, the functions that add to a string truncate it if it doesn't fit and return true if they did.
+ */
+
+#ifndef TOOLS_HOSTNETWORK_STUBS_GENERAL_STRINGREF_H_
+#define TOOLS_HOSTNETWORK_STUBS_GENERAL_STRINGREF_H_
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+// A reference to a fixed-length buffer that holds a null-terminated string
+class StringRef
+{
+public:
+	StringRef(char *pp, size_t pl) : p(pp), len(pl) { }
+
+	size_t Capacity() const { return len - 1; }
+	size_t strlen() const { return ::strlen(p); }
+	bool IsEmpty() const { return p[0] == 0; }
+	const char *c_str() const { return p; }
+	char *Pointer() const { return p; }
+	char& operator[](size_t index) const { return p[index]; }
+
+	void Clear() const { p[0] = 0; }
+	bool copy(const char *src) const { Clear(); return cat(src); }
+	bool cat(const char *src) const { return catn(src, ::strlen(src)); }
+	bool cat(char c) const { return catn(&c, 1); }
+
+	bool catn(const char *src, size_t n) const
+	{
+		const size_t used = strlen();
+		const size_t toCopy = (n < len - 1 - used) ? n : len - 1 - used;
+		memcpy(p + used, src, toCopy);
+		p[used + toCopy] = 0;
+		return toCopy != n;
+	}
+
+	int printf(const char *fmt, ...) const __attribute__ ((format (printf, 2, 3)))
+	{
+		va_list vargs;
+		va_start(vargs, fmt);
+		const int ret = vsnprintf(p, len, fmt, vargs);
+		va_end(vargs);
+		return ret;
+	}
+
+	int catf(const char *fmt, ...) const __attribute__ ((format (printf, 2, 3)))
+	{
+		const size_t used = strlen();
+		va_list vargs;
+		va_start(vargs, fmt);
+		const int ret = vsnprintf(p + used, len - used, fmt, vargs);
+		va_end(vargs);
+		return ret;
+	}
+
+	// As catf, but start a new line first if the string isn't empty
+	int lcatf(const char *fmt, ...) const __attribute__ ((format (printf, 2, 3)))
+	{
+		if (!IsEmpty())
+		{
+			cat('\n');
+		}
+		const size_t used = strlen();
+		va_list vargs;
+		va_start(vargs, fmt);
+		const int ret = vsnprintf(p + used, len - used, fmt, vargs);
+		va_end(vargs);
+		return ret;
+	}
+
+private:
+	char *p;
+	size_t len;
+};
+
+// A string with its own storage
+template<size_t Len> class String
+{
+public:
+	String() { storage[0] = 0; }
+
+	StringRef GetRef() { return StringRef(storage, Len + 1); }
+	const char *c_str() const { return storage; }
+	size_t strlen() const { return ::strlen(storage); }
+	bool IsEmpty() const { return storage[0] == 0; }
+	char& operator[](size_t index) { return storage[index]; }
+
+	void Clear() { storage[0] = 0; }
+	bool copy(const char *src) { return GetRef().copy(src); }
+	bool cat(const char *src) { return GetRef().cat(src); }
+	bool cat(char c) { return GetRef().cat(c); }
+	bool catn(const char *src, size_t n) { return GetRef().catn(src, n); }
+
+	template<typename... Args> int printf(const char *fmt, Args... args) { return snprintf(storage, Len + 1, fmt, args...); }
+	template<typename... Args> int catf(const char *fmt, Args... args) { return GetRef().catf(fmt, args...); }
+
+private:
+	char storage[Len + 1];
+};
+
+#endif /* TOOLS_HOSTNETWORK_STUBS_GENERAL_STRINGREF_H_ */
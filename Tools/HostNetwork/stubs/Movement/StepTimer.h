@@ -0,0 +1,29 @@
+/*
+ * StepTimer.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for src/Movement/StepTimer.h, for the loopback build in Tools/HostNetwork. Network::Spin uses the step clock only to time its loop,
+ *  so here it counts microseconds.
+ */
+
+#ifndef TOOLS_HOSTNETWORK_STUBS_MOVEMENT_STEPTIMER_H_
+#define TOOLS_HOSTNETWORK_STUBS_MOVEMENT_STEPTIMER_H_
+
+#include <chrono>
+#include <cstdint>
+
+class StepTimer
+{
+public:
+	static constexpr uint32_t StepClockRate = 1000000;
+	static constexpr float StepClocksToMillis = 1000.0/(float)StepClockRate;
+
+	static uint32_t GetInterruptClocks()
+	{
+		return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+};
+
+#endif /* TOOLS_HOSTNETWORK_STUBS_MOVEMENT_STEPTIMER_H_ */
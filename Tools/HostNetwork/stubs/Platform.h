@@ -0,0 +1,59 @@
+/*
+ * Platform.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for src/Platform.h, for the loopback build in Tools/HostNetwork. Messages go to the standard output, and files are opened through the host
+ *  MassStorage. It declares only the functions that the network code calls, and LoopbackServer.cpp defines those that aren't inline.
+ *  src/OutputMemory.cpp includes "Platform.h" from its own directory, so LoopbackServer.cpp includes this file first. It uses the same include guard
+ *  as the real one, which is then skipped.
+ */
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include "RepRapFirmware.h"
+#include "MessageType.h"
+#include "Storage/MassStorage.h"
+
+// Enumeration of error condition bits
+enum class ErrorCode : uint32_t
+{
+	BadTemp = 1u << 0,
+	BadMove = 1u << 1,
+	OutputStarvation = 1u << 2,
+	OutputStackOverflow = 1u << 3,
+	HsmciTimeout = 1u << 4
+};
+
+class Platform
+{
+public:
+	Platform(MassStorage *ms) : massStorage(ms), realTime(0), errorCodeBits(0) { }
+
+	void Message(MessageType type, const char *message) const;
+	void MessageF(MessageType type, const char *fmt, ...) const __attribute__ ((format (printf, 3, 4)));
+	void LogError(ErrorCode e) { errorCodeBits |= (uint32_t)e; }
+	uint32_t GetErrorCodeBits() const { return errorCodeBits; }
+
+	const char* GetBoardString() const { return "loopback"; }
+	const uint8_t *GetDefaultMacAddress() const { return DefaultMacAddress; }
+	bool IsDateTimeSet() const { return realTime != 0; }
+	bool SetDateTime(time_t time) { realTime = time; return true; }
+
+	MassStorage* GetMassStorage() const { return massStorage; }
+	FileStore* OpenFile(const char* folder, const char* fileName, OpenMode mode, uint32_t preAllocSize = 0) const;
+	bool Delete(const char* folder, const char *filename) const;
+	const char* GetWebDir() const { return WEB_DIR; }
+	const char* GetGCodeDir() const { return GCODE_DIR; }
+
+private:
+	static constexpr uint8_t DefaultMacAddress[6] = { 0xBE, 0xEF, 0xDE, 0xAD, 0xFE, 0xED };
+
+	MassStorage *massStorage;
+	time_t realTime;
+	uint32_t errorCodeBits;
+};
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * RTOSIface.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for RTOSIface.h in CoreNG, for the loopback build in Tools/HostNetwork. The loopback server runs the network code in a single thread,
+ *  calling Network::Spin as the network task does, so the mutexes and critical sections have nothing to do. The mutexes count how often they are
+ *  taken so that the server can check that every MutexLocker released its mutex.
+ */
+
+#ifndef TOOLS_HOSTNETWORK_STUBS_RTOSIFACE_RTOSIFACE_H_
+#define TOOLS_HOSTNETWORK_STUBS_RTOSIFACE_RTOSIFACE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+class Mutex
+{
+public:
+	Mutex() : name(nullptr), count(0) { }
+
+	void Create(const char *pName) { name = pName; }
+	bool Take() { ++count; return true; }
+	bool Release() { --count; return true; }
+	bool IsHeld() const { return count != 0; }
+	const char *GetName() const { return name; }
+
+private:
+	const char *name;
+	unsigned int count;
+};
+
+class MutexLocker
+{
+public:
+	MutexLocker(Mutex& m) : handle(&m) { m.Take(); }
+	MutexLocker(Mutex *m) : handle(m) { if (m != nullptr) { m->Take(); } }
+	~MutexLocker() { if (handle != nullptr) { handle->Release(); } }
+
+	MutexLocker(const MutexLocker&) = delete;
+	MutexLocker& operator=(const MutexLocker&) = delete;
+
+private:
+	Mutex *handle;
+};
+
+class TaskCriticalSectionLocker
+{
+public:
+	TaskCriticalSectionLocker() { }
+};
+
+namespace RTOSIface
+{
+	inline void Yield() { }
+}
+
+#endif /* TOOLS_HOSTNETWORK_STUBS_RTOSIFACE_RTOSIFACE_H_ */
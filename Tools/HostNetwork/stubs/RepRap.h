@@ -0,0 +1,62 @@
+/*
+ * RepRap.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for src/RepRap.h, for the loopback build in Tools/HostNetwork. It owns the Platform, Network and GCodes objects and generates the responses
+ *  that HttpResponder asks for. The status responses are short fixed documents with a sequence number, because the loopback server has no printer to
+ *  report on, but the file lists use the real FileListGenerator. LoopbackServer.cpp defines the functions that aren't inline.
+ *  src/OutputMemory.cpp includes "RepRap.h" from its own directory, so LoopbackServer.cpp includes this file first. It uses the same include guard as
+ *  the real one, which is then skipped.
+ */
+
+#ifndef REPRAP_H
+#define REPRAP_H
+
+#include "RepRapFirmware.h"
+#include "Platform.h"
+#include "RTOSIface/RTOSIface.h"
+
+enum class ResponseSource
+{
+	HTTP,
+	AUX,
+	Generic
+};
+
+class RepRap
+{
+public:
+	RepRap() : platform(nullptr), network(nullptr), gCodes(nullptr), debug(0), password(nullptr), statusSeq(0) { }
+
+	void Init(Platform *p, Network *n, GCodes *g) { platform = p; network = n; gCodes = g; }
+	void SetDebug(Module m, bool enable) { debug = (enable) ? debug | (1u << m) : debug & ~(1u << m); }
+	void SetPassword(const char *pw) { password = pw; }
+
+	bool Debug(Module module) const { return (debug & (1u << module)) != 0; }
+	bool NoPasswordSet() const { return password == nullptr; }
+	bool CheckPassword(const char* pw) const { return password == nullptr || strcmp(pw, password) == 0; }
+
+	Platform& GetPlatform() const { return *platform; }
+	Network& GetNetwork() const { return *network; }
+	GCodes& GetGCodes() const { return *gCodes; }
+
+	OutputBuffer *GetStatusResponse(uint8_t type, ResponseSource source);
+	OutputBuffer *GetStatusDeltaResponse(uint8_t type, uint32_t since);
+	OutputBuffer *GetConfigResponse();
+	OutputBuffer *GetLegacyStatusResponse(uint8_t type, int seq);
+	OutputBuffer *GetFilesResponse(const char* dir, unsigned int startAt, bool flagsDirs);
+	OutputBuffer *GetFilelistResponse(const char* dir, unsigned int startAt);
+	bool GetFileInfoResponse(const char *filename, OutputBuffer *&response, bool quitEarly);
+
+private:
+	Platform *platform;
+	Network *network;
+	GCodes *gCodes;
+	uint32_t debug;
+	const char *password;
+	uint32_t statusSeq;
+};
+
+#endif
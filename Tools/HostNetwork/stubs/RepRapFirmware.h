@@ -0,0 +1,76 @@
+/*
+ * RepRapFirmware.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for src/RepRapFirmware.h, for the loopback build of the network code in Tools/HostNetwork. It selects host networking without FTP,
+ *  Telnet or the object model, and takes the buffer sizes and file names from the real src/Configuration.h for a SAME70 board, so that the
+ *  responders run with the same number of output buffers as on a Duet 3.
+ *  Source files in src itself include "RepRapFirmware.h" from their own directory, so LoopbackServer.cpp includes this file first. It uses the same
+ *  include guard as the real one, which is then skipped.
+ */
+
+#ifndef REPRAPFIRMWARE_H
+#define REPRAPFIRMWARE_H
+
+#define SAME70					1
+#define HAS_HOST_NETWORKING		1
+#define SUPPORT_FTP				0
+#define SUPPORT_TELNET			0
+#define SUPPORT_OBJECT_MODEL	0
+
+#include <cstdint>
+#include <cstddef>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <ctime>
+
+// The eCv annotations, which ecv.h defines as nothing when compiling
+#define pre(_x)
+#define post(_x)
+
+typedef uint16_t PwmFrequency;						// defined by CoreNG, and used in Configuration.h
+
+#include "../../../src/Configuration.h"
+
+#include "General/SafeStrtod.h"
+#include "General/SafeVsnprintf.h"
+#include "General/StringRef.h"
+#include "General/StringFunctions.h"
+
+#define ARRAY_SIZE(_x)	(sizeof(_x)/sizeof(_x[0]))
+#define ARRAY_UPB(_x)	(ARRAY_SIZE(_x) - 1)
+
+template<class X> inline constexpr X min(X _a, X _b) { return (_a < _b) ? _a : _b; }
+template<class X> inline constexpr X max(X _a, X _b) { return (_a > _b) ? _a : _b; }
+
+// Module numbers, used for debug
+enum Module : uint8_t
+{
+	modulePlatform = 0,
+	moduleNetwork = 1,
+	moduleWebserver = 2,
+	numModules = 16
+};
+
+typedef uint32_t FilePosition;
+const FilePosition noFilePosition = 0xFFFFFFFF;
+
+class Network;
+class Platform;
+class GCodes;
+class RepRap;
+class GCodeBuffer;
+class OutputBuffer;
+class FileStore;
+
+extern RepRap reprap;
+
+uint32_t millis();
+extern "C" void debugPrintf(const char* fmt, ...) __attribute__ ((format (printf, 1, 2)));
+
+#endif /* REPRAPFIRMWARE_H */
@@ -0,0 +1,141 @@
+/*
+ * FileStore.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for src/Storage/FileStore.h, for the loopback build in Tools/HostNetwork. Each FileStore is a file on the host, which Platform::OpenFile
+ *  opens under the directory that the loopback server uses as the SD card. Writes go straight to the host file, but the card can be made to look
+ *  busy for a while after each write, so that CanWriteWithoutWaiting returns false as it does while the storage task is writing a queued buffer.
+ *  src/Storage/FileData.h includes "FileStore.h" from its own directory, so LoopbackServer.cpp includes this file first. It uses the same include
+ *  guard as the real one, which is then skipped.
+ */
+
+#ifndef FILESTORE_H
+#define FILESTORE_H
+
+#include "RepRapFirmware.h"
+#include "Storage/CRC32.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+enum class OpenMode : uint8_t
+{
+	read,			// open an existing file for reading
+	write,			// write a file, replacing any existing file of the same name
+	writeWithCrc,	// as write but calculate the CRC as we go
+	append			// append to an existing file, or create a new file if it is not found
+};
+
+class FileStore
+{
+public:
+	FileStore() : fd(-1), openCount(0), calcCrc(false) { }
+
+	bool Open(const char *hostPath, OpenMode mode)
+	{
+		const int flags = (mode == OpenMode::read) ? O_RDONLY
+							: (mode == OpenMode::append) ? O_WRONLY | O_CREAT | O_APPEND
+								: O_WRONLY | O_CREAT | O_TRUNC;
+		fd = open(hostPath, flags | O_CLOEXEC, 0644);
+		if (fd < 0)
+		{
+			return false;
+		}
+		openCount = 1;
+		calcCrc = (mode == OpenMode::writeWithCrc);
+		crc.Reset();
+		++filesOpen;
+		return true;
+	}
+
+	bool Read(char& b) { return Read(&b, 1) == 1; }
+	int Read(char *buf, size_t nBytes) { return (int)read(fd, buf, nBytes); }
+	int ReadSectors(uint32_t *buf, size_t maxBytes) { return Read(reinterpret_cast<char *>(buf), maxBytes); }
+
+	bool Write(char b) { return Write(&b, 1); }
+	bool Write(const uint8_t *s, size_t len) { return Write(reinterpret_cast<const char *>(s), len); }
+
+	bool Write(const char *s, size_t len)
+	{
+		if (calcCrc)
+		{
+			crc.Update(s, len);
+		}
+		busyUntil = Now() + len * cardBusyNanosPerByte;
+		while (len != 0)
+		{
+			const ssize_t written = write(fd, s, len);
+			if (written <= 0 && errno != EINTR)
+			{
+				return false;
+			}
+			if (written > 0)
+			{
+				s += written;
+				len -= (size_t)written;
+			}
+		}
+		return true;
+	}
+
+	bool WriteInBackground(const char *s, size_t len, bool sync) { return Write(s, len); }
+	bool CanWriteInBackground() const { return CanWriteWithoutWaiting(0); }
+
+	// The real FileStore returns false while the storage task is still writing the data it was given before. Here the card is busy for a time
+	// after each write that is proportional to the length written.
+	bool CanWriteWithoutWaiting(size_t len) const { return Now() >= busyUntil; }
+
+	bool Close()
+	{
+		if (openCount == 0 || --openCount != 0)
+		{
+			return openCount != 0;
+		}
+		const bool ok = close(fd) == 0;
+		fd = -1;
+		--filesOpen;
+		delete this;
+		return ok;
+	}
+
+	void Duplicate() { ++openCount; }
+	bool Flush() { return true; }
+	bool Seek(FilePosition pos) { return lseek(fd, (off_t)pos, SEEK_SET) == (off_t)pos; }
+	FilePosition Position() const { return (FilePosition)lseek(fd, 0, SEEK_CUR); }
+
+	FilePosition Length() const
+	{
+		struct stat st;
+		return (fstat(fd, &st) == 0) ? (FilePosition)st.st_size : 0;
+	}
+
+	uint32_t GetCRC32() const { return crc.Get(); }
+
+	static std::atomic<uint64_t> cardBusyNanosPerByte;	// how long the card stays busy for each byte written, which the self-test changes while it runs
+	static int filesOpen;							// how many files are open, so that the loopback server can check that none are left open
+
+private:
+	static uint64_t Now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	int fd;
+	unsigned int openCount;
+	bool calcCrc;
+	CRC32 crc;
+
+	static uint64_t busyUntil;						// there is only one card, so one write makes it busy for every file
+};
+
+inline std::atomic<uint64_t> FileStore::cardBusyNanosPerByte(0);
+inline int FileStore::filesOpen = 0;
+inline uint64_t FileStore::busyUntil = 0;
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * MassStorage.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for src/Storage/MassStorage.h, for the loopback build in Tools/HostNetwork. Volume 0 is a directory on the host, which the loopback
+ *  server sets when it starts. It declares only the functions that the network code and FileListGenerator call, and LoopbackServer.cpp defines them.
+ *  src/Storage/FileListGenerator.cpp includes "MassStorage.h" from its own directory, so LoopbackServer.cpp includes this file first. It uses the same
+ *  include guard as the real one, which is then skipped.
+ */
+
+#ifndef MASSSTORAGE_H
+#define MASSSTORAGE_H
+
+#include "RepRapFirmware.h"
+#include "Storage/FileStore.h"
+
+#include <string>
+#include <vector>
+
+// Info returned by FindFirst/FindNext calls
+struct FileInfo
+{
+	time_t lastModified;
+	uint32_t size;
+	String<MaxFilenameLength> fileName;
+	bool isDirectory;
+};
+
+class MassStorage
+{
+public:
+	static bool CombineName(const StringRef& out, const char* directory, const char* fileName);		// returns false if error i.e. filename too long
+
+	MassStorage(const char *hostRoot) : root(hostRoot), listingNext(0) { }
+
+	FileStore* OpenFile(const char* filePath, OpenMode mode, uint32_t preAllocSize);
+	bool FindFirstVisible(const char *directory, unsigned int startAt, FileInfo &file_info);
+	bool FindNextVisible(FileInfo &file_info);
+	void SuspendListing() { }
+	bool Delete(const char* filePath);
+	bool MakeDirectory(const char *directory);
+	bool Rename(const char *oldFilePath, const char *newFilePath);
+	bool FileExists(const char *filePath) const;
+	bool DirectoryExists(const char *path) const;
+	bool StatFile(const char *filePath, FileInfo& file_info) const;
+	bool SetLastModifiedTime(const char *file, time_t time);
+	bool CheckDriveMounted(const char* path) { return true; }
+	void InvalidateFileInfo(const char *filePath) { }
+
+private:
+	std::string HostPath(const char *filePath) const;
+
+	std::string root;
+	std::vector<FileInfo> listing;					// the directory being listed, read when the listing starts
+	size_t listingNext;
+};
+
+#endif
@@ -0,0 +1,302 @@
+/*
+ * AuxChannelSim.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host simulation of the M598 sync points between the main and secondary motion channels, using the MotionChannelSync class from the firmware.
+ *  Two files of moves and sync points run concurrently, each feeding a small ring of moves that execute in simulated milliseconds, in the same
+ *  way as GCodes::SyncMotionChannels and the two DDA rings. It checks that no channel passes a sync point before the other channel has finished
+ *  all its moves up to that sync point, that a channel that has finished or been stopped doesn't hold the other one up, and that the total time
+ *  is the sum of the longer channel's time between sync points plus a small overhead per sync point. A stopped main channel is also started
+ *  again on a new file without resetting the sync state, as when a new print is started, to check that a stop abandons its sync point.
+ *
+ *  Build:	g++ -std=c++17 -O2 -o AuxChannelSim AuxChannelSim.cpp
+ *  Usage:	AuxChannelSim [iterations]
+ */
+
+#include "../../src/GCodes/MotionChannelSync.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr size_t RingLength = 4;						// number of moves that each simulated DDA ring holds
+	constexpr unsigned int MaxOverheadPerSync = 3;			// ticks lost at each sync point while the channels poll each other
+	constexpr int SyncPoint = -1;							// a command that is a sync point rather than a move of that many ticks
+
+	struct Channel
+	{
+		std::vector<int> commands;							// move durations in ticks, or SyncPoint
+		size_t nextCommand = 0;
+		std::deque<int> ring;								// ticks left for each queued move
+		bool running = true;								// false once the file has ended and its moves have finished, or it was stopped
+		std::vector<unsigned long> arrived;					// tick at which the channel reached each sync point with all moves done
+		std::vector<unsigned long> passed;					// tick at which the channel carried on from each sync point
+		unsigned long finished = 0;
+	};
+
+	unsigned int failures = 0;
+
+	void Fail(const char *scenario, const char *what, size_t syncIndex, unsigned long tick)
+	{
+		if (failures < 20)
+		{
+			printf("FAIL %s: %s at sync point %zu, tick %lu\n", scenario, what, syncIndex, tick);
+		}
+		++failures;
+	}
+
+	// Run the two channels until both have finished. If stopChannel is 0 or 1, that channel is stopped at tick stopAt, as by cancelling the print
+	// or an error on the secondary channel. If restartFile isn't null, the stopped channel then runs that file once both channels have finished.
+	// Return the tick at which the last channel finished.
+	unsigned long Run(const char *scenario, Channel ch[2], int stopChannel = -1, unsigned long stopAt = 0, const std::vector<int> *restartFile = nullptr)
+	{
+		MotionChannelSync sync;
+		unsigned long tick = 0;
+		for (;;)
+		{
+			if (!ch[0].running && !ch[1].running)
+			{
+				if (restartFile == nullptr)
+				{
+					break;
+				}
+				Channel& restarted = ch[stopChannel];
+				restarted.commands = *restartFile;
+				restarted.nextCommand = 0;
+				restarted.running = true;
+				restarted.arrived.clear();
+				restarted.passed.clear();
+				restartFile = nullptr;
+			}
+
+			++tick;
+			if (tick > 10000000)
+			{
+				Fail(scenario, "deadlock", 0, tick);
+				break;
+			}
+
+			// Both rings execute their moves concurrently
+			for (size_t c = 0; c < 2; ++c)
+			{
+				if (!ch[c].ring.empty() && --ch[c].ring.front() == 0)
+				{
+					ch[c].ring.pop_front();
+				}
+			}
+
+			if (stopAt == tick && stopChannel >= 0 && ch[stopChannel].running)
+			{
+				ch[stopChannel].nextCommand = ch[stopChannel].commands.size();		// abandon the rest of the file
+				sync.Abandon(stopChannel);
+			}
+
+			// GCodes::Spin gives each channel a turn
+			for (size_t c = 0; c < 2; ++c)
+			{
+				Channel& me = ch[c];
+				if (!me.running)
+				{
+					continue;
+				}
+				if (me.nextCommand == me.commands.size())
+				{
+					if (me.ring.empty())
+					{
+						me.running = false;
+						me.finished = tick;
+					}
+					continue;
+				}
+
+				const int cmd = me.commands[me.nextCommand];
+				if (cmd != SyncPoint)
+				{
+					if (me.ring.size() < RingLength)
+					{
+						me.ring.push_back(cmd);
+						++me.nextCommand;
+					}
+				}
+				else
+				{
+					if (!sync.IsWaiting(c))
+					{
+						if (!me.ring.empty())
+						{
+							continue;								// wait for this channel's moves to finish
+						}
+						me.arrived.push_back(tick);
+					}
+
+					const Channel& other = ch[1 - c];
+					if (sync.Arrive(c, other.running))
+					{
+						const size_t index = me.passed.size();
+						me.passed.push_back(tick);
+						if (!me.ring.empty())
+						{
+							Fail(scenario, "passed before its own moves finished", index, tick);
+						}
+						if (other.running && (other.arrived.size() <= index || other.arrived[index] > tick))
+						{
+							Fail(scenario, "passed before the other channel finished its moves", index, tick);
+						}
+						++me.nextCommand;
+					}
+				}
+			}
+		}
+		return tick;
+	}
+
+	// Make a file of random moves with numSyncs sync points, and return the ticks that each part between sync points takes
+	std::vector<int> MakeFile(std::mt19937& rng, size_t numSyncs, std::vector<unsigned long>& partTicks)
+	{
+		std::vector<int> commands;
+		partTicks.assign(numSyncs + 1, 0);
+		for (size_t part = 0; part <= numSyncs; ++part)
+		{
+			const int numMoves = std::uniform_int_distribution<int>(0, 12)(rng);
+			for (int i = 0; i < numMoves; ++i)
+			{
+				const int ticks = std::uniform_int_distribution<int>(1, 200)(rng);
+				commands.push_back(ticks);
+				partTicks[part] += ticks;
+			}
+			if (part != numSyncs)
+			{
+				commands.push_back(SyncPoint);
+			}
+		}
+		return commands;
+	}
+
+	// Two channels with the same number of sync points: check sync order and that the total time is close to the ideal
+	void RandomMatched(std::mt19937& rng)
+	{
+		const size_t numSyncs = std::uniform_int_distribution<size_t>(0, 8)(rng);
+		std::vector<unsigned long> parts[2];
+		Channel ch[2];
+		for (size_t c = 0; c < 2; ++c)
+		{
+			ch[c].commands = MakeFile(rng, numSyncs, parts[c]);
+		}
+
+		unsigned long ideal = 0;
+		for (size_t part = 0; part <= numSyncs; ++part)
+		{
+			ideal += std::max(parts[0][part], parts[1][part]);
+		}
+
+		const unsigned long total = Run("matched", ch);
+		for (size_t c = 0; c < 2; ++c)
+		{
+			if (ch[c].passed.size() != numSyncs)
+			{
+				Fail("matched", "wrong number of sync points passed", ch[c].passed.size(), total);
+			}
+		}
+		for (size_t i = 0; i < numSyncs && i < ch[0].passed.size() && i < ch[1].passed.size(); ++i)
+		{
+			const unsigned long skew = (ch[0].passed[i] > ch[1].passed[i]) ? ch[0].passed[i] - ch[1].passed[i] : ch[1].passed[i] - ch[0].passed[i];
+			if (skew > 1)
+			{
+				Fail("matched", "channels left the sync point at different times", i, total);
+			}
+		}
+		if (total < ideal || total > ideal + MaxOverheadPerSync * (numSyncs + 1))
+		{
+			printf("  total %lu ticks, ideal %lu ticks\n", total, ideal);
+			Fail("matched", "unexpected total time", numSyncs, total);
+		}
+	}
+
+	// The secondary channel has fewer sync points than the main one, so it finishes first and mustn't hold the main channel up
+	void RandomShortAux(std::mt19937& rng)
+	{
+		const size_t numSyncs = std::uniform_int_distribution<size_t>(1, 8)(rng);
+		const size_t auxSyncs = std::uniform_int_distribution<size_t>(0, numSyncs - 1)(rng);
+		std::vector<unsigned long> parts[2];
+		Channel ch[2];
+		ch[0].commands = MakeFile(rng, numSyncs, parts[0]);
+		ch[1].commands = MakeFile(rng, auxSyncs, parts[1]);
+
+		const unsigned long total = Run("short aux", ch);
+		if (ch[0].passed.size() != numSyncs || ch[1].passed.size() != auxSyncs)
+		{
+			Fail("short aux", "wrong number of sync points passed", ch[0].passed.size(), total);
+		}
+	}
+
+	// One channel is stopped part way through, possibly while the other is waiting for it at a sync point or it is waiting for the other.
+	// Then a stopped main channel starts a new file.
+	void RandomStopped(std::mt19937& rng)
+	{
+		const size_t numSyncs = std::uniform_int_distribution<size_t>(1, 8)(rng);
+		std::vector<unsigned long> parts[2];
+		Channel ch[2];
+		for (size_t c = 0; c < 2; ++c)
+		{
+			ch[c].commands = MakeFile(rng, numSyncs, parts[c]);
+		}
+		const int stopChannel = std::uniform_int_distribution<int>(0, 1)(rng);
+		const unsigned long stopAt = std::uniform_int_distribution<unsigned long>(1, parts[stopChannel][0] + 50)(rng);
+
+		const std::vector<int> restartFile = { 100, SyncPoint, 100 };
+
+		const unsigned long total = Run("stopped", ch, stopChannel, stopAt, (stopChannel == 0) ? &restartFile : nullptr);
+		if (ch[1 - stopChannel].passed.size() != numSyncs)
+		{
+			Fail("stopped", "the other channel didn't complete its file", ch[1 - stopChannel].passed.size(), total);
+		}
+	}
+
+	// A fixed case that is easy to check by hand: the main channel's part before the sync point is 100 ticks, the secondary one's is 300 ticks
+	void Fixed()
+	{
+		Channel ch[2];
+		ch[0].commands = { 50, 50, SyncPoint, 10 };
+		ch[1].commands = { 100, 100, 100, SyncPoint, 20 };
+		const unsigned long total = Run("fixed", ch);
+		if (ch[0].passed.size() != 1 || ch[1].passed.size() != 1 || ch[0].passed[0] < 300 || ch[0].passed[0] > 300 + MaxOverheadPerSync)
+		{
+			Fail("fixed", "main channel didn't wait for the secondary one", 0, total);
+		}
+		if (total < 320 || total > 320 + 2 * MaxOverheadPerSync)
+		{
+			Fail("fixed", "unexpected total time", 1, total);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const unsigned long iterations = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 10000;
+	std::mt19937 rng(12345);
+
+	Fixed();
+	for (unsigned long i = 0; i < iterations; ++i)
+	{
+		RandomMatched(rng);
+		RandomShortAux(rng);
+		RandomStopped(rng);
+	}
+
+	if (failures != 0)
+	{
+		printf("%u failures\n", failures);
+		return 1;
+	}
+	printf("All %lu iterations passed\n", iterations);
+	return 0;
+}
+
+// End
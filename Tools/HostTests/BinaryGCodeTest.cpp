@@ -0,0 +1,229 @@
+/*
+ * BinaryGCodeTest.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host test of the functions in src/GCodes/BinaryGCode.h that MassStorage::RecordSimulationTime uses to record the simulated print time
+ *  at the end of a binary G-code file. It builds files of text blocks that end at many different offsets in a sector, with and without
+ *  block CRCs, records a simulated time, then replaces it with a longer and a shorter one. After each step it walks the blocks as
+ *  FileGCodeInput does and checks that the file is still valid, that the decoded text has exactly one simulated time line at the end,
+ *  and that the key and value are contiguous in the raw file so that FileInfoParser finds them.
+ *
+ *  Build:	g++ -std=c++17 -O2 -Istubs -o BinaryGCodeTest BinaryGCodeTest.cpp
+ *  Usage:	BinaryGCodeTest
+ */
+
+#include "../../src/Storage/CRC32.cpp"
+#include "../../src/GCodes/BinaryGCode.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace BinaryGCode;
+
+namespace
+{
+	const char * const SimulatedTimeString = "\n; Simulated print time";	// the same as FileInfoParser::SimulatedTimeString
+	constexpr size_t TailLength = 100;										// the number of bytes that RecordSimulationTime reads from the end of the file
+
+	unsigned int failures = 0;
+
+	void Fail(const std::string& what)
+	{
+		printf("FAIL %s\n", what.c_str());
+		++failures;
+	}
+
+	uint32_t BlockCrc(const uint8_t *data, size_t length)
+	{
+		CRC32 crc;
+		crc.Update(reinterpret_cast<const char*>(data), length);
+		return crc.Get();
+	}
+
+	std::vector<uint8_t> MakeHeader(bool withCrc)
+	{
+		return { (uint8_t)Magic[0], (uint8_t)Magic[1], (uint8_t)Magic[2], (uint8_t)Magic[3], FormatVersion, (uint8_t)((withCrc) ? FlagBlockCrc : 0), 0, 0 };
+	}
+
+	// Append a block holding one text record, padding to the next sector if necessary, as the converter does
+	void AppendTextBlock(std::vector<uint8_t>& file, const std::string& text, bool withCrc)
+	{
+		uint8_t block[MaxBlockLength];
+		const size_t blockLength = EncodeTextBlock(text.data(), text.size(), (withCrc) ? BlockCrc : nullptr, block);
+		file.insert(file.end(), PaddingBeforeBlock(file.size(), blockLength), 0);
+		file.insert(file.end(), block, block + blockLength);
+	}
+
+	// Do what MassStorage::RecordSimulationTime does to a binary file
+	bool RecordSimulationTime(std::vector<uint8_t>& file, uint32_t simSeconds, bool withCrc)
+	{
+		const std::string text = std::string(SimulatedTimeString) + ": " + std::to_string(simSeconds) + "\n";
+		uint8_t block[MaxBlockLength];
+		const size_t blockLength = EncodeTextBlock(text.data(), text.size(), (withCrc) ? BlockCrc : nullptr, block);
+		if (blockLength == 0)
+		{
+			return false;
+		}
+		const size_t tailLength = std::min(file.size(), TailLength);
+		size_t padding;
+		const uint32_t writePos = PlaceFinalTextBlock(file.data() + file.size() - tailLength, tailLength, file.size(), SimulatedTimeString, withCrc, blockLength, padding);
+		file.resize(writePos);
+		file.insert(file.end(), padding, 0);
+		file.insert(file.end(), block, block + blockLength);
+		return true;
+	}
+
+	// Walk the blocks of a file containing only text records in the same way as FileGCodeInput, returning the text or an error message
+	bool Decode(const std::vector<uint8_t>& file, std::string& text)
+	{
+		text.clear();
+		if (file.size() < HeaderLength || memcmp(file.data(), Magic, sizeof(Magic)) != 0)
+		{
+			text = "bad header";
+			return false;
+		}
+		const bool withCrc = (file[5] & FlagBlockCrc) != 0;
+		const size_t crcLength = (withCrc) ? BlockCrcLength : 0;
+		size_t pos = HeaderLength;
+		while (pos < file.size())
+		{
+			const size_t payloadLength = file[pos];
+			if (payloadLength == 0)
+			{
+				++pos;										// padding
+				continue;
+			}
+			if (payloadLength > MaxBlockPayload)
+			{
+				text = "bad block length at " + std::to_string(pos);
+				return false;
+			}
+			const size_t blockLength = 1 + payloadLength + crcLength;
+			if (pos + blockLength > file.size())
+			{
+				text = "truncated block at " + std::to_string(pos);
+				return false;
+			}
+			if (pos / SectorSize != (pos + blockLength - 1) / SectorSize)
+			{
+				text = "block straddles a sector boundary at " + std::to_string(pos);
+				return false;
+			}
+			if (withCrc)
+			{
+				uint32_t storedCrc = 0;
+				for (size_t i = 0; i < BlockCrcLength; ++i)
+				{
+					storedCrc |= (uint32_t)file[pos + 1 + payloadLength + i] << (8 * i);
+				}
+				if (BlockCrc(&file[pos], 1 + payloadLength) != storedCrc)
+				{
+					text = "CRC error at " + std::to_string(pos);
+					return false;
+				}
+			}
+
+			size_t recordPos = pos + 1;
+			const size_t payloadEnd = pos + 1 + payloadLength;
+			while (recordPos < payloadEnd)
+			{
+				if ((file[recordPos] & RecordTypeMask) != RecordTypeText || recordPos + 2 > payloadEnd || (file[recordPos + 1] & 0x80) != 0
+					|| recordPos + 2 + file[recordPos + 1] > payloadEnd)
+				{
+					text = "bad record at " + std::to_string(recordPos);
+					return false;
+				}
+				text.append(reinterpret_cast<const char*>(&file[recordPos + 2]), file[recordPos + 1]);
+				recordPos += 2 + file[recordPos + 1];
+			}
+			pos += blockLength;
+		}
+		return true;
+	}
+
+	// Check the file after recording a simulated time
+	void Check(const std::string& name, const std::vector<uint8_t>& file, const std::string& expectedGCode, uint32_t simSeconds)
+	{
+		std::string text;
+		if (!Decode(file, text))
+		{
+			Fail(name + ": " + text);
+			return;
+		}
+		const std::string timeLine = std::string(SimulatedTimeString) + ": " + std::to_string(simSeconds) + "\n";
+		if (text != expectedGCode + timeLine)
+		{
+			Fail(name + ": wrong text after the simulated time was recorded");
+		}
+
+		// FileInfoParser scans the raw file, so the key and the value must be together in it
+		const std::string raw(file.begin(), file.end());
+		if (raw.find(timeLine) == std::string::npos)
+		{
+			Fail(name + ": the simulated time is not contiguous in the raw file");
+		}
+	}
+}
+
+int main()
+{
+	for (bool withCrc : { false, true })
+	{
+		// Vary the length of the file so that it ends at every offset in the last sector, including right at the end of it
+		for (size_t fillLength = 1; fillLength <= 2 * SectorSize; ++fillLength)
+		{
+			const std::string name = std::string((withCrc) ? "with CRCs" : "without CRCs") + ", " + std::to_string(fillLength) + " bytes of text";
+			std::vector<uint8_t> file = MakeHeader(withCrc);
+			std::string gcode;
+			size_t done = 0;
+			while (done < fillLength)
+			{
+				const size_t lineLength = std::min<size_t>(fillLength - done, 40);
+				const std::string line = std::string(lineLength - 1, 'A' + (char)(done % 26)) + "\n";
+				AppendTextBlock(file, line, withCrc);
+				gcode += line;
+				done += lineLength;
+			}
+
+			std::string text;
+			if (!Decode(file, text) || text != gcode)
+			{
+				Fail(name + ": the test file is bad");
+				continue;
+			}
+
+			// Record a time, then replace it with a longer one, which may need padding, and then a shorter one
+			for (uint32_t simSeconds : { 1234u, 4294967295u, 5u })
+			{
+				if (!RecordSimulationTime(file, simSeconds, withCrc))
+				{
+					Fail(name + ": the simulated time didn't fit in a block");
+					break;
+				}
+				Check(name + ", simulated time " + std::to_string(simSeconds), file, gcode, simSeconds);
+			}
+		}
+	}
+
+	// A key that is only part of the final record, or a record that is not the last block, must not be replaced
+	{
+		std::vector<uint8_t> file = MakeHeader(true);
+		AppendTextBlock(file, std::string(SimulatedTimeString) + ": 1\n", true);
+		AppendTextBlock(file, "G1 X1\n", true);
+		(void)RecordSimulationTime(file, 2, true);
+		Check("simulated time not in the last block", file, std::string(SimulatedTimeString) + ": 1\nG1 X1\n", 2);
+	}
+
+	if (failures != 0)
+	{
+		printf("%u failures\n", failures);
+		return 1;
+	}
+	printf("All passed\n");
+	return 0;
+}
+
+// End
@@ -0,0 +1,91 @@
+/*
+ * CRC32Test.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host test of src/Storage/CRC32.cpp. It checks the standard check value, then compares the CRC of every start alignment from 0 to 7 and every
+ *  length from 0 to 279 against a bitwise reference, both in one call and split into two calls at every point. Build it once with each algorithm.
+ *
+ *  Build:	g++ -std=c++17 -O2 -Istubs -DCRC32_SLICING_BY_8=1 -o CRC32Test CRC32Test.cpp
+ *			g++ -std=c++17 -O2 -Istubs -DCRC32_SLICING_BY_8=0 -o CRC32Test CRC32Test.cpp
+ *  Usage:	CRC32Test
+ */
+
+#include "../../src/Storage/CRC32.cpp"
+
+#include <cstdio>
+
+namespace
+{
+	// Bitwise CRC32 with polynomial 0xEDB88320
+	uint32_t ReferenceCrc(const uint8_t *p, size_t len)
+	{
+		uint32_t crc = 0xFFFFFFFF;
+		for (size_t i = 0; i < len; ++i)
+		{
+			crc ^= p[i];
+			for (int bit = 0; bit < 8; ++bit)
+			{
+				crc = (crc >> 1) ^ (0xEDB88320 & (0u - (crc & 1)));
+			}
+		}
+		return ~crc;
+	}
+}
+
+int main()
+{
+	unsigned int failures = 0;
+
+	CRC32 check;
+	check.Update("123456789", 9);
+	if (check.Get() != 0xCBF43926)
+	{
+		printf("FAIL check value %08" PRIx32 "\n", check.Get());
+		++failures;
+	}
+
+	alignas(8) uint8_t buf[300];
+	for (size_t i = 0; i < sizeof(buf); ++i)
+	{
+		buf[i] = (uint8_t)(i * 37 + 11);
+	}
+
+	for (size_t align = 0; align < 8; ++align)
+	{
+		for (size_t len = 0; len < 280; ++len)
+		{
+			const uint32_t expected = ReferenceCrc(buf + align, len);
+			CRC32 whole;
+			whole.Update(buf + align, len);
+			if (whole.Get() != expected)
+			{
+				printf("FAIL alignment %zu length %zu: %08" PRIx32 ", expected %08" PRIx32 "\n", align, len, whole.Get(), expected);
+				++failures;
+			}
+
+			for (size_t split = 0; split <= len; ++split)
+			{
+				CRC32 parts;
+				parts.Update(buf + align, split);
+				parts.Update(buf + align + split, len - split);
+				if (parts.Get() != expected)
+				{
+					printf("FAIL alignment %zu length %zu split at %zu\n", align, len, split);
+					++failures;
+				}
+			}
+		}
+	}
+
+	if (failures != 0)
+	{
+		printf("%u failures\n", failures);
+		return 1;
+	}
+	printf("All passed (%s)\n", (CRC32_SLICING_BY_8) ? "slicing-by-8" : "4 bytes per iteration");
+	return 0;
+}
+
+// End
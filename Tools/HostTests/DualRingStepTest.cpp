@@ -0,0 +1,465 @@
+/*
+ * DualRingStepTest.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host simulation of the step ISR serving the main and secondary DDA rings. DDA and DDARing can't be built on the host because they depend on
+ *  the rest of the firmware, so this mirrors Move::Interrupt, DDARing::Interrupt, DDA::StepDrivers and DDA::GetNextInterruptTime on simulated
+ *  moves, using the timing rules in src/Movement/StepTiming.h that they use. The step clock starts just before it wraps round. The secondary ring
+ *  starts its first move, 10ms in the future as DDARing does, while the main ring is moving, and then the other way round. It checks that
+ *  no step is generated more than MinInterruptInterval before it is due, that every step is generated once and not too late, and that each move
+ *  ends when it should. With the main ring on its own it checks that the steps are the same as without the due time check in DDARing::Interrupt,
+ *  and with two rings that they are not, so that the test is known to catch the bug that the check fixes.
+ *
+ *  Build:	g++ -std=c++17 -O2 -o DualRingStepTest DualRingStepTest.cpp
+ *  Usage:	DualRingStepTest [iterations]
+ */
+
+#include "../../src/Movement/StepTiming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// These are the values for the SAM4E and SAM4S
+	constexpr uint32_t StepClockRate = 120000000/128;
+	constexpr uint32_t MinInterruptInterval = 6;
+	constexpr uint32_t WakeupTime = StepClockRate/10000;
+	constexpr uint32_t MovementStartDelayClocks = StepClockRate/100;
+	constexpr uint32_t IsrClocksPerRing = 1;				// simulated time that DDARing::Interrupt takes when there is nothing to do
+	constexpr uint32_t IsrClocksPerStep = 2;				// simulated time that DDA::StepDrivers takes to generate steps
+	constexpr uint32_t MaxLateness = 40;					// how late a step may be because the ISR was busy with steps of the other ring
+
+	constexpr size_t NumDrives = 3;
+
+	struct Move
+	{
+		uint32_t clocksNeeded;
+		std::vector<uint32_t> stepTimes[NumDrives];			// step times of each drive, relative to the start of the move
+	};
+
+	struct Step
+	{
+		size_t ring, move, drive, step;
+		uint32_t when;
+
+		bool operator==(const Step& other) const
+		{
+			return ring == other.ring && move == other.move && drive == other.drive && step == other.step && when == other.when;
+		}
+	};
+
+	unsigned int failures = 0;
+
+	void Fail(const char *scenario, const char *what, const Step& s, uint32_t dueTime)
+	{
+		if (failures < 20)
+		{
+			printf("FAIL %s: %s: ring %zu move %zu drive %zu step %zu at %u, due at %u\n", scenario, what, s.ring, s.move, s.drive, s.step, s.when, dueTime);
+		}
+		++failures;
+	}
+
+	// A ring of moves with the state that DDARing and the current DDA keep for the step ISR
+	class Ring
+	{
+	public:
+		Ring(size_t p_number, const std::vector<Move>& p_moves) : number(p_number), moves(p_moves) { }
+
+		// Start the first move, as DDARing::StartNextMove does when the ring is idle
+		void StartFirstMove(uint32_t now)
+		{
+			StartMove(0, now + MovementStartDelayClocks);
+		}
+
+		const std::vector<uint32_t>& GetMoveStartTimes() const { return moveStartTimes; }
+		size_t GetMovesFinished() const { return movesFinished; }
+
+		// Mirror DDA::GetNextInterruptTime
+		std::optional<uint32_t> GetNextInterruptTime() const
+		{
+			return (executing)
+					? std::optional<uint32_t>(((!activeDMs.empty()) ? nextStepTimes[activeDMs.front()] : moves[currentMove].clocksNeeded - WakeupTime) + moveStartTime)
+						: std::optional<uint32_t>();
+		}
+
+		// Mirror DDARing::Interrupt
+		void Interrupt(uint32_t& now, bool checkDue, std::vector<Step>& steps)
+		{
+			now += IsrClocksPerRing;
+			if (executing)
+			{
+				const std::optional<uint32_t> dueTime = GetNextInterruptTime();
+				if (checkDue && (!dueTime.has_value() || !StepTiming::IsDue(now, dueTime.value(), MinInterruptInterval)))
+				{
+					return;
+				}
+
+				StepDrivers(now, steps);
+				if (!executing)
+				{
+					const uint32_t finishTime = moveStartTime + moves[currentMove].clocksNeeded;
+					++movesFinished;
+					if (currentMove + 1 < moves.size())
+					{
+						StartMove(currentMove + 1, finishTime);
+					}
+				}
+			}
+		}
+
+	private:
+		void StartMove(size_t move, uint32_t startTime)
+		{
+			currentMove = move;
+			moveStartTime = startTime;
+			moveStartTimes.push_back(startTime);
+			activeDMs.clear();
+			for (size_t drive = 0; drive < NumDrives; ++drive)
+			{
+				nextStep[drive] = 0;
+				if (!moves[move].stepTimes[drive].empty())
+				{
+					nextStepTimes[drive] = moves[move].stepTimes[drive][0];
+					InsertDM(drive);
+				}
+			}
+			executing = true;
+		}
+
+		void InsertDM(size_t drive)
+		{
+			auto pos = activeDMs.begin();
+			while (pos != activeDMs.end() && nextStepTimes[*pos] <= nextStepTimes[drive])
+			{
+				++pos;
+			}
+			activeDMs.insert(pos, drive);
+		}
+
+		// Mirror DDA::StepDrivers
+		void StepDrivers(uint32_t& now, std::vector<Step>& steps)
+		{
+			const uint32_t elapsedTime = StepTiming::StepHorizon(now, moveStartTime, MinInterruptInterval);
+			std::vector<size_t> stepping;
+			while (!activeDMs.empty() && elapsedTime >= nextStepTimes[activeDMs.front()])
+			{
+				stepping.push_back(activeDMs.front());
+				activeDMs.pop_front();
+			}
+
+			if (!stepping.empty())
+			{
+				now += IsrClocksPerStep;
+				for (size_t drive : stepping)
+				{
+					steps.push_back(Step{ number, currentMove, drive, nextStep[drive], now });
+					const std::vector<uint32_t>& stepTimes = moves[currentMove].stepTimes[drive];
+					if (++nextStep[drive] < stepTimes.size())
+					{
+						nextStepTimes[drive] = stepTimes[nextStep[drive]];
+						InsertDM(drive);
+					}
+				}
+			}
+
+			if (activeDMs.empty() && now - moveStartTime + WakeupTime >= moves[currentMove].clocksNeeded)
+			{
+				executing = false;
+			}
+		}
+
+		size_t number;
+		const std::vector<Move>& moves;
+		size_t currentMove = 0;
+		bool executing = false;
+		size_t movesFinished = 0;
+		uint32_t moveStartTime = 0;
+		std::vector<uint32_t> moveStartTimes;
+		std::deque<size_t> activeDMs;						// drives with steps to do, in order of next step time
+		size_t nextStep[NumDrives];
+		uint32_t nextStepTimes[NumDrives];
+	};
+
+	// Mirror the step interrupt and Move::Interrupt
+	class StepIsr
+	{
+	public:
+		StepIsr(Ring **p_rings, size_t p_numRings, bool p_checkDue) : rings(p_rings), numRings(p_numRings), checkDue(p_checkDue) { }
+
+		// Mirror Move::Interrupt
+		void Interrupt(uint32_t& now, std::vector<Step>& steps)
+		{
+			interruptScheduled = false;
+			bool repeat;
+			do
+			{
+				for (size_t i = 0; i < numRings; ++i)
+				{
+					rings[i]->Interrupt(now, checkDue, steps);
+				}
+				const std::optional<uint32_t> nextStepTime = GetNextStepTime();
+				if (!nextStepTime.has_value())
+				{
+					break;
+				}
+				repeat = ScheduleStepInterrupt(now, nextStepTime.value());
+			} while (repeat);
+		}
+
+		// Mirror Move::ScheduleNextStepInterrupt, which is called when a ring starts a move
+		void ScheduleNextStepInterrupt(uint32_t& now, std::vector<Step>& steps)
+		{
+			const std::optional<uint32_t> nextStepTime = GetNextStepTime();
+			if (nextStepTime.has_value() && ScheduleStepInterrupt(now, nextStepTime.value()))
+			{
+				Interrupt(now, steps);
+			}
+		}
+
+		std::optional<uint32_t> GetInterruptTime() const
+		{
+			return (interruptScheduled) ? std::optional<uint32_t>(interruptTime) : std::optional<uint32_t>();
+		}
+
+	private:
+		std::optional<uint32_t> GetNextStepTime() const
+		{
+			std::optional<uint32_t> nextStepTime;
+			for (size_t i = 0; i < numRings; ++i)
+			{
+				const std::optional<uint32_t> t = rings[i]->GetNextInterruptTime();
+				if (t.has_value() && (!nextStepTime.has_value() || (int32_t)(t.value() - nextStepTime.value()) < 0))
+				{
+					nextStepTime = t;
+				}
+			}
+			return nextStepTime;
+		}
+
+		// Mirror StepTimer::ScheduleStepInterrupt
+		bool ScheduleStepInterrupt(uint32_t now, uint32_t tim)
+		{
+			if (interruptScheduled && (int32_t)(tim - interruptTime) > 0)
+			{
+				return false;
+			}
+			if ((int32_t)(tim - now) < (int32_t)MinInterruptInterval)
+			{
+				return true;
+			}
+			interruptTime = tim;
+			interruptScheduled = true;
+			return false;
+		}
+
+		Ring **rings;
+		size_t numRings;
+		bool checkDue;
+		bool interruptScheduled = false;
+		uint32_t interruptTime = 0;
+	};
+
+	std::vector<Move> MakeMoves(std::mt19937& rng, size_t numMoves)
+	{
+		std::vector<Move> moves(numMoves);
+		for (Move& m : moves)
+		{
+			m.clocksNeeded = std::uniform_int_distribution<uint32_t>(WakeupTime + 100, StepClockRate/50)(rng);
+			for (size_t drive = 0; drive < NumDrives; ++drive)
+			{
+				// Steps that speed up and then slow down, no closer together than about 16 clocks, with some drives not moving
+				const size_t numSteps = (std::uniform_int_distribution<int>(0, 3)(rng) == 0) ? 0 : std::uniform_int_distribution<size_t>(1, m.clocksNeeded/40)(rng);
+				for (size_t i = 0; i < numSteps; ++i)
+				{
+					const double fraction = (double)(i + 1)/(double)(numSteps + 1);
+					const double shaped = fraction + 0.6 * sin(2.0 * M_PI * fraction)/(2.0 * M_PI);
+					m.stepTimes[drive].push_back((uint32_t)(shaped * (m.clocksNeeded - WakeupTime)));
+				}
+			}
+		}
+		return moves;
+	}
+
+	struct RunResult
+	{
+		std::vector<Step> steps;
+		std::vector<uint32_t> moveStartTimes[2];
+		size_t movesFinished[2];
+	};
+
+	// Run the rings until all their moves are done. If there are two rings, the one with index 'lateRing' starts its first move at time 'lateStart'.
+	RunResult Run(const std::vector<Move> *moves, size_t numRings, size_t lateRing, uint32_t startTime, uint32_t lateStart, bool checkDue)
+	{
+		std::vector<Ring> ringStore;
+		ringStore.reserve(numRings);
+		Ring *rings[2];
+		for (size_t i = 0; i < numRings; ++i)
+		{
+			ringStore.emplace_back(i, moves[i]);
+			rings[i] = &ringStore[i];
+		}
+		StepIsr isr(rings, numRings, checkDue);
+		RunResult result;
+
+		uint32_t now = startTime;
+		bool lateStarted = (numRings < 2);
+		for (size_t i = 0; i < numRings; ++i)
+		{
+			if (lateStarted || i != lateRing)
+			{
+				rings[i]->StartFirstMove(now);
+				isr.ScheduleNextStepInterrupt(now, result.steps);
+			}
+		}
+
+		for (;;)
+		{
+			const std::optional<uint32_t> interruptTime = isr.GetInterruptTime();
+			if (!lateStarted && (!interruptTime.has_value() || (int32_t)(lateStart - interruptTime.value()) <= 0))
+			{
+				if ((int32_t)(lateStart - now) > 0)
+				{
+					now = lateStart;
+				}
+				rings[lateRing]->StartFirstMove(now);
+				isr.ScheduleNextStepInterrupt(now, result.steps);
+				lateStarted = true;
+			}
+			else if (interruptTime.has_value())
+			{
+				if ((int32_t)(interruptTime.value() - now) > 0)
+				{
+					now = interruptTime.value();
+				}
+				isr.Interrupt(now, result.steps);
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		for (size_t i = 0; i < numRings; ++i)
+		{
+			result.moveStartTimes[i] = rings[i]->GetMoveStartTimes();
+			result.movesFinished[i] = rings[i]->GetMovesFinished();
+		}
+		return result;
+	}
+
+	// Check that every step was generated once, in order, and neither early nor too late, and that every move finished. Return the number of problems.
+	unsigned int Check(const char *scenario, const std::vector<Move> *moves, size_t numRings, const RunResult& result, bool report)
+	{
+		unsigned int problems = 0;
+		auto problem = [&](const char *what, const Step& s, uint32_t dueTime)
+			{
+				if (report)
+				{
+					Fail(scenario, what, s, dueTime);
+				}
+				++problems;
+			};
+
+		std::vector<size_t> counts[2];
+		for (size_t i = 0; i < numRings; ++i)
+		{
+			counts[i].assign(moves[i].size() * NumDrives, 0);
+		}
+		for (const Step& s : result.steps)
+		{
+			const uint32_t dueTime = result.moveStartTimes[s.ring][s.move] + moves[s.ring][s.move].stepTimes[s.drive][s.step];
+			const int32_t early = (int32_t)(dueTime - s.when);
+			if (early > (int32_t)(MinInterruptInterval + IsrClocksPerStep))
+			{
+				problem("step too early", s, dueTime);
+			}
+			else if (-early > (int32_t)MaxLateness)
+			{
+				problem("step too late", s, dueTime);
+			}
+			if (s.step != counts[s.ring][s.move * NumDrives + s.drive]++)
+			{
+				problem("step out of order or repeated", s, dueTime);
+			}
+		}
+		for (size_t i = 0; i < numRings; ++i)
+		{
+			for (size_t move = 0; move < moves[i].size(); ++move)
+			{
+				for (size_t drive = 0; drive < NumDrives; ++drive)
+				{
+					if (counts[i][move * NumDrives + drive] != moves[i][move].stepTimes[drive].size())
+					{
+						problem("steps missing", Step{ i, move, drive, counts[i][move * NumDrives + drive], 0 }, 0);
+					}
+				}
+			}
+			if (result.movesFinished[i] != moves[i].size())
+			{
+				problem("not all moves finished", Step{ i, result.movesFinished[i], 0, 0, 0 }, 0);
+			}
+		}
+		return problems;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const unsigned int iterations = (argc > 1) ? (unsigned int)atoi(argv[1]) : 200;
+	std::mt19937 rng(12345);
+	unsigned int badRunsWithoutCheck = 0;
+
+	for (unsigned int iteration = 0; iteration < iterations; ++iteration)
+	{
+		const std::vector<Move> moves[2] = { MakeMoves(rng, 8), MakeMoves(rng, 8) };
+
+		// Start near the point where the step clock wraps round, so that wrong signed or unsigned comparisons show up
+		const uint32_t startTime = 0xFFFFFFFFu - std::uniform_int_distribution<uint32_t>(0, 4 * MovementStartDelayClocks)(rng);
+		const uint32_t lateStart = startTime + std::uniform_int_distribution<uint32_t>(1, 2 * MovementStartDelayClocks)(rng);
+
+		// One ring: checking the due time must not change anything
+		const RunResult checked = Run(moves, 1, 0, startTime, 0, true);
+		(void)Check("one ring", moves, 1, checked, true);
+		if (checked.steps != Run(moves, 1, 0, startTime, 0, false).steps)
+		{
+			printf("FAIL one ring: checking the due time changed the steps in iteration %u\n", iteration);
+			++failures;
+		}
+
+		// Two rings, each starting its first move while the other one is moving
+		for (size_t lateRing : { 1, 0 })
+		{
+			const char * const scenario = (lateRing == 1) ? "secondary ring starts late" : "main ring starts late";
+			(void)Check(scenario, moves, 2, Run(moves, 2, lateRing, startTime, lateStart, true), true);
+			if (Check(scenario, moves, 2, Run(moves, 2, lateRing, startTime, lateStart, false), false) != 0)
+			{
+				++badRunsWithoutCheck;
+			}
+		}
+	}
+
+	// Without the check, the ring whose first move hasn't started takes all its steps as due as soon as the ISR runs for the other ring
+	if (badRunsWithoutCheck == 0)
+	{
+		printf("FAIL the steps were right without the due time check in DDARing::Interrupt, so the test doesn't catch the bug it fixes\n");
+		++failures;
+	}
+	if (failures != 0)
+	{
+		printf("%u failures\n", failures);
+		return 1;
+	}
+	printf("All passed (%u of %u two ring runs went wrong without the due time check)\n", badRunsWithoutCheck, 2 * iterations);
+	return 0;
+}
+
+// End
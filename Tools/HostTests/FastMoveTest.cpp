@@ -0,0 +1,162 @@
+/*
+ * FastMoveTest.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host test of IsFastMoveCode in src/GCodes/GCodeTable.h, which decides whether GCodes::DoFastMove may pass a command straight to DoStraightMove.
+ *  It enumerates commands with every combination of letter, number, fraction, code table entry, machine type and a set of parameters, and compares
+ *  the result with a model of what ActOnCode, HandleGcode and DoStraightMove do with them. The fast path must never take a command that the normal
+ *  path would queue, pass to a table handler or treat as a special move, and it must take every plain G0 and G1 move.
+ *
+ *  Build:	g++ -std=c++17 -O2 -Istubs -o FastMoveTest FastMoveTest.cpp
+ *  Usage:	FastMoveTest
+ */
+
+#include "../../src/GCodes/GCodeTable.h"
+
+#include <cstdio>
+#include <string>
+
+class GCodes
+{
+public:
+	GCodeResult Handler(GCodeBuffer&, const StringRef&) { return GCodeResult::ok; }
+};
+
+namespace
+{
+	const char ParameterLetters[] = "XEFHRS";
+
+	struct Command
+	{
+		char letter;
+		bool hasNumber;
+		int number;
+		int fraction;
+		const CodeTableEntry *entry;
+		bool isLaser;
+		unsigned int parameters;							// bitmap of the letters in ParameterLetters that the command has
+
+		bool Seen(char c) const
+		{
+			const char * const p = strchr(ParameterLetters, c);
+			return p != nullptr && (parameters & (1u << (p - ParameterLetters))) != 0;
+		}
+
+		std::string Describe() const
+		{
+			std::string s(1, letter);
+			if (hasNumber)
+			{
+				s += std::to_string(number);
+				if (fraction >= 0)
+				{
+					s += "." + std::to_string(fraction);
+				}
+			}
+			for (size_t i = 0; ParameterLetters[i] != 0; ++i)
+			{
+				if (parameters & (1u << i))
+				{
+					s += std::string(" ") + ParameterLetters[i] + "1";
+				}
+			}
+			s += (entry == nullptr) ? ", no table entry" : (entry->handler != nullptr) ? ", table handler" : (entry->queueRule != CodeQueueRule::never) ? ", queued" : ", plain table entry";
+			if (isLaser)
+			{
+				s += ", laser";
+			}
+			return s;
+		}
+	};
+
+	// Return true if the normal path would do nothing with the command but call DoStraightMove, and DoStraightMove would treat it as a plain move
+	bool NormalPathIsPlainMove(const Command& cmd)
+	{
+		// ActOnCode: codes with a queue rule may be queued
+		if (cmd.entry != nullptr && cmd.entry->queueRule != CodeQueueRule::never)
+		{
+			return false;
+		}
+
+		// ActOnCode and HandleGcode: only G-codes with a number and no table handler reach the switch statement
+		if (cmd.letter != 'G' || !cmd.hasNumber || (cmd.entry != nullptr && cmd.entry->handler != nullptr))
+		{
+			return false;
+		}
+
+		// HandleGcode: only G0 and G1 call DoStraightMove
+		if (cmd.number != 0 && cmd.number != 1)
+		{
+			return false;
+		}
+
+		// DoStraightMove: H and non-laser S select special moves, and R moves to a restore point
+		return !cmd.Seen('H') && !cmd.Seen('R') && (cmd.isLaser || !cmd.Seen('S'));
+	}
+}
+
+int main()
+{
+	const CodeTableEntry plainEntry = { 1, CodeQueueRule::never, CodeLock::none, nullptr };
+	const CodeTableEntry handlerEntry = { 1, CodeQueueRule::never, CodeLock::movement, &GCodes::Handler };
+	const CodeTableEntry queuedEntry = { 1, CodeQueueRule::always, CodeLock::none, nullptr };
+	const CodeTableEntry toolTemperaturesEntry = { 1, CodeQueueRule::toolTemperatures, CodeLock::none, nullptr };
+	const CodeTableEntry * const entries[] = { nullptr, &plainEntry, &handlerEntry, &queuedEntry, &toolTemperaturesEntry };
+
+	unsigned int failures = 0, fastCommands = 0, commands = 0;
+	for (char letter : { 'G', 'M', 'T' })
+	{
+		for (bool hasNumber : { false, true })
+		{
+			for (int number : { 0, 1, 2, 28, 92 })
+			{
+				for (int fraction : { -1, 0, 1 })
+				{
+					for (const CodeTableEntry *entry : entries)
+					{
+						for (bool isLaser : { false, true })
+						{
+							for (unsigned int parameters = 0; parameters < (1u << strlen(ParameterLetters)); ++parameters)
+							{
+								const Command cmd = { letter, hasNumber, number, fraction, entry, isLaser, parameters };
+								const bool fast = IsFastMoveCode(cmd.letter, cmd.hasNumber, cmd.number, cmd.fraction, cmd.entry, cmd.isLaser,
+																	[&cmd](char c) -> bool { return cmd.Seen(c); });
+								const bool plain = NormalPathIsPlainMove(cmd);
+								++commands;
+								if (fast)
+								{
+									++fastCommands;
+								}
+
+								// A fractional code number is left to the normal path even though HandleGcode ignores the fraction, so that G0.x and G1.x
+								// can be given another meaning without changing the fast path. Every other plain move must take the fast path.
+								if (fast && !plain)
+								{
+									printf("FAIL \"%s\": the fast path takes it but the normal path doesn't treat it as a plain move\n", cmd.Describe().c_str());
+									++failures;
+								}
+								else if (plain && !fast && fraction < 0)
+								{
+									printf("FAIL \"%s\": a plain move doesn't take the fast path\n", cmd.Describe().c_str());
+									++failures;
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (failures != 0)
+	{
+		printf("%u failures\n", failures);
+		return 1;
+	}
+	printf("All passed (%u of %u commands take the fast path)\n", fastCommands, commands);
+	return 0;
+}
+
+// End
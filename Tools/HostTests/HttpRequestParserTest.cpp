@@ -0,0 +1,225 @@
+/*
+ * HttpRequestParserTest.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host test of src/Networking/HttpRequestParser.cpp. It parses sample requests one character at a time with CharFromClient and checks the status,
+ *  command words, qualifiers, headers and reject reason. Then it feeds each request, followed by the start of another one, to CharsFromClient in
+ *  chunks of every size from 1 byte up to the whole request, and checks that the result is the same and that only the first request is consumed.
+ *
+ *  Build:	g++ -std=c++17 -O2 -Istubs -o HttpRequestParserTest HttpRequestParserTest.cpp
+ *  Usage:	HttpRequestParserTest
+ */
+
+#include "../../src/Networking/HttpRequestParser.cpp"
+
+#include <cstdio>
+#include <string>
+
+namespace
+{
+	struct TestCase
+	{
+		const char *name;
+		std::string request;
+		HttpRequestParser::Status status;
+		const char *expected;				// the parsed request as written by Describe, or the reject reason
+	};
+
+	unsigned int failures = 0;
+
+	void Fail(const char *name, const char *what, const std::string& got, const std::string& expected)
+	{
+		printf("FAIL %s: %s\n  got      \"%s\"\n  expected \"%s\"\n", name, what, got.c_str(), expected.c_str());
+		++failures;
+	}
+
+	// Write the parsed request as a string that is easy to compare. Each command word, qualifier and header is followed by '|'.
+	std::string Describe(const HttpRequestParser& parser)
+	{
+		std::string s;
+		for (size_t i = 0; i < parser.GetNumCommandWords(); ++i)
+		{
+			s.append(parser.GetCommandWord(i)).append("|");
+		}
+		s.append("?");
+		for (size_t i = 0; i < parser.GetNumQualifiers(); ++i)
+		{
+			s.append(parser.GetQualifierKey(i)).append("=").append(parser.GetQualifierValue(i)).append("|");
+		}
+		s.append("#");
+		for (size_t i = 0; i < parser.GetNumHeaders(); ++i)
+		{
+			s.append(parser.GetHeaderKey(i)).append(":").append(parser.GetHeaderValue(i)).append("|");
+		}
+		return s;
+	}
+
+	std::string Result(HttpRequestParser::Status status, const HttpRequestParser& parser)
+	{
+		switch (status)
+		{
+		case HttpRequestParser::Status::needMore:
+			return "(need more)";
+		case HttpRequestParser::Status::complete:
+			return Describe(parser);
+		default:
+			return std::string("(rejected) ") + parser.GetRejectReason();
+		}
+	}
+
+	std::string Expected(const TestCase& tc)
+	{
+		switch (tc.status)
+		{
+		case HttpRequestParser::Status::needMore:
+			return "(need more)";
+		case HttpRequestParser::Status::complete:
+			return tc.expected;
+		default:
+			return std::string("(rejected) ") + tc.expected;
+		}
+	}
+
+	// Parse the request one character at a time, returning the number of characters used
+	size_t ParseByChar(HttpRequestParser& parser, const std::string& request, HttpRequestParser::Status& status)
+	{
+		status = HttpRequestParser::Status::needMore;
+		size_t i = 0;
+		while (i < request.size() && status == HttpRequestParser::Status::needMore)
+		{
+			status = parser.CharFromClient(request[i++]);
+		}
+		return i;
+	}
+
+	std::string ManyHeaders(size_t n)
+	{
+		std::string s = "GET /rr_status HTTP/1.1\r\n";
+		for (size_t i = 0; i < n; ++i)
+		{
+			s += "X-Header-" + std::to_string(i) + ": " + std::to_string(i * 7) + "\r\n";
+		}
+		return s + "\r\n";
+	}
+}
+
+int main()
+{
+	using Status = HttpRequestParser::Status;
+
+	std::string manyHeadersExpected = "GET|/rr_status|HTTP/1.1|?#";
+	for (size_t i = 0; i < HttpRequestParser::MaxHeaders - 1; ++i)
+	{
+		manyHeadersExpected += "X-Header-" + std::to_string(i) + ":" + std::to_string(i * 7) + "|";
+	}
+
+	static HttpRequestParser parser;				// static because it is too big to be worth putting on the stack
+	const TestCase cases[] =
+	{
+		{ "status", "GET /rr_status?type=3 HTTP/1.1\r\nHost: 192.168.1.10\r\nConnection: keep-alive\r\n\r\n",
+				Status::complete, "GET|/rr_status|HTTP/1.1|?type=3|#Host:192.168.1.10|Connection:keep-alive|" },
+		{ "bare newlines", "GET /rr_status?type=3 HTTP/1.0\nHost: printer\n\n",
+				Status::complete, "GET|/rr_status|HTTP/1.0|?type=3|#Host:printer|" },
+		{ "no qualifier", "GET /index.html HTTP/1.1\r\nAccept-Encoding: gzip, deflate\r\n\r\n",
+				Status::complete, "GET|/index.html|HTTP/1.1|?#Accept-Encoding:gzip, deflate|" },
+		{ "no headers", "GET / HTTP/1.1\r\n\r\n", Status::complete, "GET|/|HTTP/1.1|?#" },
+		{ "upload", "POST /rr_upload?name=0:/gcodes/a%20b.g&time=2026-10-19T10:00:00&crc32=1a2b3c4d HTTP/1.1\r\nContent-Length: 12\r\n\r\nG1 X10 Y20\r\n",
+				Status::complete, "POST|/rr_upload|HTTP/1.1|?name=0:/gcodes/a b.g|time=2026-10-19T10:00:00|crc32=1a2b3c4d|#Content-Length:12|" },
+		{ "escapes and plus", "GET /rr_gcode?gcode=M117+Hello%2C%20World%21 HTTP/1.1\r\n\r\n",
+				Status::complete, "GET|/rr_gcode|HTTP/1.1|?gcode=M117 Hello, World!|#" },
+		{ "escaped filename", "GET /www/My%20File.htm HTTP/1.1\r\n\r\n", Status::complete, "GET|/www/My File.htm|HTTP/1.1|?#" },
+		{ "IE11 trailing question mark", "GET /fonts/glyphicons.eot? HTTP/1.1\r\n\r\n",
+				Status::complete, "GET|/fonts/glyphicons.eot|HTTP/1.1|?#" },
+		{ "continuation", "GET / HTTP/1.1\r\nX-Long: first\r\n\tsecond\r\nHost: h\r\n\r\n",
+				Status::complete, "GET|/|HTTP/1.1|?#X-Long:first\tsecond|Host:h|" },
+		{ "space before value", "GET / HTTP/1.1\r\nHost:   \t h\r\nIf-None-Match:\"abc\"\r\n\r\n",
+				Status::complete, "GET|/|HTTP/1.1|?#Host:h|If-None-Match:\"abc\"|" },
+		{ "stray return", "GET / HTTP/1.1\r\nX-A\rB: c\rd\r\n\r\n", Status::complete, "GET|/|HTTP/1.1|?#X-AB:cd|" },
+		{ "colon in value", "GET / HTTP/1.1\r\nHost: 10.0.0.1:8080\r\n\r\n", Status::complete, "GET|/|HTTP/1.1|?#Host:10.0.0.1:8080|" },
+		{ "max qualifiers", "GET /rr_x?a=1&b=2&c=3&d=4&e=5 HTTP/1.1\r\n\r\n", Status::complete, "GET|/rr_x|HTTP/1.1|?a=1|b=2|c=3|d=4|e=5|#" },
+		{ "max headers", ManyHeaders(HttpRequestParser::MaxHeaders - 1), Status::complete, manyHeadersExpected.c_str() },
+		{ "too many qualifiers", "GET /rr_x?a=1&b=2&c=3&d=4&e=5&f=6 HTTP/1.1\r\n\r\n", Status::rejected, "too many keys in qualifier" },
+		{ "too many headers", ManyHeaders(HttpRequestParser::MaxHeaders), Status::rejected, "too many header key-value pairs" },
+		{ "max command words", "GET / HTTP/1.1 extra\r\n\r\n", Status::complete, "GET|/|HTTP/1.1|extra|?#" },
+		{ "too many command words", "GET / HTTP/1.1 extra more\r\n\r\n", Status::rejected, "too many command words" },
+		{ "bad escape", "GET /rr_gcode?gcode=M117%2g HTTP/1.1\r\n\r\n", Status::rejected, "bad escape" },
+		{ "lower case escape", "GET /a%2c HTTP/1.1\r\n\r\n", Status::rejected, "bad escape" },
+		{ "escape in key", "GET /rr_x?a%20=1 HTTP/1.1\r\n\r\n", Status::rejected, "bad qualifier key" },
+		{ "key without value", "GET /rr_x?a&b=1 HTTP/1.1\r\n\r\n", Status::rejected, "bad qualifier key" },
+		{ "header without colon", "GET / HTTP/1.1\r\nHost\r\n\r\n", Status::rejected, "unexpected newline" },
+		{ "long header", "GET / HTTP/1.1\r\nCookie: " + std::string(HttpRequestParser::WebMessageLength, 'x') + "\r\n\r\n", Status::rejected, "overflow" },
+		{ "long key", "GET / HTTP/1.1\r\n" + std::string(HttpRequestParser::WebMessageLength, 'k') + ": v\r\n\r\n", Status::rejected, "overflow" },
+		{ "long command", "GET /" + std::string(HttpRequestParser::WebMessageLength, 'f') + " HTTP/1.1\r\n\r\n", Status::rejected, "overflow" },
+		{ "incomplete", "GET /rr_status HTTP/1.1\r\nHost: h\r\n", Status::needMore, "" },
+	};
+
+	for (const TestCase& tc : cases)
+	{
+		const std::string expected = Expected(tc);
+
+		// One character at a time
+		parser.Reset();
+		if (!parser.IsEmpty())
+		{
+			Fail(tc.name, "not empty after Reset", "", "");
+		}
+		Status status;
+		const size_t usedByChar = ParseByChar(parser, tc.request, status);
+		const std::string byChar = Result(status, parser);
+		if (byChar != expected)
+		{
+			Fail(tc.name, "CharFromClient", byChar, expected);
+			continue;
+		}
+
+		// In chunks of every size, with the start of the next request after this one
+		const std::string input = tc.request + "GET /next HTTP/1.1\r\n";
+		for (size_t chunk = 1; chunk <= input.size(); ++chunk)
+		{
+			parser.Reset();
+			size_t used = 0;
+			status = Status::needMore;
+			while (used < input.size() && status == Status::needMore)
+			{
+				size_t consumed;
+				const size_t len = std::min(chunk, input.size() - used);
+				status = parser.CharsFromClient(input.data() + used, len, consumed);
+				if (consumed > len || (status == Status::needMore && consumed != len))
+				{
+					Fail(tc.name, "bad consumed count", std::to_string(consumed), std::to_string(len));
+				}
+				used += consumed;
+			}
+
+			const std::string byChunk = Result(status, parser);
+			if (tc.status == Status::needMore)
+			{
+				// The incomplete request runs into the next one, so all we can check is that the parser didn't stop early
+				if (used != input.size() && status == Status::complete)
+				{
+					Fail(tc.name, ("chunks of " + std::to_string(chunk) + " completed early").c_str(), byChunk, expected);
+				}
+			}
+			else if (byChunk != expected)
+			{
+				Fail(tc.name, ("chunks of " + std::to_string(chunk)).c_str(), byChunk, expected);
+			}
+			else if (status == Status::complete && used != usedByChar)
+			{
+				Fail(tc.name, ("chunks of " + std::to_string(chunk) + " consumed the wrong amount").c_str(), std::to_string(used), std::to_string(usedByChar));
+			}
+		}
+	}
+
+	if (failures != 0)
+	{
+		printf("%u failures\n", failures);
+		return 1;
+	}
+	printf("All passed\n");
+	return 0;
+}
+
+// End
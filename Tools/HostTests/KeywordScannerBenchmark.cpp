@@ -0,0 +1,181 @@
+/*
+ * KeywordScannerBenchmark.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host benchmark of the keyword scanner in src/Storage/KeywordScanner.h against the search that FileInfoParser did before it, which was one
+ *  strstr call per key on each chunk of the file. It builds slicer-style G-code with a PrusaSlicer header and footer, splits it into null-terminated
+ *  chunks of GCODE_READ_SIZE bytes as FileInfoParser reads them, and reports how many MB/s each method gets through when finding the first
+ *  occurrence of every file info key in each chunk. It also checks that they find the same positions. Most keys don't occur in a given file, so
+ *  strstr reads the whole chunk for each of them.
+ *
+ *  glibc's strstr uses SIMD instructions on x86. The firmware links newlib-nano (--specs=nano.specs), which is built to be small and has a simple
+ *  byte-at-a-time strstr, so strstr is also timed with a loop like that one. That figure is the better guide to what happens on the printer,
+ *  but only timing on the printer itself gives the real one.
+ *
+ *  Build:	g++ -std=c++17 -O2 -o KeywordScannerBenchmark KeywordScannerBenchmark.cpp
+ *  Usage:	KeywordScannerBenchmark [megabytes]
+ */
+
+#include "../../src/Storage/KeywordScanner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// The same keys as in FileInfoParser.cpp
+	constexpr const char *FileInfoKeys[] =
+	{
+		"layer_height", "Layer height", "layerHeight", "layer_thickness_mm", "layerThickness",
+		"generated by ", ";Sliced by ", "; KISSlicer", ";Sliced at: ", ";Generated with ",
+		" estimated printing time (normal mode)", " estimated printing time", ";TIME", " Build time", " Build Time",
+		"\n; Simulated print time",
+		"ilament used", ";Material#", "ilament length", ";    Ext ", "; Estimated Build Volume: "
+	};
+	constexpr size_t NumKeys = sizeof(FileInfoKeys)/sizeof(FileInfoKeys[0]);
+
+	constexpr KeywordScanner<NumKeys, TotalKeywordLength(FileInfoKeys) + 1> fileInfoScanner(FileInfoKeys);
+
+	constexpr size_t ChunkSize = 2048;							// GCODE_READ_SIZE on the Duet 2
+
+	// A strstr that compares one byte at a time, like the one in newlib-nano
+	const char *SimpleStrstr(const char *haystack, const char *needle)
+	{
+		for (; *haystack != 0; ++haystack)
+		{
+			size_t i = 0;
+			while (needle[i] != 0 && haystack[i] == needle[i])
+			{
+				++i;
+			}
+			if (needle[i] == 0)
+			{
+				return haystack;
+			}
+		}
+		return nullptr;
+	}
+
+	// Make G-code that looks like PrusaSlicer output, with the keys that it writes in the header and footer
+	std::string MakeGCode(size_t length)
+	{
+		std::mt19937 rng(12345);
+		std::uniform_real_distribution<double> coord(10.0, 240.0);
+		char line[100];
+		std::string s = "; generated by PrusaSlicer 2.6.0+win64 on 2026-10-19 at 10:00:00 UTC\n\n; external perimeters extrusion width = 0.45mm\n"
+						"; perimeters extrusion width = 0.45mm\n; infill extrusion width = 0.45mm\n\nM73 P0 R95\nM201 X1000 Y1000 Z200 E5000\n"
+						"M203 X200 Y200 Z12 E120\nM104 S215\nM140 S60\nG28\nG1 Z0.2 F720\nG92 E0\n";
+		double z = 0.2;
+		unsigned int lineNumber = 0;
+		while (s.size() < length)
+		{
+			if (lineNumber % 400 == 0)
+			{
+				z += 0.2;
+				snprintf(line, sizeof(line), ";LAYER_CHANGE\n;Z:%.1f\n;HEIGHT:0.2\nG1 Z%.3f F10800\n;TYPE:External perimeter\n;WIDTH:0.449999\n", z, z);
+			}
+			else if (lineNumber % 7 == 0)
+			{
+				snprintf(line, sizeof(line), "G1 X%.3f Y%.3f F10800\n", coord(rng), coord(rng));
+			}
+			else
+			{
+				snprintf(line, sizeof(line), "G1 X%.3f Y%.3f E%.5f\n", coord(rng), coord(rng), coord(rng) / 5000.0);
+			}
+			s += line;
+			++lineNumber;
+		}
+		s += "M107\n;TYPE:Custom\nM104 S0\nM140 S0\nG1 X0 Y200 F3000\nM84\n\n; filament used [mm] = 5240.63\n; filament used [cm3] = 12.61\n"
+			 "; filament used [g] = 15.64\n; filament cost = 0.39\n; total filament used [g] = 15.64\n"
+			 "; estimated printing time (normal mode) = 1h 23m 45s\n; estimated printing time (silent mode) = 1h 25m 1s\n\n"
+			 "; prusaslicer_config = begin\n; layer_height = 0.2\n; first_layer_height = 0.2\n; prusaslicer_config = end\n";
+		return s;
+	}
+
+	template<class Find> double TimeSearch(const std::vector<std::string>& chunks, size_t megabytes, std::vector<const char*>& positions, Find find)
+	{
+		size_t done = 0, total = 0;
+		const auto start = std::chrono::steady_clock::now();
+		while (total < megabytes * 1024 * 1024)
+		{
+			const std::string& chunk = chunks[done++ % chunks.size()];
+			find(chunk, positions);
+			total += chunk.size();
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return (double)total / (1024.0 * 1024.0) / seconds;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const size_t megabytes = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 64;
+	const std::string gcode = MakeGCode(4 * 1024 * 1024);
+	std::vector<std::string> chunks;
+	for (size_t pos = 0; pos < gcode.size(); pos += ChunkSize)
+	{
+		chunks.push_back(gcode.substr(pos, ChunkSize));			// std::string is null-terminated, like the FileInfoParser buffer
+	}
+
+	// Check that all three methods find the same first occurrences
+	unsigned int failures = 0, keysFound = 0;
+	for (const std::string& chunk : chunks)
+	{
+		const char *first[NumKeys] = {};
+		fileInfoScanner.Scan(chunk.c_str(), chunk.size(), [&first](size_t key, const char *pos) { if (first[key] == nullptr) { first[key] = pos; } });
+		for (size_t k = 0; k < NumKeys; ++k)
+		{
+			if (first[k] != strstr(chunk.c_str(), FileInfoKeys[k]) || first[k] != SimpleStrstr(chunk.c_str(), FileInfoKeys[k]))
+			{
+				printf("FAIL key \"%s\" found in different places\n", FileInfoKeys[k]);
+				++failures;
+			}
+			if (first[k] != nullptr)
+			{
+				++keysFound;
+			}
+		}
+	}
+	if (failures != 0)
+	{
+		printf("%u failures\n", failures);
+		return 1;
+	}
+
+	std::vector<const char*> positions(NumKeys);
+	const double scannerRate = TimeSearch(chunks, megabytes, positions, [](const std::string& chunk, std::vector<const char*>& pos)
+		{
+			std::fill(pos.begin(), pos.end(), nullptr);
+			fileInfoScanner.Scan(chunk.c_str(), chunk.size(), [&pos](size_t key, const char *p) { if (pos[key] == nullptr) { pos[key] = p; } });
+		});
+	const double strstrRate = TimeSearch(chunks, megabytes, positions, [](const std::string& chunk, std::vector<const char*>& pos)
+		{
+			for (size_t k = 0; k < NumKeys; ++k)
+			{
+				pos[k] = strstr(chunk.c_str(), FileInfoKeys[k]);
+			}
+		});
+	const double simpleRate = TimeSearch(chunks, megabytes, positions, [](const std::string& chunk, std::vector<const char*>& pos)
+		{
+			for (size_t k = 0; k < NumKeys; ++k)
+			{
+				pos[k] = SimpleStrstr(chunk.c_str(), FileInfoKeys[k]);
+			}
+		});
+
+	printf("%zu keys in %zu chunks of %zu bytes of slicer output, %u keys found\n", NumKeys, chunks.size(), ChunkSize, keysFound);
+	printf("KeywordScanner, one pass:            %8.1f MB/s\n", scannerRate);
+	printf("glibc strstr, one pass per key:      %8.1f MB/s (%.2fx the scanner)\n", strstrRate, strstrRate/scannerRate);
+	printf("simple strstr, one pass per key:     %8.1f MB/s (%.2fx the scanner)\n", simpleRate, simpleRate/scannerRate);
+	return 0;
+}
+
+// End
@@ -0,0 +1,168 @@
+/*
+ * KeywordScannerTest.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host test of the keyword scanner in src/Storage/KeywordScanner.h. For random buffers that are seeded with the keywords, it checks that the
+ *  scanner reports exactly the occurrences that a naive search finds, in order of the end of the match, and that the first occurrence of
+ *  each key is the one that strstr finds, which is what FileInfoParser relies on. It uses the file info keys and a set of keys that are
+ *  prefixes, suffixes and substrings of each other. The scanners are declared constexpr, as in FileInfoParser.cpp, so the test also checks
+ *  that the compiler can build them.
+ *
+ *  Build:	g++ -std=c++17 -O2 -o KeywordScannerTest KeywordScannerTest.cpp
+ *  Usage:	KeywordScannerTest [iterations]
+ */
+
+#include "../../src/Storage/KeywordScanner.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// The same keys as in FileInfoParser.cpp
+	constexpr const char *FileInfoKeys[] =
+	{
+		"layer_height", "Layer height", "layerHeight", "layer_thickness_mm", "layerThickness",
+		"generated by ", ";Sliced by ", "; KISSlicer", ";Sliced at: ", ";Generated with ",
+		" estimated printing time (normal mode)", " estimated printing time", ";TIME", " Build time", " Build Time",
+		"\n; Simulated print time",
+		"ilament used", ";Material#", "ilament length", ";    Ext ", "; Estimated Build Volume: "
+	};
+
+	// Keys that overlap in every way, so that the failure and output links get exercised
+	constexpr const char *OverlappingKeys[] =
+	{
+		"abcab", "bca", "ca", "a", "abc", "cabca", "bb", "\xC2\xB0", "\xB0" "C"
+	};
+
+	constexpr KeywordScanner<sizeof(FileInfoKeys)/sizeof(FileInfoKeys[0]), TotalKeywordLength(FileInfoKeys) + 1> fileInfoScanner(FileInfoKeys);
+	constexpr KeywordScanner<sizeof(OverlappingKeys)/sizeof(OverlappingKeys[0]), TotalKeywordLength(OverlappingKeys) + 1> overlappingScanner(OverlappingKeys);
+
+	struct Match
+	{
+		size_t key;
+		size_t start;
+	};
+
+	unsigned int failures = 0;
+
+	void Fail(const char *what, unsigned long iteration, size_t key)
+	{
+		if (failures < 20)
+		{
+			printf("FAIL iteration %lu key %zu: %s\n", iteration, key, what);
+		}
+		++failures;
+	}
+
+	// Fill a buffer with characters from the alphabet, with whole keys mixed in
+	std::vector<char> MakeBuffer(std::mt19937& rng, const char *alphabet, const char * const *keys, size_t numKeys)
+	{
+		const size_t len = std::uniform_int_distribution<size_t>(0, 600)(rng);
+		const size_t alphabetLength = strlen(alphabet);
+		std::vector<char> buf;
+		while (buf.size() < len)
+		{
+			if (std::uniform_int_distribution<int>(0, 15)(rng) == 0)
+			{
+				const char *key = keys[std::uniform_int_distribution<size_t>(0, numKeys - 1)(rng)];
+				buf.insert(buf.end(), key, key + strlen(key));
+			}
+			else
+			{
+				buf.push_back(alphabet[std::uniform_int_distribution<size_t>(0, alphabetLength - 1)(rng)]);
+			}
+		}
+		buf.push_back(0);
+		return buf;
+	}
+
+	template<class Scanner> void Check(const Scanner& scanner, const char * const *keys, size_t numKeys, const char *alphabet, std::mt19937& rng, unsigned long iteration)
+	{
+		const std::vector<char> buf = MakeBuffer(rng, alphabet, keys, numKeys);
+		const size_t len = buf.size() - 1;
+
+		std::vector<Match> found;
+		scanner.Scan(buf.data(), len, [&found, &buf](size_t key, const char *pos) { found.push_back(Match{key, (size_t)(pos - buf.data())}); });
+
+		// Every match must be a real occurrence and matches must come in order of their end position
+		size_t lastEnd = 0;
+		for (const Match& m : found)
+		{
+			const size_t keyLength = strlen(keys[m.key]);
+			if (m.start + keyLength > len || memcmp(buf.data() + m.start, keys[m.key], keyLength) != 0)
+			{
+				Fail("reported a match that isn't there", iteration, m.key);
+			}
+			else if (m.start + keyLength < lastEnd)
+			{
+				Fail("matches out of order", iteration, m.key);
+			}
+			else
+			{
+				lastEnd = m.start + keyLength;
+			}
+		}
+
+		// Every occurrence must be reported, and the first one must be where strstr finds it
+		for (size_t k = 0; k < numKeys; ++k)
+		{
+			const size_t keyLength = strlen(keys[k]);
+			size_t expected = 0, reported = 0;
+			for (size_t i = 0; i + keyLength <= len; ++i)
+			{
+				if (memcmp(buf.data() + i, keys[k], keyLength) == 0)
+				{
+					++expected;
+				}
+			}
+			const char *first = nullptr;
+			for (const Match& m : found)
+			{
+				if (m.key == k)
+				{
+					++reported;
+					if (first == nullptr)
+					{
+						first = buf.data() + m.start;
+					}
+				}
+			}
+			if (reported != expected)
+			{
+				Fail("wrong number of matches", iteration, k);
+			}
+			if (first != strstr(buf.data(), keys[k]))
+			{
+				Fail("first match differs from strstr", iteration, k);
+			}
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const unsigned long iterations = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 20000;
+	std::mt19937 rng(12345);
+
+	for (unsigned long i = 0; i < iterations; ++i)
+	{
+		Check(fileInfoScanner, FileInfoKeys, sizeof(FileInfoKeys)/sizeof(FileInfoKeys[0]), " ;:\n_layer_heightLTimeBuildSsmuiaEx#dg", rng, i);
+		Check(overlappingScanner, OverlappingKeys, sizeof(OverlappingKeys)/sizeof(OverlappingKeys[0]), "abcC\xC2\xB0", rng, i);
+	}
+
+	if (failures != 0)
+	{
+		printf("%u failures\n", failures);
+		return 1;
+	}
+	printf("All %lu iterations passed\n", iterations);
+	return 0;
+}
+
+// End
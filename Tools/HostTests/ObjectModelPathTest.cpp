@@ -0,0 +1,285 @@
+/*
+ * ObjectModelPathTest.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host test of ObjectModelPath in src/ObjectModel/ObjectModel.cpp, using a small object model with nested objects, arrays of objects and of values,
+ *  and a value of a type that GetPrimitiveValue doesn't handle. For each ID string it checks that a path compiles exactly when the ID identifies a value
+ *  that GetObjectValue can fetch, and that the compiled path then returns the same value as GetObjectValue. It also checks that a compiled path
+ *  follows changes to the values and to the objects along it, that it returns NoType when an array shrinks below its index, and SameAs.
+ *
+ *  Build:	g++ -std=c++17 -O2 -Istubs -DSUPPORT_OBJECT_MODEL=1 -o ObjectModelPathTest ObjectModelPathTest.cpp
+ *  Usage:	ObjectModelPathTest
+ */
+
+#include "../../src/ObjectModel/ObjectModel.cpp"
+
+#include <cstdio>
+
+namespace
+{
+	class Unencodable;										// a type that GetPrimitiveValue doesn't handle
+}
+
+template<> constexpr TypeCode TypeOf<Unencodable>() { return 100; }
+
+namespace
+{
+	class Axis : public ObjectModel
+	{
+	public:
+		float position = 0.0;
+		int32_t steps = 0;
+		char letter[2] = "X";
+
+	protected:
+		DECLARE_OBJECT_MODEL
+	};
+
+	const ObjectModelTableEntry Axis::objectModelTable[] =
+	{
+		// These entries must be in alphabetical order
+		{ "letter", OBJECT_MODEL_FUNC_BODY(Axis, self->letter), TYPE_OF(const char*), ObjectModelTableEntry::none },
+		{ "position", OBJECT_MODEL_FUNC_BODY(Axis, &self->position), TYPE_OF(Float3), ObjectModelTableEntry::live },
+		{ "steps", OBJECT_MODEL_FUNC_BODY(Axis, &self->steps), TYPE_OF(int32_t), ObjectModelTableEntry::none },
+	};
+
+	DEFINE_GET_OBJECT_MODEL_TABLE(Axis)
+
+	class Motion : public ObjectModel
+	{
+	public:
+		Axis axes[4];
+		size_t numAxes = 3;
+		uint32_t currents[4] = { 800, 900, 1000, 1100 };
+		size_t numCurrents = 4;
+		bool homed = false;
+		uint32_t state = 0;
+		uint32_t opaque = 0;
+
+		static const ObjectModelArrayDescriptor axesArrayDescriptor;
+		static const ObjectModelArrayDescriptor currentsArrayDescriptor;
+
+	protected:
+		DECLARE_OBJECT_MODEL
+	};
+
+	const ObjectModelArrayDescriptor Motion::axesArrayDescriptor =
+	{
+		[] (ObjectModel *self) -> size_t { return static_cast<Motion*>(self)->numAxes; },
+		[] (ObjectModel *self, size_t n) -> void* { return &static_cast<Motion*>(self)->axes[n]; }
+	};
+
+	const ObjectModelArrayDescriptor Motion::currentsArrayDescriptor =
+	{
+		[] (ObjectModel *self) -> size_t { return static_cast<Motion*>(self)->numCurrents; },
+		[] (ObjectModel *self, size_t n) -> void* { return &static_cast<Motion*>(self)->currents[n]; }
+	};
+
+	const ObjectModelTableEntry Motion::objectModelTable[] =
+	{
+		// These entries must be in alphabetical order
+		{ "axes", OBJECT_MODEL_FUNC_NOSELF(&axesArrayDescriptor), TYPE_OF(ObjectModel) | IsArray, ObjectModelTableEntry::none },
+		{ "currents", OBJECT_MODEL_FUNC_NOSELF(&currentsArrayDescriptor), TYPE_OF(uint32_t) | IsArray, ObjectModelTableEntry::none },
+		{ "homed", OBJECT_MODEL_FUNC_BODY(Motion, &self->homed), TYPE_OF(bool), ObjectModelTableEntry::live },
+		{ "opaque", OBJECT_MODEL_FUNC_BODY(Motion, &self->opaque), TYPE_OF(Unencodable), ObjectModelTableEntry::none },
+		{ "state", OBJECT_MODEL_FUNC_BODY(Motion, &self->state), TYPE_OF(Enum32), ObjectModelTableEntry::none },
+	};
+
+	DEFINE_GET_OBJECT_MODEL_TABLE(Motion)
+
+	class Root : public ObjectModel
+	{
+	public:
+		Motion motion;
+		IPAddress ip = IPAddress(0x0101A8C0);
+		float temperature = 21.5;
+
+	protected:
+		DECLARE_OBJECT_MODEL
+	};
+
+	const ObjectModelTableEntry Root::objectModelTable[] =
+	{
+		// These entries must be in alphabetical order
+		{ "ip", OBJECT_MODEL_FUNC_BODY(Root, &self->ip), TYPE_OF(IPAddress), ObjectModelTableEntry::none },
+		{ "motion", OBJECT_MODEL_FUNC_BODY(Root, &self->motion), TYPE_OF(ObjectModel), ObjectModelTableEntry::none },
+		{ "temperature", OBJECT_MODEL_FUNC_BODY(Root, &self->temperature), TYPE_OF(float), ObjectModelTableEntry::live },
+	};
+
+	DEFINE_GET_OBJECT_MODEL_TABLE(Root)
+
+	unsigned int failures = 0;
+
+	void Fail(const char *id, const char *what)
+	{
+		printf("FAIL \"%s\": %s\n", id, what);
+		++failures;
+	}
+
+	bool SameValue(TypeCode tc, const ExpressionValue& a, const ExpressionValue& b)
+	{
+		switch (tc)
+		{
+		case TYPE_OF(bool):
+			return a.bVal == b.bVal;
+
+		case TYPE_OF(const char*):
+			return strcmp(a.sVal, b.sVal) == 0;
+
+		default:
+			return a.uVal == b.uVal;							// the same bits for floats, integers, bitmaps, enums and IP addresses
+		}
+	}
+
+	// Compile the ID and check the result against GetObjectValue. Return true if the path compiled.
+	bool CheckId(Root& root, const char *id, bool expectValid)
+	{
+		ObjectModelPath path;
+		const bool compiled = path.Compile(&root, id);
+		if (compiled != expectValid)
+		{
+			Fail(id, (compiled) ? "compiled but shouldn't have" : "didn't compile");
+			return compiled;
+		}
+		if (compiled != path.IsValid())
+		{
+			Fail(id, "IsValid doesn't match the result of Compile");
+		}
+
+		ExpressionValue pathVal, directVal;
+		const TypeCode pathType = path.GetValue(&root, pathVal);
+		if (!compiled)
+		{
+			if (pathType != NoType)
+			{
+				Fail(id, "a path that didn't compile returned a value");
+			}
+			return false;
+		}
+
+		// GetObjectValue accepts only a trailing index into an array of values, so it can't check IDs that index into an array of objects
+		if (strchr(id, '[') == nullptr || strncmp(id, "motion.currents[", 16) == 0)
+		{
+			const TypeCode directType = root.GetObjectValue(directVal, id);
+			if (pathType != directType)
+			{
+				Fail(id, "type differs from GetObjectValue");
+			}
+			else if (!SameValue(pathType, pathVal, directVal))
+			{
+				Fail(id, "value differs from GetObjectValue");
+			}
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	Root root;
+	for (size_t i = 0; i < 4; ++i)
+	{
+		root.motion.axes[i].position = 10.0 * i + 0.125;
+		root.motion.axes[i].steps = 1000 * (int32_t)i - 1500;
+		root.motion.axes[i].letter[0] = "XYZU"[i];
+	}
+
+	static const char * const ValidIds[] =
+	{
+		"temperature", "ip", "motion.homed", "motion.state", "motion.currents[0]", "motion.currents[3]",
+		"motion.axes[0].position", "motion.axes[1].steps", "motion.axes[2].letter", "motion.axes[2]position"
+	};
+	static const char * const InvalidIds[] =
+	{
+		"", "*", "motion", "motion.", "motion.axes", "motion.axes[", "motion.axes[]", "motion.axes[x].position", "motion.axes[1]",
+		"motion.axes[3].position", "motion.axes[1].position.x", "motion.currents", "motion.currents[4]", "motion.opaque", "temperature.x",
+		"temperatures", "temp", "nothing", "motion.*", "motion.axes[0].*"
+	};
+
+	for (const char *id : ValidIds)
+	{
+		(void)CheckId(root, id, true);
+	}
+	for (const char *id : InvalidIds)
+	{
+		(void)CheckId(root, id, false);
+	}
+
+	// A compiled path must follow changes to the values and to the objects along it
+	ObjectModelPath position, current, homed;
+	if (!position.Compile(&root, "motion.axes[2].position") || !current.Compile(&root, "motion.currents[3]") || !homed.Compile(&root, "motion.homed"))
+	{
+		Fail("motion.axes[2].position", "didn't compile");
+	}
+	else
+	{
+		root.motion.axes[2].position = -7.25;
+		root.motion.currents[3] = 1234;
+		root.motion.homed = true;
+		ExpressionValue val;
+		if (position.GetValue(&root, val) != TYPE_OF(Float3) || val.fVal != -7.25f)
+		{
+			Fail("motion.axes[2].position", "didn't follow a change of value");
+		}
+		if (current.GetValue(&root, val) != TYPE_OF(uint32_t) || val.uVal != 1234)
+		{
+			Fail("motion.currents[3]", "didn't follow a change of value");
+		}
+		if (homed.GetValue(&root, val) != TYPE_OF(bool) || !val.bVal)
+		{
+			Fail("motion.homed", "didn't follow a change of value");
+		}
+
+		// A path into a different root object of the same class gets that object's value
+		Root other;
+		other.motion.axes[2].position = 3.5;
+		if (position.GetValue(&other, val) != TYPE_OF(Float3) || val.fVal != 3.5f)
+		{
+			Fail("motion.axes[2].position", "didn't follow a change of object");
+		}
+
+		// When the arrays shrink, the paths must stop returning values, and start again when they grow
+		root.motion.numAxes = 2;
+		root.motion.numCurrents = 3;
+		if (position.GetValue(&root, val) != NoType)
+		{
+			Fail("motion.axes[2].position", "returned a value after the array shrank");
+		}
+		if (current.GetValue(&root, val) != NoType)
+		{
+			Fail("motion.currents[3]", "returned a value after the array shrank");
+		}
+		if (homed.GetValue(&root, val) != TYPE_OF(bool))
+		{
+			Fail("motion.homed", "stopped returning a value after an unrelated array shrank");
+		}
+		root.motion.numAxes = 3;
+		root.motion.numCurrents = 4;
+		if (position.GetValue(&root, val) != TYPE_OF(Float3) || val.fVal != -7.25f)
+		{
+			Fail("motion.axes[2].position", "didn't return the value after the array grew again");
+		}
+	}
+
+	// SameAs must compare the whole path, including the array indices
+	ObjectModelPath a, b, c;
+	(void)a.Compile(&root, "motion.axes[1].position");
+	(void)b.Compile(&root, "motion.axes[1]position");
+	(void)c.Compile(&root, "motion.axes[0].position");
+	if (!a.SameAs(b) || a.SameAs(c) || a.SameAs(homed))
+	{
+		Fail("motion.axes[1].position", "SameAs gave the wrong answer");
+	}
+
+	if (failures != 0)
+	{
+		printf("%u failures\n", failures);
+		return 1;
+	}
+	printf("All passed\n");
+	return 0;
+}
+
+// End
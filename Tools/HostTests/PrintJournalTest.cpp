@@ -0,0 +1,343 @@
+/*
+ * PrintJournalTest.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host test of src/Storage/PrintJournal.cpp, with the journal file held in memory. It writes journals of layer records with resurrect.g markers
+ *  in between, through SetPendingRecord, MoveCompleted and AddResumeFileMarker, and checks that only records whose moves have been executed are
+ *  written. Then it checks what ReadLastRecord returns, and whether M916 would resume from the journal, when the journal:
+ *   - is complete
+ *   - is truncated at every byte offset, as when the power fails part way through a write
+ *   - has a byte of a record changed, so that its CRC is wrong
+ *   - has a record whose sequence number is wrong but whose CRC is right, as when an old record is left after a new one
+ *   - has a bad header
+ *  In each case resume must use the last record before the damage, and must not use the journal if that record is a resurrect.g marker.
+ *  It also checks that a write failure stops the journal but keeps the records already written, and that starting a new print replaces the journal.
+ *
+ *  Build:	g++ -std=c++17 -O2 -Istubs -o PrintJournalTest PrintJournalTest.cpp
+ *  Usage:	PrintJournalTest [iterations]
+ */
+
+#include "FileStore.h"										// the stand-in, which must come before the firmware files that include the real one
+#include "../../src/Storage/CRC32.cpp"
+#include "../../src/Storage/PrintJournal.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::vector<char> journalData;
+	bool journalExists = false;
+	std::vector<std::unique_ptr<FileStore>> openedFiles;
+	FileStore *journalWriter = nullptr;						// the last file opened for writing the journal
+	unsigned int failures = 0;
+
+	void Fail(const std::string& what)
+	{
+		if (failures < 20)
+		{
+			printf("FAIL %s\n", what.c_str());
+		}
+		++failures;
+	}
+
+	// What ReadLastRecord should find in a journal: the last good record, or none
+	struct Expected
+	{
+		bool found;
+		PrintJournal::Record record;
+	};
+}
+
+RepRap reprap;
+
+FileStore* Platform::OpenSysFile(const char *filename, OpenMode mode) const
+{
+	if (strcmp(filename, PrintJournal::JournalFileName) != 0 || (mode == OpenMode::read && !journalExists))
+	{
+		return nullptr;
+	}
+	journalExists = true;
+	openedFiles.push_back(std::make_unique<FileStore>(journalData, mode));
+	if (mode != OpenMode::read)
+	{
+		journalWriter = openedFiles.back().get();
+	}
+	return openedFiles.back().get();
+}
+
+bool Platform::DeleteSysFile(const char *filename) const
+{
+	if (strcmp(filename, PrintJournal::JournalFileName) != 0 || !journalExists)
+	{
+		return false;
+	}
+	journalData.clear();
+	journalExists = false;
+	return true;
+}
+
+void Platform::MessageF(MessageType type, const char *fmt, ...)
+{
+}
+
+namespace
+{
+	constexpr size_t HeaderSize = sizeof(uint32_t) + MaxFilenameLength + 1 + 3 + sizeof(uint32_t);	// the size of PrintJournal::Header, which is private
+	constexpr size_t RecordSize = sizeof(PrintJournal::Record);
+	const char * const PrintingFile = "0:/gcodes/Part with a long name.gcode";
+
+	PrintJournal::Record MakeRecord(std::mt19937& rng, FilePosition filePos)
+	{
+		std::uniform_real_distribution<float> value(-100.0, 300.0);
+		PrintJournal::Record r;
+		memset(&r, 0, sizeof(r));
+		r.filePos = filePos;
+		r.coords[0] = value(rng);
+		r.coords[1] = value(rng);
+		r.coords[2] = value(rng);
+		r.virtualExtruderPosition = value(rng);
+		r.feedRate = 50.0;
+		r.toolTemperature = 210.0;
+		r.bedTemperature = 60.0;
+		r.fanSpeed = 0.5;
+		r.toolNumber = (int16_t)std::uniform_int_distribution<int>(-1, 3)(rng);
+		r.flags = (uint16_t)std::uniform_int_distribution<int>(0, 3)(rng);		// drives relative and using inches
+		return r;
+	}
+
+	bool SameContents(const PrintJournal::Record& a, const PrintJournal::Record& b)
+	{
+		return a.filePos == b.filePos && memcmp(a.coords, b.coords, sizeof(a.coords)) == 0 && a.virtualExtruderPosition == b.virtualExtruderPosition
+			&& a.feedRate == b.feedRate && a.toolTemperature == b.toolTemperature && a.bedTemperature == b.bedTemperature && a.fanSpeed == b.fanSpeed
+			&& a.toolNumber == b.toolNumber && a.flags == b.flags;
+	}
+
+	PrintJournal::Record RecordAt(const std::vector<char>& data, size_t offset)
+	{
+		PrintJournal::Record r;
+		memcpy(&r, data.data() + offset, sizeof(r));
+		return r;
+	}
+
+	// Read the journal back and check the result. M916 uses the journal only if the last record isn't a resurrect.g marker.
+	void CheckRead(const std::string& name, const Expected& expected)
+	{
+		char filenameBuffer[MaxFilenameLength + 1];
+		const StringRef filename(filenameBuffer, sizeof(filenameBuffer));
+		PrintJournal::Record r;
+		const size_t openBefore = openedFiles.size();
+		const bool found = PrintJournal::ReadLastRecord(filename, r);
+		for (size_t i = openBefore; i < openedFiles.size(); ++i)
+		{
+			if (openedFiles[i]->IsOpen())
+			{
+				Fail(name + ": ReadLastRecord left the journal open");
+			}
+		}
+
+		if (found != expected.found)
+		{
+			Fail(name + ((found) ? ": found a record that it shouldn't have" : ": didn't find a record"));
+			return;
+		}
+		if (found)
+		{
+			if (memcmp(&r, &expected.record, sizeof(r)) != 0)
+			{
+				Fail(name + ": returned record " + std::to_string(r.sequence) + " instead of record " + std::to_string(expected.record.sequence));
+			}
+			if (strcmp(filename.c_str(), PrintingFile) != 0)
+			{
+				Fail(name + ": wrong file name \"" + filename.c_str() + "\"");
+			}
+			const bool resumeFromJournal = (r.flags & PrintJournal::ResumeFileSavedFlag) == 0;
+			const bool expectedResume = (expected.record.flags & PrintJournal::ResumeFileSavedFlag) == 0;
+			if (resumeFromJournal != expectedResume)
+			{
+				Fail(name + ": wrong choice between the journal and resurrect.g");
+			}
+		}
+	}
+
+	// Return what ReadLastRecord should find in the first 'length' bytes of the journal, given the offsets of the good records in it
+	Expected ExpectedAt(const std::vector<char>& data, const std::vector<size_t>& recordOffsets, size_t length)
+	{
+		Expected e = { false, {} };
+		for (size_t offset : recordOffsets)
+		{
+			if (offset + RecordSize <= length)
+			{
+				e.found = true;
+				e.record = RecordAt(data, offset);
+			}
+		}
+		return e;
+	}
+
+	void RunIteration(std::mt19937& rng, unsigned int iteration)
+	{
+		const std::string it = "iteration " + std::to_string(iteration);
+		PrintJournal journal;
+		if (!journal.Start(PrintingFile) || !journal.IsActive() || journalData.size() != HeaderSize)
+		{
+			Fail(it + ": Start failed or wrote a header of the wrong size");
+			return;
+		}
+
+		// Write some layers, with resurrect.g markers in between. Each layer's record is only written when its move has been executed.
+		std::vector<size_t> recordOffsets;
+		std::vector<PrintJournal::Record> written;
+		const size_t numLayers = std::uniform_int_distribution<size_t>(0, 12)(rng);
+		FilePosition filePos = 1000;
+		for (size_t layer = 0; layer < numLayers; ++layer)
+		{
+			if (std::uniform_int_distribution<int>(0, 3)(rng) == 0)
+			{
+				recordOffsets.push_back(journalData.size());
+				journal.AddResumeFileMarker();
+				PrintJournal::Record marker;
+				memset(&marker, 0, sizeof(marker));
+				marker.filePos = noFilePosition;
+				marker.toolNumber = -1;
+				marker.flags = PrintJournal::ResumeFileSavedFlag;
+				written.push_back(marker);
+			}
+
+			filePos += std::uniform_int_distribution<FilePosition>(1, 5000)(rng);
+			const PrintJournal::Record r = MakeRecord(rng, filePos);
+			journal.SetPendingRecord(r);
+
+			// A record whose move hasn't been executed yet mustn't be written
+			const size_t sizeBefore = journalData.size();
+			journal.MoveCompleted(noFilePosition);
+			journal.MoveCompleted(filePos - 1);
+			if (journalData.size() != sizeBefore)
+			{
+				Fail(it + ": a record was written before its move was executed");
+			}
+
+			// Sometimes the next layer starts before the move has been executed, which replaces the pending record
+			if (std::uniform_int_distribution<int>(0, 4)(rng) == 0)
+			{
+				continue;
+			}
+			recordOffsets.push_back(journalData.size());
+			journal.MoveCompleted(filePos + std::uniform_int_distribution<FilePosition>(0, 1)(rng));
+			journal.MoveCompleted(filePos + 10);												// the record must only be written once
+			written.push_back(r);
+		}
+
+		if (journalData.size() != HeaderSize + recordOffsets.size() * RecordSize)
+		{
+			Fail(it + ": the journal has the wrong size");
+			return;
+		}
+		for (size_t i = 0; i < recordOffsets.size(); ++i)
+		{
+			const PrintJournal::Record r = RecordAt(journalData, recordOffsets[i]);
+			if (r.sequence != i || !SameContents(r, written[i]))
+			{
+				Fail(it + ": record " + std::to_string(i) + " was written wrongly");
+			}
+		}
+
+		// The complete journal
+		CheckRead(it + ", complete", ExpectedAt(journalData, recordOffsets, journalData.size()));
+
+		// Truncated at every offset, as when the power fails part way through a write
+		const std::vector<char> complete = journalData;
+		for (size_t length = 0; length < complete.size(); ++length)
+		{
+			journalData.assign(complete.begin(), complete.begin() + length);
+			const Expected e = (length < HeaderSize) ? Expected{ false, {} } : ExpectedAt(complete, recordOffsets, length);
+			CheckRead(it + ", truncated to " + std::to_string(length), e);
+		}
+
+		for (size_t k = 0; k < recordOffsets.size(); ++k)
+		{
+			const std::vector<size_t> before(recordOffsets.begin(), recordOffsets.begin() + k);
+			const Expected e = ExpectedAt(complete, before, complete.size());
+
+			// A changed byte anywhere in record k, including its CRC
+			journalData = complete;
+			const size_t byte = recordOffsets[k] + std::uniform_int_distribution<size_t>(0, RecordSize - 1)(rng);
+			journalData[byte] ^= (char)std::uniform_int_distribution<int>(1, 255)(rng);
+			CheckRead(it + ", byte " + std::to_string(byte) + " of record " + std::to_string(k) + " changed", e);
+
+			// Record k has a good CRC but the wrong sequence number, as if it was left over from an older journal
+			journalData = complete;
+			PrintJournal::Record r = RecordAt(complete, recordOffsets[k]);
+			r.sequence += std::uniform_int_distribution<uint32_t>(1, 5)(rng) * ((std::uniform_int_distribution<int>(0, 1)(rng) == 0) ? 1u : (uint32_t)-1);
+			CRC32 crc;
+			crc.Update(reinterpret_cast<const uint8_t*>(&r), offsetof(PrintJournal::Record, crc));
+			r.crc = crc.Get();
+			memcpy(journalData.data() + recordOffsets[k], &r, sizeof(r));
+			CheckRead(it + ", record " + std::to_string(k) + " out of sequence", e);
+		}
+
+		// A bad header makes the whole journal unusable
+		journalData = complete;
+		journalData[std::uniform_int_distribution<size_t>(0, HeaderSize - 1)(rng)] ^= 0x20;
+		CheckRead(it + ", bad header", Expected{ false, {} });
+
+		// A write failure stops the journal, but the records already written can still be used
+		journalData = complete;
+		journalWriter->SetFailWrites(true);
+		journal.SetPendingRecord(MakeRecord(rng, filePos + 100));
+		journal.MoveCompleted(filePos + 100);
+		if (journal.IsActive())
+		{
+			Fail(it + ": the journal is still active after a write failed");
+		}
+		CheckRead(it + ", after a write failure", ExpectedAt(complete, recordOffsets, complete.size()));
+
+		// Finishing without deleting keeps the journal, and starting again replaces it with an empty one
+		journal.Finish(false);
+		if (!journalExists)
+		{
+			Fail(it + ": Finish(false) deleted the journal");
+		}
+		if (!journal.Start(PrintingFile))
+		{
+			Fail(it + ": Start failed");
+			return;
+		}
+		CheckRead(it + ", new journal", Expected{ false, {} });
+		journal.AddResumeFileMarker();
+		CheckRead(it + ", new journal with a marker", ExpectedAt(journalData, { HeaderSize }, journalData.size()));
+		journal.Finish(true);
+		if (journalExists)
+		{
+			Fail(it + ": Finish(true) didn't delete the journal");
+		}
+		CheckRead(it + ", deleted journal", Expected{ false, {} });
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const unsigned int iterations = (argc > 1) ? (unsigned int)atoi(argv[1]) : 300;
+	std::mt19937 rng(12345);
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		RunIteration(rng, i);
+		openedFiles.clear();
+	}
+
+	if (failures != 0)
+	{
+		printf("%u failures\n", failures);
+		return 1;
+	}
+	printf("All %u iterations passed\n", iterations);
+	return 0;
+}
+
+// End
@@ -0,0 +1,542 @@
+/*
+ * StatusDeltaTest.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host test of StatusDelta::MakeDelta in src/StatusDelta.cpp. It passes status responses to MakeDelta in chains of buffers of every size from 1 byte
+ *  up, so that keys, values and escapes are split across buffers, and checks the response against the fields of the status parsed separately. The
+ *  fixed cases cover strings that contain ',', '}', '{', ']', ':' and escaped quotes and backslashes, nested objects and arrays, a field that is
+ *  removed, added, moved or renamed, sequence numbers of 0, from before the last change of fields and from the future, the periodic full response,
+ *  more than MaxFields fields, malformed status and running out of buffers. Then a random sequence of changes is made to a status response, with
+ *  clients that pass back sequence numbers of different ages, and the test checks that applying each delta to what the client had at that sequence
+ *  number gives the current status, and that it contains no field that has not changed since then.
+ *
+ *  Build:	g++ -std=c++17 -O2 -Istubs -o StatusDeltaTest StatusDeltaTest.cpp
+ *  Usage:	StatusDeltaTest [iterations]
+ */
+
+#include "RepRapFirmware.h"									// the stand-ins, which must come before the firmware files that include the real ones
+#include "OutputMemory.h"
+#include "../../src/Storage/CRC32.cpp"
+#include "../../src/StatusDelta.cpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	uint32_t now = 1;
+
+	typedef std::vector<std::pair<std::string, std::string>> Fields;	// key including its quotes, and the value as written
+
+	unsigned int failures = 0;
+
+	void Fail(const char *name, const std::string& what)
+	{
+		printf("FAIL %s: %s\n", name, what.c_str());
+		++failures;
+	}
+
+	// Split the top-level object into its fields. This doesn't share any code with StatusDelta::ReadField. Return false if it isn't an object.
+	bool ParseFields(const std::string& json, Fields& fields)
+	{
+		fields.clear();
+		if (json.size() < 2 || json.front() != '{' || json.back() != '}')
+		{
+			return false;
+		}
+		if (json.size() == 2)
+		{
+			return true;
+		}
+
+		size_t start = 1;
+		int depth = 0;
+		bool inString = false;
+		for (size_t i = 1; i < json.size(); ++i)
+		{
+			const char c = json[i];
+			if (inString)
+			{
+				if (c == '\\')
+				{
+					++i;
+				}
+				else if (c == '"')
+				{
+					inString = false;
+				}
+			}
+			else if (c == '"')
+			{
+				inString = true;
+			}
+			else if (c == '{' || c == '[')
+			{
+				++depth;
+			}
+			else if ((c == '}' || c == ']') && depth > 0)
+			{
+				--depth;
+			}
+			else if (depth == 0 && (c == ',' || c == '}'))
+			{
+				const std::string member = json.substr(start, i - start);
+				const size_t keyEnd = member.find("\":");
+				if (member.empty() || member[0] != '"' || keyEnd == std::string::npos)
+				{
+					return false;
+				}
+				fields.emplace_back(member.substr(0, keyEnd + 1), member.substr(keyEnd + 2));
+				start = i + 1;
+			}
+		}
+		return !inString && depth == 0 && start == json.size();
+	}
+
+	std::string MakeJson(const Fields& fields)
+	{
+		std::string s = "{";
+		for (const auto& f : fields)
+		{
+			if (s.size() > 1)
+			{
+				s += ',';
+			}
+			s += f.first + ":" + f.second;
+		}
+		return s + "}";
+	}
+
+	// Make a chain of buffers holding the text, each but the last holding bufferSize characters
+	OutputBuffer *MakeChain(const std::string& text, size_t bufferSize)
+	{
+		OutputBuffer *first = nullptr;
+		size_t pos = 0;
+		do
+		{
+			OutputBuffer *buf;
+			OutputBuffer::Allocate(buf);
+			buf->cat(text.c_str() + pos, std::min(bufferSize, text.size() - pos));
+			pos += bufferSize;
+			if (first == nullptr)
+			{
+				first = buf;
+			}
+			else
+			{
+				first->Append(buf);
+			}
+		} while (pos < text.size());
+		return first;
+	}
+
+	struct Delta
+	{
+		bool ok;
+		uint32_t seq;
+		bool full;
+		Fields fields;
+	};
+
+	// Pass the status to MakeDelta and take apart the response
+	Delta GetDelta(const char *name, StatusDelta& sd, const std::string& status, uint32_t since, size_t bufferSize)
+	{
+		Delta d { false, 0, false, {} };
+		OutputBuffer *response = sd.MakeDelta(MakeChain(status, bufferSize), since);
+		if (response == nullptr)
+		{
+			Fail(name, "no response");
+			return d;
+		}
+		const std::string text = response->ChainText();
+		OutputBuffer::ReleaseAll(response);
+
+		Fields fields;
+		if (!ParseFields(text, fields) || fields.size() < 2 || fields[0].first != "\"seq\"" || fields[1].first != "\"full\""
+			|| (fields[1].second != "0" && fields[1].second != "1"))
+		{
+			Fail(name, "bad response " + text);
+			return d;
+		}
+		d.ok = true;
+		d.seq = strtoul(fields[0].second.c_str(), nullptr, 10);
+		d.full = (fields[1].second == "1");
+		d.fields.assign(fields.begin() + 2, fields.end());
+		return d;
+	}
+
+	std::string Describe(const Fields& fields)
+	{
+		std::string s;
+		for (const auto& f : fields)
+		{
+			s += f.first + ":" + f.second + " ";
+		}
+		return s;
+	}
+
+	// Check a delta against the full status and the names of the fields that should be in it, or an empty list for a full response
+	void Check(const char *name, const Delta& d, const Fields& status, bool expectFull, const std::vector<std::string>& expectedKeys)
+	{
+		if (!d.ok)
+		{
+			return;
+		}
+		if (d.full != expectFull)
+		{
+			Fail(name, std::string("full is ") + ((d.full) ? "1" : "0"));
+			return;
+		}
+
+		Fields expected;
+		for (const auto& f : status)
+		{
+			if (expectFull || std::find(expectedKeys.begin(), expectedKeys.end(), f.first) != expectedKeys.end())
+			{
+				expected.push_back(f);
+			}
+		}
+		if (d.fields != expected)
+		{
+			Fail(name, "got " + Describe(d.fields) + "\n  expected " + Describe(expected));
+		}
+	}
+
+	// Strings that a status response can contain and that a parser that ignored quotes or escapes would get wrong
+	const char *const AwkwardStrings[] =
+	{
+		"\"\"", "\"a,b\"", "\"}\"", "\"{\"", "\"]\"", "\"[\"", "\",\\\"x\\\":1}\"", "\"ends with backslash\\\\\"", "\"\\\\\\\"\"",
+		"\"key:value\"", "\"M117 Hello, World!\"", "\"\\u0041\"", "\"x\\\"}\"",
+	};
+
+	// Values of all kinds, including nested objects and arrays that contain awkward strings
+	std::string RandomValue(std::mt19937& rng)
+	{
+		const char *const strings[] = { "\"a,b\"", "\"}\"", "\"\\\"\"", "\"\\\\\"", "\"[\"" };
+		switch (rng() % 6)
+		{
+		case 0:
+			return std::to_string(rng() % 1000);
+		case 1:
+			return std::to_string(rng() % 1000) + "." + std::to_string(rng() % 10);
+		case 2:
+			return AwkwardStrings[rng() % ARRAY_SIZE(AwkwardStrings)];
+		case 3:
+			return "[" + std::to_string(rng() % 10) + "," + strings[rng() % ARRAY_SIZE(strings)] + ",[]]";
+		case 4:
+			return std::string("{\"s\":") + strings[rng() % ARRAY_SIZE(strings)] + ",\"n\":{\"a\":[" + std::to_string(rng() % 10) + "]}}";
+		default:
+			return (rng() % 2 == 0) ? "null" : "true";
+		}
+	}
+
+	void FixedCases(size_t bufferSize)
+	{
+		char name[100];
+		auto Name = [&name, bufferSize](const char *what) { snprintf(name, sizeof(name), "%s, %zu byte buffers", what, bufferSize); return name; };
+
+		StatusDelta sd;
+		Fields status =
+		{
+			{ "\"status\"", "\"I\"" },
+			{ "\"coords\"", "{\"xyz\":[0.000,0.000,0.000],\"extr\":[0.0]}" },
+			{ "\"msg\"", "\"a,b}c\\\"d\\\\\"" },
+			{ "\"temps\"", "{\"bed\":{\"current\":21.5,\"state\":0},\"names\":[\"\",\"}\"]}" },
+			{ "\"seqs\"", "[1,2,3]" },
+		};
+
+		// The first response is full, and one with the same status since then is empty
+		Delta d = GetDelta(Name("first"), sd, MakeJson(status), 0, bufferSize);
+		Check(name, d, status, true, {});
+		uint32_t seq = d.seq;
+		d = GetDelta(Name("unchanged"), sd, MakeJson(status), seq, bufferSize);
+		Check(name, d, status, false, {});
+		if (d.seq != seq)
+		{
+			Fail(name, "sequence number changed");
+		}
+
+		// Change fields one at a time, including inside strings and nested values
+		status[2].second = "\"a,b}c\\\"e\\\\\"";
+		d = GetDelta(Name("string changed"), sd, MakeJson(status), seq, bufferSize);
+		Check(name, d, status, false, { "\"msg\"" });
+		const uint32_t seqBeforeTemps = d.seq;
+		status[3].second = "{\"bed\":{\"current\":21.6,\"state\":0},\"names\":[\"\",\"}\"]}";
+		d = GetDelta(Name("nested changed"), sd, MakeJson(status), d.seq, bufferSize);
+		Check(name, d, status, false, { "\"temps\"" });
+
+		// A client that is further behind gets all the changes since its sequence number
+		d = GetDelta(Name("older sequence"), sd, MakeJson(status), seq, bufferSize);
+		Check(name, d, status, false, { "\"msg\"", "\"temps\"" });
+		d = GetDelta(Name("one change behind"), sd, MakeJson(status), seqBeforeTemps, bufferSize);
+		Check(name, d, status, false, { "\"temps\"" });
+		seq = d.seq;
+
+		// A sequence number from the future, as after a reset, and 0 get the full status
+		d = GetDelta(Name("future sequence"), sd, MakeJson(status), seq + 1, bufferSize);
+		Check(name, d, status, true, {});
+		d = GetDelta(Name("maximum sequence"), sd, MakeJson(status), 0xFFFFFFFF, bufferSize);
+		Check(name, d, status, true, {});
+		d = GetDelta(Name("zero sequence"), sd, MakeJson(status), 0, bufferSize);
+		Check(name, d, status, true, {});
+
+		// A removed field means that every client gets the full status once, including ones that are up to date
+		const Fields before = status;
+		status.erase(status.begin() + 1);
+		d = GetDelta(Name("field removed"), sd, MakeJson(status), seq, bufferSize);
+		Check(name, d, status, true, {});
+		const uint32_t seqAfterRemove = d.seq;
+		d = GetDelta(Name("after removal"), sd, MakeJson(status), seqAfterRemove, bufferSize);
+		Check(name, d, status, false, {});
+		d = GetDelta(Name("before removal"), sd, MakeJson(status), seqAfterRemove - 1, bufferSize);
+		Check(name, d, status, true, {});
+
+		// So does an added field, fields that change places, and a renamed field, even when only the part of its name after a ':' changes
+		status = before;
+		status.emplace_back("\"a:b\"", "1");
+		d = GetDelta(Name("field added"), sd, MakeJson(status), d.seq, bufferSize);
+		Check(name, d, status, true, {});
+		std::swap(status[0], status[1]);
+		d = GetDelta(Name("fields swapped"), sd, MakeJson(status), d.seq, bufferSize);
+		Check(name, d, status, true, {});
+		status.back().first = "\"a:c\"";
+		d = GetDelta(Name("field renamed"), sd, MakeJson(status), d.seq, bufferSize);
+		Check(name, d, status, true, {});
+
+		// A value that changes and then changes back is still sent to a client that saw neither change
+		seq = d.seq;
+		const std::string old = status[4].second;
+		status[4].second = "[1,2,4]";
+		(void)GetDelta(Name("changed"), sd, MakeJson(status), seq, bufferSize);
+		status[4].second = old;
+		d = GetDelta(Name("changed back"), sd, MakeJson(status), seq, bufferSize);
+		Check(name, d, status, false, { "\"seqs\"" });
+
+		// The full status is sent at least once every FullSnapshotInterval even if nothing changes
+		seq = d.seq;
+		now += 59999;
+		d = GetDelta(Name("before snapshot"), sd, MakeJson(status), seq, bufferSize);
+		Check(name, d, status, false, {});
+		now += 1;
+		d = GetDelta(Name("snapshot"), sd, MakeJson(status), seq, bufferSize);
+		Check(name, d, status, true, {});
+		if (d.seq == seq)
+		{
+			Fail(name, "snapshot didn't change the sequence number");
+		}
+		d = GetDelta(Name("after snapshot"), sd, MakeJson(status), d.seq, bufferSize);
+		Check(name, d, status, false, {});
+
+		// A single field, and an empty object
+		StatusDelta sd2;
+		const Fields single = { { "\"a\"", AwkwardStrings[6] } };
+		d = GetDelta(Name("single field"), sd2, MakeJson(single), 0, bufferSize);
+		Check(name, d, single, true, {});
+		d = GetDelta(Name("single field unchanged"), sd2, MakeJson(single), d.seq, bufferSize);
+		Check(name, d, single, false, {});
+		d = GetDelta(Name("single field removed"), sd2, "{}", d.seq, bufferSize);
+		Check(name, d, {}, true, {});
+	}
+
+	// Fields after the first MaxFields aren't tracked, so they are always sent
+	void ManyFields()
+	{
+		StatusDelta sd;
+		Fields status;
+		for (int i = 0; i < 40; ++i)
+		{
+			status.emplace_back("\"f" + std::to_string(i) + "\"", std::to_string(i));
+		}
+		Delta d = GetDelta("many fields", sd, MakeJson(status), 0, 7);
+		Check("many fields", d, status, true, {});
+		status[3].second = "x";
+		d = GetDelta("many fields", sd, MakeJson(status), d.seq, 7);
+		std::vector<std::string> expected = { "\"f3\"" };
+		for (int i = 32; i < 40; ++i)
+		{
+			expected.push_back("\"f" + std::to_string(i) + "\"");
+		}
+		Check("many fields changed", d, status, false, expected);
+	}
+
+	// A status that isn't a JSON object is passed back unchanged, and running out of buffers releases the status
+	void BadInput()
+	{
+		StatusDelta sd;
+		const char *const bad[] = { "[1,2]", "{\"a\":1", "{\"a\":\"1}", "{\"a\":1]}", "{\"a\"}", "{\"a\":1,}", "" };
+		for (const char *text : bad)
+		{
+			OutputBuffer * const status = MakeChain(text, 3);
+			OutputBuffer *response = sd.MakeDelta(status, 0);
+			if (response != status)
+			{
+				Fail("malformed status", std::string("not passed back unchanged: ") + text);
+			}
+			OutputBuffer::ReleaseAll(response);
+		}
+
+		OutputBuffer * const status = MakeChain("{\"a\":1}", 3);
+		OutputBuffer::failAllocations = true;
+		OutputBuffer * const response = sd.MakeDelta(status, 0);
+		OutputBuffer::failAllocations = false;
+		if (response != nullptr)
+		{
+			Fail("out of buffers", "got a response");
+		}
+	}
+
+	// Make random changes to a status and check the deltas that clients with sequence numbers of different ages get
+	void RandomChanges(unsigned int iterations)
+	{
+		std::mt19937 rng(12345);
+		StatusDelta sd;
+		Fields status;
+		for (int i = 0; i < 12; ++i)
+		{
+			status.emplace_back("\"k" + std::to_string(i) + "\"", RandomValue(rng));
+		}
+
+		std::map<uint32_t, Fields> history;							// what a client that was given each sequence number has
+		Delta d = GetDelta("random", sd, MakeJson(status), 0, 5);
+		history[d.seq] = status;
+		uint32_t layoutSeq = d.seq;
+		uint32_t lastSnapshotTime = now;
+
+		for (unsigned int i = 0; i < iterations && failures == 0; ++i)
+		{
+			// Change a few fields, and occasionally remove or add one
+			const unsigned int changes = rng() % 3;
+			for (unsigned int c = 0; c < changes; ++c)
+			{
+				status[rng() % status.size()].second = RandomValue(rng);
+			}
+			bool layoutChanged = false;
+			if (rng() % 50 == 0 && status.size() > 2)
+			{
+				status.erase(status.begin() + rng() % status.size());
+				layoutChanged = true;
+			}
+			else if (rng() % 50 == 0 && status.size() < 20)
+			{
+				status.emplace(status.begin() + rng() % status.size(), "\"n" + std::to_string(i) + "\"", RandomValue(rng));
+				layoutChanged = true;
+			}
+			now += rng() % 1000;
+
+			// Pick a client: up to date, behind by a few responses, or knowing nothing
+			uint32_t since = 0;
+			const unsigned int age = rng() % 6;
+			if (age != 5)
+			{
+				auto it = history.end();
+				for (unsigned int a = 0; a <= age && it != history.begin(); ++a)
+				{
+					--it;
+				}
+				since = it->first;
+			}
+
+			const size_t bufferSize = 1 + rng() % 40;
+			d = GetDelta("random", sd, MakeJson(status), since, bufferSize);
+			if (!d.ok)
+			{
+				break;
+			}
+
+			// After the fields change, and every FullSnapshotInterval, every client that isn't up to date with this response gets the full status
+			if (layoutChanged || now - lastSnapshotTime >= 60000)
+			{
+				layoutSeq = d.seq;
+				lastSnapshotTime = now;
+			}
+			const bool expectFull = (since == 0 || since < layoutSeq);
+			if (d.full != expectFull)
+			{
+				Fail("random", std::string("full is ") + ((d.full) ? "1" : "0") + " for sequence number " + std::to_string(since));
+			}
+			else if (d.full)
+			{
+				if (d.fields != status)
+				{
+					Fail("random", "full response is wrong: " + Describe(d.fields));
+				}
+			}
+			else
+			{
+				// Applying the delta to what the client had must give the current status
+				const Fields& old = history[since];
+				Fields updated = old;
+				for (const auto& f : d.fields)
+				{
+					for (auto& u : updated)
+					{
+						if (u.first == f.first)
+						{
+							u.second = f.second;
+						}
+					}
+				}
+				if (updated != status)
+				{
+					Fail("random", "delta since " + std::to_string(since) + " gives " + Describe(updated) + "\n  expected " + Describe(status));
+				}
+
+				// and it must not include a field that has had the same value in every response since then
+				for (const auto& f : d.fields)
+				{
+					const auto Value = [&f](const Fields& fields) { for (const auto& g : fields) { if (g.first == f.first) { return g.second; } } return std::string(); };
+					bool changed = (f.second != Value(old));
+					for (auto it = history.upper_bound(since); it != history.end() && !changed; ++it)
+					{
+						changed = (Value(it->second) != Value(old));
+					}
+					if (!changed)
+					{
+						Fail("random", "delta since " + std::to_string(since) + " includes unchanged field " + f.first);
+					}
+				}
+			}
+			history[d.seq] = status;
+		}
+	}
+}
+
+uint32_t millis()
+{
+	return now;
+}
+
+int main(int argc, char **argv)
+{
+	const unsigned int iterations = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 20000;
+
+	for (size_t bufferSize = 1; bufferSize <= 200; ++bufferSize)
+	{
+		FixedCases(bufferSize);
+	}
+	ManyFields();
+	BadInput();
+	RandomChanges(iterations);
+
+	if (OutputBuffer::buffersInUse != 0)
+	{
+		Fail("buffers", std::to_string(OutputBuffer::buffersInUse) + " buffers not released");
+	}
+	if (failures != 0)
+	{
+		printf("%u failures\n", failures);
+		return 1;
+	}
+	printf("All passed\n");
+	return 0;
+}
+
+// End
@@ -0,0 +1,81 @@
+/*
+ * FileStore.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for src/Storage/FileStore.h, for the host tests in Tools/HostTests. The file is held in a vector owned by the test, and writes can be made
+ *  to fail. Source files in src/Storage include "FileStore.h" from their own directory, so a test must include this file before them. It uses the same
+ *  include guard as the real one, which is then skipped.
+ */
+
+#ifndef FILESTORE_H
+#define FILESTORE_H
+
+#include "RepRapFirmware.h"
+
+#include <algorithm>
+#include <vector>
+
+enum class OpenMode : uint8_t
+{
+	read,			// open an existing file for reading
+	write,			// write a file, replacing any existing file of the same name
+	writeWithCrc,	// as write but calculate the CRC as we go
+	append			// append to an existing file, or create a new file if it is not found
+};
+
+class FileStore
+{
+public:
+	FileStore(std::vector<char>& p_data, OpenMode mode)
+		: data(p_data), position((mode == OpenMode::append) ? p_data.size() : 0), writing(mode != OpenMode::read), isOpen(true), failWrites(false)
+	{
+		if (mode == OpenMode::write || mode == OpenMode::writeWithCrc)
+		{
+			data.clear();
+		}
+	}
+
+	int Read(char* buf, size_t nBytes)
+	{
+		if (!isOpen)
+		{
+			return -1;
+		}
+		const size_t n = (position < data.size()) ? std::min(nBytes, data.size() - position) : 0;
+		memcpy(buf, data.data() + position, n);
+		position += n;
+		return (int)n;
+	}
+
+	bool Write(const char *s, size_t len)
+	{
+		if (!isOpen || !writing || failWrites)
+		{
+			return false;
+		}
+		if (data.size() < position + len)
+		{
+			data.resize(position + len);
+		}
+		memcpy(data.data() + position, s, len);
+		position += len;
+		return true;
+	}
+
+	bool WriteAndSync(const char *s, size_t len) { return Write(s, len) && Flush(); }
+	bool Flush() { return isOpen && !failWrites; }
+	bool Close() { const bool wasOpen = isOpen; isOpen = false; return wasOpen; }
+	bool IsOpen() const { return isOpen; }
+	void SetFailWrites(bool fail) { failWrites = fail; }	// make writes fail from now on, as when the card is full or has been removed
+
+private:
+	std::vector<char>& data;
+	size_t position;
+	bool writing;
+	bool isOpen;
+	bool failWrites;
+};
+
+#endif
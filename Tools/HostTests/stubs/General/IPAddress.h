@@ -0,0 +1,28 @@
+/*
+ * IPAddress.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for the IPAddress class in RRFLibraries, for the host tests in Tools/HostTests. It has only the members that the firmware files they compile use.
+ */
+
+#ifndef TOOLS_HOSTTESTS_STUBS_GENERAL_IPADDRESS_H_
+#define TOOLS_HOSTTESTS_STUBS_GENERAL_IPADDRESS_H_
+
+#include <cstdint>
+
+class IPAddress
+{
+public:
+	IPAddress() : v4LittleEndian(0) { }
+	explicit IPAddress(uint32_t addr) : v4LittleEndian(addr) { }
+
+	uint32_t GetV4LittleEndian() const { return v4LittleEndian; }
+	uint8_t GetQuad(size_t n) const { return (uint8_t)(v4LittleEndian >> (8 * n)); }
+
+private:
+	uint32_t v4LittleEndian;
+};
+
+#endif /* TOOLS_HOSTTESTS_STUBS_GENERAL_IPADDRESS_H_ */
@@ -0,0 +1,37 @@
+/*
+ * SafeStrtod.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for SafeStrtod.h in RRFLibraries, for the host tests in Tools/HostTests. The host library functions are safe to use here.
+ */
+
+#ifndef TOOLS_HOSTTESTS_STUBS_GENERAL_SAFESTRTOD_H_
+#define TOOLS_HOSTTESTS_STUBS_GENERAL_SAFESTRTOD_H_
+
+#include <cstdlib>
+
+inline unsigned long SafeStrtoul(const char *s, const char **endptr = nullptr, int base = 10)
+{
+	char *end;
+	const unsigned long ret = strtoul(s, &end, base);
+	if (endptr != nullptr)
+	{
+		*endptr = end;
+	}
+	return ret;
+}
+
+inline long SafeStrtol(const char *s, const char **endptr = nullptr, int base = 10)
+{
+	char *end;
+	const long ret = strtol(s, &end, base);
+	if (endptr != nullptr)
+	{
+		*endptr = end;
+	}
+	return ret;
+}
+
+#endif /* TOOLS_HOSTTESTS_STUBS_GENERAL_SAFESTRTOD_H_ */
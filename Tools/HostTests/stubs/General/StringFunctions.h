@@ -0,0 +1,39 @@
+/*
+ * StringFunctions.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for StringFunctions.h in RRFLibraries, for the host tests in Tools/HostTests. It provides only the functions that those tests use.
+ */
+
+#ifndef TOOLS_HOSTTESTS_STUBS_GENERAL_STRINGFUNCTIONS_H_
+#define TOOLS_HOSTTESTS_STUBS_GENERAL_STRINGFUNCTIONS_H_
+
+#include <cctype>
+#include <cstring>
+
+// Compare two strings ignoring case, returning true if they are equal
+inline bool StringEqualsIgnoreCase(const char *s1, const char *s2)
+{
+	while (*s1 != 0 && *s2 != 0)
+	{
+		if (tolower((unsigned char)*s1++) != tolower((unsigned char)*s2++))
+		{
+			return false;
+		}
+	}
+	return *s1 == *s2;
+}
+
+// Copy a string, truncating it if necessary so that the result is always null-terminated
+inline void SafeStrncpy(char *dst, const char *src, size_t length)
+{
+	if (length != 0)
+	{
+		strncpy(dst, src, length);
+		dst[length - 1] = 0;
+	}
+}
+
+#endif /* TOOLS_HOSTTESTS_STUBS_GENERAL_STRINGFUNCTIONS_H_ */
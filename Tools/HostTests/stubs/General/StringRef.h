@@ -0,0 +1,42 @@
+/*
+ * StringRef.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for StringRef.h in RRFLibraries, for the host tests in Tools/HostTests. It provides only the functions that those tests use.
+ */
+
+#ifndef TOOLS_HOSTTESTS_STUBS_GENERAL_STRINGREF_H_
+#define TOOLS_HOSTTESTS_STUBS_GENERAL_STRINGREF_H_
+
+#include <cstddef>
+#include <cstring>
+
+// A reference to a fixed-length buffer that holds a null-terminated string
+class StringRef
+{
+public:
+	StringRef(char *pp, size_t pl) : p(pp), len(pl) { }
+
+	size_t Capacity() const { return len - 1; }
+	size_t strlen() const { return ::strlen(p); }
+	const char *c_str() const { return p; }
+	void Clear() const { p[0] = 0; }
+
+	// Copy a string, truncating it if it is too long. Return true if it was truncated, like the real StringRef.
+	bool copy(const char *src) const
+	{
+		const size_t srcLen = ::strlen(src);
+		const size_t n = (srcLen < len) ? srcLen : len - 1;
+		memcpy(p, src, n);
+		p[n] = 0;
+		return n != srcLen;
+	}
+
+private:
+	char *p;
+	size_t len;
+};
+
+#endif /* TOOLS_HOSTTESTS_STUBS_GENERAL_STRINGREF_H_ */
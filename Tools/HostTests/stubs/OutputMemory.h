@@ -0,0 +1,113 @@
+/*
+ * OutputMemory.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for src/OutputMemory.h, for the host tests in Tools/HostTests. Each OutputBuffer collects its text in a std::string, and buffers can be
+ *  chained as in the firmware. Allocate can be made to fail, and counts the buffers in use so that a test can check that none are leaked.
+ *  Source files in src include "OutputMemory.h" from their own directory, so a test of one of them must include this file first. It uses the same
+ *  include guard as the real one, which is then skipped.
+ */
+
+#ifndef OUTPUTMEMORY_H_
+#define OUTPUTMEMORY_H_
+
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+
+class OutputBuffer
+{
+public:
+	void cat(char c) { text += c; }
+	void cat(const char *s) { text += s; }
+	void cat(const char *s, size_t len) { text.append(s, len); }
+
+	template<typename... Args> void catf(const char *fmt, Args... args)
+	{
+		char buf[100];
+		snprintf(buf, sizeof(buf), fmt, args...);
+		text += buf;
+	}
+
+	size_t printf(const char *fmt, ...) __attribute__ ((format (printf, 2, 3)))
+	{
+		char buf[200];
+		va_list vargs;
+		va_start(vargs, fmt);
+		const int len = vsnprintf(buf, sizeof(buf), fmt, vargs);
+		va_end(vargs);
+		text = buf;
+		return (size_t)len;
+	}
+
+	void EncodeString(const char *s, bool isString)
+	{
+		text += '"';
+		text += s;
+		text += '"';
+	}
+
+	const std::string& Text() const { return text; }
+
+	void Append(OutputBuffer *other)
+	{
+		OutputBuffer *last = this;
+		while (last->next != nullptr)
+		{
+			last = last->next;
+		}
+		last->next = other;
+	}
+
+	OutputBuffer *Next() const { return next; }
+	const char *Data() const { return text.data(); }
+	size_t DataLength() const { return text.size(); }
+
+	// Return the text of the whole chain
+	std::string ChainText() const
+	{
+		std::string s;
+		for (const OutputBuffer *b = this; b != nullptr; b = b->next)
+		{
+			s += b->text;
+		}
+		return s;
+	}
+
+	static bool Allocate(OutputBuffer *&buf)
+	{
+		if (failAllocations)
+		{
+			buf = nullptr;
+			return false;
+		}
+		buf = new OutputBuffer;
+		++buffersInUse;
+		return true;
+	}
+
+	static void ReleaseAll(OutputBuffer *&buf)
+	{
+		while (buf != nullptr)
+		{
+			OutputBuffer * const next = buf->next;
+			delete buf;
+			--buffersInUse;
+			buf = next;
+		}
+	}
+
+	static bool failAllocations;
+	static int buffersInUse;
+
+private:
+	std::string text;
+	OutputBuffer *next = nullptr;
+};
+
+inline bool OutputBuffer::failAllocations = false;
+inline int OutputBuffer::buffersInUse = 0;
+
+#endif /* OUTPUTMEMORY_H_ */
@@ -0,0 +1,27 @@
+/*
+ * Platform.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for src/Platform.h, for the host tests in Tools/HostTests. It declares only the functions that the source files under test call,
+ *  and each test that includes it defines them.
+ */
+
+#ifndef TOOLS_HOSTTESTS_STUBS_PLATFORM_H_
+#define TOOLS_HOSTTESTS_STUBS_PLATFORM_H_
+
+#include "RepRapFirmware.h"
+#include "../../../src/MessageType.h"
+
+enum class OpenMode : uint8_t;
+
+class Platform
+{
+public:
+	FileStore* OpenSysFile(const char *filename, OpenMode mode) const;
+	bool DeleteSysFile(const char *filename) const;
+	void MessageF(MessageType type, const char *fmt, ...) __attribute__ ((format (printf, 3, 4)));
+};
+
+#endif /* TOOLS_HOSTTESTS_STUBS_PLATFORM_H_ */
@@ -0,0 +1,26 @@
+/*
+ * RepRap.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for src/RepRap.h, for the host tests in Tools/HostTests. Each test that includes it defines the reprap object.
+ */
+
+#ifndef TOOLS_HOSTTESTS_STUBS_REPRAP_H_
+#define TOOLS_HOSTTESTS_STUBS_REPRAP_H_
+
+#include "Platform.h"
+
+class RepRap
+{
+public:
+	Platform& GetPlatform() { return platform; }
+
+private:
+	Platform platform;
+};
+
+extern RepRap reprap;
+
+#endif /* TOOLS_HOSTTESTS_STUBS_REPRAP_H_ */
@@ -0,0 +1,43 @@
+/*
+ * RepRapFirmware.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Stand-in for src/RepRapFirmware.h when the host tests in Tools/HostTests compile firmware source files. It provides only what those files use.
+ *  None of the processor macros (SAME70, SAM4E etc.) are defined, so code that depends on them takes the path for the smallest processor
+ *  unless the test defines a feature macro itself.
+ *  Source files in src itself include "RepRapFirmware.h" from their own directory, so a test of one of them must include this file first. It uses
+ *  the same include guard as the real one, which is then skipped.
+ */
+
+#ifndef REPRAPFIRMWARE_H
+#define REPRAPFIRMWARE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cinttypes>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+
+#include "General/StringRef.h"
+#include "General/StringFunctions.h"
+
+#define ARRAY_SIZE(_x)	(sizeof(_x)/sizeof(_x[0]))
+
+template<class X> inline constexpr X min(X _a, X _b) { return (_a < _b) ? _a : _b; }
+template<class X> inline constexpr X max(X _a, X _b) { return (_a > _b) ? _a : _b; }
+
+uint32_t millis();									// a test that uses it must define it
+
+typedef uint32_t FilePosition;
+const FilePosition noFilePosition = 0xFFFFFFFF;
+constexpr size_t MaxFilenameLength = 120;			// the value for SAM4E, SAM4S and SAME70 builds
+
+class OutputBuffer;
+class GCodes;
+class GCodeBuffer;
+class FileStore;
+
+#endif /* REPRAPFIRMWARE_H */
@@ -0,0 +1,443 @@
+/*
+ * StorageBenchmark.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host benchmark of the SD card access patterns of the firmware, using the firmware's copy of FatFS on a FAT image file through the host disk
+ *  backend in src/Libraries/Fatfs/diskio_host.cpp. The delays per command and per sector model a real card. For each test it reports the time
+ *  taken and the numbers of disk commands and sectors transferred, so the effect of a change to FatFS or its configuration can be measured.
+ *  FileStore and MassStorage need the rest of the firmware, so the tests call FatFS in the same way that they do:
+ *   - write:		a G-code file written in FileWriteBufLen blocks, as an upload is written through a write buffer
+ *   - append:		short lines appended and synced one at a time, as the logger and the print journal write them
+ *   - read:		the file read in small pieces, as FileGCodeInput reads it without a read-ahead buffer, and in ReadAheadBufferSize pieces
+ *   - seek:		random seeks followed by short reads, following the cluster chain and with a cluster map as set up by EnableFastSeek
+ *   - file info:	the header and footer reads that FileInfoParser does when a file is selected
+ *   - listing:		a directory read entry by entry, as MassStorage::FindFirst and FindNext do, with and without f_stat of each file
+ *
+ *  Build:	gcc -O2 -DFATFS_HOST_IMAGE -c ../../src/Libraries/Fatfs/ff.c ../../src/Libraries/Fatfs/ffunicode.c
+ *			g++ -std=c++17 -O2 -DFATFS_HOST_IMAGE -o StorageBenchmark StorageBenchmark.cpp ../../src/Libraries/Fatfs/diskio_host.cpp ff.o ffunicode.o
+ *  Usage:	StorageBenchmark [-c command_delay_us] [-s sector_delay_us] [-f file_size_kb] image_file
+ *			The image file is created or overwritten and formatted. The defaults are 200us per command, 5us per sector and a 4096K file.
+ */
+
+#include "../../src/Libraries/Fatfs/ff.h"
+#include "../../src/Libraries/Fatfs/diskio.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+	// The same sizes as the firmware on SAM4E and SAME70 builds
+	constexpr size_t FileWriteBufLen = 8192;				// FileWriteBuffer.h
+	constexpr size_t ReadAheadBufferSize = 2048;			// FileStore.h
+	constexpr size_t ClusterMapLength = 64;					// FileStore.h
+	constexpr size_t GCodeInputReadSize = 256;				// the size of the reads that FileGCodeInput makes
+	constexpr size_t GCodeReadSize = 2048;					// FileInfoParser.h GCODE_READ_SIZE
+	constexpr size_t GCodeHeaderSize = 20000;				// FileInfoParser.h GCODE_HEADER_SIZE
+	constexpr size_t GCodeFooterSize = 400000;				// FileInfoParser.h GCODE_FOOTER_SIZE
+	constexpr size_t ImageSize = 512 * 1024 * 1024;				// big enough for FAT32 with 4K clusters. The image file is sparse.
+	constexpr size_t NumListedFiles = 200;
+	constexpr size_t NumSeeks = 1000;
+	constexpr size_t NumAppends = 200;
+	constexpr size_t FragmentSize = 256 * 1024;				// the benchmark file is fragmented every this many bytes, so that it has fewer fragments than a cluster map holds
+
+	const char * const BenchFile = "0:/gcodes/bench.g";
+	const char * const FillerFile = "0:/gcodes/filler.g";
+	const char * const ListDir = "0:/gcodes/list";
+	const char * const LogFile = "0:/sys/eventlog.txt";
+
+	FATFS fileSystem;
+	std::chrono::steady_clock::time_point startTime;
+
+	void Fail(const char *what, FRESULT fr)
+	{
+		fprintf(stderr, "%s failed, error %d\n", what, (int)fr);
+		exit(1);
+	}
+
+	void Start()
+	{
+		(void)DiskioHostGetAndClearStats(0);
+		startTime = std::chrono::steady_clock::now();
+	}
+
+	void Report(const char *test)
+	{
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		const DiskioHostStats stats = DiskioHostGetAndClearStats(0);
+		printf("%-28s %10.1f %10u %10u %10u %10u\n", test, ms, stats.readCommands, stats.sectorsRead, stats.writeCommands, stats.sectorsWritten);
+	}
+
+	// Make a block of G-code moves to write
+	std::string MakeGCode(size_t len)
+	{
+		std::string s;
+		unsigned int n = 0;
+		while (s.size() < len)
+		{
+			char line[64];
+			snprintf(line, sizeof(line), "G1 X%u.%03u Y%u.%03u E%u.%05u\n", 50 + n % 100, (n * 7) % 1000, 80 + n % 50, (n * 13) % 1000, n / 100, (n * 31) % 100000);
+			s += line;
+			++n;
+		}
+		s.resize(len);
+		return s;
+	}
+
+	// Write the benchmark file in write buffer sized blocks. Another file is written in between so that the benchmark file is fragmented.
+	void TestWrite(size_t fileSize)
+	{
+		const std::string data = MakeGCode(fileSize);
+		FIL bench, filler;
+		FRESULT fr = f_open(&filler, FillerFile, FA_CREATE_ALWAYS | FA_WRITE);
+		if (fr != FR_OK)
+		{
+			Fail("f_open filler", fr);
+		}
+
+		Start();
+		fr = f_open(&bench, BenchFile, FA_CREATE_ALWAYS | FA_WRITE);
+		if (fr != FR_OK)
+		{
+			Fail("f_open", fr);
+		}
+		for (size_t done = 0; done < fileSize; )
+		{
+			const size_t len = std::min(FileWriteBufLen, fileSize - done);
+			UINT written;
+			fr = f_write(&bench, data.data() + done, len, &written);
+			if (fr != FR_OK || written != len)
+			{
+				Fail("f_write", fr);
+			}
+			done += len;
+			if (done % FragmentSize == 0)
+			{
+				(void)f_write(&filler, data.data(), 4096, &written);
+			}
+		}
+		fr = f_close(&bench);
+		if (fr != FR_OK)
+		{
+			Fail("f_close", fr);
+		}
+		Report("write 8K blocks");
+		(void)f_close(&filler);
+	}
+
+	// Append short lines and sync after each one, as the logger and the print journal do
+	void TestAppend()
+	{
+		FIL f;
+		Start();
+		FRESULT fr = f_open(&f, LogFile, FA_READ | FA_WRITE | FA_OPEN_ALWAYS);
+		if (fr != FR_OK)
+		{
+			Fail("f_open log", fr);
+		}
+		(void)f_lseek(&f, f_size(&f));
+		for (size_t i = 0; i < NumAppends; ++i)
+		{
+			char line[80];
+			const int len = snprintf(line, sizeof(line), "2026-10-19 12:00:%02u Event %u happened\n", (unsigned int)(i % 60), (unsigned int)i);
+			UINT written;
+			fr = f_write(&f, line, (UINT)len, &written);
+			if (fr == FR_OK)
+			{
+				fr = f_sync(&f);
+			}
+			if (fr != FR_OK)
+			{
+				Fail("append", fr);
+			}
+		}
+		(void)f_close(&f);
+		Report("append and sync 200 lines");
+	}
+
+	void TestRead(size_t chunkSize, const char *name)
+	{
+		static char buf[ReadAheadBufferSize];
+		FIL f;
+		Start();
+		FRESULT fr = f_open(&f, BenchFile, FA_OPEN_EXISTING | FA_READ);
+		if (fr != FR_OK)
+		{
+			Fail("f_open", fr);
+		}
+		UINT bytesRead;
+		do
+		{
+			fr = f_read(&f, buf, chunkSize, &bytesRead);
+			if (fr != FR_OK)
+			{
+				Fail("f_read", fr);
+			}
+		} while (bytesRead == chunkSize);
+		(void)f_close(&f);
+		Report(name);
+	}
+
+	// Seek to random positions and read a little after each one, optionally with a cluster map as FileStore::EnableFastSeek sets up
+	void TestSeek(bool fastSeek)
+	{
+		static DWORD clusterMap[ClusterMapLength];
+		char buf[GCodeInputReadSize];
+		std::mt19937 rng(1);
+		FIL f;
+		FRESULT fr = f_open(&f, BenchFile, FA_OPEN_EXISTING | FA_READ);
+		if (fr != FR_OK)
+		{
+			Fail("f_open", fr);
+		}
+
+		Start();
+		if (fastSeek)
+		{
+			clusterMap[0] = ClusterMapLength;
+			f.cltbl = clusterMap;
+			fr = f_lseek(&f, CREATE_LINKMAP);
+			if (fr != FR_OK)
+			{
+				Fail("f_lseek CREATE_LINKMAP", fr);
+			}
+		}
+
+		const FSIZE_t size = f_size(&f);
+		for (size_t i = 0; i < NumSeeks; ++i)
+		{
+			const FSIZE_t pos = std::uniform_int_distribution<FSIZE_t>(0, size - sizeof(buf))(rng);
+			UINT bytesRead;
+			fr = f_lseek(&f, pos);
+			if (fr == FR_OK)
+			{
+				fr = f_read(&f, buf, sizeof(buf), &bytesRead);
+			}
+			if (fr != FR_OK)
+			{
+				Fail("seek and read", fr);
+			}
+		}
+		Report((fastSeek) ? "1000 seeks, cluster map" : "1000 seeks, cluster chain");
+		(void)f_close(&f);
+	}
+
+	// Read the header and the footer of the file in the same pieces and order as FileInfoParser
+	void TestFileInfo()
+	{
+		static char buf[GCodeReadSize];
+		FIL f;
+		Start();
+		FRESULT fr = f_open(&f, BenchFile, FA_OPEN_EXISTING | FA_READ);
+		if (fr != FR_OK)
+		{
+			Fail("f_open", fr);
+		}
+
+		const FSIZE_t size = f_size(&f);
+		UINT bytesRead;
+		for (FSIZE_t pos = 0; pos < GCodeHeaderSize && pos < size; pos += GCodeReadSize)
+		{
+			fr = f_read(&f, buf, GCodeReadSize, &bytesRead);
+			if (fr != FR_OK)
+			{
+				Fail("header read", fr);
+			}
+		}
+
+		// The footer is read backwards from the end of the file
+		const FSIZE_t footerStart = (size > GCodeFooterSize) ? size - GCodeFooterSize : 0;
+		FSIZE_t pos = size;
+		while (pos > footerStart)
+		{
+			const FSIZE_t len = std::min<FSIZE_t>(GCodeReadSize, pos - footerStart);
+			pos -= len;
+			fr = f_lseek(&f, pos);
+			if (fr == FR_OK)
+			{
+				fr = f_read(&f, buf, len, &bytesRead);
+			}
+			if (fr != FR_OK)
+			{
+				Fail("footer read", fr);
+			}
+		}
+		(void)f_close(&f);
+		Report("file info header and footer");
+	}
+
+	// Read a directory entry by entry, as FindFirst and FindNext do
+	void TestListing(bool statEachFile)
+	{
+		Start();
+		DIR dir;
+		FRESULT fr = f_opendir(&dir, ListDir);
+		if (fr != FR_OK)
+		{
+			Fail("f_opendir", fr);
+		}
+		size_t count = 0;
+		for (;;)
+		{
+			FILINFO entry;
+			fr = f_readdir(&dir, &entry);
+			if (fr != FR_OK)
+			{
+				Fail("f_readdir", fr);
+			}
+			if (entry.fname[0] == 0)
+			{
+				break;
+			}
+			++count;
+			if (statEachFile)
+			{
+				const std::string path = std::string(ListDir) + "/" + entry.fname;
+				FILINFO info;
+				fr = f_stat(path.c_str(), &info);
+				if (fr != FR_OK)
+				{
+					Fail("f_stat", fr);
+				}
+			}
+		}
+		(void)f_closedir(&dir);
+		if (count != NumListedFiles)
+		{
+			fprintf(stderr, "Listed %zu files, expected %zu\n", count, NumListedFiles);
+			exit(1);
+		}
+		Report((statEachFile) ? "list 200 files and stat" : "list 200 files");
+	}
+
+	void MakeListedFiles()
+	{
+		FRESULT fr = f_mkdir(ListDir);
+		if (fr != FR_OK)
+		{
+			Fail("f_mkdir", fr);
+		}
+		for (size_t i = 0; i < NumListedFiles; ++i)
+		{
+			char path[80];
+			snprintf(path, sizeof(path), "%s/Part number %03u with a long file name.gcode", ListDir, (unsigned int)i);
+			FIL f;
+			fr = f_open(&f, path, FA_CREATE_ALWAYS | FA_WRITE);
+			if (fr != FR_OK)
+			{
+				Fail("f_open listed file", fr);
+			}
+			UINT written;
+			(void)f_write(&f, "G28\n", 4, &written);
+			(void)f_close(&f);
+		}
+	}
+}
+
+// FatFS calls this for file time stamps. Return the same time as the firmware does when the clock hasn't been set.
+extern "C" DWORD get_fattime()
+{
+	return 0x210001;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t commandDelay = 200, sectorDelay = 5;
+	size_t fileSize = 4096 * 1024;
+	int opt;
+	while ((opt = getopt(argc, argv, "c:s:f:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'c':
+			commandDelay = strtoul(optarg, nullptr, 10);
+			break;
+		case 's':
+			sectorDelay = strtoul(optarg, nullptr, 10);
+			break;
+		case 'f':
+			fileSize = strtoul(optarg, nullptr, 10) * 1024;
+			break;
+		default:
+			fprintf(stderr, "Usage: StorageBenchmark [-c command_delay_us] [-s sector_delay_us] [-f file_size_kb] image_file\n");
+			return 1;
+		}
+	}
+	if (optind + 1 != argc || fileSize < GCodeReadSize)
+	{
+		fprintf(stderr, "Usage: StorageBenchmark [-c command_delay_us] [-s sector_delay_us] [-f file_size_kb] image_file\n");
+		return 1;
+	}
+
+	// Create and format the image without delays
+	const char * const imageFile = argv[optind];
+	const int fd = open(imageFile, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 || ftruncate(fd, ImageSize) != 0)
+	{
+		fprintf(stderr, "Can't create image file %s\n", imageFile);
+		return 1;
+	}
+	close(fd);
+	if (!DiskioHostAttachImage(0, imageFile, 0, 0))
+	{
+		fprintf(stderr, "Can't map image file %s\n", imageFile);
+		return 1;
+	}
+
+	static BYTE work[FF_MAX_SS * 8];
+	FRESULT fr = f_mkfs("0:", FM_FAT32 | FM_SFD, 4096, work, sizeof(work));
+	if (fr != FR_OK)
+	{
+		Fail("f_mkfs", fr);
+	}
+	fr = f_mount(&fileSystem, "0:", 1);
+	if (fr != FR_OK)
+	{
+		Fail("f_mount", fr);
+	}
+	(void)f_mkdir("0:/gcodes");
+	(void)f_mkdir("0:/sys");
+	MakeListedFiles();
+
+	// Remount with the delays of a real card, so that nothing is cached from setting up
+	(void)f_mount(nullptr, "0:", 0);
+	DiskioHostDetachImage(0);
+	if (!DiskioHostAttachImage(0, imageFile, commandDelay, sectorDelay))
+	{
+		fprintf(stderr, "Can't map image file %s\n", imageFile);
+		return 1;
+	}
+	fr = f_mount(&fileSystem, "0:", 1);
+	if (fr != FR_OK)
+	{
+		Fail("f_mount", fr);
+	}
+
+	printf("File size %zuK, %" PRIu32 "us per command, %" PRIu32 "us per sector\n", fileSize / 1024, commandDelay, sectorDelay);
+	printf("%-28s %10s %10s %10s %10s %10s\n", "Test", "ms", "read cmds", "sectors", "write cmds", "sectors");
+	TestWrite(fileSize);
+	TestAppend();
+	TestRead(GCodeInputReadSize, "read 256 byte pieces");
+	TestRead(ReadAheadBufferSize, "read 2K pieces");
+	TestSeek(false);
+	TestSeek(true);
+	TestFileInfo();
+	TestListing(false);
+	TestListing(true);
+
+	(void)f_mount(nullptr, "0:", 0);
+	DiskioHostDetachImage(0);
+	return 0;
+}
+
+// End
@@ -0,0 +1,528 @@
+/*
+ * UploadBenchmark.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Host benchmark of writing an upload to the SD card through the storage task, using the firmware's copy of FatFS on a FAT image file through the
+ *  host disk backend in src/Libraries/Fatfs/diskio_host.cpp. FileStore and MassStorage need the rest of the firmware, so the upload task and the storage
+ *  task are threads that follow FileStore::Write, FileStore::EmptyWriteBuffer, FileStore::WaitForPendingWrites, MassStorage::QueueWriteBuffer and
+ *  MassStorage::WriteQueuedBuffers. The data arrives in TCP segments at a fixed network rate. Each time the upload task has to wait for the card
+ *  before it can take the next segment, the segments that arrive meanwhile have to wait in the network buffers, and when those are full the client stops
+ *  sending. So for each number of write buffers it reports:
+ *   - the upload rate, from the arrival of the first segment to the file being closed, not counting opening the file
+ *   - the longest time that the upload task waited in a single write, which is how long the client may be stalled
+ *   - the most data that had arrived but had not been taken by the upload task, which is how much network buffering is needed to avoid that stall
+ *  One write buffer is how the firmware behaved before the storage task, because there is never a free buffer to carry on with. The SAM4E and SAM4S
+ *  have two and the SAME70 has four. Each configuration is run with the card at its normal speed and with a card that stalls for a while after
+ *  writing a number of sectors, as real cards do when they erase blocks.
+ *
+ *  Then the upload task is replaced by a model of the network task, which serves the upload and a client that polls rr_status in turn as
+ *  Network::Spin does, yielding between them. The client sends the upload at the network rate but can't have more than a TCP window of data
+ *  that hasn't been taken, and it asks for the status again a fixed time after each reply. The upload is run as HttpResponder::DoUpload used to do it,
+ *  calling Write however long it takes, and as it does now, leaving the data in the socket while FileStore::CanWriteWithoutWaiting returns false.
+ *  For each it reports the upload rate and the average and longest time that a status request waited to be served while the data was being
+ *  received. Closing the file at the end waits for the card in both cases, so it isn't included. Generating the status is not modelled either,
+ *  because it takes the same time in both cases.
+ *
+ *  Build:	gcc -O2 -DFATFS_HOST_IMAGE -c ../../src/Libraries/Fatfs/ff.c ../../src/Libraries/Fatfs/ffunicode.c
+ *			g++ -std=c++17 -O2 -pthread -DFATFS_HOST_IMAGE -o UploadBenchmark UploadBenchmark.cpp ../../src/Libraries/Fatfs/diskio_host.cpp ff.o ffunicode.o
+ *  Usage:	UploadBenchmark [-c command_delay_us] [-s sector_delay_us] [-n network_kb_per_second] [-p stall_every_kb] [-q stall_ms] [-f file_size_kb]
+ *							[-w tcp_window_bytes] [-u status_interval_ms] image_file
+ *			The image file is created or overwritten and formatted. The defaults are 200us per command, 40us per sector, a 2000K/s network,
+ *			a stall of 150ms every 1024K written, a 4096K file, the 2920 byte window in lwipopts.h and DWC's default status update interval of 250ms.
+ */
+
+#include "../../src/Libraries/Fatfs/ff.h"
+#include "../../src/Libraries/Fatfs/diskio.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr size_t FileWriteBufLen = 8192;				// FileWriteBuffer.h on SAM4E, SAM4S and SAME70 builds
+	constexpr size_t SegmentSize = 1460;					// the TCP payload of a full Ethernet frame
+	constexpr size_t ImageSize = 512 * 1024 * 1024;			// big enough for FAT32 with 4K clusters. The image file is sparse.
+	constexpr uint32_t MaxWriteWaitMillis = 10000;			// FileStore.cpp
+
+	const char * const UploadFile = "0:/gcodes/upload.g";
+
+	FATFS fileSystem;
+	std::mutex fsMutex;										// FatFS isn't built re-entrant on the host, so this stands in for its volume mutex
+
+	void Fail(const char *what, FRESULT fr)
+	{
+		fprintf(stderr, "%s failed, error %d\n", what, (int)fr);
+		exit(1);
+	}
+
+	struct WriteBuffer
+	{
+		char data[FileWriteBufLen];
+		size_t stored = 0;
+	};
+
+	// The file being uploaded and the write buffers, with the parts of FileStore and MassStorage that they use
+	class QueuedFile
+	{
+	public:
+		QueuedFile(size_t numBuffers) : buffers(numBuffers)
+		{
+			for (size_t i = 1; i < numBuffers; ++i)
+			{
+				freeBuffers.push_back(&buffers[i]);
+			}
+			writeBuffer = &buffers[0];
+			std::lock_guard<std::mutex> fsLock(fsMutex);
+			const FRESULT fr = f_open(&file, UploadFile, FA_CREATE_ALWAYS | FA_WRITE);
+			if (fr != FR_OK)
+			{
+				Fail("f_open", fr);
+			}
+			storageTask = std::thread([this]() { WriteQueuedBuffers(); });
+		}
+
+		// Like FileStore::Write with a write buffer
+		void Write(const char *s, size_t len)
+		{
+			while (len != 0)
+			{
+				const size_t n = std::min(len, FileWriteBufLen - writeBuffer->stored);
+				memcpy(writeBuffer->data + writeBuffer->stored, s, n);
+				writeBuffer->stored += n;
+				s += n;
+				len -= n;
+				if (writeBuffer->stored == FileWriteBufLen)
+				{
+					EmptyWriteBuffer();
+				}
+			}
+		}
+
+		// Like FileStore::CanWriteWithoutWaiting
+		bool CanWriteWithoutWaiting(size_t len)
+		{
+			if (len < FileWriteBufLen - writeBuffer->stored)
+			{
+				return true;
+			}
+			std::lock_guard<std::mutex> lock(queueMutex);
+			return !freeBuffers.empty() || (pendingWrites == 0 && queue.empty());
+		}
+
+		// Like FileStore::Close: wait for the queued buffers, then write what is left and close the file
+		void Close()
+		{
+			WaitForPendingWrites();
+			{
+				std::lock_guard<std::mutex> fsLock(fsMutex);
+				Store(writeBuffer->data, writeBuffer->stored);
+				const FRESULT fr = f_close(&file);
+				if (fr != FR_OK)
+				{
+					Fail("f_close", fr);
+				}
+			}
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				stopping = true;
+			}
+			queueChanged.notify_all();
+			storageTask.join();
+		}
+
+	private:
+		// Like FileStore::EmptyWriteBuffer
+		void EmptyWriteBuffer()
+		{
+			WriteBuffer *newBuffer = AllocateWriteBuffer();
+			if (newBuffer == nullptr && HasPendingWrites())
+			{
+				WaitForPendingWrites();
+				newBuffer = AllocateWriteBuffer();
+			}
+
+			if (newBuffer != nullptr)
+			{
+				{
+					std::lock_guard<std::mutex> lock(queueMutex);
+					++pendingWrites;
+					queue.push_back(writeBuffer);
+				}
+				queueChanged.notify_all();
+				writeBuffer = newBuffer;
+				return;
+			}
+
+			std::lock_guard<std::mutex> fsLock(fsMutex);
+			Store(writeBuffer->data, writeBuffer->stored);
+			writeBuffer->stored = 0;
+		}
+
+		bool HasPendingWrites()
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			return pendingWrites != 0;
+		}
+
+		WriteBuffer *AllocateWriteBuffer()
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			if (freeBuffers.empty())
+			{
+				return nullptr;
+			}
+			WriteBuffer * const b = freeBuffers.back();
+			freeBuffers.pop_back();
+			return b;
+		}
+
+		// Like FileStore::WaitForPendingWrites, except that we are notified when each buffer has been written instead of polling
+		void WaitForPendingWrites()
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			if (!queueChanged.wait_for(lock, std::chrono::milliseconds(MaxWriteWaitMillis), [this]() { return pendingWrites == 0; }))
+			{
+				fprintf(stderr, "Queued writes timed out\n");
+				exit(1);
+			}
+		}
+
+		// Like MassStorage::WriteQueuedBuffers, run by the storage task
+		void WriteQueuedBuffers()
+		{
+			for (;;)
+			{
+				WriteBuffer *buffer;
+				{
+					std::unique_lock<std::mutex> lock(queueMutex);
+					queueChanged.wait(lock, [this]() { return stopping || !queue.empty(); });
+					if (queue.empty())
+					{
+						return;
+					}
+					buffer = queue.front();
+					queue.pop_front();
+				}
+
+				{
+					std::lock_guard<std::mutex> fsLock(fsMutex);
+					Store(buffer->data, buffer->stored);
+				}
+				buffer->stored = 0;
+
+				{
+					std::lock_guard<std::mutex> lock(queueMutex);
+					freeBuffers.push_back(buffer);
+					--pendingWrites;
+				}
+				queueChanged.notify_all();
+			}
+		}
+
+		// Like FileStore::Store. The caller must hold fsMutex.
+		void Store(const char *s, size_t len)
+		{
+			UINT written;
+			const FRESULT fr = f_write(&file, s, (UINT)len, &written);
+			if (fr != FR_OK || written != len)
+			{
+				Fail("f_write", fr);
+			}
+		}
+
+		FIL file;
+		std::vector<WriteBuffer> buffers;
+		WriteBuffer *writeBuffer;
+		std::mutex queueMutex;								// stands in for the critical sections that protect the queue and the free list
+		std::condition_variable queueChanged;
+		std::deque<WriteBuffer*> queue;
+		std::vector<WriteBuffer*> freeBuffers;
+		unsigned int pendingWrites = 0;
+		bool stopping = false;
+		std::thread storageTask;
+	};
+
+	struct Result
+	{
+		double kbPerSecond;
+		double longestWaitMillis;
+		size_t maxBacklog;
+		unsigned int cardStalls;
+	};
+
+	// Upload a file of the given size arriving at the given rate, writing it through the given number of write buffers
+	Result Upload(const std::string& data, size_t numBuffers, uint32_t networkKbPerSecond)
+	{
+		QueuedFile f(numBuffers);
+		(void)DiskioHostGetAndClearStats(0);
+		const Clock::time_point start = Clock::now();
+		const double segmentSeconds = (double)SegmentSize / (networkKbPerSecond * 1024.0);
+		Result r = {};
+
+		for (size_t pos = 0, segment = 0; pos < data.size(); pos += SegmentSize, ++segment)
+		{
+			// Wait for this segment to arrive, then see how far behind we are
+			const Clock::time_point arrival = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(segment * segmentSeconds));
+			std::this_thread::sleep_until(arrival);
+			const Clock::time_point now = Clock::now();
+			const double secondsSinceStart = std::chrono::duration<double>(now - start).count();
+			const size_t arrived = std::min(data.size(), (size_t)(secondsSinceStart / segmentSeconds + 1.0) * SegmentSize);
+			r.maxBacklog = std::max(r.maxBacklog, arrived - std::min(arrived, pos));
+
+			const size_t len = std::min(SegmentSize, data.size() - pos);
+			f.Write(data.data() + pos, len);
+			r.longestWaitMillis = std::max(r.longestWaitMillis, std::chrono::duration<double, std::milli>(Clock::now() - now).count());
+		}
+		f.Close();
+
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		r.kbPerSecond = (double)data.size() / 1024.0 / seconds;
+		r.cardStalls = DiskioHostGetAndClearStats(0).writeStalls;
+		return r;
+	}
+
+	struct StatusResult
+	{
+		double kbPerSecond;
+		double averageLatencyMillis;
+		double longestLatencyMillis;
+		unsigned int requests;
+	};
+
+	// Upload a file while a client polls for the status, with the network task serving both. If backPressure is true then the upload data is left
+	// where it is when writing it would have to wait for the card, like HttpResponder::DoUpload does now.
+	StatusResult UploadWithStatus(const std::string& data, size_t numBuffers, uint32_t networkKbPerSecond, size_t window, uint32_t statusIntervalMillis, bool backPressure)
+	{
+		QueuedFile f(numBuffers);
+		(void)DiskioHostGetAndClearStats(0);
+		const Clock::time_point start = Clock::now();
+		const double bytesPerSecond = networkKbPerSecond * 1024.0;
+		const Clock::duration statusInterval = std::chrono::milliseconds(statusIntervalMillis);
+		StatusResult r = {};
+		double arrived = 0.0, totalLatency = 0.0;
+		size_t taken = 0;
+		Clock::time_point lastTime = start;
+		Clock::time_point nextStatusRequest = start + statusInterval;
+		unsigned int nextResponder = 0;
+
+		while (taken < data.size())
+		{
+			// The client sends data at the network rate as long as the TCP window is open
+			const Clock::time_point now = Clock::now();
+			arrived = std::min<double>(taken + window, arrived + bytesPerSecond * std::chrono::duration<double>(now - lastTime).count());
+			lastTime = now;
+
+			// The status responder, which does something if a request is waiting
+			auto spinStatus = [&]() -> bool
+			{
+				if (now < nextStatusRequest)
+				{
+					return false;
+				}
+				const double latency = std::chrono::duration<double, std::milli>(now - nextStatusRequest).count();
+				totalLatency += latency;
+				r.longestLatencyMillis = std::max(r.longestLatencyMillis, latency);
+				++r.requests;
+				nextStatusRequest = now + statusInterval;
+				return true;
+			};
+
+			// The upload responder, which takes the data a whole segment at a time like HttpResponder::DoUpload
+			auto spinUpload = [&]() -> bool
+			{
+				const size_t len = std::min(std::min((size_t)arrived - taken, SegmentSize), data.size() - taken);
+				if (len == 0 || (len < SegmentSize && taken + len < data.size()))
+				{
+					return false;
+				}
+				if (backPressure && !f.CanWriteWithoutWaiting(len))
+				{
+					return false;
+				}
+				f.Write(data.data() + taken, len);
+				taken += len;
+				return true;
+			};
+
+			// Poll the responders in turn, starting after the last one polled and stopping at the first one that does something, like Network::Spin
+			bool doneSomething = false;
+			for (unsigned int polled = 0; polled < 2 && !doneSomething; ++polled)
+			{
+				doneSomething = (nextResponder == 0) ? spinUpload() : spinStatus();
+				nextResponder ^= 1;
+			}
+			std::this_thread::yield();
+		}
+
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		f.Close();
+		r.kbPerSecond = (double)data.size() / 1024.0 / seconds;
+		r.averageLatencyMillis = (r.requests == 0) ? 0.0 : totalLatency / r.requests;
+		return r;
+	}
+
+	std::string MakeGCode(size_t len)
+	{
+		std::string s;
+		unsigned int n = 0;
+		while (s.size() < len)
+		{
+			char line[64];
+			snprintf(line, sizeof(line), "G1 X%u.%03u Y%u.%03u E%u.%05u\n", 50 + n % 100, (n * 7) % 1000, 80 + n % 50, (n * 13) % 1000, n / 100, (n * 31) % 100000);
+			s += line;
+			++n;
+		}
+		s.resize(len);
+		return s;
+	}
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: UploadBenchmark [-c command_delay_us] [-s sector_delay_us] [-n network_kb_per_second] [-p stall_every_kb] [-q stall_ms] [-f file_size_kb]"
+						" [-w tcp_window_bytes] [-u status_interval_ms] image_file\n");
+		exit(1);
+	}
+}
+
+// FatFS calls this for file time stamps. Return the same time as the firmware does when the clock hasn't been set.
+extern "C" DWORD get_fattime()
+{
+	return 0x210001;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t commandDelay = 200, sectorDelay = 40, networkRate = 2000, stallEveryKb = 1024, stallMillis = 150, statusInterval = 250;
+	size_t fileSize = 4096 * 1024, window = 2 * SegmentSize;
+	int opt;
+	while ((opt = getopt(argc, argv, "c:s:n:p:q:f:w:u:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'c':
+			commandDelay = strtoul(optarg, nullptr, 10);
+			break;
+		case 's':
+			sectorDelay = strtoul(optarg, nullptr, 10);
+			break;
+		case 'n':
+			networkRate = strtoul(optarg, nullptr, 10);
+			break;
+		case 'p':
+			stallEveryKb = strtoul(optarg, nullptr, 10);
+			break;
+		case 'q':
+			stallMillis = strtoul(optarg, nullptr, 10);
+			break;
+		case 'f':
+			fileSize = strtoul(optarg, nullptr, 10) * 1024;
+			break;
+		case 'w':
+			window = strtoul(optarg, nullptr, 10);
+			break;
+		case 'u':
+			statusInterval = strtoul(optarg, nullptr, 10);
+			break;
+		default:
+			Usage();
+		}
+	}
+	if (optind + 1 != argc || networkRate == 0 || fileSize == 0 || window < SegmentSize || statusInterval == 0)
+	{
+		Usage();
+	}
+
+	// Create and format the image without delays
+	const char * const imageFile = argv[optind];
+	const int fd = open(imageFile, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 || ftruncate(fd, ImageSize) != 0)
+	{
+		fprintf(stderr, "Can't create image file %s\n", imageFile);
+		return 1;
+	}
+	close(fd);
+	if (!DiskioHostAttachImage(0, imageFile, 0, 0))
+	{
+		fprintf(stderr, "Can't map image file %s\n", imageFile);
+		return 1;
+	}
+
+	static BYTE work[FF_MAX_SS * 8];
+	FRESULT fr = f_mkfs("0:", FM_FAT32 | FM_SFD, 4096, work, sizeof(work));
+	if (fr != FR_OK)
+	{
+		Fail("f_mkfs", fr);
+	}
+	fr = f_mount(&fileSystem, "0:", 1);
+	if (fr != FR_OK)
+	{
+		Fail("f_mount", fr);
+	}
+	(void)f_mkdir("0:/gcodes");
+
+	// Remount with the delays of a real card
+	(void)f_mount(nullptr, "0:", 0);
+	DiskioHostDetachImage(0);
+	if (!DiskioHostAttachImage(0, imageFile, commandDelay, sectorDelay))
+	{
+		fprintf(stderr, "Can't map image file %s\n", imageFile);
+		return 1;
+	}
+	fr = f_mount(&fileSystem, "0:", 1);
+	if (fr != FR_OK)
+	{
+		Fail("f_mount", fr);
+	}
+
+	const std::string data = MakeGCode(fileSize);
+	printf("File size %zuK, %" PRIu32 "us per command, %" PRIu32 "us per sector, network %" PRIu32 "K/s, card stall %" PRIu32 "ms every %" PRIu32 "K\n",
+			fileSize / 1024, commandDelay, sectorDelay, networkRate, stallMillis, stallEveryKb);
+	printf("%-10s %-8s %10s %14s %14s %8s\n", "Buffers", "Card", "K/s", "longest wait", "max backlog", "stalls");
+	for (size_t numBuffers : { 1, 2, 4 })
+	{
+		for (bool stalls : { false, true })
+		{
+			DiskioHostSetWriteStall(0, (stalls) ? stallEveryKb * 2 : 0, stallMillis * 1000);
+			const Result r = Upload(data, numBuffers, networkRate);
+			printf("%-10zu %-8s %10.1f %12.1fms %13zuK %8u\n", numBuffers, (stalls) ? "stalls" : "normal", r.kbPerSecond, r.longestWaitMillis, r.maxBacklog / 1024, r.cardStalls);
+		}
+	}
+
+	printf("\nrr_status every %" PRIu32 "ms during the upload, TCP window %zu bytes\n", statusInterval, window);
+	printf("%-10s %-8s %-14s %10s %10s %14s %14s\n", "Buffers", "Card", "Upload", "K/s", "requests", "average wait", "longest wait");
+	for (size_t numBuffers : { 1, 2, 4 })
+	{
+		for (bool stalls : { false, true })
+		{
+			for (bool backPressure : { false, true })
+			{
+				DiskioHostSetWriteStall(0, (stalls) ? stallEveryKb * 2 : 0, stallMillis * 1000);
+				const StatusResult r = UploadWithStatus(data, numBuffers, networkRate, window, statusInterval, backPressure);
+				printf("%-10zu %-8s %-14s %10.1f %10u %12.2fms %12.2fms\n", numBuffers, (stalls) ? "stalls" : "normal", (backPressure) ? "back-pressure" : "wait",
+						r.kbPerSecond, r.requests, r.averageLatencyMillis, r.longestLatencyMillis);
+			}
+		}
+	}
+
+	(void)f_mount(nullptr, "0:", 0);
+	DiskioHostDetachImage(0);
+	return 0;
+}
+
+// End
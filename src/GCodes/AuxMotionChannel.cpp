@@ -0,0 +1,305 @@
+/*
+ * AuxMotionChannel.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  This file contains the functions of class GCodes that implement the secondary motion channel.
+ *  M596 P"file" A"axes" starts running a file on the secondary channel and gives it exclusive ownership of the named axes, which must not be coupled
+ *  to other axes by the kinematics. The channel sends its moves to its own DDA ring, so they execute concurrently with the moves of the main channel.
+ *  It supports G0, G1, G4, G20, G21, G90 and G91, and M-codes are executed as on any other channel. Coordinates are machine coordinates.
+ *  M598 is the sync point: when used in the file being printed or in the file on the secondary channel, it waits until that channel's moves have finished
+ *  and the other channel has reached the same number of M598 commands or is not running a file. From any other channel it waits until the secondary
+ *  channel has finished its file. The main channel takes back the axes the next time it waits for standstill after the secondary channel has finished.
+ *  The secondary channel holds while the print is paused, and cancelling the print or an error on the secondary channel stops its file.
+ */
+
+#include "GCodes.h"
+
+#if SUPPORT_ASYNC_MOVES
+
+#include "GCodeBuffer.h"
+#include "Movement/Move.h"
+#include "RepRap.h"
+
+// The Move class calls this function to get the next move of the secondary motion channel
+bool GCodes::ReadAuxMove(RawMove& m)
+{
+	if (!auxMoveAvailable)
+	{
+		return false;
+	}
+
+	m = auxMoveBuffer;
+	auxMoveAvailable = false;
+	return true;
+}
+
+// Return true if the secondary motion channel is running a file
+bool GCodes::IsAuxChannelRunning() const
+{
+	return file2GCode->OriginalMachineState().fileState.IsLive();
+}
+
+// Return true if all moves of the secondary motion channel have been completed
+bool GCodes::AuxMovesAreFinished() const
+{
+	return !auxMoveAvailable && reprap.GetMove().NoLiveAuxMovement();
+}
+
+// Handle M596. The caller has already locked movement and waited for standstill.
+GCodeResult GCodes::StartAuxChannel(GCodeBuffer& gb, const StringRef& reply)
+{
+	if (&gb == file2GCode)
+	{
+		reply.copy("M596 can't be used on the secondary motion channel");
+		return GCodeResult::error;
+	}
+	if (IsAuxChannelRunning())
+	{
+		reply.copy("The secondary motion channel is already running a file");
+		return GCodeResult::error;
+	}
+	if (!AuxMovesAreFinished())
+	{
+		return GCodeResult::notFinished;			// wait for the last moves of the previous file to finish
+	}
+#if SUPPORT_LASER
+	if (machineType == MachineType::laser)
+	{
+		reply.copy("The secondary motion channel is not supported in laser mode");
+		return GCodeResult::error;
+	}
+#endif
+
+	String<MaxFilenameLength> filename;
+	if (!gb.Seen('P') || !gb.GetPossiblyQuotedString(filename.GetRef()))
+	{
+		reply.copy("M596: missing file name");
+		return GCodeResult::error;
+	}
+
+	String<StringLength20> letters;
+	if (!gb.Seen('A') || !gb.GetPossiblyQuotedString(letters.GetRef()))
+	{
+		reply.copy("M596: missing axis letters");
+		return GCodeResult::error;
+	}
+
+	AxesBitmap axes = 0;
+	const Kinematics& k = reprap.GetMove().GetKinematics();
+	for (const char *p = letters.c_str(); *p != 0; ++p)
+	{
+		const char c = toupper(*p);
+		size_t axis = 0;
+		while (axis < numVisibleAxes && axisLetters[axis] != c)
+		{
+			++axis;
+		}
+		if (axis == numVisibleAxes)
+		{
+			reply.printf("M596: unknown axis '%c'", *p);
+			return GCodeResult::error;
+		}
+		if (k.GetConnectedAxes(axis) != MakeBitmap<AxesBitmap>(axis))
+		{
+			reply.printf("M596: axis %c is coupled to other axes", c);
+			return GCodeResult::error;
+		}
+		SetBit(axes, axis);
+	}
+
+	FileStore * const f = platform.OpenFile(platform.GetGCodeDir(), filename.c_str(), OpenMode::read);
+	if (f == nullptr)
+	{
+		reply.printf("GCode file \"%s\" not found", filename.c_str());
+		return GCodeResult::error;
+	}
+	(void)f->EnableFastSeek();
+	(void)f->EnableReadAhead();
+
+	// Both rings are idle, so we can start the secondary ring from where the main one is
+	reprap.GetMove().CopyPositionToAuxRing();
+	reprap.GetMove().GetAuxMachinePosition(auxMachinePosition);
+	auxAxes = axes;
+	channelSync.Reset();
+
+	file2GCode->OriginalMachineState().fileState.Set(f);
+	file2Input->Reset(file2GCode->OriginalMachineState().fileState);
+	file2GCode->Init();
+	platform.MessageF(LogMessage, "Started running file %s on the secondary motion channel\n", filename.c_str());
+	return GCodeResult::ok;
+}
+
+// Handle M598
+GCodeResult GCodes::SyncMotionChannels(GCodeBuffer& gb, const StringRef& reply)
+{
+	const bool isAux = (&gb == file2GCode);
+	if (!isAux && &gb != fileGCode)
+	{
+		// Wait for the secondary channel to finish, then for standstill so that the main channel gets its axes back
+		return (!IsAuxChannelRunning() && AuxMovesAreFinished() && LockMovementAndWaitForStandstill(gb)) ? GCodeResult::ok : GCodeResult::notFinished;
+	}
+
+	const size_t channel = (isAux) ? 1 : 0;
+	if (!channelSync.IsWaiting(channel))
+	{
+		// Wait for the moves of this channel to finish
+		if (isAux ? !AuxMovesAreFinished() : !LockMovementAndWaitForStandstill(gb))
+		{
+			return GCodeResult::notFinished;
+		}
+	}
+
+	// Wait for the other channel to reach the same sync point, unless it isn't running
+	const bool otherChannelRunning = (isAux) ? fileGCode->OriginalMachineState().fileState.IsLive() : IsAuxChannelRunning();
+	return (channelSync.Arrive(channel, otherChannelRunning)) ? GCodeResult::ok : GCodeResult::notFinished;
+}
+
+// Stop the file running on the secondary motion channel, because the print has been cancelled or the channel has hit an error.
+// The moves already in its DDA ring are completed, and the main channel takes back the axes when it next waits for standstill.
+void GCodes::StopAuxChannel()
+{
+	if (IsAuxChannelRunning())
+	{
+		file2GCode->AbortFile(file2Input);
+		file2GCode->Init();
+		UnlockAll(*file2GCode);
+		platform.Message(LogMessage, "Stopped the file on the secondary motion channel\n");
+	}
+	auxMoveAvailable = false;
+	channelSync.Abandon(1);
+}
+
+// Execute a G- or T-code from the secondary motion channel
+bool GCodes::HandleAuxChannelCode(GCodeBuffer& gb, const StringRef& reply)
+{
+	if (gb.GetCommandLetter() != 'G' || !gb.HasCommandNumber() || gb.GetCommandFraction() >= 0)
+	{
+		reply.copy("Not supported on the secondary motion channel: ");
+		gb.AppendFullCommand(reply);
+		AbortPrint(gb);
+		return HandleResult(gb, GCodeResult::error, reply, nullptr);
+	}
+
+	GCodeResult result = GCodeResult::ok;
+	const int code = gb.GetCommandNumber();
+	switch (code)
+	{
+	case 0: // Rapid move
+	case 1: // Ordinary move
+		if (auxMoveAvailable)
+		{
+			return false;							// wait for Move to take the previous move
+		}
+		result = DoAuxMove(gb, code == 1, reply);
+		if (result == GCodeResult::error)
+		{
+			AbortPrint(gb);
+		}
+		break;
+
+	case 4: // Dwell
+		if (!AuxMovesAreFinished())
+		{
+			return false;
+		}
+		if (simulationMode == 0)
+		{
+			const int32_t dwell = (gb.Seen('S')) ? (int32_t)(gb.GetFValue() * 1000.0)
+									: (gb.Seen('P')) ? gb.GetIValue()
+										: 0;
+			if (dwell > 0)
+			{
+				result = DoDwellTime(gb, (uint32_t)dwell);
+			}
+		}
+		break;
+
+	case 20: // Inches
+		gb.MachineState().usingInches = true;
+		break;
+
+	case 21: // mm
+		gb.MachineState().usingInches = false;
+		break;
+
+	case 90: // Absolute coordinates
+		gb.MachineState().axesRelative = false;
+		break;
+
+	case 91: // Relative coordinates
+		gb.MachineState().axesRelative = true;
+		break;
+
+	default:
+		reply.printf("G%d is not supported on the secondary motion channel", code);
+		result = GCodeResult::error;
+		AbortPrint(gb);
+		break;
+	}
+
+	return HandleResult(gb, result, reply, nullptr);
+}
+
+// Set up a G0 or G1 move from the secondary motion channel. Axes that the channel doesn't own keep the position they had when M596 was executed,
+// so the DDA ring doesn't move them.
+GCodeResult GCodes::DoAuxMove(GCodeBuffer& gb, bool isCoordinated, const StringRef& reply)
+{
+	auxMoveBuffer.SetDefaults(numTotalAxes);
+	memcpy(auxMoveBuffer.coords, auxMachinePosition, numTotalAxes * sizeof(auxMoveBuffer.coords[0]));
+	memcpy(auxMoveBuffer.initialCoords, auxMachinePosition, numTotalAxes * sizeof(auxMoveBuffer.initialCoords[0]));
+
+	AxesBitmap axesMentioned = 0;
+	for (size_t axis = 0; axis < numVisibleAxes; ++axis)
+	{
+		if (gb.Seen(axisLetters[axis]))
+		{
+			if (!IsBitSet(auxAxes, axis))
+			{
+				reply.printf("G0/G1: axis %c does not belong to the secondary motion channel", axisLetters[axis]);
+				return GCodeResult::error;
+			}
+
+			SetBit(axesMentioned, axis);
+			const float moveArg = gb.GetDistance();
+			float newPos = (gb.MachineState().axesRelative) ? auxMachinePosition[axis] + moveArg : moveArg;
+			if (limitAxes && IsBitSet(axesHomed, axis))
+			{
+				newPos = constrain<float>(newPos, platform.AxisMinimum(axis), platform.AxisMaximum(axis));
+			}
+			auxMoveBuffer.coords[axis] = newPos;
+		}
+	}
+
+	if (CheckEnoughAxesHomed(axesMentioned))
+	{
+		reply.copy("G0/G1: insufficient axes homed");
+		return GCodeResult::error;
+	}
+
+	if (gb.Seen(feedrateLetter))
+	{
+		gb.MachineState().feedRate = gb.GetDistance() * SecondsToMinutes;	// the speed factor applies only to the main channel
+	}
+
+	auxMoveBuffer.feedRate = gb.MachineState().feedRate;
+	auxMoveBuffer.usingStandardFeedrate = true;
+	auxMoveBuffer.isCoordinated = isCoordinated;
+	auxMoveBuffer.isFirmwareRetraction = false;
+	auxMoveBuffer.canPauseAfter = true;
+	auxMoveBuffer.virtualExtruderPosition = 0.0;
+	auxMoveBuffer.proportionDone = 1.0;
+#if SUPPORT_LASER || SUPPORT_IOBITS
+	auxMoveBuffer.laserPwmOrIoBits.Clear();
+#endif
+
+	memcpy(auxMachinePosition, auxMoveBuffer.coords, numTotalAxes * sizeof(auxMachinePosition[0]));
+	__DMB();										// make sure that the move details have been written first
+	auxMoveAvailable = true;
+	return GCodeResult::ok;
+}
+
+#endif
+
+// End
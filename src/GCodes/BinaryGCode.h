@@ -0,0 +1,156 @@
+/*
+ * BinaryGCode.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Definition of the binary G-code stream format that FileGCodeInput can read in place of text G-code, and of the pre-parsed command
+ *  that it decodes into. This file must not depend on anything else in the firmware, because the host converter in Tools/BinaryGCode uses it too.
+ *
+ *  File layout:
+ *   - 8-byte header: 'R' 'R' 'F' 'B', format version, flags, 2 reserved bytes
+ *   - a sequence of blocks. A block is a length byte L (1 to MaxBlockPayload), L bytes of records, then a 4-byte little-endian CRC32
+ *     of the length byte and the records if FlagBlockCrc is set in the header. A zero byte where a block should start is padding.
+ *     Blocks never straddle a SectorSize boundary, so the start of every sector after the first is the start of a block or of padding.
+ *     This lets the reader resynchronise after seeking to an arbitrary record position, e.g. when resuming a paused print.
+ *
+ *  Record layout:
+ *   - header byte: bits 0-1 record type, bit 2 'same command number as the previous record of this type in this block', bits 3-7 parameter count
+ *   - G, M and T records: the command number as an unsigned LEB128 varint unless bit 2 is set, then the parameters.
+ *     Each parameter is a byte holding the upper case letter in bits 0-6 and a 'delta' flag in bit 7, followed by a zigzag-encoded LEB128 varint.
+ *     The value is a fixed-point number scaled by ParameterScale(letter). If the delta flag is set it is relative to the previous value of that
+ *     letter in the same block. Delta state and previous command numbers are reset at the start of every block.
+ *   - text records: an unsigned LEB128 length followed by that many bytes of ordinary G-code text. A line of text may be split across several records.
+ *     Text records carry everything that has no binary encoding, including comments. Resuming a print from the middle of a text record restarts the record.
+ */
+
+#ifndef SRC_GCODES_BINARYGCODE_H_
+#define SRC_GCODES_BINARYGCODE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace BinaryGCode
+{
+	constexpr char Magic[4] = { 'R', 'R', 'F', 'B' };
+	constexpr uint8_t FormatVersion = 1;
+	constexpr size_t HeaderLength = 8;
+	constexpr uint8_t FlagBlockCrc = 0x01;				// blocks are followed by a CRC32
+
+	constexpr size_t SectorSize = 512;					// blocks never cross a boundary of this size
+	constexpr size_t MaxBlockPayload = 120;				// a complete block including its length byte and CRC must fit in GCodeInputFileReadThreshold bytes
+	constexpr size_t BlockCrcLength = 4;
+	constexpr size_t MaxBlockLength = 1 + MaxBlockPayload + BlockCrcLength;
+
+	constexpr uint8_t RecordTypeMask = 0x03;
+	constexpr uint8_t RecordTypeG = 0;
+	constexpr uint8_t RecordTypeM = 1;
+	constexpr uint8_t RecordTypeT = 2;
+	constexpr uint8_t RecordTypeText = 3;
+	constexpr uint8_t RecordSameNumber = 0x04;
+	constexpr unsigned int RecordParamCountShift = 3;
+
+	constexpr uint8_t ParamDelta = 0x80;
+	constexpr uint8_t ParamLetterMask = 0x7F;
+
+	// Return the fixed-point scale used to encode the value of a parameter. Extrusion amounts need more precision than coordinates.
+	constexpr int32_t ParameterScale(char letter)
+	{
+		return (letter == 'E') ? 100000 : 1000;
+	}
+
+	constexpr uint64_t ZigZagEncode(int64_t v)
+	{
+		return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+	}
+
+	constexpr int64_t ZigZagDecode(uint64_t v)
+	{
+		return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+	}
+
+	// Return how many bytes of padding must be written at file offset 'offset' so that a block of 'blockLength' bytes after them doesn't straddle a sector boundary
+	constexpr size_t PaddingBeforeBlock(uint32_t offset, size_t blockLength)
+	{
+		return ((offset % SectorSize) + blockLength > SectorSize) ? SectorSize - (offset % SectorSize) : 0;
+	}
+
+	// Encode a block holding a single text record into 'block', which must have room for MaxBlockLength bytes.
+	// If 'crcFunc' is not null, the block ends with the CRC that it calculates over the length byte and the record.
+	// Return the length of the block, or 0 if the text doesn't fit in one record with a single-byte length.
+	inline size_t EncodeTextBlock(const char *text, size_t textLength, uint32_t (*crcFunc)(const uint8_t *data, size_t length), uint8_t *block)
+	{
+		if (textLength == 0 || textLength >= 0x80 || textLength + 2 > MaxBlockPayload)
+		{
+			return 0;
+		}
+		block[0] = (uint8_t)(textLength + 2);
+		block[1] = RecordTypeText;
+		block[2] = (uint8_t)textLength;
+		memcpy(block + 3, text, textLength);
+		size_t length = textLength + 3;
+		if (crcFunc != nullptr)
+		{
+			const uint32_t crc = crcFunc(block, length);
+			for (size_t i = 0; i < BlockCrcLength; ++i)
+			{
+				block[length++] = (uint8_t)(crc >> (8 * i));
+			}
+		}
+		return length;
+	}
+
+	// Search the last 'tailLength' bytes of a binary file for a final block that holds a single text record starting with 'text', as written by EncodeTextBlock.
+	// Return the offset of the block in 'tail', or -1 if there isn't one.
+	inline int FindFinalTextBlock(const uint8_t *tail, size_t tailLength, const char *text, bool withCrc)
+	{
+		const size_t textLength = strlen(text);
+		const size_t crcLength = (withCrc) ? BlockCrcLength : 0;
+		for (size_t i = 0; i + 3 + textLength + crcLength <= tailLength; ++i)
+		{
+			if (   tail[i + 1] == RecordTypeText
+				&& tail[i + 2] + 2 == tail[i]
+				&& i + 1 + tail[i] + crcLength == tailLength
+				&& tail[i + 2] >= textLength
+				&& memcmp(tail + i + 3, text, textLength) == 0
+			   )
+			{
+				return (int)i;
+			}
+		}
+		return -1;
+	}
+
+	// Work out where to write a block of 'blockLength' bytes holding a single text record at the end of a binary file, replacing any final block
+	// whose text starts with 'key'. 'tail' holds the last 'tailLength' bytes of the file, which is 'fileLength' bytes long.
+	// Return the file position at which to write 'padding' zero bytes followed by the block. The file must be truncated after the block.
+	inline uint32_t PlaceFinalTextBlock(const uint8_t *tail, size_t tailLength, uint32_t fileLength, const char *key, bool withCrc, size_t blockLength, size_t& padding)
+	{
+		const int blockOffset = FindFinalTextBlock(tail, tailLength, key, withCrc);
+		const uint32_t writePos = (blockOffset >= 0) ? fileLength - tailLength + (uint32_t)blockOffset : fileLength;
+		padding = PaddingBeforeBlock(writePos, blockLength);
+		return writePos;
+	}
+}
+
+// A G-, M- or T-code that has already been parsed. Only single numeric parameters are supported.
+struct ParsedGCode
+{
+	static constexpr size_t MaxParameters = 12;
+
+	struct Parameter
+	{
+		float value;
+		char letter;
+	};
+
+	int32_t commandNumber;
+	char commandLetter;
+	uint8_t numParameters;
+	Parameter parameters[MaxParameters];
+
+	void Init(char letter, int32_t number) { commandLetter = letter; commandNumber = number; numParameters = 0; }
+};
+
+#endif /* SRC_GCODES_BINARYGCODE_H_ */
@@ -21,7 +21,7 @@ GCodeBuffer::GCodeBuffer(const char* id, MessageType mt, bool usesCodeQueue)
 	: machineState(new GCodeMachineState()), identity(id), fileBeingWritten(nullptr), writingFileSize(0), eofStringCounter(0),
 	  toolNumberAdjust(0), responseMessageType(mt),
 	  hasCommandNumber(false), commandLetter('Q'),
-	  checksumRequired(false), queueCodes(usesCodeQueue), binaryWriting(false)
+	  checksumRequired(false), parsedCode(nullptr), queueCodes(usesCodeQueue), binaryWriting(false)
 {
 	Init();
 }
@@ -39,6 +39,8 @@ void GCodeBuffer::Init()
 	readPointer = -1;
 	hadLineNumber = hadChecksum = timerRunning = false;
 	computedChecksum = 0;
+	lineFilePosition = noFilePosition;
+	isPreParsed = false;
 	bufferState = GCodeBufferState::parseNotStarted;
 }
 
@@ -52,11 +54,15 @@ void GCodeBuffer::Diagnostics(MessageType mtype)
 		break;
 
 	case GCodeBufferState::ready:
-		scratchString.printf("%s is ready with \"%s\"", identity, Buffer());
+		scratchString.printf("%s is ready with \"", identity);
+		AppendFullCommand(scratchString.GetRef());
+		scratchString.cat('"');
 		break;
 
 	case GCodeBufferState::executing:
-		scratchString.printf("%s is doing \"%s\"", identity, Buffer());
+		scratchString.printf("%s is doing \"", identity);
+		AppendFullCommand(scratchString.GetRef());
+		scratchString.cat('"');
 		break;
 
 	default:
@@ -404,6 +410,32 @@ void GCodeBuffer::Put(const char *str)
 	Put(str, strlen(str));
 }
 
+// Load a command that has already been parsed, overwriting any existing content. The command is ready to execute when this returns.
+void GCodeBuffer::Put(const ParsedGCode& code, FilePosition filePos)
+{
+	Init();
+	if (parsedCode == nullptr)
+	{
+		parsedCode = new ParsedGCode;
+	}
+	*parsedCode = code;
+	isPreParsed = true;
+	lineFilePosition = filePos;
+	commandLetter = code.commandLetter;
+	hasCommandNumber = true;
+	commandNumber = code.commandNumber;
+	commandFraction = -1;
+	gcodeBuffer[0] = 0;
+	commandStart = parameterStart = commandEnd = 0;
+	if (reprap.Debug(moduleGcodes))
+	{
+		String<ScratchStringLength> scratchString;
+		AppendFullCommand(scratchString.GetRef());
+		reprap.GetPlatform().MessageF(DebugMessage, "%s(pre-parsed): %s\n", identity, scratchString.c_str());
+	}
+	bufferState = GCodeBufferState::ready;
+}
+
 void GCodeBuffer::SetFinished(bool f)
 {
 	if (f)
@@ -431,15 +463,38 @@ FilePosition GCodeBuffer::GetFilePosition(size_t bytesCached) const
 {
 	if (machineState->fileState.IsLive())
 	{
-		return machineState->fileState.GetPosition() - bytesCached - commandLength + commandStart;
+		return (lineFilePosition != noFilePosition) ? lineFilePosition : machineState->fileState.GetPosition() - bytesCached - commandLength + commandStart;
 	}
 	return noFilePosition;
 }
 
+// Record the file position of the start of the line being assembled, unless we already have it.
+// Used when the input isn't plain text, so that GetFilePosition can't work it out.
+void GCodeBuffer::SetLineFilePosition(FilePosition filePos)
+{
+	if (lineFilePosition == noFilePosition)
+	{
+		lineFilePosition = filePos;
+	}
+}
+
 // Is 'c' in the G Code string? 'c' must be uppercase.
 // Leave the pointer there for a subsequent read.
 bool GCodeBuffer::Seen(char c)
 {
+	if (isPreParsed)
+	{
+		for (readPointer = 0; readPointer < (int)parsedCode->numParameters; ++readPointer)
+		{
+			if (parsedCode->parameters[readPointer].letter == c)
+			{
+				return true;
+			}
+		}
+		readPointer = -1;
+		return false;
+	}
+
 	bool inQuotes = false;
 	unsigned int inBrackets = 0;
 	for (readPointer = parameterStart; (unsigned int)readPointer < commandEnd; ++readPointer)
@@ -474,7 +529,7 @@ float GCodeBuffer::GetFValue()
 {
 	if (readPointer >= 0)
 	{
-		const float result = ReadFloatValue(&gcodeBuffer[readPointer + 1], nullptr);
+		const float result = (isPreParsed) ? parsedCode->parameters[readPointer].value : ReadFloatValue(&gcodeBuffer[readPointer + 1], nullptr);
 		readPointer = -1;
 		return result;
 	}
@@ -496,24 +551,32 @@ void GCodeBuffer::GetFloatArray(float arr[], size_t& returnedLength, bool doPad)
 	if (readPointer >= 0)
 	{
 		size_t length = 0;
-		const char *p = gcodeBuffer + readPointer + 1;
-		for (;;)
+		if (isPreParsed)
 		{
-			if (length >= returnedLength)		// array limit has been set in here
-			{
-				reprap.GetPlatform().MessageF(ErrorMessage, "GCodes: Attempt to read a GCode float array that is too long: %s\n", gcodeBuffer);
-				readPointer = -1;
-				returnedLength = 0;
-				return;
-			}
-			const char *q;
-			arr[length] = ReadFloatValue(p, &q);
-			length++;
-			if (*q != LIST_SEPARATOR)
+			// Pre-parsed commands never have more than one value per parameter
+			arr[length++] = parsedCode->parameters[readPointer].value;
+		}
+		else
+		{
+			const char *p = gcodeBuffer + readPointer + 1;
+			for (;;)
 			{
-				break;
+				if (length >= returnedLength)		// array limit has been set in here
+				{
+					reprap.GetPlatform().MessageF(ErrorMessage, "GCodes: Attempt to read a GCode float array that is too long: %s\n", gcodeBuffer);
+					readPointer = -1;
+					returnedLength = 0;
+					return;
+				}
+				const char *q;
+				arr[length] = ReadFloatValue(p, &q);
+				length++;
+				if (*q != LIST_SEPARATOR)
+				{
+					break;
+				}
+				p = q + 1;
 			}
-			p = q + 1;
 		}
 
 		// Special case if there is one entry and returnedLength requests several. Fill the array with the first entry.
@@ -544,24 +607,32 @@ void GCodeBuffer::GetIntArray(int32_t arr[], size_t& returnedLength, bool doPad)
 	if (readPointer >= 0)
 	{
 		size_t length = 0;
-		const char *p = gcodeBuffer + readPointer + 1;
-		for (;;)
+		if (isPreParsed)
 		{
-			if (length >= returnedLength) // Array limit has been set in here
-			{
-				reprap.GetPlatform().MessageF(ErrorMessage, "GCodes: Attempt to read a GCode int array that is too long: %s\n", gcodeBuffer);
-				readPointer = -1;
-				returnedLength = 0;
-				return;
-			}
-			const char *q;
-			arr[length] = ReadIValue(p, &q);
-			length++;
-			if (*q != LIST_SEPARATOR)
+			// Pre-parsed commands never have more than one value per parameter
+			arr[length++] = (int32_t)parsedCode->parameters[readPointer].value;
+		}
+		else
+		{
+			const char *p = gcodeBuffer + readPointer + 1;
+			for (;;)
 			{
-				break;
+				if (length >= returnedLength) // Array limit has been set in here
+				{
+					reprap.GetPlatform().MessageF(ErrorMessage, "GCodes: Attempt to read a GCode int array that is too long: %s\n", gcodeBuffer);
+					readPointer = -1;
+					returnedLength = 0;
+					return;
+				}
+				const char *q;
+				arr[length] = ReadIValue(p, &q);
+				length++;
+				if (*q != LIST_SEPARATOR)
+				{
+					break;
+				}
+				p = q + 1;
 			}
-			p = q + 1;
 		}
 
 		// Special case if there is one entry and returnedLength requests several. Fill the array with the first entry.
@@ -591,24 +662,32 @@ void GCodeBuffer::GetUnsignedArray(uint32_t arr[], size_t& returnedLength, bool
 	if (readPointer >= 0)
 	{
 		size_t length = 0;
-		const char *p = gcodeBuffer + readPointer + 1;
-		for (;;)
+		if (isPreParsed)
 		{
-			if (length >= returnedLength) // Array limit has been set in here
-			{
-				reprap.GetPlatform().MessageF(ErrorMessage, "GCodes: Attempt to read a GCode unsigned array that is too long: %s\n", gcodeBuffer);
-				readPointer = -1;
-				returnedLength = 0;
-				return;
-			}
-			const char *q;
-			arr[length] = ReadUIValue(p, &q);
-			length++;
-			if (*q != LIST_SEPARATOR)
+			// Pre-parsed commands never have more than one value per parameter
+			arr[length++] = (uint32_t)parsedCode->parameters[readPointer].value;
+		}
+		else
+		{
+			const char *p = gcodeBuffer + readPointer + 1;
+			for (;;)
 			{
-				break;
+				if (length >= returnedLength) // Array limit has been set in here
+				{
+					reprap.GetPlatform().MessageF(ErrorMessage, "GCodes: Attempt to read a GCode unsigned array that is too long: %s\n", gcodeBuffer);
+					readPointer = -1;
+					returnedLength = 0;
+					return;
+				}
+				const char *q;
+				arr[length] = ReadUIValue(p, &q);
+				length++;
+				if (*q != LIST_SEPARATOR)
+				{
+					break;
+				}
+				p = q + 1;
 			}
-			p = q + 1;
 		}
 
 		// Special case if there is one entry and returnedLength requests several. Fill the array with the first entry.
@@ -637,6 +716,11 @@ void GCodeBuffer::GetUnsignedArray(uint32_t arr[], size_t& returnedLength, bool
 bool GCodeBuffer::GetQuotedString(const StringRef& str)
 {
 	str.Clear();
+	if (isPreParsed)
+	{
+		readPointer = -1;			// pre-parsed commands never have string parameters
+		return false;
+	}
 	if (readPointer >= 0)
 	{
 		++readPointer;				// skip the character that introduced the string
@@ -700,6 +784,12 @@ bool GCodeBuffer::InternalGetQuotedString(const StringRef& str)
 // Return true if successful.
 bool GCodeBuffer::GetPossiblyQuotedString(const StringRef& str)
 {
+	if (isPreParsed)
+	{
+		str.Clear();
+		readPointer = -1;
+		return false;
+	}
 	if (readPointer >= 0)
 	{
 		++readPointer;
@@ -747,6 +837,11 @@ bool GCodeBuffer::InternalGetPossiblyQuotedString(const StringRef& str)
 // been preceded by a tag letter.
 bool GCodeBuffer::GetUnprecedentedString(const StringRef& str)
 {
+	if (isPreParsed)
+	{
+		str.Clear();
+		return false;
+	}
 	readPointer = parameterStart;
 	char c;
 	while ((unsigned int)readPointer < commandEnd && ((c = gcodeBuffer[readPointer]) == ' ' || c == '\t'))
@@ -761,7 +856,7 @@ int32_t GCodeBuffer::GetIValue()
 {
 	if (readPointer >= 0)
 	{
-		const int32_t result = ReadIValue(&gcodeBuffer[readPointer + 1], nullptr);
+		const int32_t result = (isPreParsed) ? (int32_t)parsedCode->parameters[readPointer].value : ReadIValue(&gcodeBuffer[readPointer + 1], nullptr);
 		readPointer = -1;
 		return result;
 	}
@@ -775,7 +870,7 @@ uint32_t GCodeBuffer::GetUIValue()
 {
 	if (readPointer >= 0)
 	{
-		const uint32_t result = ReadUIValue(&gcodeBuffer[readPointer + 1], nullptr);
+		const uint32_t result = (isPreParsed) ? (uint32_t)parsedCode->parameters[readPointer].value : ReadUIValue(&gcodeBuffer[readPointer + 1], nullptr);
 		readPointer = -1;
 		return result;
 	}
@@ -908,6 +1003,11 @@ bool GCodeBuffer::GetIPAddress(IPAddress& returnedIp)
 		INTERNAL_ERROR;
 		return false;
 	}
+	if (isPreParsed)
+	{
+		readPointer = -1;
+		return false;
+	}
 
 	const char* p = &gcodeBuffer[readPointer + 1];
 	uint8_t ip[4];
@@ -953,6 +1053,11 @@ bool GCodeBuffer::GetMacAddress(uint8_t mac[6])
 		INTERNAL_ERROR;
 		return false;
 	}
+	if (isPreParsed)
+	{
+		readPointer = -1;
+		return false;
+	}
 
 	const char* p = gcodeBuffer + readPointer + 1;
 	unsigned int n = 0;
@@ -1111,6 +1216,91 @@ void GCodeBuffer::PrintCommand(const StringRef& s) const
 	}
 }
 
+// Append the text of the whole command including its parameters to a string. Pre-parsed commands are converted back to text.
+void GCodeBuffer::AppendFullCommand(const StringRef& s) const
+{
+	if (isPreParsed)
+	{
+		AppendParsedCommand(s, *parsedCode);
+	}
+	else
+	{
+		s.catn(gcodeBuffer + commandStart, commandEnd - commandStart);
+	}
+}
+
+// Append the text of a pre-parsed command to a string
+/*static*/ void GCodeBuffer::AppendParsedCommand(const StringRef& s, const ParsedGCode& code)
+{
+	s.catf("%c%d", code.commandLetter, (int)code.commandNumber);
+	for (size_t i = 0; i < code.numParameters; ++i)
+	{
+		const ParsedGCode::Parameter& param = code.parameters[i];
+		s.catf((BinaryGCode::ParameterScale(param.letter) > 1000) ? " %c%.5f" : " %c%.3f", param.letter, (double)param.value);
+	}
+}
+
+// Convert the current command to pre-parsed form, returning true if successful.
+// This fails if the command has a fractional command number, a lower case parameter letter, or any parameter that isn't a plain decimal number.
+// The parsed value must give the same results as reading the text would: GetFValue reads the same float from the text as SafeStrtof,
+// but GetIValue and GetUIValue read an integer from the text, so we also require the integer part of the number to survive conversion to float and back.
+// Callers must not use this for commands that take a string parameter, because the text of such a parameter can look like a number.
+bool GCodeBuffer::GetParsedForm(ParsedGCode& code) const
+{
+	if (isPreParsed)
+	{
+		code = *parsedCode;
+		return true;
+	}
+	if (!hasCommandNumber || commandFraction >= 0)
+	{
+		return false;
+	}
+
+	code.Init(commandLetter, commandNumber);
+	const char *p = gcodeBuffer + parameterStart;
+	const char * const end = gcodeBuffer + commandEnd;
+	for (;;)
+	{
+		while (p < end && (*p == ' ' || *p == '\t'))
+		{
+			++p;
+		}
+		if (p >= end)
+		{
+			return true;
+		}
+
+		const char letter = *p;
+		if (letter < 'A' || letter > 'Z' || code.numParameters == ParsedGCode::MaxParameters)
+		{
+			return false;
+		}
+		++p;
+		const char *q = p;
+		while (q < end && (isdigit(*q) || *q == '.' || *q == '-' || *q == '+'))
+		{
+			++q;
+		}
+		if (q == p || (q < end && *q != ' ' && *q != '\t'))
+		{
+			return false;
+		}
+
+		const char *floatEnd;
+		const float val = SafeStrtof(p, &floatEnd);
+		const long intVal = strtol(p, nullptr, 10);
+		if (floatEnd != q || fabsf(val) >= 16777216.0 || (long)val != intVal)	// every integer below 2^24 converts to float exactly
+		{
+			return false;
+		}
+		code.parameters[code.numParameters].letter = letter;
+		code.parameters[code.numParameters].value = val;
+		++code.numParameters;
+		p = q;
+	}
+}
+
 // Open a file to write to
 bool GCodeBuffer::OpenFileToWrite(const char* directory, const char* fileName, const FilePosition size, const bool binaryWrite, const uint32_t fileCRC32)
 {
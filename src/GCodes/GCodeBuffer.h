@@ -12,6 +12,7 @@
 #include "GCodeMachineState.h"
 #include "MessageType.h"
 #include "ObjectModel/ObjectModel.h"
+#include "BinaryGCode.h"
 
 // Class to hold an individual GCode and provide functions to allow it to be parsed
 class GCodeBuffer
@@ -24,6 +25,7 @@ public:
 	bool Put(char c) __attribute__((hot));				// Add a character to the end
 	void Put(const char *str, size_t len);				// Add an entire string, overwriting any existing content
 	void Put(const char *str);							// Add a null-terminated string, overwriting any existing content
+	void Put(const ParsedGCode& code, FilePosition filePos);	// Load a command that has already been parsed, overwriting any existing content
 	void FileEnded();									// Called when we reach the end of the file we are reading from
 	bool Seen(char c) __attribute__((hot));				// Is a character present?
 
@@ -82,6 +84,9 @@ public:
 	bool CanQueueCodes() const;
 	void MessageAcknowledged(bool cancelled);
 	FilePosition GetFilePosition(size_t bytesCached) const;	// Get the file position at the start of the current command
+	void SetLineFilePosition(FilePosition filePos);		// Record where the line being assembled started if the file position can't be calculated
+	bool IsPreParsed() const { return isPreParsed; }	// Return true if the current command was loaded by Put(const ParsedGCode&, FilePosition)
+	const ParsedGCode& GetParsedCode() const { return *parsedCode; }
 
 	bool OpenFileToWrite(const char* directory, const char* fileName, const FilePosition size, const bool binaryWrite, const uint32_t fileCRC32);	// open a file to write to
 	bool IsWritingFile() const { return fileBeingWritten != nullptr; }		// returns true if writing a file
@@ -95,6 +100,9 @@ public:
 	const char* CommandStart() const { return gcodeBuffer + commandStart; }	// get the start of the current command
 
 	void PrintCommand(const StringRef& s) const;
+	void AppendFullCommand(const StringRef& s) const;	// Append the text of the whole command
+	bool GetParsedForm(ParsedGCode& code) const;		// Convert the current command to pre-parsed form if possible
+	static void AppendParsedCommand(const StringRef& s, const ParsedGCode& code);
 
 	uint32_t whenTimerStarted;							// when we started waiting
 	bool timerRunning;									// true if we are waiting
@@ -165,6 +173,10 @@ private:
 	bool checksumRequired;								// True if we only accept commands with a valid checksum
 	int8_t commandFraction;
 
+	ParsedGCode *parsedCode;							// The pre-parsed command, allocated when we are first given one
+	FilePosition lineFilePosition;						// The file position of the current line if it can't be calculated, else noFilePosition
+	bool isPreParsed;									// True if the current command is in parsedCode instead of gcodeBuffer
+
 	bool queueCodes;									// Can we queue certain G-codes from this source?
 	bool binaryWriting;									// Executing gcode or writing binary file?
 };
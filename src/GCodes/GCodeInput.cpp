@@ -8,8 +8,10 @@
 #include "GCodeInput.h"
 
 #include "RepRap.h"
+#include "Platform.h"
 #include "GCodes.h"
 #include "GCodeBuffer.h"
+#include "Storage/CRC32.h"
 
 bool GCodeInput::FillBuffer(GCodeBuffer *gb)
 {
@@ -211,10 +213,16 @@ bool NetworkGCodeInput::FillBuffer(GCodeBuffer *gb) /*override*/
 
 // File-based G-code input source
 
+FileGCodeInput::FileGCodeInput() : RegularGCodeInput(), lastFile(nullptr)
+{
+	ResetBinaryState();
+}
+
 // Reset this input. Should be called when the associated file is being closed
 void FileGCodeInput::Reset()
 {
 	lastFile = nullptr;
+	ResetBinaryState();
 	RegularGCodeInput::Reset();
 }
 
@@ -227,15 +235,34 @@ void FileGCodeInput::Reset(const FileData &file)
 	}
 }
 
+void FileGCodeInput::ResetBinaryState()
+{
+	binarySyncPosition = textRecordStart = 0;
+	blockBytesLeft = textBytesLeft = 0;
+	crcBytesLeft = 0;
+	isBinary = hasBlockCrcs = binaryError = false;
+}
+
+// Fill a GCodeBuffer with the next G-code from the file
+bool FileGCodeInput::FillBuffer(GCodeBuffer *gb) /*override*/
+{
+	return (isBinary) ? FillBufferFromBinary(gb) : RegularGCodeInput::FillBuffer(gb);
+}
+
 // Read another chunk of G-codes from the file and return true if more data is available
 GCodeInputReadResult FileGCodeInput::ReadFromFile(FileData &file)
 {
+	if (binaryError)
+	{
+		return GCodeInputReadResult::error;
+	}
+
 	const size_t bytesCached = BytesCached();
 
 	// Keep track of the last file we read from
-	if (lastFile != nullptr && lastFile != file.f)
+	if (lastFile != file.f)
 	{
-		if (bytesCached > 0)
+		if (lastFile != nullptr && bytesCached > 0)
 		{
 			// Rewind back to the right position so we can resume at the right position later.
 			// This may be necessary when nested macros are executed.
@@ -243,11 +270,15 @@ GCodeInputReadResult FileGCodeInput::ReadFromFile(FileData &file)
 		}
 
 		RegularGCodeInput::Reset();
+		lastFile = file.f;
+		if (!StartFile(file.f))
+		{
+			return GCodeInputReadResult::error;
+		}
 	}
-	lastFile = file.f;
 
 	// Read more from the file
-	if (bytesCached < GCodeInputFileReadThreshold)
+	if (BytesCached() < GCodeInputFileReadThreshold)
 	{
 		// Reset the read+write pointers for better performance if possible
 		if (readingPointer == writingPointer)
@@ -258,6 +289,7 @@ GCodeInputReadResult FileGCodeInput::ReadFromFile(FileData &file)
 		// The code here used to read into a local buffer in blocks that are multiples of 4 bytes.
 		// However, unless we can use a buffer of at least 512 bytes then that is redundant,
 		// because the data will be copied via the sector buffer in FatFS anyway. So we don't do that any more.
+		// Files being printed have a read-ahead buffer in FileStore instead, which is filled several sectors at a time.
 		const int bytesRead = file.Read(buffer + writingPointer, min<size_t>(BufferSpaceLeft(), GCodeInputBufferSize - writingPointer));
 		if (bytesRead < 0)
 		{
@@ -270,7 +302,283 @@ GCodeInputReadResult FileGCodeInput::ReadFromFile(FileData &file)
 		}
 	}
 
-	return (bytesCached > 0) ? GCodeInputReadResult::haveData : GCodeInputReadResult::noData;
+	return (BytesCached() > 0) ? GCodeInputReadResult::haveData : GCodeInputReadResult::noData;
+}
+
+// We are about to start or resume reading a file. The first time we read it, find out whether it is in binary format by reading the header,
+// and store the result with the file so that we don't read the header again each time we return to the file from a macro.
+// If it is binary and we are part way through it, seek back to the start of the sector so that we can resynchronise with the block structure.
+// Return false if the file can't be read.
+bool FileGCodeInput::StartFile(FileStore *f)
+{
+	ResetBinaryState();
+	const FilePosition startPosition = f->Position();
+	GCodeFileFormat format = f->GetGCodeFormat();
+	if (format == GCodeFileFormat::unknown)
+	{
+		char header[BinaryGCode::HeaderLength];
+		if (   f->Length() >= BinaryGCode::HeaderLength
+			&& f->Seek(0)
+			&& f->Read(header, BinaryGCode::HeaderLength) == (int)BinaryGCode::HeaderLength
+			&& memcmp(header, BinaryGCode::Magic, sizeof(BinaryGCode::Magic)) == 0
+		   )
+		{
+			if ((uint8_t)header[4] != BinaryGCode::FormatVersion)
+			{
+				return BinaryError("unsupported format version");
+			}
+			format = ((header[5] & BinaryGCode::FlagBlockCrc) != 0) ? GCodeFileFormat::binaryWithCrcs : GCodeFileFormat::binary;
+		}
+		else
+		{
+			format = GCodeFileFormat::text;
+		}
+		f->SetGCodeFormat(format);
+		if (format == GCodeFileFormat::text)
+		{
+			return f->Seek(startPosition);
+		}
+	}
+
+	if (format == GCodeFileFormat::text)
+	{
+		return true;
+	}
+
+	isBinary = true;
+	hasBlockCrcs = (format == GCodeFileFormat::binaryWithCrcs);
+	binarySyncPosition = startPosition;
+	const FilePosition sectorStart = startPosition - (startPosition % BinaryGCode::SectorSize);
+	return f->Seek(max<FilePosition>(sectorStart, BinaryGCode::HeaderLength));
+}
+
+// Decode records from a binary file until we have a command for the GCodeBuffer or we need more data
+bool FileGCodeInput::FillBufferFromBinary(GCodeBuffer *gb)
+{
+	for (;;)
+	{
+		if (textBytesLeft != 0)
+		{
+			if (PassTextToBuffer(gb))
+			{
+				return true;
+			}
+			continue;
+		}
+
+		if (blockBytesLeft == 0 && !StartBinaryBlock())
+		{
+			return false;
+		}
+
+		const FilePosition recordStart = lastFile->Position() - BytesCached();
+		const bool skipping = recordStart < binarySyncPosition;
+		const uint8_t recordHeader = ReadBlockByte();
+		const uint8_t recordType = recordHeader & BinaryGCode::RecordTypeMask;
+		if (recordType == BinaryGCode::RecordTypeText)
+		{
+			uint64_t length;
+			if (!ReadVarint(length) || length > blockBytesLeft)
+			{
+				return BinaryError("bad text record");
+			}
+			textBytesLeft = (size_t)length;
+			textRecordStart = recordStart;
+			if (skipping)
+			{
+				while (textBytesLeft != 0)
+				{
+					(void)ReadBlockByte();
+					--textBytesLeft;
+				}
+			}
+			continue;
+		}
+
+		ParsedGCode code;
+		if ((recordHeader & BinaryGCode::RecordSameNumber) == 0)
+		{
+			uint64_t number;
+			if (!ReadVarint(number) || number > INT32_MAX)
+			{
+				return BinaryError("bad command number");
+			}
+			lastCommandNumbers[recordType] = (uint32_t)number;
+		}
+		code.Init("GMT"[recordType], (int32_t)lastCommandNumbers[recordType]);
+
+		const unsigned int numParameters = recordHeader >> BinaryGCode::RecordParamCountShift;
+		if (numParameters > ParsedGCode::MaxParameters)
+		{
+			return BinaryError("too many parameters");
+		}
+		while (code.numParameters < numParameters)
+		{
+			if (blockBytesLeft == 0)
+			{
+				return BinaryError("truncated record");
+			}
+			const uint8_t letterByte = ReadBlockByte();
+			const char letter = (char)(letterByte & BinaryGCode::ParamLetterMask);
+			uint64_t rawValue;
+			if (letter < 'A' || letter > 'Z' || !ReadVarint(rawValue))
+			{
+				return BinaryError("bad parameter");
+			}
+			int64_t& lastValue = lastParameterValues[letter - 'A'];
+			const int64_t value = BinaryGCode::ZigZagDecode(rawValue);
+			lastValue = (letterByte & BinaryGCode::ParamDelta) ? lastValue + value : value;
+			code.parameters[code.numParameters].letter = letter;
+			code.parameters[code.numParameters].value = (float)lastValue/(float)BinaryGCode::ParameterScale(letter);
+			++code.numParameters;
+		}
+
+		if (!skipping)
+		{
+			if (gb->IsWritingFile())
+			{
+				// The converter always emits the commands between M28 and M29 as text
+				return BinaryError("binary command while writing a file");
+			}
+			binarySyncPosition = 0;
+			gb->Put(code, recordStart);
+			return true;
+		}
+	}
+}
+
+// Pass the bytes of the current text record to the GCodeBuffer, returning true if it has a complete command
+bool FileGCodeInput::PassTextToBuffer(GCodeBuffer *gb)
+{
+	while (textBytesLeft != 0)
+	{
+		--textBytesLeft;
+		const char c = (char)ReadBlockByte();
+		gb->SetLineFilePosition(textRecordStart);		// if this starts a new line, resuming from here must re-read this record
+		if (gb->IsWritingBinary())
+		{
+			gb->WriteBinaryToFile(c);
+		}
+		else if (gb->Put(c))
+		{
+			if (gb->IsWritingFile())
+			{
+				gb->WriteToFile();
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+// Skip the CRC of the previous block and any padding, then check that the next block is complete and valid.
+// Return true if we have a block to decode, false if we need to read more data or the block is corrupt.
+bool FileGCodeInput::StartBinaryBlock()
+{
+	for (;;)
+	{
+		while (crcBytesLeft != 0)
+		{
+			if (BytesCached() == 0)
+			{
+				return false;
+			}
+			(void)ReadByte();
+			--crcBytesLeft;
+		}
+
+		if (BytesCached() == 0)
+		{
+			return false;
+		}
+
+		const size_t payloadLength = PeekByte(0);
+		if (payloadLength == 0)
+		{
+			(void)ReadByte();					// skip padding
+			continue;
+		}
+		if (payloadLength > BinaryGCode::MaxBlockPayload)
+		{
+			return BinaryError("bad block length");
+		}
+
+		const size_t crcLength = (hasBlockCrcs) ? BinaryGCode::BlockCrcLength : 0;
+		if (BytesCached() < 1 + payloadLength + crcLength)
+		{
+			// Wait until the whole block has been read, so that we don't execute any of it before we have checked the CRC
+			return (lastFile->Position() < lastFile->Length()) || BinaryError("truncated block");
+		}
+
+		if (hasBlockCrcs)
+		{
+			CRC32 crc;
+			for (size_t i = 0; i <= payloadLength; ++i)
+			{
+				crc.Update((char)PeekByte(i));
+			}
+			uint32_t storedCrc = 0;
+			for (size_t i = 0; i < BinaryGCode::BlockCrcLength; ++i)
+			{
+				storedCrc |= (uint32_t)PeekByte(1 + payloadLength + i) << (8 * i);
+			}
+			if (crc.Get() != storedCrc)
+			{
+				return BinaryError("CRC error");
+			}
+		}
+
+		(void)ReadByte();
+		blockBytesLeft = payloadLength;
+		crcBytesLeft = crcLength;
+		for (int64_t& v : lastParameterValues)
+		{
+			v = 0;
+		}
+		for (uint32_t& n : lastCommandNumbers)
+		{
+			n = 0;
+		}
+		return true;
+	}
+}
+
+// Read an unsigned LEB128 value from the current block
+bool FileGCodeInput::ReadVarint(uint64_t& val)
+{
+	val = 0;
+	for (unsigned int shift = 0; shift < 64 && blockBytesLeft != 0; shift += 7)
+	{
+		const uint8_t b = ReadBlockByte();
+		val |= (uint64_t)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Read a byte from the current block. The caller must check that there is one.
+uint8_t FileGCodeInput::ReadBlockByte()
+{
+	--blockBytesLeft;
+	return (uint8_t)ReadByte();
+}
+
+// Return a cached byte without consuming it
+uint8_t FileGCodeInput::PeekByte(size_t offset) const
+{
+	return (uint8_t)buffer[(readingPointer + offset) % GCodeInputBufferSize];
+}
+
+// Report corrupt binary data. Subsequent calls to ReadFromFile will return an error until we are reset.
+bool FileGCodeInput::BinaryError(const char *msg)
+{
+	const FilePosition pos = (lastFile != nullptr) ? lastFile->Position() - BytesCached() : 0;
+	reprap.GetPlatform().MessageF(ErrorMessage, "Binary G-code file: %s near byte %" PRIu32 "\n", msg, (uint32_t)pos);
+	binaryError = true;
+	return false;
 }
 
 // End
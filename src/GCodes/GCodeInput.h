@@ -12,6 +12,7 @@
 #include "Storage/FileData.h"
 #include "MessageType.h"
 #include "RTOSIface/RTOSIface.h"
+#include "BinaryGCode.h"
 
 const size_t GCodeInputBufferSize = 256;				// How many bytes can we cache per input source?
 const size_t GCodeInputFileReadThreshold = 128;			// How many free bytes must be available before data is read from the SD card?
@@ -85,19 +86,43 @@ enum class GCodeInputReadResult : uint8_t { haveData, noData, error };
 
 // This class is an expansion of the RegularGCodeInput class to buffer G-codes and to rewind file positions when
 // nested G-code files are started. However buffered codes are not explicitly checked for M112.
+// Files may be plain text or in the binary format defined in BinaryGCode.h.
 class FileGCodeInput : public RegularGCodeInput
 {
 public:
 
-	FileGCodeInput() : RegularGCodeInput(), lastFile(nullptr) { }
+	FileGCodeInput();
 
 	void Reset() override;								// This should be called when the associated file is being closed
 	void Reset(const FileData &file);					// Should be called when a specific G-code or macro file is closed or re-opened outside the reading context
+	bool FillBuffer(GCodeBuffer *gb) override;			// Fill a GCodeBuffer with the next G-code from the file
 
 	GCodeInputReadResult ReadFromFile(FileData &file);	// Read another chunk of G-codes from the file and return true if more data is available
 
 private:
+	void ResetBinaryState();
+	bool StartFile(FileStore *f);						// Find out what format a file is in and position it ready to read
+	bool FillBufferFromBinary(GCodeBuffer *gb);
+	bool StartBinaryBlock();
+	bool PassTextToBuffer(GCodeBuffer *gb);
+	bool ReadVarint(uint64_t& val);
+	uint8_t ReadBlockByte();
+	uint8_t PeekByte(size_t offset) const;
+	bool BinaryError(const char *msg);
+
 	FileStore *lastFile;
+
+	// Binary G-code decoding state
+	FilePosition binarySyncPosition;					// when we start reading part way through a file, we skip records that start before this position
+	FilePosition textRecordStart;						// the file position of the current text record
+	int64_t lastParameterValues['Z' - 'A' + 1];			// the previous value of each parameter in the current block
+	uint32_t lastCommandNumbers[3];						// the previous G, M and T command numbers in the current block
+	size_t blockBytesLeft;								// how many bytes of records in the current block we haven't consumed
+	size_t textBytesLeft;								// how many bytes of the current text record we haven't passed to the GCodeBuffer
+	uint8_t crcBytesLeft;								// how many bytes of the CRC of the current block we haven't skipped
+	bool isBinary;										// true if the file is in binary format
+	bool hasBlockCrcs;									// true if each block is followed by a CRC
+	bool binaryError;									// true if we found corrupt binary data
 };
 
 // This class receives its data from the network task
@@ -13,17 +13,20 @@
 
 // GCodeQueue class
 
-GCodeQueue::GCodeQueue() : freeItems(nullptr), queuedItems(nullptr)
+constexpr size_t MaxQueuedCodes = DdaRingLength;		// how many codes can be queued
+
+GCodeQueue::GCodeQueue() : items(new QueuedCode[MaxQueuedCodes]), firstItem(0), numItems(0)
 {
-	for (size_t i = 0; i < maxQueuedCodes; i++)
-	{
-		freeItems = new QueuedCode(freeItems);
-	}
 }
 
-// Return true if the move in the GCodeBuffer should be queued
-/*static*/ bool GCodeQueue::ShouldQueueCode(GCodeBuffer &gb)
+// Return true if the move in the GCodeBuffer should be queued. 'entry' is the code table entry for the command, or nullptr if it has none.
+/*static*/ bool GCodeQueue::ShouldQueueCode(GCodeBuffer &gb, const CodeTableEntry *entry)
 {
+	if (entry == nullptr || entry->queueRule == CodeQueueRule::never)
+	{
+		return false;
+	}
+
 #if SUPPORT_ROLAND
 	// Don't queue codes if the Roland module is active
 	if (reprap.GetRoland()->Active())
@@ -33,199 +36,159 @@ GCodeQueue::GCodeQueue() : freeItems(nullptr), queuedItems(nullptr)
 #endif
 
 	// Don't queue anything if no moves are being performed
-	const uint32_t scheduledMoves = reprap.GetMove().GetScheduledMoves();
-	if (scheduledMoves != reprap.GetMove().GetCompletedMoves())
+	if (reprap.GetMove().GetScheduledMoves() == reprap.GetMove().GetCompletedMoves())
 	{
-		switch (gb.GetCommandLetter())
+		return false;
+	}
+
+	switch (entry->queueRule)
+	{
+	case CodeQueueRule::always:
+	case CodeQueueRule::message:
+		return true;
+
+	case CodeQueueRule::unlessLaser:
+		// On laser devices we use these codes (M3 and M5) to set the default laser power for the next G1 command
+		return reprap.GetGCodes().GetMachineType() != MachineType::laser;
+
+	case CodeQueueRule::nonBlockingMessage:
 		{
-		case 'G':
-			{
-				const int code = gb.GetCommandNumber();
-				return code == 10 && gb.Seen('P') && !gb.Seen('L') && (gb.Seen('R') || gb.Seen('S'));			// set active/standby temperatures
-			}
-
-		case 'M':
-			{
-				switch (gb.GetCommandNumber())
-				{
-				case 3:		// spindle or laser control
-				case 5:		// spindle or laser control
-					// On laser devices we use these codes to set the default laser power for the next G1 command
-					return reprap.GetGCodes().GetMachineType() != MachineType::laser;
-
-				case 4:		// spindle control
-				case 42:	// set IO pin
-				case 106:	// fan control
-				case 107:	// fan off
-				case 104:	// set temperatures and return immediately
-				case 140:	// set bed temperature and return immediately
-				case 141:	// set chamber temperature and return immediately
-				case 144:	// bed standby
-				case 117:	// display message
-				case 280:	// set servo
-				case 300:	// beep
-				case 420:	// set RGB colour
-					return true;
-
-				case 291:
-					{
-						bool seen = false;
-						int32_t sParam = 1;
-						gb.TryGetIValue('S', sParam, seen);
-						return sParam < 2;					// queue non-blocking messages only
-					}
-
-				default:
-					break;
-				}
-			}
-			break;
-
-		default:
-			break;
+			bool seen = false;
+			int32_t sParam = 1;
+			gb.TryGetIValue('S', sParam, seen);
+			return sParam < 2;					// queue non-blocking messages only
 		}
-	}
 
-	return false;
+	case CodeQueueRule::toolTemperatures:
+		return gb.Seen('P') && !gb.Seen('L') && (gb.Seen('R') || gb.Seen('S'));		// set active/standby temperatures
+
+	default:
+		return false;
+	}
 }
 
 // Try to queue the command in the passed GCodeBuffer.
 // If successful, return true to indicate it has been queued.
 // If the queue is full or the command is too long to be queued, return false.
-bool GCodeQueue::QueueCode(GCodeBuffer &gb)
+// 'entry' is the code table entry that ShouldQueueCode accepted. Codes that take a string parameter are always queued as text.
+bool GCodeQueue::QueueCode(GCodeBuffer &gb, const CodeTableEntry *entry)
 {
 	// Can we queue this code somewhere?
-	if (freeItems == nullptr || gb.CommandLength() > SHORT_GCODE_LENGTH - 1)
+	if (numItems == MaxQueuedCodes)
 	{
 		return false;
 	}
 
-	// Unlink a free element and assign gb's code to it
-	QueuedCode * const code = freeItems;
-	freeItems = code->next;
-	code->AssignFrom(gb);
-	code->executeAtMove = reprap.GetMove().GetScheduledMoves();
-	code->next = nullptr;
-
-	// Append it to the list of queued codes
-	if (queuedItems == nullptr)
-	{
-		queuedItems = code;
-	}
-	else
+	// Assign gb's code to the next free element, unless it turns out to be too long
+	QueuedCode& code = items[(firstItem + numItems) % MaxQueuedCodes];
+	const bool takesString = entry->queueRule == CodeQueueRule::message || entry->queueRule == CodeQueueRule::nonBlockingMessage;
+	if (!code.AssignFrom(gb, !takesString))
 	{
-		QueuedCode *last = queuedItems;
-		while (last->Next() != nullptr)
-		{
-			last = last->Next();
-		}
-		last->next = code;
+		return false;
 	}
-
+	code.executeAtMove = reprap.GetMove().GetScheduledMoves();
+	++numItems;
 	return true;
 }
 
 bool GCodeQueue::FillBuffer(GCodeBuffer *gb)
 {
 	// Can this buffer be filled?
-	if (queuedItems == nullptr || queuedItems->executeAtMove > reprap.GetMove().GetCompletedMoves())
+	if (IsIdle())
 	{
 		// No - stop here
 		return false;
 	}
 
-	// Yes - load it into the passed GCodeBuffer instance
-	QueuedCode *code = queuedItems;
-	code->AssignTo(gb);
-
-	// Release this item again
-	queuedItems = queuedItems->next;
-	code->next = freeItems;
-	freeItems = code;
+	// Yes - load it into the passed GCodeBuffer instance and release the item
+	items[firstItem].AssignTo(gb);
+	firstItem = (firstItem + 1) % MaxQueuedCodes;
+	--numItems;
 	return true;
 }
 
 // Return true if there is nothing to do
 bool GCodeQueue::IsIdle() const
 {
-	return queuedItems == nullptr || queuedItems->executeAtMove > reprap.GetMove().GetCompletedMoves();
+	return numItems == 0 || items[firstItem].executeAtMove > reprap.GetMove().GetCompletedMoves();
 }
 
 // Because some moves may end before the print is actually paused, we need a method to
-// remove all the entries that will not be executed after the print has finally paused
+// remove all the entries that will not be executed after the print has finally paused.
+// Codes are queued in move order, so these are all at the end of the queue.
 void GCodeQueue::PurgeEntries()
 {
-	QueuedCode *item = queuedItems, *lastItem = nullptr;
-	while (item != nullptr)
+	while (numItems != 0 && items[(firstItem + numItems - 1) % MaxQueuedCodes].executeAtMove > reprap.GetMove().GetScheduledMoves())
 	{
-		if (item->executeAtMove > reprap.GetMove().GetScheduledMoves())
-		{
-			// Release this item
-			QueuedCode *nextItem = item->Next();
-			item->next = freeItems;
-			freeItems = item;
-
-			// Unlink it from the list
-			if (lastItem == nullptr)
-			{
-				queuedItems = nextItem;
-			}
-			else
-			{
-				lastItem->next = nextItem;
-			}
-			item = nextItem;
-		}
-		else
-		{
-			lastItem = item;
-			item = item->Next();
-		}
+		--numItems;
 	}
 }
 
 void GCodeQueue::Clear()
 {
-	while (queuedItems != nullptr)
-	{
-		QueuedCode * const item = queuedItems;
-		queuedItems = item->Next();
-		item->next = freeItems;
-		freeItems = item;
-	}
+	firstItem = numItems = 0;
 }
 
 void GCodeQueue::Diagnostics(MessageType mtype)
 {
-	reprap.GetPlatform().MessageF(mtype, "Code queue is %s\n", (queuedItems == nullptr) ? "empty." : "not empty:");
-	if (queuedItems != nullptr)
+	reprap.GetPlatform().MessageF(mtype, "Code queue is %s\n", (numItems == 0) ? "empty." : "not empty:");
+	if (numItems != 0)
 	{
-		const QueuedCode *item = queuedItems;
-		size_t queueLength = 0;
-		do
+		for (size_t i = 0; i < numItems; ++i)
 		{
-			queueLength++;
-			reprap.GetPlatform().MessageF(mtype, "Queued '%s' for move %" PRIu32 "\n", item->code, item->executeAtMove);
-		} while ((item = item->Next()) != nullptr);
-		reprap.GetPlatform().MessageF(mtype, "%d of %d codes have been queued.\n", queueLength, maxQueuedCodes);
+			const QueuedCode& item = items[(firstItem + i) % MaxQueuedCodes];
+			String<ScratchStringLength> codeText;
+			item.AppendText(codeText.GetRef());
+			reprap.GetPlatform().MessageF(mtype, "Queued '%s' for move %" PRIu32 "\n", codeText.c_str(), item.executeAtMove);
+		}
+		reprap.GetPlatform().MessageF(mtype, "%u of %u codes have been queued.\n", (unsigned int)numItems, (unsigned int)MaxQueuedCodes);
 	}
 }
 
 // QueuedCode class
 
-void QueuedCode::AssignFrom(GCodeBuffer &gb)
+// Copy the command from gb, returning false if it was too long to fit. Commands are stored in pre-parsed form if allowed and possible.
+bool QueuedCode::AssignFrom(GCodeBuffer &gb, bool mayPreParse)
 {
 	toolNumberAdjust = gb.GetToolNumberAdjust();
-	const size_t length = min<size_t>(gb.CommandLength(), ARRAY_SIZE(code) - 1);
-	memcpy(code, gb.CommandStart(), length);
-	code[length] = 0;
+	isParsed = mayPreParse && gb.GetParsedForm(parsed);
+	if (isParsed)
+	{
+		return true;
+	}
+
+	if (gb.CommandLength() > ARRAY_SIZE(text) - 1)
+	{
+		return false;
+	}
+	memcpy(text, gb.CommandStart(), gb.CommandLength());
+	text[gb.CommandLength()] = 0;
+	return true;
 }
 
 void QueuedCode::AssignTo(GCodeBuffer *gb)
 {
 	gb->SetToolNumberAdjust(toolNumberAdjust);
-	gb->Put(code);
+	if (isParsed)
+	{
+		gb->Put(parsed, noFilePosition);
+	}
+	else
+	{
+		gb->Put(text);
+	}
 }
 
-// End
+void QueuedCode::AppendText(const StringRef& s) const
+{
+	if (isParsed)
+	{
+		GCodeBuffer::AppendParsedCommand(s, parsed);
+	}
+	else
+	{
+		s.cat(text);
+	}
+}
 
+// End
@@ -9,16 +9,38 @@
 
 #include "RepRapFirmware.h"
 #include "GCodeBuffer.h"
+#include "GCodeTable.h"
 
-class QueuedCode;
+// A code that has been queued to synchronise it with the moves. It is held in pre-parsed form if possible, so that replaying it doesn't parse it again.
+class QueuedCode
+{
+public:
+	friend class GCodeQueue;
 
+private:
+	union
+	{
+		ParsedGCode parsed;						// the command, if isParsed is true
+		char text[SHORT_GCODE_LENGTH];			// the command as text, if it has parameters that can't be pre-parsed
+	};
+	uint32_t executeAtMove;
+	int toolNumberAdjust;
+	bool isParsed;
+
+	bool AssignFrom(GCodeBuffer &gb, bool mayPreParse);
+	void AssignTo(GCodeBuffer *gb);
+	void AppendText(const StringRef& s) const;
+};
+
+// Queue of codes waiting for moves to complete. The queue is a ring that is allocated once and has one entry per entry in the DDA ring,
+// so that it only fills up if there is more than one queued code for each pending move.
 class GCodeQueue
 {
 public:
 	GCodeQueue();
 
-	static bool ShouldQueueCode(GCodeBuffer &gb);				// Return true if this code should be queued
-	bool QueueCode(GCodeBuffer &gb);							// Queue a G-code
+	static bool ShouldQueueCode(GCodeBuffer &gb, const CodeTableEntry *entry);	// Return true if this code should be queued
+	bool QueueCode(GCodeBuffer &gb, const CodeTableEntry *entry);	// Queue a G-code
 	bool FillBuffer(GCodeBuffer *gb);							// If there is another move to execute at this time, fill a buffer
 	void PurgeEntries();										// Remove stored codes when a print is being paused
 	void Clear();												// Clean up all the stored codes
@@ -27,27 +49,9 @@ public:
 	void Diagnostics(MessageType mtype);
 
 private:
-	QueuedCode *freeItems;
-	QueuedCode *queuedItems;
-};
-
-class QueuedCode
-{
-public:
-	friend class GCodeQueue;
-
-	QueuedCode(QueuedCode *n) : next(n) { }
-	QueuedCode *Next() const { return next; }
-
-private:
-	QueuedCode *next;
-
-	char code[SHORT_GCODE_LENGTH];
-	uint32_t executeAtMove;
-	int toolNumberAdjust;
-
-	void AssignFrom(GCodeBuffer &gb);
-	void AssignTo(GCodeBuffer *gb);
+	QueuedCode *items;											// the ring of queued codes
+	size_t firstItem;											// index of the oldest queued code
+	size_t numItems;											// how many codes are queued
 };
 
 #endif
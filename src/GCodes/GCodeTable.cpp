@@ -0,0 +1,384 @@
+/*
+ * GCodeTable.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  This file contains the G- and M-code registration tables, which say for each code whether it can be queued, which locks it needs and which function handles it.
+ *  Codes that don't have a handler in the table are handled by the switch statements in GCodes2.cpp.
+ *  It also contains the optional per-code execution statistics, which are reported by M122 P106.
+ */
+
+#include "GCodes.h"
+
+#include "GCodeBuffer.h"
+#include "Movement/StepTimer.h"
+#include "RepRap.h"
+
+// The tables must be sorted by code number
+const CodeTableEntry GCodes::gCodeTable[] =
+{
+	{ 0,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// rapid move
+	{ 1,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// ordinary move
+	{ 2,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// clockwise arc
+	{ 3,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// anticlockwise arc
+	{ 4,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// dwell
+	{ 10,	CodeQueueRule::toolTemperatures,	CodeLock::none,						nullptr },		// set offsets and temperatures, or retract
+	{ 11,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// un-retract
+	{ 17,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// select XY plane
+	{ 18,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// select XZ plane
+	{ 19,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// select YZ plane
+	{ 20,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// inches
+	{ 21,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// mm
+	{ 28,	CodeQueueRule::never,				CodeLock::movementAndStandstill,	&GCodes::DoHome },
+	{ 29,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// grid-based bed probing
+	{ 30,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// single Z probe
+	{ 31,	CodeQueueRule::never,				CodeLock::none,						&GCodes::SetPrintZProbe },
+	{ 32,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// bed probing
+	{ 53,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// use machine coordinates
+	{ 54,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// select workplace coordinates
+	{ 55,	CodeQueueRule::never,				CodeLock::none,						nullptr },
+	{ 56,	CodeQueueRule::never,				CodeLock::none,						nullptr },
+	{ 57,	CodeQueueRule::never,				CodeLock::none,						nullptr },
+	{ 58,	CodeQueueRule::never,				CodeLock::none,						nullptr },
+	{ 59,	CodeQueueRule::never,				CodeLock::none,						nullptr },
+	{ 60,	CodeQueueRule::never,				CodeLock::none,						&GCodes::SavePosition },
+	{ 90,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// absolute coordinates
+	{ 91,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// relative coordinates
+	{ 92,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// set position
+};
+
+const CodeTableEntry GCodes::mCodeTable[] =
+{
+	{ 0,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// stop
+	{ 1,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// sleep
+	{ 3,	CodeQueueRule::unlessLaser,			CodeLock::none,						nullptr },		// spindle or laser on
+	{ 4,	CodeQueueRule::always,				CodeLock::none,						nullptr },		// spindle on counterclockwise
+	{ 5,	CodeQueueRule::unlessLaser,			CodeLock::none,						nullptr },		// spindle or laser off
+	{ 18,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// motors off
+	{ 20,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// list files
+	{ 21,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// mount SD card
+	{ 22,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// release SD card
+	{ 23,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// select file
+	{ 24,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// start or resume print
+	{ 25,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// pause print
+	{ 26,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// set file position
+	{ 27,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// report print status
+	{ 28,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// write to file
+	{ 29,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// end of file being written
+	{ 30,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// delete file
+	{ 32,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// select file and start print
+	{ 36,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// file information
+	{ 37,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// simulation mode
+	{ 38,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// SHA1 of file
+	{ 39,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// SD card info
+	{ 42,	CodeQueueRule::always,				CodeLock::none,						nullptr },		// set IO pin
+	{ 80,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// ATX power on
+	{ 81,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// ATX power off
+	{ 82,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// absolute extrusion
+	{ 83,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// relative extrusion
+	{ 84,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// motors off
+	{ 85,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// inactive time
+	{ 92,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// steps/mm
+	{ 98,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// call macro
+	{ 99,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// return from macro
+	{ 101,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// un-retract
+	{ 102,	CodeQueueRule::never,				CodeLock::none,						nullptr },
+	{ 103,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// retract
+	{ 104,	CodeQueueRule::always,				CodeLock::none,						nullptr },		// set temperatures and return immediately
+	{ 105,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// get temperatures
+	{ 106,	CodeQueueRule::always,				CodeLock::none,						nullptr },		// fan control
+	{ 107,	CodeQueueRule::always,				CodeLock::none,						nullptr },		// fan off
+	{ 108,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// cancel waiting for temperature
+	{ 109,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// set temperature and wait
+	{ 110,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// set line number
+	{ 111,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// debug level
+	{ 112,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// emergency stop
+	{ 114,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// report position
+	{ 115,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// firmware version
+	{ 116,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// wait for temperatures
+	{ 117,	CodeQueueRule::message,				CodeLock::none,						nullptr },		// display message
+	{ 118,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// echo message
+	{ 119,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// endstop status
+	{ 120,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// push
+	{ 121,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// pop
+	{ 122,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// diagnostics
+	{ 140,	CodeQueueRule::always,				CodeLock::none,						nullptr },		// bed temperature
+	{ 141,	CodeQueueRule::always,				CodeLock::none,						nullptr },		// chamber temperature
+	{ 143,	CodeQueueRule::never,				CodeLock::none,						&GCodes::SetHeaterProtection },
+	{ 144,	CodeQueueRule::always,				CodeLock::none,						nullptr },		// bed standby
+	{ 150,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// DotStar LED colour
+	{ 190,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// bed temperature and wait
+	{ 191,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// chamber temperature and wait
+	{ 200,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// filament diameter
+	{ 201,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// accelerations
+	{ 203,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// feedrates
+	{ 204,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// printing and travel accelerations
+	{ 205,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// jerk in mm/sec
+	{ 206,	CodeQueueRule::never,				CodeLock::none,						&GCodes::OffsetAxes },
+	{ 207,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// firmware retraction
+	{ 208,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// axis limits
+	{ 210,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// homing feed rates
+	{ 220,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// speed factor
+	{ 221,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// extrusion factor
+	{ 226,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// synchronous pause
+	{ 260,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// I2C send
+	{ 261,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// I2C receive
+	{ 280,	CodeQueueRule::always,				CodeLock::none,						nullptr },		// servo
+	{ 290,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// baby stepping
+	{ 291,	CodeQueueRule::nonBlockingMessage,	CodeLock::none,						nullptr },		// message box
+	{ 292,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// acknowledge message
+	{ 300,	CodeQueueRule::always,				CodeLock::none,						nullptr },		// beep
+	{ 301,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// hot end PID
+	{ 302,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// cold extrusion
+	{ 303,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// PID tuning
+	{ 304,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// bed PID
+	{ 305,	CodeQueueRule::never,				CodeLock::none,						&GCodes::SetHeaterParameters },
+	{ 307,	CodeQueueRule::never,				CodeLock::none,						&GCodes::SetHeaterModel },
+	{ 350,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// microstepping
+	{ 374,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// save height map
+	{ 375,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// load height map
+	{ 376,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// taper height
+	{ 400,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// wait for moves to finish
+	{ 401,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// deploy Z probe
+	{ 402,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// retract Z probe
+	{ 404,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// filament width and nozzle diameter
+	{ 408,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// JSON status
+	{ 420,	CodeQueueRule::always,				CodeLock::none,						nullptr },		// RGB colour
+	{ 450,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// report machine mode
+	{ 451,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// FFF mode
+	{ 452,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// laser mode
+	{ 453,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// CNC mode
+	{ 470,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// mkdir
+	{ 471,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// rename
+	{ 500,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// write config-override.g
+	{ 501,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// run config-override.g
+	{ 502,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// factory settings
+	{ 503,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// list config
+	{ 505,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// set sys folder
+	{ 540,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// MAC address
+	{ 550,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// machine name
+	{ 551,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// password
+	{ 552,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// network and IP address
+	{ 553,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// netmask
+	{ 554,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// gateway
+	{ 555,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// firmware compatibility
+	{ 556,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// axis compensation
+	{ 557,	CodeQueueRule::never,				CodeLock::movement,					&GCodes::DefineGrid },
+	{ 558,	CodeQueueRule::never,				CodeLock::none,						&GCodes::SetOrReportZProbe },
+	{ 559,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// binary writing
+	{ 560,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// binary writing
+	{ 561,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// identity transform
+	{ 562,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// reset temperature fault
+	{ 563,	CodeQueueRule::never,				CodeLock::none,						&GCodes::ManageTool },
+	{ 564,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// axis limits
+	{ 566,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// jerk in mm/min
+	{ 567,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// mix ratios
+	{ 568,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// automatic mixing
+	{ 569,	CodeQueueRule::never,				CodeLock::none,						&GCodes::ConfigureDriver },
+	{ 570,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// heater monitoring
+	{ 571,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// output on extrude
+	{ 572,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// pressure advance
+	{ 573,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// heater average PWM
+	{ 574,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// endstops
+	{ 575,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// communications parameters
+	{ 577,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// wait for endstop
+	{ 578,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// inkjet
+	{ 579,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// scale axes
+	{ 580,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// Roland
+	{ 581,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// configure trigger
+	{ 582,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// check trigger
+	{ 584,	CodeQueueRule::never,				CodeLock::movementAndStandstill,	&GCodes::DoDriveMapping },
+	{ 585,	CodeQueueRule::never,				CodeLock::none,						&GCodes::ProbeTool },
+	{ 586,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// network protocols
+	{ 587,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// WiFi networks
+	{ 588,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// forget WiFi network
+	{ 589,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// access point
+	{ 591,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// filament sensor
+	{ 592,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// nonlinear extrusion
+	{ 593,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// dynamic ringing cancellation
+#if SUPPORT_ASYNC_MOVES
+	{ 596,	CodeQueueRule::never,				CodeLock::movementAndStandstill,	&GCodes::StartAuxChannel },
+	{ 598,	CodeQueueRule::never,				CodeLock::none,						&GCodes::SyncMotionChannels },
+#endif
+	{ 600,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// filament change pause
+	{ 665,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// delta configuration
+	{ 666,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// delta endstop adjustments
+	{ 667,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// CoreXY mode
+	{ 669,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// kinematics
+	{ 670,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// IO bits
+	{ 671,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// leadscrew positions
+	{ 672,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// program Z probe
+	{ 675,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// find centre of cavity
+	{ 701,	CodeQueueRule::never,				CodeLock::none,						&GCodes::LoadFilament },
+	{ 702,	CodeQueueRule::never,				CodeLock::none,						&GCodes::UnloadFilament },
+	{ 703,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// configure filament
+	{ 750,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// 3D scanner
+	{ 751,	CodeQueueRule::never,				CodeLock::none,						nullptr },
+	{ 752,	CodeQueueRule::never,				CodeLock::none,						nullptr },
+	{ 753,	CodeQueueRule::never,				CodeLock::none,						nullptr },
+	{ 754,	CodeQueueRule::never,				CodeLock::none,						nullptr },
+	{ 755,	CodeQueueRule::never,				CodeLock::none,						nullptr },
+	{ 756,	CodeQueueRule::never,				CodeLock::none,						nullptr },
+	{ 851,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// Z probe offset
+	{ 905,	CodeQueueRule::never,				CodeLock::none,						&GCodes::SetDateTime },
+	{ 906,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// motor currents
+	{ 911,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// power fail auto save
+	{ 912,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// MCU temperature adjustment
+	{ 913,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// motor current percent
+	{ 914,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// expansion voltage level
+	{ 915,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// stall detection
+	{ 916,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// resume after power fail
+	{ 917,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// standstill current
+	{ 918,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// direct-connect display
+	{ 929,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// event logging
+	{ 997,	CodeQueueRule::never,				CodeLock::movementAndStandstill,	&GCodes::UpdateFirmware },
+	{ 998,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// resend line
+	{ 999,	CodeQueueRule::never,				CodeLock::none,						nullptr },		// reset
+};
+
+const size_t GCodes::NumGCodeTableEntries = ARRAY_SIZE(gCodeTable);
+const size_t GCodes::NumMCodeTableEntries = ARRAY_SIZE(mCodeTable);
+
+// Statistics are kept for every table entry, then for T-codes, then for all other codes
+const size_t GCodes::TCodeStatisticsIndex = NumGCodeTableEntries + NumMCodeTableEntries;
+const size_t GCodes::NumCodeStatistics = TCodeStatisticsIndex + 2;
+
+// Find the table entry for the command in the buffer, or return nullptr if it isn't a G- or M-code that we have an entry for
+/*static*/ const CodeTableEntry *GCodes::FindCodeTableEntry(const GCodeBuffer& gb)
+{
+	if (!gb.HasCommandNumber() || gb.GetCommandNumber() < 0)
+	{
+		return nullptr;
+	}
+
+	const CodeTableEntry *table;
+	size_t numEntries;
+	switch (gb.GetCommandLetter())
+	{
+	case 'G':
+		table = gCodeTable;
+		numEntries = NumGCodeTableEntries;
+		break;
+
+	case 'M':
+		table = mCodeTable;
+		numEntries = NumMCodeTableEntries;
+		break;
+
+	default:
+		return nullptr;
+	}
+
+	const unsigned int number = (unsigned int)gb.GetCommandNumber();
+	size_t low = 0, high = numEntries;
+	while (low < high)
+	{
+		const size_t mid = (low + high)/2;
+		if (table[mid].number < number)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return (low < numEntries && table[low].number == number) ? &table[low] : nullptr;
+}
+
+// Take the locks that a table entry says its handler needs, returning true if we have them all
+bool GCodes::LockForCode(const GCodeBuffer& gb, CodeLock lock)
+{
+	switch (lock)
+	{
+	case CodeLock::movement:
+		return LockMovement(gb);
+
+	case CodeLock::movementAndStandstill:
+		return LockMovementAndWaitForStandstill(gb);
+
+	case CodeLock::none:
+	default:
+		return true;
+	}
+}
+
+// Record the time taken by one call to ActOnCode
+void GCodes::RecordCodeStatistics(const GCodeBuffer& gb, const CodeTableEntry *entry, uint32_t startClocks, bool finished)
+{
+	const uint32_t clocks = StepTimer::GetInterruptClocks() - startClocks;
+	const size_t index = (entry == nullptr)
+							? ((gb.GetCommandLetter() == 'T') ? TCodeStatisticsIndex : TCodeStatisticsIndex + 1)
+						: (entry >= gCodeTable && entry < gCodeTable + NumGCodeTableEntries)
+							? entry - gCodeTable
+							: NumGCodeTableEntries + (entry - mCodeTable);
+	CodeStatistics& stats = codeStatistics[index];
+	stats.totalClocks += clocks;
+	if (clocks > stats.maxClocks)
+	{
+		stats.maxClocks = clocks;
+	}
+	if (finished)
+	{
+		++stats.invocations;
+	}
+}
+
+// Handle M122 P106. With an S parameter, enable (and reset) or disable collection of code statistics. Without one, report them.
+GCodeResult GCodes::ConfigureCodeStatistics(GCodeBuffer& gb, const StringRef& reply)
+{
+	if (gb.Seen('S'))
+	{
+		collectCodeStatistics = (gb.GetIValue() > 0);
+		if (collectCodeStatistics)
+		{
+			if (codeStatistics == nullptr)
+			{
+				codeStatistics = new CodeStatistics[NumCodeStatistics];
+			}
+			for (size_t i = 0; i < NumCodeStatistics; ++i)
+			{
+				codeStatistics[i].Clear();
+			}
+		}
+		return GCodeResult::ok;
+	}
+
+	if (codeStatistics == nullptr)
+	{
+		reply.copy("Code statistics are not enabled, use M122 P106 S1 to enable them");
+		return GCodeResult::ok;
+	}
+
+	const MessageType mtype = gb.GetResponseMessageType();
+	platform.MessageF(mtype, "=== Code statistics (%s) ===\n", (collectCodeStatistics) ? "enabled" : "disabled");
+	for (size_t i = 0; i < NumCodeStatistics; ++i)
+	{
+		const CodeStatistics& stats = codeStatistics[i];
+		if (stats.invocations != 0 || stats.totalClocks != 0)
+		{
+			String<StringLength20> codeName;
+			if (i < NumGCodeTableEntries)
+			{
+				codeName.printf("G%u", gCodeTable[i].number);
+			}
+			else if (i < TCodeStatisticsIndex)
+			{
+				codeName.printf("M%u", mCodeTable[i - NumGCodeTableEntries].number);
+			}
+			else
+			{
+				codeName.copy((i == TCodeStatisticsIndex) ? "T" : "other");
+			}
+			const float totalMillis = (float)stats.totalClocks * StepTimer::StepClocksToMillis;
+			platform.MessageF(mtype, "%s: %" PRIu32 " completed, total %.1fms, mean %.3fms, max call %.3fms\n",
+								codeName.c_str(), stats.invocations, (double)totalMillis,
+								(double)((stats.invocations == 0) ? 0.0 : totalMillis/stats.invocations),
+								(double)((float)stats.maxClocks * StepTimer::StepClocksToMillis));
+		}
+	}
+	return GCodeResult::ok;
+}
+
+// End
@@ -0,0 +1,73 @@
+/*
+ * GCodeTable.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Types used by the G- and M-code registration tables. The tables themselves are static members of class GCodes and are defined in GCodeTable.cpp.
+ */
+
+#ifndef SRC_GCODES_GCODETABLE_H_
+#define SRC_GCODES_GCODETABLE_H_
+
+#include "RepRapFirmware.h"
+#include "GCodeResult.h"
+
+// Type of a function that handles a complete G- or M-code. It has the same semantics as the code blocks in the switch statements of HandleGcode and HandleMcode.
+typedef GCodeResult (GCodes::*CodeHandler)(GCodeBuffer& gb, const StringRef& reply);
+
+// Rules for deciding whether a code that arrives while moves are pending should be queued until those moves have completed
+enum class CodeQueueRule : uint8_t
+{
+	never,						// never queue this code
+	always,						// always queue this code
+	message,					// always queue this code, as text because it takes a string parameter (M117)
+	unlessLaser,				// queue this code unless we are in laser mode (M3, M5)
+	nonBlockingMessage,			// queue this code as text if the S parameter is less than 2 (M291)
+	toolTemperatures			// queue this code if it sets tool temperatures without setting offsets (G10 P with R or S but without L)
+};
+
+// Resources that the dispatcher must lock before it calls the handler of a code
+enum class CodeLock : uint8_t
+{
+	none,
+	movement,					// lock movement
+	movementAndStandstill		// lock movement and wait for all pending moves to finish
+};
+
+// Entry in a code table. Tables are sorted by code number so that they can be binary searched.
+struct CodeTableEntry
+{
+	uint16_t number;			// the G or M number
+	CodeQueueRule queueRule;	// whether the code may be queued to synchronise it with moves
+	CodeLock lock;				// which locks to take before calling the handler
+	CodeHandler handler;		// the handler, or nullptr if the code is handled by the switch statement in HandleGcode or HandleMcode
+};
+
+// Return true if GCodes::DoFastMove may execute a command by calling DoStraightMove directly, because ActOnCode and HandleGcode would do nothing
+// else with it. That is the case for a plain G0 or G1 that has no handler in the code table and is never queued. Homing moves (H), moves to
+// a restore point (R), moves with endstop checks (S, except on a laser) and codes with a fractional number are left to the normal path.
+// 'entry' is the code table entry for the command, and 'seen' is called to find out whether the command has a parameter with a given letter.
+template<class SeenFunction> inline bool IsFastMoveCode(char letter, bool hasNumber, int number, int fraction, const CodeTableEntry *entry, bool isLaser, SeenFunction seen)
+{
+	return letter == 'G'
+		&& hasNumber
+		&& (number == 0 || number == 1)
+		&& fraction < 0
+		&& (entry == nullptr || (entry->handler == nullptr && entry->queueRule == CodeQueueRule::never))
+		&& !seen('H')
+		&& !seen('R')
+		&& (isLaser || !seen('S'));
+}
+
+// Execution statistics for one table entry. The times are measured in step clocks and include every call to the code, including calls that returned 'not finished'.
+struct CodeStatistics
+{
+	uint32_t invocations;		// how many times the code has completed
+	uint32_t maxClocks;			// the longest time taken by a single call
+	uint64_t totalClocks;		// the total time taken by all calls
+
+	void Clear() { invocations = 0; maxClocks = 0; totalClocks = 0; }
+};
+
+#endif /* SRC_GCODES_GCODETABLE_H_ */
@@ -95,7 +95,7 @@ GCodes::GCodes(Platform& p) :
 #if HAS_VOLTAGE_MONITOR
 	powerFailScript(nullptr),
 #endif
-	isFlashing(false), fileBeingHashed(nullptr), lastWarningMillis(0), sdTimingFile(nullptr)
+	isFlashing(false), codeStatistics(nullptr), collectCodeStatistics(false), fileBeingHashed(nullptr), lastWarningMillis(0), sdTimingFile(nullptr)
 {
 	fileInput = new FileGCodeInput();
 	fileGCode = new GCodeBuffer("file", GenericMessage, true);
@@ -122,6 +122,12 @@ GCodes::GCodes(Platform& p) :
 	lcdGCode = nullptr;
 #endif
 	queuedGCode = new GCodeBuffer("queue", GenericMessage, false);
+#if SUPPORT_ASYNC_MOVES
+	file2Input = new FileGCodeInput();
+	file2GCode = new GCodeBuffer("file2", GenericMessage, false);
+#else
+	file2GCode = nullptr;
+#endif
 	autoPauseGCode = new GCodeBuffer("autopause", GenericMessage, false);
 	codeQueue = new GCodeQueue();
 }
@@ -251,7 +257,7 @@ void GCodes::Reset()
 	}
 
 	currentZHop = 0.0;									// clear this before calling ToolOffsetInverseTransform
-	lastPrintingMoveHeight = -1.0;
+	lastPrintingMoveHeight = lastJournalHeight = -1.0;
 	moveBuffer.tool = nullptr;
 	moveBuffer.virtualExtruderPosition = 0.0;
 
@@ -292,6 +298,12 @@ void GCodes::Reset()
 	codeQueue->Clear();
 	cancelWait = isWaiting = displayNoToolWarning = false;
 
+#if SUPPORT_ASYNC_MOVES
+	auxMoveAvailable = false;
+	auxAxes = 0;
+	channelSync.Reset();
+#endif
+
 	for (const GCodeBuffer*& gbp : resourceOwners)
 	{
 		gbp = nullptr;
@@ -395,6 +407,7 @@ void GCodes::Spin()
 	CheckTriggers();
 	CheckHeaterFault();
 	CheckFilament();
+	printJournal.MoveCompleted(reprap.GetMove().GetCompletedFilePosition());
 
 	// Get the GCodeBuffer that we want to process a command from. Give priority to auto-pause.
 	GCodeBuffer *gbp = autoPauseGCode;
@@ -444,6 +457,13 @@ void GCodes::Spin()
 		RunStateMachine(gb, reply.GetRef());			// Execute the state machine
 	}
 
+	// Give the file being printed an extra turn if it is just a stream of moves
+	if (gbp != fileGCode)
+	{
+		reply.Clear();
+		DoFastMove(reply.GetRef());
+	}
+
 	// Check if we need to display a warning
 	const uint32_t now = millis();
 	if (now - lastWarningMillis >= MinimumWarningInterval)
@@ -1603,6 +1623,13 @@ void GCodes::StartNextGCode(GCodeBuffer& gb, const StringRef& reply)
 		// There is a potential issue here if fileGCode holds any locks, so unlock everything.
 		UnlockAll(gb);
 	}
+#if SUPPORT_ASYNC_MOVES
+	else if (isPaused && &gb == file2GCode)
+	{
+		// The secondary motion channel holds at its next command while the print is pausing or paused, and carries on when it is resumed
+		UnlockAll(gb);
+	}
+#endif
 	else if (gb.IsReady() || gb.IsExecuting())
 	{
 		gb.SetFinished(ActOnCode(gb, reply));
@@ -1650,16 +1677,70 @@ void GCodes::StartNextGCode(GCodeBuffer& gb, const StringRef& reply)
 #endif
 }
 
+// Fast path for plain G0 and G1 moves from the file being printed. This is called on every spin, so that when the file is a stream of moves
+// we give Move a new one each time round the main loop instead of waiting for the file to get its turn in the round robin.
+// It only runs when the file is in a simple state, and anything it doesn't handle is left in the GCodeBuffer for StartNextGCode to execute.
+// While code statistics are being collected we don't use it, so that all moves are counted.
+void GCodes::DoFastMove(const StringRef& reply)
+{
+	GCodeBuffer& gb = *fileGCode;
+	if (   segmentsLeft != 0
+		|| collectCodeStatistics
+		|| gb.GetState() != GCodeState::normal
+		|| gb.MachineState().previous != nullptr					// running a macro
+		|| !gb.MachineState().fileState.IsLive()
+		|| gb.IsWritingFile()
+		|| triggersPending != 0
+		|| !autoPauseGCode->IsCompletelyIdle()
+		|| (resourceOwners[MoveResource] != nullptr && resourceOwners[MoveResource] != &gb)
+		|| IsPaused() || IsPausing()
+	   )
+	{
+		return;
+	}
+
+	if (gb.IsIdle())
+	{
+		if (   fileInput->ReadFromFile(gb.MachineState().fileState) != GCodeInputReadResult::haveData
+			|| !fileInput->FillBuffer(&gb)
+		   )
+		{
+			return;													// leave end of file and read errors to DoFilePrint
+		}
+	}
+
+	// A move that is executing is one that StartNextGCode tried to start before Move took the previous one, so it is safe to start it again here
+	if ((gb.IsReady() || gb.IsExecuting()) && IsFastMove(gb) && LockMovement(gb))
+	{
+		const char* err = DoStraightMove(gb, gb.GetCommandNumber() == 1);
+		if (err != nullptr)
+		{
+			AbortPrint(gb);
+			gb.SetState(GCodeState::waitingForSpecialMoveToComplete, err);	// force the user position to be restored
+		}
+		gb.SetFinished(HandleResult(gb, GCodeResult::ok, reply, nullptr));
+	}
+}
+
+// Return true if the command in the buffer is a G0 or G1 move that the normal path would pass straight to DoStraightMove
+bool GCodes::IsFastMove(GCodeBuffer& gb) const
+{
+	return gb.GetCommandLetter() == 'G'												// check this first so that we don't search the code table for other commands
+		&& IsFastMoveCode(gb.GetCommandLetter(), gb.HasCommandNumber(), gb.GetCommandNumber(), gb.GetCommandFraction(), FindCodeTableEntry(gb),
+							machineType == MachineType::laser, [&gb](char c) -> bool { return gb.Seen(c); });
+}
+
 void GCodes::DoFilePrint(GCodeBuffer& gb, const StringRef& reply)
 {
 	FileData& fd = gb.MachineState().fileState;
+	FileGCodeInput * const input = GetFileInput(gb);
 
 	// Do we have more data to process?
-	switch (fileInput->ReadFromFile(fd))
+	switch (input->ReadFromFile(fd))
 	{
 	case GCodeInputReadResult::haveData:
 		// Yes - fill up the GCodeBuffer and run the next code
-		if (fileInput->FillBuffer(&gb))
+		if (input->FillBuffer(&gb))
 		{
 			// We read some data, but we don't necessarily have a command available because we may be executing M28 within a file
 			if (gb.IsReady())
@@ -1684,6 +1765,21 @@ void GCodes::DoFilePrint(GCodeBuffer& gb, const StringRef& reply)
 
 		gb.Init();								// mark buffer as empty
 
+#if SUPPORT_ASYNC_MOVES
+		if (&gb == file2GCode && gb.MachineState().previous == nullptr)
+		{
+			// Finished the file on the secondary motion channel. We keep its axes until the main channel next waits for standstill, because
+			// only then can we hand them back.
+			if (AuxMovesAreFinished())
+			{
+				input->Reset(fd);
+				fd.Close();
+				UnlockAll(gb);
+				platform.Message(LogMessage, "Finished running file on the secondary motion channel\n");
+			}
+		}
+		else
+#endif
 		if (gb.MachineState().previous == nullptr)
 		{
 			// Finished printing SD card file.
@@ -1700,7 +1796,7 @@ void GCodes::DoFilePrint(GCodeBuffer& gb, const StringRef& reply)
 		else
 		{
 			// Finished a macro or finished processing config.g
-			fileInput->Reset(fd);
+			input->Reset(fd);
 			fd.Close();
 			if (runningConfigFile && gb.MachineState().previous->previous == nullptr)
 			{
@@ -2361,6 +2457,7 @@ void GCodes::SaveResumeInfo(bool wasPowerFailure)
 			}
 			if (ok)
 			{
+				printJournal.AddResumeFileMarker();
 				platform.Message(LoggedGenericMessage, "Resume state saved\n");
 			}
 			else
@@ -2372,6 +2469,86 @@ void GCodes::SaveResumeInfo(bool wasPowerFailure)
 	}
 }
 
+// Record the state of the print at the start of a layer in the print job journal. Called when the first printing move of the layer has been read,
+// so the move buffer holds the virtual extruder position before the move and initialX/Y are where it starts. The journal holds the record back
+// until Spin finds that the move has been executed.
+void GCodes::AddJournalRecord(const GCodeBuffer& gb, float initialX, float initialY)
+{
+	PrintJournal::Record r;
+	r.filePos = gb.GetFilePosition(fileInput->BytesCached());
+	r.coords[0] = initialX;
+	r.coords[1] = initialY;
+	r.coords[2] = currentUserPosition[Z_AXIS];
+	r.virtualExtruderPosition = moveBuffer.virtualExtruderPosition;
+	r.feedRate = gb.MachineState().feedRate;
+	r.fanSpeed = lastDefaultFanSpeed;
+
+	const Tool * const ct = reprap.GetCurrentTool();
+	r.toolNumber = (ct == nullptr) ? -1 : (int16_t)ct->Number();
+	r.toolTemperature = (ct == nullptr || ct->HeaterCount() == 0) ? 0.0 : ct->GetToolHeaterActiveTemperature(0);
+
+	const int8_t bedHeater = reprap.GetHeat().GetBedHeater(0);
+	r.bedTemperature = (bedHeater >= 0) ? reprap.GetHeat().GetActiveTemperature(bedHeater) : 0.0;
+
+	r.flags = ((gb.MachineState().drivesRelative) ? PrintJournal::DrivesRelativeFlag : 0)
+			| ((gb.MachineState().usingInches) ? PrintJournal::UsingInchesFlag : 0);
+	reprap.GetMove().ClearCompletedFilePosition();
+	printJournal.SetPendingRecord(r);
+}
+
+// Create the resume file from the last record in the print job journal. This is used when the power failed without us saving the resume file.
+// We don't know where the head stopped, so the resume prologue must home the axes that it can. The head is assumed to be at the height of the last layer recorded.
+bool GCodes::SaveResumeInfoFromJournal(const char *printingFilename, const PrintJournal::Record& r, const StringRef& reply)
+{
+	FileStore * const f = platform.OpenSysFile(RESUME_AFTER_POWER_FAIL_G, OpenMode::write);
+	if (f == nullptr)
+	{
+		reply.printf("Failed to create file %s", RESUME_AFTER_POWER_FAIL_G);
+		return false;
+	}
+
+	String<FormatStringLength> buf;
+	buf.printf("; File \"%s\" resume print from print job journal record %" PRIu32 "\nG21\n", printingFilename, r.sequence);
+	if (r.bedTemperature > 0.0)
+	{
+		buf.catf("M140 S%.1f\n", (double)r.bedTemperature);
+	}
+	buf.catf("T-1 P0\nG92 X%.3f Y%.3f Z%.3f\nG60 S1\n", (double)r.coords[0], (double)r.coords[1], (double)r.coords[2]);
+	bool ok = f->Write(buf.c_str());
+	if (ok)
+	{
+		buf.printf("M98 P\"%s\"\n", RESUME_PROLOGUE_G);
+		if (r.toolNumber >= 0)
+		{
+			buf.catf("G10 P%d S%.1f\nT%d P6\n", r.toolNumber, (double)r.toolTemperature, r.toolNumber);
+		}
+		buf.catf("M106 S%.2f\nM116\nG92 E%.5f\n%s\n", (double)r.fanSpeed, (double)r.virtualExtruderPosition, (r.flags & PrintJournal::DrivesRelativeFlag) ? "M83" : "M82");
+		ok = f->Write(buf.c_str());
+	}
+	if (ok)
+	{
+		buf.printf("M23 \"%s\"\nM26 S%" PRIu32 "\n", printingFilename, r.filePos);
+		ok = f->Write(buf.c_str());
+	}
+	if (ok)
+	{
+		buf.printf("G0 F6000 Z%.3f\nG0 F6000 X%.3f Y%.3f\nG0 F6000 Z%.3f\nG1 F%.1f\n%s\nM24\n",
+					(double)(r.coords[2] + 2.0), (double)r.coords[0], (double)r.coords[1], (double)r.coords[2],
+					(double)(r.feedRate * MinutesToSeconds), (r.flags & PrintJournal::UsingInchesFlag) ? "G20" : "G21");
+		ok = f->Write(buf.c_str());
+	}
+	if (!f->Close())
+	{
+		ok = false;
+	}
+	if (!ok)
+	{
+		platform.DeleteSysFile(RESUME_AFTER_POWER_FAIL_G);
+		reply.printf("Failed to write or close file %s", RESUME_AFTER_POWER_FAIL_G);
+	}
+	return ok;
+}
+
 void GCodes::Diagnostics(MessageType mtype)
 {
 	platform.Message(mtype, "=== GCodes ===\n");
@@ -2413,6 +2590,15 @@ bool GCodes::LockMovementAndWaitForStandstill(const GCodeBuffer& gb)
 		return false;
 	}
 
+#if SUPPORT_ASYNC_MOVES
+	// If the secondary motion channel has finished, now is the time to take back the axes that it owned
+	if (auxAxes != 0 && !IsAuxChannelRunning() && AuxMovesAreFinished())
+	{
+		reprap.GetMove().CopyAxesFromAuxRing(auxAxes);
+		auxAxes = 0;
+	}
+#endif
+
 	// Get the current positions. These may not be the same as the ones we remembered from last time if we just did a special move.
 	UpdateCurrentUserPosition();
 	return true;
@@ -2707,6 +2893,13 @@ const char* GCodes::DoStraightMove(GCodeBuffer& gb, bool isCoordinated)
 	{
 		if (gb.Seen(axisLetters[axis]))
 		{
+#if SUPPORT_ASYNC_MOVES
+			if (IsBitSet(auxAxes, axis))
+			{
+				return "G0/G1: attempt to move an axis that belongs to the secondary motion channel";
+			}
+#endif
+
 			// If it is a special move on a delta, movement must be relative.
 			if (moveBuffer.moveType != 0 && !gb.MachineState().axesRelative && reprap.GetMove().GetKinematics().GetKinematicsType() == KinematicsType::linearDelta)
 			{
@@ -2793,6 +2986,11 @@ const char* GCodes::DoStraightMove(GCodeBuffer& gb, bool isCoordinated)
 		if (&gb == fileGCode && !gb.IsDoingFileMacro() && moveBuffer.hasExtrusion && (axesMentioned & ((1 << X_AXIS) | (1 << Y_AXIS))) != 0)
 		{
 			lastPrintingMoveHeight = currentUserPosition[Z_AXIS];
+			if (printJournal.IsActive() && lastPrintingMoveHeight > lastJournalHeight + LAYER_HEIGHT_TOLERANCE)
+			{
+				AddJournalRecord(gb, initialX, initialY);					// this is the first printing move of a new layer
+				lastJournalHeight = lastPrintingMoveHeight;
+			}
 		}
 
 		ToolOffsetTransform(currentUserPosition, moveBuffer.coords, axesMentioned);
@@ -3304,11 +3502,17 @@ void GCodes::ClearMove()
 // Cancel any macro or print in progress
 void GCodes::AbortPrint(GCodeBuffer& gb)
 {
-	(void)gb.AbortFile(fileInput);				// stop executing any files or macros that this GCodeBuffer is running
+	(void)gb.AbortFile(GetFileInput(gb));		// stop executing any files or macros that this GCodeBuffer is running
 	if (&gb == fileGCode)						// if the current command came from a file being printed
 	{
 		StopPrint(StopPrintReason::abort);
 	}
+#if SUPPORT_ASYNC_MOVES
+	else if (&gb == file2GCode)
+	{
+		StopAuxChannel();
+	}
+#endif
 }
 
 // Cancel everything
@@ -3349,7 +3553,7 @@ bool GCodes::DoFileMacro(GCodeBuffer& gb, const char* fileName, bool reportMissi
 		return true;
 	}
 	gb.MachineState().fileState.Set(f);
-	fileInput->Reset(gb.MachineState().fileState);
+	GetFileInput(gb)->Reset(gb.MachineState().fileState);
 	gb.MachineState().doingFileMacro = true;
 	gb.MachineState().runningM501 = (codeRunning == 501);
 	gb.MachineState().runningM502 = (codeRunning == 502);
@@ -3367,7 +3571,7 @@ void GCodes::FileMacroCyclesReturn(GCodeBuffer& gb)
 	if (gb.IsDoingFileMacro())
 	{
 		FileData &file = gb.MachineState().fileState;
-		fileInput->Reset(file);
+		GetFileInput(gb)->Reset(file);
 		file.Close();
 
 		gb.PopState();
@@ -3377,13 +3581,9 @@ void GCodes::FileMacroCyclesReturn(GCodeBuffer& gb)
 
 // Home one or more of the axes
 // 'reply' is only written if there is an error.
+// The caller must already have locked movement and waited for standstill.
 GCodeResult GCodes::DoHome(GCodeBuffer& gb, const StringRef& reply)
 {
-	if (!LockMovementAndWaitForStandstill(gb))
-	{
-		return GCodeResult::notFinished;
-	}
-
 #if SUPPORT_ROLAND
 	// Deal with a Roland configuration
 	if (reprap.GetRoland()->Active())
@@ -3689,7 +3889,8 @@ bool GCodes::QueueFileToPrint(const char* fileName, const StringRef& reply)
 	FileStore * const f = platform.OpenFile(platform.GetGCodeDir(), fileName, OpenMode::read);
 	if (f != nullptr)
 	{
-
+		(void)f->EnableFastSeek();								// so that resuming a print with M26 doesn't have to follow the cluster chain
+		(void)f->EnableReadAhead();								// so that we read the file several sectors at a time
 		fileToPrint.Set(f);
 		fileOffsetToPrint = 0;
 		restartMoveFractionDone = 0.0;
@@ -3723,8 +3924,16 @@ void GCodes::StartPrinting(bool fromStart)
 	fileInput->Reset(fileGCode->OriginalMachineState().fileState);
 
 	lastFilamentError = FilamentSensorStatus::ok;
-	lastPrintingMoveHeight = -1.0;
+	lastPrintingMoveHeight = lastJournalHeight = -1.0;
 	reprap.GetPrintMonitor().StartedPrint();
+	if (simulationMode == 0)
+	{
+		if (fromStart)
+		{
+			platform.DeleteSysFile(RESUME_AFTER_POWER_FAIL_G);		// it belongs to an earlier print. If we are resuming then it is the file we are running.
+		}
+		(void)printJournal.Start(reprap.GetPrintMonitor().GetPrintingFilename());
+	}
 	platform.MessageF(LogMessage,
 						(simulationMode == 0) ? "Started printing file %s\n" : "Started simulating printing file %s\n",
 							reprap.GetPrintMonitor().GetPrintingFilename());
@@ -4107,7 +4316,7 @@ void GCodes::HandleReply(GCodeBuffer& gb, GCodeResult rslt, const char* reply)
 {
 	// Don't report empty responses if a file or macro is being processed, or if the GCode was queued
 	// Also check that this response was triggered by a gcode
-	if (reply[0] == 0 && (gb.MachineState().doingFileMacro || &gb == fileGCode || &gb == queuedGCode || &gb == daemonGCode || &gb == autoPauseGCode))
+	if (reply[0] == 0 && (gb.MachineState().doingFileMacro || &gb == fileGCode || &gb == file2GCode || &gb == queuedGCode || &gb == daemonGCode || &gb == autoPauseGCode))
 	{
 		return;
 	}
@@ -4710,6 +4919,14 @@ void GCodes::StopPrint(StopPrintReason reason)
 
 	UnlockAll(*fileGCode);
 
+#if SUPPORT_ASYNC_MOVES
+	channelSync.Abandon(0);
+	if (reason != StopPrintReason::normalCompletion)
+	{
+		StopAuxChannel();						// a cancelled print stops the secondary motion channel too, but a finished one lets it finish its file
+	}
+#endif
+
 	// Deal with the Z hop from a G10 that has not been undone by G11
 	if (isRetracted)
 	{
@@ -4787,6 +5004,8 @@ void GCodes::StopPrint(StopPrintReason reason)
 		}
 	}
 
+	printJournal.Finish(reason == StopPrintReason::normalCompletion);
+
 	updateFileWhenSimulationComplete = false;
 	reprap.GetPrintMonitor().StoppedPrint();		// must do this after printing the simulation details because it clears the filename
 }
@@ -25,12 +25,15 @@ Licence: GPL
 #include "RepRapFirmware.h"
 #include "RepRap.h"			// for type ResponseSource
 #include "GCodeResult.h"
+#include "GCodeTable.h"
 #include "Libraries/sha1/sha1.h"
 #include "Platform.h"		// for type EndStopHit
 #include "GCodeInput.h"
 #include "Tools/Filament.h"
 #include "FilamentMonitors/FilamentMonitor.h"
 #include "RestorePoint.h"
+#include "Storage/PrintJournal.h"
+#include "MotionChannelSync.h"
 #include "Movement/BedProbing/Grid.h"
 
 const char feedrateLetter = 'F';						// GCode feedrate
@@ -146,6 +149,9 @@ public:
 	void Exit();														// Shut it down
 	void Reset();														// Reset some parameter to defaults
 	bool ReadMove(RawMove& m);											// Called by the Move class to get a movement set by the last G Code
+#if SUPPORT_ASYNC_MOVES
+	bool ReadAuxMove(RawMove& m);										// Called by the Move class to get a movement from the secondary motion channel
+#endif
 	void ClearMove();
 	bool QueueFileToPrint(const char* fileName, const StringRef& reply);	// Open a file of G Codes to run
 	void StartPrinting(bool fromStart);									// Start printing the file already selected
@@ -274,17 +280,27 @@ private:
 	void StartNextGCode(GCodeBuffer& gb, const StringRef& reply);		// Fetch a new or old GCode and process it
 	void RunStateMachine(GCodeBuffer& gb, const StringRef& reply);		// Execute a step of the state machine
 	void DoFilePrint(GCodeBuffer& gb, const StringRef& reply);			// Get G Codes from a file and print them
+	void DoFastMove(const StringRef& reply) __attribute__((hot));		// Execute a plain G0 or G1 move from the file being printed if nothing else is going on
+	bool IsFastMove(GCodeBuffer& gb) const;								// Return true if the command in the buffer is a move that DoFastMove can execute
 	bool DoFileMacro(GCodeBuffer& gb, const char* fileName, bool reportMissing, int codeRunning = 0);
 																		// Run a GCode macro file, optionally report error if not found
 	void FileMacroCyclesReturn(GCodeBuffer& gb);						// End a macro
 
 	bool ActOnCode(GCodeBuffer& gb, const StringRef& reply);			// Do a G, M or T Code
-	bool HandleGcode(GCodeBuffer& gb, const StringRef& reply);			// Do a G code
-	bool HandleMcode(GCodeBuffer& gb, const StringRef& reply);			// Do an M code
+	bool HandleGcode(GCodeBuffer& gb, const StringRef& reply, const CodeTableEntry *entry);	// Do a G code
+	bool HandleMcode(GCodeBuffer& gb, const StringRef& reply, const CodeTableEntry *entry);	// Do an M code
 	bool HandleTcode(GCodeBuffer& gb, const StringRef& reply);			// Do a T code
+	bool HandleTableCode(GCodeBuffer& gb, const StringRef& reply, const CodeTableEntry& entry)	// Do a code that has a handler in the code table
+		pre(entry.handler != nullptr);
+	bool HandleBadCommand(GCodeBuffer& gb, const StringRef& reply);		// Report an unrecognised command
 	bool HandleResult(GCodeBuffer& gb, GCodeResult rslt, const StringRef& reply, OutputBuffer *outBuf)
 		pre(outBuf == nullptr || rslt == GCodeResult::ok);
 
+	static const CodeTableEntry *FindCodeTableEntry(const GCodeBuffer& gb);	// Find the code table entry for the command in the buffer
+	bool LockForCode(const GCodeBuffer& gb, CodeLock lock);				// Take the locks needed by a code handler
+	void RecordCodeStatistics(const GCodeBuffer& gb, const CodeTableEntry *entry, uint32_t startClocks, bool finished);
+	GCodeResult ConfigureCodeStatistics(GCodeBuffer& gb, const StringRef& reply);	// Handle M122 P106
+
 	void HandleReply(GCodeBuffer& gb, OutputBuffer *reply);
 
 	const char* DoStraightMove(GCodeBuffer& gb, bool isCoordinated) __attribute__((hot));	// Execute a straight move returning any error message
@@ -393,10 +409,23 @@ private:
 
 	void AppendAxes(const StringRef& reply, AxesBitmap axes) const;			// Append a list of axes to a string
 
+#if SUPPORT_ASYNC_MOVES
+	GCodeResult StartAuxChannel(GCodeBuffer& gb, const StringRef& reply);		// Handle M596
+	GCodeResult SyncMotionChannels(GCodeBuffer& gb, const StringRef& reply);	// Handle M598
+	void StopAuxChannel();														// Stop the file running on the secondary motion channel
+	bool HandleAuxChannelCode(GCodeBuffer& gb, const StringRef& reply);			// Execute a G- or T-code from the secondary motion channel
+	GCodeResult DoAuxMove(GCodeBuffer& gb, bool isCoordinated, const StringRef& reply);	// Set up a move from the secondary motion channel
+	bool IsAuxChannelRunning() const;											// Return true if the secondary motion channel is running a file
+	bool AuxMovesAreFinished() const;											// Return true if all moves of the secondary motion channel have been completed
+#endif
+	FileGCodeInput *GetFileInput(const GCodeBuffer& gb) const;					// Return the input that a GCodeBuffer reads its files through
+
 	void EndSimulation(GCodeBuffer *gb);								// Restore positions etc. when exiting simulation mode
 	bool IsCodeQueueIdle() const;										// Return true if the code queue is idle
 
 	void SaveResumeInfo(bool wasPowerFailure);
+	void AddJournalRecord(const GCodeBuffer& gb, float initialX, float initialY);	// Record the state of the print at the start of a layer
+	bool SaveResumeInfoFromJournal(const char *printingFilename, const PrintJournal::Record& r, const StringRef& reply);	// Create the resume file from a print job journal record
 
 	const char* GetMachineModeString() const;							// Get the name of the current machine mode
 
@@ -429,6 +458,9 @@ private:
 	Platform& platform;													// The RepRap machine
 
 	FileGCodeInput* fileInput;											// ...
+#if SUPPORT_ASYNC_MOVES
+	FileGCodeInput* file2Input;											// File input for the secondary motion channel
+#endif
 	StreamGCodeInput* serialInput;										// ...
 
 #if HAS_NETWORKING
@@ -439,7 +471,7 @@ private:
 	StreamGCodeInput* auxInput;											// ...for the GCodeBuffers below
 #endif
 
-	GCodeBuffer* gcodeSources[9];										// The various sources of gcodes
+	GCodeBuffer* gcodeSources[10];										// The various sources of gcodes
 
 	GCodeBuffer*& httpGCode = gcodeSources[0];
 	GCodeBuffer*& telnetGCode = gcodeSources[1];
@@ -449,7 +481,8 @@ private:
 	GCodeBuffer*& daemonGCode = gcodeSources[5];						// Used for executing config.g and trigger macro files
 	GCodeBuffer*& queuedGCode = gcodeSources[6];
 	GCodeBuffer*& lcdGCode = gcodeSources[7];							// This one for the 12864 LCD
-	GCodeBuffer*& autoPauseGCode = gcodeSources[8];						// ***THIS ONE MUST BE LAST*** GCode state machine used to run macros on power fail, heater faults and filament out
+	GCodeBuffer*& file2GCode = gcodeSources[8];							// This one runs a file on the secondary motion channel
+	GCodeBuffer*& autoPauseGCode = gcodeSources[9];						// ***THIS ONE MUST BE LAST*** GCode state machine used to run macros on power fail, heater faults and filament out
 
 	size_t nextGcodeSource;												// The one to check next
 
@@ -474,6 +507,9 @@ private:
 	float currentUserPosition[MaxAxes];			// The current position of the axes as commanded by the input gcode, after accounting for workplace offset, before accounting for tool offset and Z hop
 	float currentZHop;							// The amount of Z hop that is currently applied
 	float lastPrintingMoveHeight;				// the Z coordinate in the last printing move, or a negative value if we don't know it
+	float lastJournalHeight;					// the Z coordinate of the layer that we last recorded in the print job journal
+
+	PrintJournal printJournal;
 
 	// The following contain the details of moves that the Move module fetches
 	// CAUTION: segmentsLeft should ONLY be changed from 0 to not 0 by calling NewMoveAvailable()!
@@ -481,6 +517,16 @@ private:
 	unsigned int segmentsLeft;					// The number of segments left to do in the current move, or 0 if no move available
 	unsigned int totalSegments;					// The total number of segments left in the complete move
 
+#if SUPPORT_ASYNC_MOVES
+	// The secondary motion channel runs a file in parallel with the main one, moving only the axes that it owns.
+	// Its moves go to a separate DDA ring. Its coordinates are machine coordinates and its moves are never segmented.
+	RawMove auxMoveBuffer;						// Move details of the secondary motion channel to pass to Move class
+	bool auxMoveAvailable;						// True if auxMoveBuffer holds a move that Move hasn't taken yet
+	AxesBitmap auxAxes;							// The axes that the secondary motion channel owns
+	float auxMachinePosition[MaxAxes];			// The position of the axes at the end of the last move of the secondary motion channel
+	MotionChannelSync channelSync;				// The M598 sync points that the main and secondary channels have reached
+#endif
+
 	unsigned int segmentsLeftToStartAt;
 	float moveFractionToSkip;
 	float firstSegmentFractionToSkip;
@@ -589,6 +635,16 @@ private:
 	// Code queue
 	GCodeQueue *codeQueue;						// Stores certain codes for deferred execution
 
+	// Code tables, in GCodeTable.cpp
+	static const CodeTableEntry gCodeTable[];
+	static const CodeTableEntry mCodeTable[];
+	static const size_t NumGCodeTableEntries;
+	static const size_t NumMCodeTableEntries;
+	static const size_t TCodeStatisticsIndex;
+	static const size_t NumCodeStatistics;
+	CodeStatistics *codeStatistics;				// Per-code execution statistics, allocated when they are first enabled
+	bool collectCodeStatistics;					// True if we are collecting code statistics
+
 	// SHA1 hashing
 	FileStore *fileBeingHashed;
 	SHA1Context hash;
@@ -670,6 +726,16 @@ inline void GCodes::NewMoveAvailable()
 	segmentsLeft = sl;			// set the number of segments to indicate that a move is available to be taken
 }
 
+// Return the input that a GCodeBuffer reads its files through
+inline FileGCodeInput *GCodes::GetFileInput(const GCodeBuffer& gb) const
+{
+#if SUPPORT_ASYNC_MOVES
+	return (&gb == file2GCode) ? file2Input : fileInput;
+#else
+	return fileInput;
+#endif
+}
+
 // Get the total baby stepping offset for an axis
 inline float GCodes::GetTotalBabyStepOffset(size_t axis) const
 {
@@ -45,8 +45,10 @@
 // It is called repeatedly for a given code until it returns true for that code.
 bool GCodes::ActOnCode(GCodeBuffer& gb, const StringRef& reply)
 {
+	const CodeTableEntry * const entry = FindCodeTableEntry(gb);
+
 	// Can we queue this code?
-	if (gb.CanQueueCodes() && codeQueue->ShouldQueueCode(gb))
+	if (gb.CanQueueCodes() && codeQueue->ShouldQueueCode(gb, entry))
 	{
 		// Don't queue any GCodes if there are segments not yet picked up by Move, because in the event that a segment corresponds to no movement,
 		// the move gets discarded, which throws out the count of scheduled moves and hence the synchronisation
@@ -55,7 +57,7 @@ bool GCodes::ActOnCode(GCodeBuffer& gb, const StringRef& reply)
 			return false;
 		}
 
-		if (codeQueue->QueueCode(gb))
+		if (codeQueue->QueueCode(gb, entry))
 		{
 			HandleReply(gb, GCodeResult::ok, "");
 			return true;
@@ -64,35 +66,62 @@ bool GCodes::ActOnCode(GCodeBuffer& gb, const StringRef& reply)
 		return false;		// we should queue this code but we can't, so wait until we can either execute it or queue it
 	}
 
+	const bool collectingStatistics = collectCodeStatistics;
+	const uint32_t startClocks = (collectingStatistics) ? StepTimer::GetInterruptClocks() : 0;
+	bool finished;
+#if SUPPORT_ASYNC_MOVES
+	if (&gb == file2GCode && gb.GetCommandLetter() != 'M')
+	{
+		finished = HandleAuxChannelCode(gb, reply);			// the secondary motion channel interprets its own G-codes
+	}
+	else
+#endif
 	switch (gb.GetCommandLetter())
 	{
 	case 'G':
-		if (gb.HasCommandNumber())
-		{
-			return HandleGcode(gb, reply);
-		}
+		finished = (gb.HasCommandNumber()) ? HandleGcode(gb, reply, entry) : HandleBadCommand(gb, reply);
 		break;
 
 	case 'M':
-		if (gb.HasCommandNumber())
-		{
-			return HandleMcode(gb, reply);
-		}
+		finished = (gb.HasCommandNumber()) ? HandleMcode(gb, reply, entry) : HandleBadCommand(gb, reply);
 		break;
 
 	case 'T':
-		return HandleTcode(gb, reply);
+		finished = HandleTcode(gb, reply);
+		break;
 
 	default:
+		finished = HandleBadCommand(gb, reply);
 		break;
 	}
 
-	reply.printf("Bad command: %s", gb.Buffer());
+	if (collectingStatistics)
+	{
+		RecordCodeStatistics(gb, entry, startClocks, finished);
+	}
+	return finished;
+}
+
+// Report a command that we don't recognise
+bool GCodes::HandleBadCommand(GCodeBuffer& gb, const StringRef& reply)
+{
+	reply.copy("Bad command: ");
+	gb.AppendFullCommand(reply);
 	HandleReply(gb, GCodeResult::error, reply.c_str());
 	return true;
 }
 
-bool GCodes::HandleGcode(GCodeBuffer& gb, const StringRef& reply)
+// Call the handler of a code that has one in the code table
+bool GCodes::HandleTableCode(GCodeBuffer& gb, const StringRef& reply, const CodeTableEntry& entry)
+{
+	if (!LockForCode(gb, entry.lock))
+	{
+		return false;
+	}
+	return HandleResult(gb, (this->*entry.handler)(gb, reply), reply, nullptr);
+}
+
+bool GCodes::HandleGcode(GCodeBuffer& gb, const StringRef& reply, const CodeTableEntry *entry)
 {
 	GCodeResult result = GCodeResult::ok;
 	const int code = gb.GetCommandNumber();
@@ -101,6 +130,11 @@ bool GCodes::HandleGcode(GCodeBuffer& gb, const StringRef& reply)
 		return true;					// we only simulate some gcodes
 	}
 
+	if (entry != nullptr && entry->handler != nullptr)
+	{
+		return HandleTableCode(gb, reply, *entry);
+	}
+
 	switch (code)
 	{
 	case 0: // Rapid move
@@ -218,10 +252,6 @@ bool GCodes::HandleGcode(GCodeBuffer& gb, const StringRef& reply)
 		gb.MachineState().usingInches = false;
 		break;
 
-	case 28: // Home
-		result = DoHome(gb, reply);
-		break;
-
 	case 29: // Grid-based bed probing
 		if (!LockMovementAndWaitForStandstill(gb))		// do this first to make sure that a new grid isn't being defined
 		{
@@ -271,10 +301,6 @@ bool GCodes::HandleGcode(GCodeBuffer& gb, const StringRef& reply)
 		}
 		break;
 
-	case 31: // Return the probe value, or set probe variables
-		result = SetPrintZProbe(gb, reply);
-		break;
-
 	case 32: // Probe Z at multiple positions and generate the bed transform
 		if (!LockMovementAndWaitForStandstill(gb))
 		{
@@ -324,10 +350,6 @@ bool GCodes::HandleGcode(GCodeBuffer& gb, const StringRef& reply)
 		break;
 #endif
 
-	case 60: // Save position
-		result = SavePosition(gb, reply);
-		break;
-
 	case 90: // Absolute coordinates
 		gb.MachineState().axesRelative = false;
 		break;
@@ -357,7 +379,7 @@ bool GCodes::HandleGcode(GCodeBuffer& gb, const StringRef& reply)
 	return HandleResult(gb, result, reply, nullptr);
 }
 
-bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
+bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply, const CodeTableEntry *entry)
 {
 	GCodeResult result = GCodeResult::ok;
 	OutputBuffer *outBuf = nullptr;
@@ -371,6 +393,11 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 		return true;			// we don't simulate most M codes
 	}
 
+	if (entry != nullptr && entry->handler != nullptr)
+	{
+		return HandleTableCode(gb, reply, *entry);
+	}
+
 	switch (code)
 	{
 	case 0: // Stop
@@ -1651,6 +1678,10 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 			{
 				reprap.Diagnostics(gb.GetResponseMessageType());
 			}
+			else if (val == (int)DiagnosticTestType::PrintCodeStatistics)
+			{
+				result = ConfigureCodeStatistics(gb, reply);
+			}
 			else
 			{
 				result = platform.DiagnosticTest(gb, reply, val);
@@ -1761,10 +1792,6 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 		}
 		break;
 
-	case 143: // Configure heater protection
-		result = SetHeaterProtection(gb, reply);
-		break;
-
 	case 144: // Set bed to standby, or to active if S1 parameter given
 		{
 			const unsigned int index = gb.Seen('P') ? gb.GetUIValue() : 0;
@@ -1985,10 +2012,6 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 
 	// For case 205 see case 566
 
-	case 206: // Offset axes
-		result = OffsetAxes(gb, reply);
-		break;
-
 	case 207: // Set firmware retraction details
 		{
 			bool seen = false;
@@ -2471,14 +2494,6 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 		SetPidParameters(gb, 0, reply);
 		break;
 
-	case 305: // Set/report specific heater parameters
-		result = SetHeaterParameters(gb, reply);
-		break;
-
-	case 307: // Set heater process model parameters
-		result = SetHeaterModel(gb, reply);
-		break;
-
 	case 350: // Set/report microstepping
 		{
 			bool interp = (gb.Seen('I') && gb.GetIValue() > 0);
@@ -3135,14 +3150,6 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 		}
 		break;
 
-	case 557: // Set/report Z probe point coordinates
-		result = DefineGrid(gb, reply);
-		break;
-
-	case 558: // Set or report Z probe type and for which axes it is used
-		result = SetOrReportZProbe(gb, reply);
-		break;
-
 	case 559:
 	case 560: // Binary writing
 		{
@@ -3217,10 +3224,6 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 		heaterFaultState = HeaterFaultState::noFault;
 		break;
 
-	case 563: // Define tool
-		result = ManageTool(gb, reply);
-		break;
-
 	case 564: // Think outside the box?
 		{
 			bool seen = false;
@@ -3335,10 +3338,6 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 		reply.copy("The M568 command is no longer needed");
 		break;
 
-	case 569: // Set/report axis direction
-		result = ConfigureDriver(gb, reply);
-		break;
-
 	case 570: // Set/report heater monitoring
 		{
 			bool seen = false;
@@ -3680,14 +3679,6 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 		result = CheckOrConfigureTrigger(gb, reply, code);
 		break;
 
-	case 584: // Set axis/extruder to stepper driver(s) mapping
-		result = DoDriveMapping(gb, reply);
-		break;
-
-	case 585: // Probe Tool
-		result = ProbeTool(gb, reply);
-		break;
-
 	case 586: // Configure network protocols
 		{
 			const unsigned int interface = (gb.Seen('I') ? gb.GetUIValue() : 0);
@@ -3957,14 +3948,6 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 		result = FindCenterOfCavity(gb, reply);
 		break;
 
-	case 701: // Load filament
-		result = LoadFilament(gb, reply);
-		break;
-
-	case 702: // Unload filament
-		result = UnloadFilament(gb, reply);
-		break;
-
 	case 703: // Configure Filament
 		if (reprap.GetCurrentTool() != nullptr)
 		{
@@ -4161,10 +4144,6 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 		}
 		break;
 
-	case 905: // Set current RTC date and time
-		result = SetDateTime(gb, reply);
-		break;
-
 	case 906: // Set/report Motor currents
 	case 913: // Set/report motor current percent
 #if HAS_SMART_DRIVERS
@@ -4324,6 +4303,22 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 #endif
 
 	case 916:
+		{
+			// If the last record in the print job journal isn't the marker that says resurrect.g was saved, then the power failed without resurrect.g
+			// being saved since that record, so create it from the journal. Starting a print deletes any older resurrect.g, so we don't need file times.
+			String<MaxFilenameLength> printingFilename;
+			PrintJournal::Record r;
+			if (PrintJournal::ReadLastRecord(printingFilename.GetRef(), r) && (r.flags & PrintJournal::ResumeFileSavedFlag) == 0)
+			{
+				if (!SaveResumeInfoFromJournal(printingFilename.c_str(), r, reply))
+				{
+					result = GCodeResult::error;
+					break;
+				}
+				platform.Message(LoggedGenericMessage, "Resume file created from print job journal\n");
+			}
+		}
+
 		if (!platform.SysFileExists(RESUME_AFTER_POWER_FAIL_G))
 		{
 			reply.copy("No resume file found");
@@ -4352,10 +4347,6 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply)
 		result = platform.ConfigureLogging(gb, reply);
 		break;
 
-	case 997: // Perform firmware update
-		result = UpdateFirmware(gb, reply);
-		break;
-
 	case 998:
 		// The input handling code replaces the gcode by this when it detects a checksum error.
 		// Since we have no way of asking for the line to be re-sent, just report an error.
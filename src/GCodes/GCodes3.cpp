@@ -301,13 +301,9 @@ bool GCodes::WriteWorkplaceCoordinates(FileStore *f) const
 #endif
 
 // Define the probing grid, called when we see an M557 command
+// The caller must already have locked movement, to ensure that probing is not already in progress.
 GCodeResult GCodes::DefineGrid(GCodeBuffer& gb, const StringRef &reply)
 {
-	if (!LockMovement(gb))							// to ensure that probing is not already in progress
-	{
-		return GCodeResult::notFinished;
-	}
-
 	bool seenX = false, seenY = false, seenR = false, seenP = false, seenS = false;
 	float xValues[2];
 	float yValues[2];
@@ -706,13 +702,9 @@ GCodeResult GCodes::CheckOrConfigureTrigger(GCodeBuffer& gb, const StringRef& re
 }
 
 // Deal with a M584
+// The caller must already have locked movement and waited for standstill. We also rely on this to retrieve the current motor positions to moveBuffer.
 GCodeResult GCodes::DoDriveMapping(GCodeBuffer& gb, const StringRef& reply)
 {
-	if (!LockMovementAndWaitForStandstill(gb))				// we also rely on this to retrieve the current motor positions to moveBuffer
-	{
-		return GCodeResult::notFinished;
-	}
-
 	bool seen = false;
 	const char *lettersToTry = "XYZUVWABC";
 	char c;
@@ -1027,13 +1019,9 @@ GCodeResult GCodes::SetDateTime(GCodeBuffer& gb, const StringRef& reply)
 }
 
 // Handle M997
+// The caller must already have locked movement and waited for standstill.
 GCodeResult GCodes::UpdateFirmware(GCodeBuffer& gb, const StringRef &reply)
 {
-	if (!LockMovementAndWaitForStandstill(gb))
-	{
-		return GCodeResult::notFinished;
-	}
-
 	reprap.GetHeat().SwitchOffAll(true);				// turn all heaters off because the main loop may get suspended
 	DisableDrives();									// all motors off
 
@@ -0,0 +1,63 @@
+/*
+ * MotionChannelSync.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  The M598 sync point logic between the main motion channel (channel 0) and the secondary one (channel 1).
+ *  Each channel counts the sync points it has reached. A channel that has reached a sync point waits until the other channel has reached
+ *  at least as many, or is not running a file. This file must not depend on anything else in the firmware, because the host simulation
+ *  in Tools/HostTests uses it too.
+ */
+
+#ifndef SRC_GCODES_MOTIONCHANNELSYNC_H_
+#define SRC_GCODES_MOTIONCHANNELSYNC_H_
+
+#include <cstdint>
+#include <cstddef>
+
+class MotionChannelSync
+{
+public:
+	static constexpr size_t NumChannels = 2;
+
+	MotionChannelSync() { Reset(); }
+
+	// Forget all sync points, e.g. when a new file is started on the secondary channel
+	void Reset()
+	{
+		for (size_t i = 0; i < NumChannels; ++i)
+		{
+			counts[i] = 0;
+			waiting[i] = false;
+		}
+	}
+
+	// Return true if the channel has reached a sync point and is waiting for the other one
+	bool IsWaiting(size_t channel) const { return waiting[channel]; }
+
+	// Called repeatedly by a channel at a sync point once all its moves have finished. Return true when it may carry on.
+	bool Arrive(size_t channel, bool otherChannelRunning)
+	{
+		if (!waiting[channel])
+		{
+			++counts[channel];
+			waiting[channel] = true;
+		}
+		if (otherChannelRunning && counts[NumChannels - 1 - channel] < counts[channel])
+		{
+			return false;
+		}
+		waiting[channel] = false;
+		return true;
+	}
+
+	// Called when the file on a channel is stopped, which abandons any sync point it was waiting at
+	void Abandon(size_t channel) { waiting[channel] = false; }
+
+private:
+	uint32_t counts[NumChannels];			// how many sync points each channel has reached
+	bool waiting[NumChannels];				// true if the channel has reached a sync point and is waiting for the other one
+};
+
+#endif /* SRC_GCODES_MOTIONCHANNELSYNC_H_ */
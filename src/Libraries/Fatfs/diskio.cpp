@@ -41,6 +41,8 @@
  *
  */
 
+#ifndef FATFS_HOST_IMAGE		// host builds use diskio_host.cpp instead
+
 #include "ctrl_access.h"
 #include "compiler.h"
 
@@ -382,3 +384,5 @@ DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
 }
 
 //@}
+
+#endif
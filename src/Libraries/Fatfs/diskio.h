@@ -6,6 +6,26 @@
 
 #ifdef __cplusplus
 unsigned int DiskioGetAndClearMaxRetryCount();
+
+#ifdef FATFS_HOST_IMAGE
+#include <cstdint>
+
+// Functions provided by the host backend in diskio_host.cpp
+struct DiskioHostStats
+{
+	uint32_t readCommands;
+	uint32_t writeCommands;
+	uint32_t sectorsRead;
+	uint32_t sectorsWritten;
+	uint32_t writeStalls;
+};
+
+bool DiskioHostAttachImage(unsigned char drv, const char *imageFile, uint32_t commandDelayMicroseconds, uint32_t sectorDelayMicroseconds);
+void DiskioHostDetachImage(unsigned char drv);
+DiskioHostStats DiskioHostGetAndClearStats(unsigned char drv);
+void DiskioHostSetWriteStall(unsigned char drv, uint32_t sectorsBetweenStalls, uint32_t stallMicroseconds);
+#endif
+
 extern "C" {
 #endif
 
@@ -0,0 +1,233 @@
+/*
+ * diskio_host.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Low level disk I/O for FatFS when the storage code is built to run on a Linux host instead of the SD card drivers.
+ *  Each drive is a FAT image file that is memory mapped. An optional delay per sector transferred and per command models the speed of a real SD card,
+ *  so that changes to the storage code can be measured without running them on a board. An optional longer delay after a number of sectors have been
+ *  written models a card that stalls now and then while it erases blocks.
+ *  This file is only compiled into host builds, which define FATFS_HOST_IMAGE. diskio.cpp is used otherwise.
+ */
+
+#ifdef FATFS_HOST_IMAGE
+
+#include "diskio.h"
+#include "ffconf.h"
+
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace
+{
+	constexpr size_t SectorSize = FF_MAX_SS;
+
+	struct HostDrive
+	{
+		uint8_t *image;								// the mapped image file, or nullptr if no image is attached
+		size_t numSectors;
+		uint32_t commandDelayMicroseconds;			// delay for each read or write command, to model the command overhead of a card
+		uint32_t sectorDelayMicroseconds;			// additional delay for each sector transferred
+		uint32_t sectorsBetweenStalls;				// how many sectors are written between write stalls, or 0 for no stalls
+		uint32_t stallMicroseconds;					// additional delay for a write command that reaches the next stall
+		uint32_t sectorsSinceStall;
+		DiskioHostStats stats;
+	};
+
+	HostDrive drives[FF_VOLUMES] = {};
+
+	void Delay(const HostDrive& d, unsigned int numSectors, uint32_t extraMicroseconds = 0)
+	{
+		const uint64_t us = (uint64_t)d.commandDelayMicroseconds + (uint64_t)d.sectorDelayMicroseconds * numSectors + extraMicroseconds;
+		if (us != 0)
+		{
+			timespec ts;
+			ts.tv_sec = us / 1000000u;
+			ts.tv_nsec = (us % 1000000u) * 1000u;
+			while (nanosleep(&ts, &ts) != 0) { }
+		}
+	}
+}
+
+// Map a FAT image file as a drive. Return true if successful.
+bool DiskioHostAttachImage(BYTE drv, const char *imageFile, uint32_t commandDelayMicroseconds, uint32_t sectorDelayMicroseconds)
+{
+	if (drv >= FF_VOLUMES)
+	{
+		return false;
+	}
+	DiskioHostDetachImage(drv);
+
+	const int fd = open(imageFile, O_RDWR);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)SectorSize)
+	{
+		close(fd);
+		return false;
+	}
+
+	void * const p = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);										// the mapping remains valid after the file is closed
+	if (p == MAP_FAILED)
+	{
+		return false;
+	}
+
+	HostDrive& d = drives[drv];
+	d.image = static_cast<uint8_t*>(p);
+	d.numSectors = (size_t)st.st_size / SectorSize;
+	d.commandDelayMicroseconds = commandDelayMicroseconds;
+	d.sectorDelayMicroseconds = sectorDelayMicroseconds;
+	d.sectorsBetweenStalls = 0;
+	d.stallMicroseconds = 0;
+	d.sectorsSinceStall = 0;
+	memset(&d.stats, 0, sizeof(d.stats));
+	return true;
+}
+
+// Make a write command stall for an additional time each time the specified number of sectors have been written, or never if sectorsBetweenStalls is 0
+void DiskioHostSetWriteStall(BYTE drv, uint32_t sectorsBetweenStalls, uint32_t stallMicroseconds)
+{
+	if (drv < FF_VOLUMES)
+	{
+		HostDrive& d = drives[drv];
+		d.sectorsBetweenStalls = sectorsBetweenStalls;
+		d.stallMicroseconds = stallMicroseconds;
+		d.sectorsSinceStall = 0;
+	}
+}
+
+// Unmap the image file of a drive, writing back any changes to it
+void DiskioHostDetachImage(BYTE drv)
+{
+	if (drv < FF_VOLUMES && drives[drv].image != nullptr)
+	{
+		HostDrive& d = drives[drv];
+		msync(d.image, d.numSectors * SectorSize, MS_SYNC);
+		munmap(d.image, d.numSectors * SectorSize);
+		d.image = nullptr;
+		d.numSectors = 0;
+	}
+}
+
+// Return and clear the counts of disk commands and sectors transferred
+DiskioHostStats DiskioHostGetAndClearStats(BYTE drv)
+{
+	DiskioHostStats ret = {};
+	if (drv < FF_VOLUMES)
+	{
+		ret = drives[drv].stats;
+		memset(&drives[drv].stats, 0, sizeof(drives[drv].stats));
+	}
+	return ret;
+}
+
+// There are no retries on the host
+unsigned int DiskioGetAndClearMaxRetryCount()
+{
+	return 0;
+}
+
+DSTATUS disk_initialize(BYTE drv)
+{
+	return disk_status(drv);
+}
+
+DSTATUS disk_status(BYTE drv)
+{
+	return (drv < FF_VOLUMES && drives[drv].image != nullptr) ? 0 : STA_NOINIT | STA_NODISK;
+}
+
+DRESULT disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count)
+{
+	if (drv >= FF_VOLUMES || drives[drv].image == nullptr)
+	{
+		return RES_NOTRDY;
+	}
+
+	HostDrive& d = drives[drv];
+	if ((size_t)sector + count > d.numSectors)
+	{
+		return RES_PARERR;
+	}
+
+	Delay(d, count);
+	memcpy(buff, d.image + (size_t)sector * SectorSize, (size_t)count * SectorSize);
+	++d.stats.readCommands;
+	d.stats.sectorsRead += count;
+	return RES_OK;
+}
+
+#if _READONLY == 0
+DRESULT disk_write(BYTE drv, BYTE const *buff, DWORD sector, BYTE count)
+{
+	if (drv >= FF_VOLUMES || drives[drv].image == nullptr)
+	{
+		return RES_NOTRDY;
+	}
+
+	HostDrive& d = drives[drv];
+	if ((size_t)sector + count > d.numSectors)
+	{
+		return RES_PARERR;
+	}
+
+	uint32_t stall = 0;
+	d.sectorsSinceStall += count;
+	if (d.sectorsBetweenStalls != 0 && d.sectorsSinceStall >= d.sectorsBetweenStalls)
+	{
+		d.sectorsSinceStall -= d.sectorsBetweenStalls;
+		stall = d.stallMicroseconds;
+		++d.stats.writeStalls;
+	}
+
+	Delay(d, count, stall);
+	memcpy(d.image + (size_t)sector * SectorSize, buff, (size_t)count * SectorSize);
+	++d.stats.writeCommands;
+	d.stats.sectorsWritten += count;
+	return RES_OK;
+}
+#endif
+
+DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
+{
+	if (drv >= FF_VOLUMES || drives[drv].image == nullptr)
+	{
+		return RES_NOTRDY;
+	}
+
+	switch (ctrl)
+	{
+	case GET_BLOCK_SIZE:
+		*(DWORD *)buff = 1;
+		return RES_OK;
+
+	case GET_SECTOR_COUNT:
+		*(DWORD *)buff = (DWORD)drives[drv].numSectors;
+		return RES_OK;
+
+	case GET_SECTOR_SIZE:
+		*(WORD *)buff = SectorSize;
+		return RES_OK;
+
+	case CTRL_SYNC:
+		return RES_OK;								// the image is written back when it is detached
+
+	default:
+		return RES_PARERR;
+	}
+}
+
+#endif
+
+// End
@@ -580,7 +580,7 @@ static inline _Bool isAligned(const BYTE *p)
 #if FF_DISKIO_ALIGN == 1
 	return true;
 #else
-	return ((unsigned int)p & (FF_DISKIO_ALIGN - 1)) == 0;
+	return ((uintptr_t)p & (FF_DISKIO_ALIGN - 1)) == 0;
 #endif
 }
 #endif
@@ -12,6 +12,8 @@
 
 #else			/* Embedded platform */
 
+#include <stdint.h>
+
 /* These types must be 16-bit, 32-bit or larger integer */
 typedef int				INT;
 typedef unsigned int	UINT;
@@ -30,7 +32,7 @@ typedef unsigned short	WCHAR;
 /* These types must be 32-bit integer */
 typedef long			LONG;
 typedef unsigned long	ULONG;
-typedef unsigned long	DWORD;
+typedef uint32_t		DWORD;	/* the same type as in ff.h, which is unsigned long on ARM but not on 64-bit hosts */
 
 #endif
 
@@ -10,6 +10,7 @@
 #include "OutputMemory.h"
 #include "RepRap.h"
 #include "Platform.h"
+#include "Storage/FileWriteBuffer.h"
 
 // Simple lock class that sets a variable true when it is created and makes sure it gets set false when it falls out of scope
 class Lock
@@ -22,7 +23,8 @@ private:
 	bool& b;
 };
 
-Logger::Logger() : logFile(), lastFlushTime(0), lastFlushFileSize(0), dirty(false), inLogger(false)
+Logger::Logger()
+	: logFile(), lastFlushTime(0), lastFlushFileSize(0), logFileSize(0), clusterSize(1), ringHead(0), ringTail(0), droppedMessages(0), longestWriteTime(0), dirty(false), inLogger(false)
 {
 }
 
@@ -31,12 +33,10 @@ void Logger::Start(time_t time, const StringRef& filename)
 	if (!inLogger)
 	{
 		Lock loggerLock(inLogger);
-		FileStore * const f = reprap.GetPlatform().OpenSysFile(filename.c_str(), OpenMode::append);
-		if (f != nullptr)
+		logFileName.copy(filename.c_str());
+		ringHead = ringTail = 0;
+		if (OpenLogFile())
 		{
-			logFile.Set(f);
-			lastFlushFileSize = logFile.Length();
-			logFile.Seek(lastFlushFileSize);
 			InternalLogMessage(time, "Event logging started\n");
 		}
 	}
@@ -46,39 +46,43 @@ void Logger::Stop(time_t time)
 {
 	if (logFile.IsLive() && !inLogger)
 	{
-		Lock loggerLock(inLogger);
-		InternalLogMessage(time, "Event logging stopped\n");
+		{
+			Lock loggerLock(inLogger);
+			InternalLogMessage(time, "Event logging stopped\n");
+		}
+		Flush(true);
 		logFile.Close();
 	}
 }
 
 void Logger::LogMessage(time_t time, const char *message)
 {
-	if (logFile.IsLive() && !inLogger)
+	if (logFile.IsLive())
 	{
-		Lock loggerLock(inLogger);
-		InternalLogMessage(time, message);
+		if (inLogger)
+		{
+			++droppedMessages;				// another task is storing a message, and we don't wait for it
+		}
+		else
+		{
+			Lock loggerLock(inLogger);
+			InternalLogMessage(time, message);
+		}
 	}
 }
 
 void Logger::LogMessage(time_t time, OutputBuffer *buf)
 {
-	if (logFile.IsLive() && !inLogger)
+	if (logFile.IsLive())
 	{
-		Lock loggerLock(inLogger);
-		bool ok = WriteDateTime(time);
-		if (ok)
+		if (inLogger)
 		{
-			ok = buf->WriteToFile(logFile);
-		}
-
-		if (ok)
-		{
-			dirty = true;
+			++droppedMessages;
 		}
 		else
 		{
-			logFile.Close();
+			Lock loggerLock(inLogger);
+			(void)StoreMessage(time, nullptr, buf->Length(), buf);
 		}
 	}
 }
@@ -86,59 +90,216 @@ void Logger::LogMessage(time_t time, OutputBuffer *buf)
 // Version of LogMessage for when we already know we want to proceed and we have already set inLogger
 void Logger::InternalLogMessage(time_t time, const char *message)
 {
-	bool ok = WriteDateTime(time);
-	if (ok)
+	(void)StoreMessage(time, message, strlen(message), nullptr);
+}
+
+// Put the date and time and a message in the ring, adding a newline if the message doesn't end with one. The message is either a string or an OutputBuffer chain.
+// If there isn't room for the whole message then drop it and count it, because we mustn't make the caller wait for the SD card.
+// Caller must already have checked and set inLogger.
+bool Logger::StoreMessage(time_t time, const char *message, size_t len, OutputBuffer *buf)
+{
+	char dateTime[30];
+	const size_t dateTimeLength = FormatDateTime(time, dateTime, sizeof(dateTime));
+
+	char lastChar = 0;
+	if (message != nullptr)
 	{
-		const size_t len = strlen(message);
 		if (len != 0)
 		{
-			ok = logFile.Write(message, len);
+			lastChar = message[len - 1];
 		}
-		if (ok && (len == 0 || message[len - 1] != '\n'))
+	}
+	else
+	{
+		for (const OutputBuffer *b = buf; b != nullptr; b = b->Next())
 		{
-			ok = logFile.Write('\n');
+			if (b->DataLength() != 0)
+			{
+				lastChar = b->Data()[b->DataLength() - 1];
+			}
 		}
 	}
 
-	if (ok)
+	const size_t totalLength = dateTimeLength + len + ((lastChar == '\n') ? 0 : 1);
+	if (totalLength >= RingSize - BytesInRing())				// one byte of the ring is always left free so that a full ring can be told from an empty one
+	{
+		++droppedMessages;
+		return false;
+	}
+
+	size_t head = CopyToRing(ringHead, dateTime, dateTimeLength);
+	if (message != nullptr)
 	{
-		dirty = true;
+		head = CopyToRing(head, message, len);
 	}
 	else
 	{
-		logFile.Close();
+		for (const OutputBuffer *b = buf; b != nullptr; b = b->Next())
+		{
+			head = CopyToRing(head, b->Data(), b->DataLength());
+		}
+	}
+	if (lastChar != '\n')
+	{
+		head = CopyToRing(head, "\n", 1);
 	}
+
+	__DMB();														// make sure that the message has been written before Flush can see it
+	ringHead = head;
+	return true;
+}
+
+// Copy data into the ring starting at the specified index, returning the index after the end of it. The caller must already have checked that there is room.
+size_t Logger::CopyToRing(size_t head, const char *data, size_t len)
+{
+	const size_t firstPart = min<size_t>(len, RingSize - head);
+	memcpy(ring + head, data, firstPart);
+	memcpy(ring, data + firstPart, len - firstPart);
+	return (head + len) & (RingSize - 1);
 }
 
-// This is called regularly by Platform to give the logger an opportunity to flush the file buffer
+// Give the oldest bytes in the ring to the storage task to write to the log file, optionally syncing the file afterwards, and remove them from the ring.
+// The bytes must not wrap round the end of the ring and there must be no more than FileWriteBufLen of them.
+bool Logger::WriteFromRing(size_t len, bool sync)
+{
+	const size_t tail = ringTail;
+	const bool ok = logFile.WriteInBackground(ring + tail, len, sync);
+	ringTail = (tail + len) & (RingSize - 1);
+	logFileSize += len;
+	return ok;
+}
+
+// This is called regularly by Platform to write the messages in the ring to the log file and to flush the file.
+// To avoid excessive disk write operations:
+// 1. We write only whole sectors, unless it is time to flush the file, so that a sector is not rewritten each time a message is added to it.
+// 2. We flush the file if we have started a new cluster since the last flush, to avoid lost clusters if we power down before flushing,
+//    or if it hasn't been flushed for LogFlushInterval milliseconds.
+// The storage task does the writing and flushing. Unless we are forced to, we stop when there is no free write buffer and carry on next time.
 void Logger::Flush(bool forced)
 {
-	if (logFile.IsLive() && dirty && !inLogger)
-	{
-		// Log file is dirty and can be flushed.
-		// To avoid excessive disk write operations, flush it only if one of the following is true:
-		// 1. We have possibly allocated a new cluster since the last flush. To avoid lost clusters if we power down before flushing,
-		//    we should flush early in this case. Rather than determine the cluster size, we flush if we have started a new 512-byte sector.
-		// 2. If it hasn't been flushed for LogFlushInterval milliseconds.
-		const FilePosition currentPos = logFile.GetPosition();
-		const uint32_t now = millis();
-		if (forced || now - lastFlushTime >= LogFlushInterval || currentPos/512 != lastFlushFileSize/512)
+	if (logFile.IsLive())
+	{
+		const uint32_t startTime = millis();
+		const bool timeToFlush = forced || startTime - lastFlushTime >= LogFlushInterval;
+		size_t toWrite = BytesInRing();
+		if (toWrite != 0 && !timeToFlush)
 		{
-			Lock loggerLock(inLogger);
-			logFile.Flush();
-			lastFlushTime = millis();
-			lastFlushFileSize = currentPos;
-			dirty = false;
+			const size_t offsetInSector = (size_t)(logFileSize % SectorSize);
+			const size_t sectorsEnd = (offsetInSector + toWrite) & ~(SectorSize - 1);
+			toWrite = (sectorsEnd > offsetInSector) ? sectorsEnd - offsetInSector : 0;
+		}
+
+		const bool sync = (dirty || toWrite != 0)
+						&& (timeToFlush || (logFileSize + toWrite)/clusterSize != lastFlushFileSize/clusterSize);
+		if (toWrite == 0 && !sync)
+		{
+			return;
+		}
+
+		bool wrote = false;
+		do
+		{
+			if (!forced && !logFile.CanWriteInBackground())
+			{
+				break;
+			}
+
+			const size_t len = min<size_t>(toWrite, min<size_t>(RingSize - ringTail, FileWriteBufLen));
+			toWrite -= len;
+			const bool syncNow = sync && toWrite == 0;					// if there is nothing to write then this is an empty block that just syncs the file
+			if (!WriteFromRing(len, syncNow))
+			{
+				logFile.Close();
+				return;
+			}
+			wrote = true;
+			if (syncNow)
+			{
+				lastFlushTime = millis();
+				lastFlushFileSize = logFileSize;
+				dirty = false;
+			}
+			else
+			{
+				dirty = true;
+			}
+		} while (toWrite != 0);
+
+		if (wrote)
+		{
+			const uint32_t writeTime = millis() - startTime;
+			if (writeTime > longestWriteTime)
+			{
+				longestWriteTime = writeTime;
+			}
+
+			if (logFileSize >= MaxLogFileSize)
+			{
+				RotateLogFile();
+			}
 		}
 	}
 }
 
-// Write the data and time to the file followed by a space.
-// Caller must already have checked and set inLogger.
-bool Logger::WriteDateTime(time_t time)
+// Report the number of messages dropped and the longest time taken to write to the log file, and clear them
+void Logger::Diagnostics(MessageType mtype)
+{
+	reprap.GetPlatform().MessageF(mtype, "Event log: %" PRIu32 " messages dropped, longest write time %" PRIu32 "ms\n", droppedMessages, longestWriteTime);
+	droppedMessages = longestWriteTime = 0;
+}
+
+// Open the log file for appending. If it is a new file, reserve contiguous space for it so that it isn't fragmented by other files written while we are logging.
+// Caller must not be in the middle of storing a message.
+bool Logger::OpenLogFile()
+{
+	FileStore * const f = reprap.GetPlatform().OpenSysFile(logFileName.c_str(), OpenMode::append);
+	if (f == nullptr)
+	{
+		return false;
+	}
+
+	clusterSize = f->ClusterSize();
+	lastFlushFileSize = logFileSize = f->Length();
+	if (lastFlushFileSize == 0)
+	{
+		(void)f->ReserveContiguousSpace(MaxLogFileSize);
+	}
+	else
+	{
+		(void)f->Seek(lastFlushFileSize);
+	}
+	logFile.Set(f);
+	lastFlushTime = millis();
+	dirty = false;
+	return true;
+}
+
+// The log file has reached its maximum size, so keep it with ".old" appended to its name, replacing the previous one, and start a new log file.
+// Closing the file waits for the storage task to finish writing it, but this only happens once per MaxLogFileSize bytes logged.
+void Logger::RotateLogFile()
+{
+	logFile.Close();
+
+	Platform& platform = reprap.GetPlatform();
+	String<MaxFilenameLength> currentName;
+	String<MaxFilenameLength> oldName;
+	if (platform.MakeSysFileName(currentName.GetRef(), logFileName.c_str()))
+	{
+		oldName.copy(currentName.c_str());
+	}
+	if (!oldName.IsEmpty() && !oldName.cat(".old"))
+	{
+		MassStorage * const massStorage = platform.GetMassStorage();
+		(void)massStorage->Delete(oldName.c_str());
+		(void)massStorage->Rename(currentName.c_str(), oldName.c_str());
+	}
+	(void)OpenLogFile();
+}
+
+// Format the date and time followed by a space into the buffer, returning its length
+size_t Logger::FormatDateTime(time_t time, char *buffer, size_t bufSize)
 {
-	String<30> bufferSpace;
-	const StringRef buf = bufferSpace.GetRef();
+	const StringRef buf(buffer, bufSize);
 	if (time == 0)
 	{
 		const uint32_t timeSincePowerUp = (uint32_t)(millis64()/1000u);
@@ -150,7 +311,7 @@ bool Logger::WriteDateTime(time_t time)
 		buf.printf("%04u-%02u-%02u %02u:%02u:%02u ",
 						timeInfo->tm_year + 1900, timeInfo->tm_mon + 1, timeInfo->tm_mday, timeInfo->tm_hour, timeInfo->tm_min, timeInfo->tm_sec);
 	}
-	return logFile.Write(buf.c_str());
+	return buf.strlen();
 }
 
 // End
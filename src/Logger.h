@@ -3,12 +3,19 @@
  *
  *  Created on: 17 Sep 2017
  *      Author: David
+ *
+ *  Messages are formatted into a RAM ring buffer and written to the log file by Flush, which Platform calls from its Spin loop.
+ *  So a task that logs a message never waits for the SD card, and if the ring is full the message is dropped and counted instead.
+ *  Flush hands whole sectors to the storage task to write, except when it is time to sync the file, so Platform doesn't wait for the SD card either.
+ *  If no write buffer is free, the data stays in the ring until the next call. The file is rotated when it reaches its maximum size.
  */
 
 #ifndef SRC_LOGGER_H_
 #define SRC_LOGGER_H_
 
 #include <ctime>
+#include "RepRapFirmware.h"
+#include "MessageType.h"
 #include "Storage/FileData.h"
 
 class OutputBuffer;
@@ -24,16 +31,41 @@ public:
 	void LogMessage(time_t time, OutputBuffer *buf);
 	void Flush(bool forced);
 	bool IsActive() const { return logFile.IsLive(); }
+	void Diagnostics(MessageType mtype);
 
 private:
-	bool WriteDateTime(time_t time);
+#if SAM4E || SAM4S || SAME70
+	static constexpr size_t RingSize = 4096;					// must be a power of 2
+#else
+	static constexpr size_t RingSize = 1024;					// must be a power of 2
+#endif
+	static constexpr size_t SectorSize = 512;
+	static constexpr FilePosition MaxLogFileSize = 1024 * 1024;	// when the log file reaches this size we rename it and start a new one
+
+	static_assert((RingSize & (RingSize - 1)) == 0, "RingSize must be a power of 2");
+
+	bool OpenLogFile();
+	void RotateLogFile();
+	size_t FormatDateTime(time_t time, char *buf, size_t bufSize);
 	void InternalLogMessage(time_t time, const char *message);
+	bool StoreMessage(time_t time, const char *message, size_t len, OutputBuffer *buf);
+	size_t CopyToRing(size_t head, const char *data, size_t len);
+	bool WriteFromRing(size_t len, bool sync);
+	size_t BytesInRing() const { return (ringHead - ringTail) & (RingSize - 1); }
 
 	FileData logFile;
+	String<MaxFilenameLength> logFileName;
 	uint32_t lastFlushTime;
 	FilePosition lastFlushFileSize;
-	bool dirty;
+	FilePosition logFileSize;									// the size of the file once the storage task has written everything we gave it
+	uint32_t clusterSize;
+	volatile size_t ringHead;									// where the next message goes, only changed by the task that holds inLogger
+	volatile size_t ringTail;									// the oldest byte not yet written to the file, only changed by Flush
+	uint32_t droppedMessages;
+	uint32_t longestWriteTime;									// in milliseconds
+	bool dirty;													// true if we have written data to the file since we last synced it
 	bool inLogger;
+	char ring[RingSize];
 };
 
 #endif /* SRC_LOGGER_H_ */
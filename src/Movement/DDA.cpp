@@ -1665,7 +1665,8 @@ void DDA::CheckEndstops(Platform& platform)
 // The GCC optimize pragma appears to be broken, if we try to force O3 optimisation here then functions are never inlined
 
 // Start executing this move, returning true if Step() needs to be called immediately. Must be called with interrupts disabled or basepri >= set interrupt priority, to avoid a race condition.
-void DDA::Start(Platform& p, uint32_t tim)
+// If setOutputs is false then we leave the laser power and ancillary PWM alone, because another DDA ring is in charge of them.
+void DDA::Start(Platform& p, uint32_t tim, bool setOutputs)
 pre(state == frozen)
 {
 	if ((int32_t)(tim - afterPrepare.moveStartTime ) > 25)
@@ -1684,7 +1685,7 @@ pre(state == frozen)
 
 #if SUPPORT_LASER
 	// Deal with laser power
-	if (reprap.GetGCodes().GetMachineType() == MachineType::laser)
+	if (setOutputs && reprap.GetGCodes().GetMachineType() == MachineType::laser)
 	{
 		// Ideally we should ramp up the laser power as the machine accelerates, but for now we don't.
 		p.SetLaserPwm(laserPwmOrIoBits.laserPwm);
@@ -1742,13 +1743,16 @@ pre(state == frozen)
 			}
 		}
 
-		if (extruding)
+		if (setOutputs)
 		{
-			p.ExtrudeOn();
-		}
-		else
-		{
-			p.ExtrudeOff();
+			if (extruding)
+			{
+				p.ExtrudeOn();
+			}
+			else
+			{
+				p.ExtrudeOff();
+			}
 		}
 	}
 }
@@ -1772,7 +1776,7 @@ void DDA::StepDrivers(Platform& p)
 	uint32_t driversStepping = 0;
 	DriveMovement* dm = activeDMs;
 	uint32_t now = StepTimer::GetInterruptClocks();
-	const uint32_t elapsedTime = (now - afterPrepare.moveStartTime) + MinInterruptInterval;
+	const uint32_t elapsedTime = StepTiming::StepHorizon(now, afterPrepare.moveStartTime, MinInterruptInterval);
 	while (dm != nullptr && elapsedTime >= dm->nextStepTime)		// if the next step is due
 	{
 		driversStepping |= p.GetDriversBitmap(dm->drive);
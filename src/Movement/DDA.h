@@ -11,6 +11,7 @@
 #include "RepRapFirmware.h"
 #include "DriveMovement.h"
 #include "StepTimer.h"
+#include "StepTiming.h"
 #include "GCodes/GCodes.h"			// for class RawMove
 
 #include <optional>
@@ -44,7 +45,7 @@ public:
 	bool InitStandardMove(DDARing& ring, GCodes::RawMove &nextMove, bool doMotorMapping) __attribute__ ((hot));	// Set up a new move, returning true if it represents real movement
 	bool InitLeadscrewMove(DDARing& ring, float feedrate, const float amounts[MaxTotalDrivers]);		// Set up a leadscrew motor move
 
-	void Start(Platform& p, uint32_t tim) __attribute__ ((hot));			// Start executing the DDA, i.e. move the move.
+	void Start(Platform& p, uint32_t tim, bool setOutputs) __attribute__ ((hot));	// Start executing the DDA, i.e. move the move.
 	void StepDrivers(Platform& p) __attribute__ ((hot));					// Take one step of the DDA, called by timed interrupt.
 	std::optional<uint32_t> GetNextInterruptTime() const;					// Return the time that the next interrupt is needed
 
@@ -16,14 +16,16 @@
 constexpr uint32_t UsualMinimumPreparedTime = StepTimer::StepClockRate/10;			// 100ms
 constexpr uint32_t AbsoluteMinimumPreparedTime = StepTimer::StepClockRate/20;		// 50ms
 
-DDARing::DDARing() : scheduledMoves(0), completedMoves(0)
+DDARing::DDARing() : scheduledMoves(0), completedMoves(0), completedFilePos(noFilePosition)
 {
 }
 
 // This can be called in the constructor for class Move
-void DDARing::Init1(unsigned int numDdas)
+// If there is more than one ring then only one of them may control the laser and ancillary PWM outputs.
+void DDARing::Init1(unsigned int numDdas, bool pControlsOutputs)
 {
 	numDdasInRing = numDdas;
+	controlsOutputs = pControlsOutputs;
 
 	// Build the DDA ring
 	DDA *dda = new DDA(nullptr);
@@ -197,14 +199,7 @@ void DDARing::Spin(uint8_t simulationMode, bool shouldStartMove)
 					Platform& p = reprap.GetPlatform();
 					SetBasePriority(NvicPriorityStep);				// shut out step interrupt
 					StartNextMove(p, StepTimer::GetInterruptClocksInterruptsDisabled());	// start the next move
-					std::optional<uint32_t> nextInterruptTime = GetNextInterruptTime();
-					if (nextInterruptTime.has_value())
-					{
-						if (StepTimer::ScheduleStepInterrupt(nextInterruptTime.value()))
-						{
-							Interrupt(p);
-						}
-					}
+					reprap.GetMove().ScheduleNextStepInterrupt();	// another ring may have a step due before ours
 					SetBasePriority(0);
 				}
 			}
@@ -275,13 +270,16 @@ void DDARing::TryStartNextMove(Platform& p, uint32_t startTime)
 	}
 	else
 	{
-#if SUPPORT_LASER
-		if (reprap.GetGCodes().GetMachineType() == MachineType::laser)
+		if (controlsOutputs)
 		{
-			p.SetLaserPwm(0);						// turn off the laser
-		}
+#if SUPPORT_LASER
+			if (reprap.GetGCodes().GetMachineType() == MachineType::laser)
+			{
+				p.SetLaserPwm(0);					// turn off the laser
+			}
 #endif
-		p.ExtrudeOff();								// turn off ancillary PWM
+			p.ExtrudeOff();							// turn off ancillary PWM
+		}
 		if (st == DDA::provisional)
 		{
 			++numPrepareUnderruns;					// there are more moves available, but they are not prepared yet. Signal an underrun.
@@ -294,6 +292,14 @@ void DDARing::Interrupt(Platform& p)
 	DDA* const cdda = currentDda;					// capture volatile variable
 	if (cdda != nullptr)
 	{
+		// The step ISR serves every ring, so it may be called when nothing in this ring is due, for example while its first move is waiting to start.
+		// StepDrivers would then take every drive as due and step it, so don't call it until the next step or the end of the move is due.
+		const std::optional<uint32_t> dueTime = cdda->GetNextInterruptTime();
+		if (!dueTime.has_value() || !StepTiming::IsDue(StepTimer::GetInterruptClocks(), dueTime.value(), DDA::MinInterruptInterval))
+		{
+			return;
+		}
+
 		cdda->StepDrivers(p);						// check endstops if necessary and step the drivers
 		if (cdda->GetState() == DDA::completed)
 		{
@@ -330,6 +336,10 @@ void DDARing::CurrentMoveCompleted()
 	{
 		extrusionAccumulators[drive - numAxes] += currentDda->GetStepsTaken(drive);
 	}
+	if (currentDda->GetFilePosition() != noFilePosition)
+	{
+		completedFilePos = currentDda->GetFilePosition();
+	}
 	currentDda = nullptr;
 
 	getPointer = getPointer->GetNext();
@@ -17,7 +17,7 @@ class DDARing
 public:
 	DDARing();
 
-	void Init1(unsigned int numDdas);
+	void Init1(unsigned int numDdas, bool pControlsOutputs);
 	void Init2();
 	void Exit();
 
@@ -42,6 +42,8 @@ public:
 	uint32_t GetScheduledMoves() const { return scheduledMoves; }				// How many moves have been scheduled?
 	uint32_t GetCompletedMoves() const { return completedMoves; }				// How many moves have been completed?
 	void ResetMoveCounters() { scheduledMoves = completedMoves = 0; }
+	FilePosition GetCompletedFilePosition() const { return completedFilePos; }	// File position of the last completed move that came from a file
+	void ClearCompletedFilePosition() { completedFilePos = noFilePosition; }
 
 	float GetSimulationTime() const { return simulationTime; }
 	void ResetSimulationTime() { simulationTime = 0.0; }
@@ -86,9 +88,11 @@ private:
 	volatile int32_t liveEndPoints[MaxTotalDrivers];							// The XYZ endpoints of the last completed move in motor coordinates
 
 	unsigned int numDdasInRing;
+	bool controlsOutputs;														// True if moves in this ring set the laser power and ancillary PWM
 
 	uint32_t scheduledMoves;													// Move counters for the code queue
 	volatile uint32_t completedMoves;											// This one is modified by an ISR, hence volatile
+	volatile FilePosition completedFilePos;										// Also modified by the ISR
 
 	unsigned int numLookaheadUnderruns;											// How many times we have run out of moves to adjust during lookahead
 	unsigned int numPrepareUnderruns;											// How many times we wanted a new move but there were only un-prepared moves in the queue
@@ -118,7 +122,7 @@ pre(ddaRingGetPointer->GetState() == DDA::frozen)
 		extrudersPrintingSince = millis();
 	}
 	currentDda = cdda;
-	cdda->Start(p, startTime);
+	cdda->Start(p, startTime, controlsOutputs);
 }
 
 #if HAS_SMART_DRIVERS
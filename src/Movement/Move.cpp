@@ -76,13 +76,20 @@ Move::Move()
 {
 	// Kinematics must be set up here because GCodes::Init asks the kinematics for the assumed initial position
 	kinematics = Kinematics::Create(KinematicsType::cartesian);		// default to Cartesian
-	mainDDARing.Init1(DdaRingLength);
+	mainDDARing.Init1(DdaRingLength, true);
+#if SUPPORT_ASYNC_MOVES
+	auxDDARing.Init1(AuxDdaRingLength, false);
+#endif
 	DriveMovement::InitialAllocate(NumDms);
 }
 
 void Move::Init()
 {
 	mainDDARing.Init2();
+#if SUPPORT_ASYNC_MOVES
+	auxDDARing.Init2();
+	auxIdleCount = 0;
+#endif
 
 	// Clear the transforms
 	SetIdentityTransform();
@@ -109,6 +116,9 @@ void Move::Exit()
 {
 	StepTimer::DisableStepInterrupt();
 	mainDDARing.Exit();
+#if SUPPORT_ASYNC_MOVES
+	auxDDARing.Exit();
+#endif
 	active = false;												// don't accept any more moves
 }
 
@@ -118,6 +128,9 @@ void Move::Spin()
 	{
 		GCodes::RawMove nextMove;
 		(void) reprap.GetGCodes().ReadMove(nextMove);			// throw away any move that GCodes tries to pass us
+#if SUPPORT_ASYNC_MOVES
+		(void) reprap.GetGCodes().ReadAuxMove(nextMove);
+#endif
 		return;
 	}
 
@@ -196,8 +209,30 @@ void Move::Spin()
 
 	mainDDARing.Spin(simulationMode, idleCount > 10);	// let the DDA ring process moves. Better to have a few moves in the queue so that we can do lookahead, hence the test on idleCount.
 
+#if SUPPORT_ASYNC_MOVES
+	// Do the same for the secondary motion channel. Its moves are already in machine coordinates, so we don't transform them.
+	if (auxIdleCount < 1000)
+	{
+		++auxIdleCount;
+	}
+	auxDDARing.RecycleDDAs();
+	if (auxDDARing.CanAddMove())
+	{
+		GCodes::RawMove nextAuxMove;
+		if (reprap.GetGCodes().ReadAuxMove(nextAuxMove) && simulationMode < 2 && auxDDARing.AddStandardMove(nextAuxMove, true))
+		{
+			auxIdleCount = 0;
+		}
+	}
+	auxDDARing.Spin(simulationMode, auxIdleCount > 10);
+
+	const bool ringsIdle = mainDDARing.IsIdle() && auxDDARing.IsIdle();
+#else
+	const bool ringsIdle = mainDDARing.IsIdle();
+#endif
+
 	// Reduce motor current to standby if the rings have been idle for long enough
-	if (mainDDARing.IsIdle())
+	if (ringsIdle)
 	{
 		if (moveState == MoveState::executing && !reprap.GetGCodes().IsPaused())
 		{
@@ -333,6 +368,9 @@ void Move::Diagnostics(MessageType mtype)
 #endif
 
 	mainDDARing.Diagnostics(mtype, "");
+#if SUPPORT_ASYNC_MOVES
+	auxDDARing.Diagnostics(mtype, "Aux ");
+#endif
 }
 
 // Set the current position to be this
@@ -699,7 +737,10 @@ void Move::Interrupt()
 	do
 	{
 		mainDDARing.Interrupt(p);
-		std::optional<uint32_t> nextStepTime = mainDDARing.GetNextInterruptTime();
+#if SUPPORT_ASYNC_MOVES
+		auxDDARing.Interrupt(p);
+#endif
+		std::optional<uint32_t> nextStepTime = GetNextStepTime();
 		if (!nextStepTime.has_value())
 		{
 			break;
@@ -711,6 +752,9 @@ void Move::Interrupt()
 		{
 			// Force a break by updating the move start time
 			mainDDARing.InsertHiccup(DDA::HiccupTime);
+#if SUPPORT_ASYNC_MOVES
+			auxDDARing.InsertHiccup(DDA::HiccupTime);
+#endif
 			nextStepTime = nextStepTime.value() + DDA::HiccupTime;
 #if SUPPORT_CAN_EXPANSION
 			CanInterface::InsertHiccup(DDA::HiccupTime);
@@ -724,6 +768,69 @@ void Move::Interrupt()
 	} while (repeat);
 }
 
+// Schedule the step interrupt for the earliest step that is due in any ring, calling the ISR directly if that step is already due.
+// This is called when a ring starts a move, because the step interrupt may already be scheduled for a later step of another ring.
+// Must be called with base priority greater than or equal to the step interrupt, to avoid a race with the step ISR.
+void Move::ScheduleNextStepInterrupt()
+{
+	const std::optional<uint32_t> nextStepTime = GetNextStepTime();
+	if (nextStepTime.has_value() && StepTimer::ScheduleStepInterrupt(nextStepTime.value()))
+	{
+		Interrupt();
+	}
+}
+
+// Return the time that the next step is due in any ring
+std::optional<uint32_t> Move::GetNextStepTime() const
+{
+	std::optional<uint32_t> nextStepTime = mainDDARing.GetNextInterruptTime();
+#if SUPPORT_ASYNC_MOVES
+	const std::optional<uint32_t> nextAuxStepTime = auxDDARing.GetNextInterruptTime();
+	if (nextAuxStepTime.has_value() && (!nextStepTime.has_value() || (int32_t)(nextAuxStepTime.value() - nextStepTime.value()) < 0))
+	{
+		nextStepTime = nextAuxStepTime;
+	}
+#endif
+	return nextStepTime;
+}
+
+#if SUPPORT_ASYNC_MOVES
+
+// Make the position of the secondary motion channel the same as the main one, before handing some axes over to it.
+// Both rings must be idle.
+void Move::CopyPositionToAuxRing()
+{
+	float positions[MaxTotalDrivers];
+	mainDDARing.GetCurrentMachinePosition(positions, false);
+	for (size_t drive = MaxAxes; drive < MaxTotalDrivers; ++drive)
+	{
+		positions[drive] = 0.0;
+	}
+	auxDDARing.SetLiveCoordinates(positions);
+	auxDDARing.SetPositions(positions);
+}
+
+// Hand some axes back from the secondary motion channel to the main one, by making their positions in the main ring the same as in the secondary ring.
+// Both rings must be idle.
+void Move::CopyAxesFromAuxRing(AxesBitmap axes)
+{
+	float positions[MaxTotalDrivers];
+	float auxPositions[MaxAxes];
+	mainDDARing.LiveCoordinates(positions);
+	auxDDARing.GetCurrentMachinePosition(auxPositions, false);
+	for (size_t axis = 0; axis < MaxAxes; ++axis)
+	{
+		if (IsBitSet(axes, axis))
+		{
+			positions[axis] = auxPositions[axis];
+		}
+	}
+	mainDDARing.SetLiveCoordinates(positions);
+	mainDDARing.SetPositions(positions);
+}
+
+#endif
+
 /*static*/ float Move::MotorStepsToMovement(size_t drive, int32_t endpoint)
 {
 	return ((float)(endpoint))/reprap.GetPlatform().DriveStepsPerUnit(drive);
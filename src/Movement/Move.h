@@ -39,6 +39,10 @@ const unsigned int NumDms = 20 * 5;													// suitable for e.g. a delta + 2
 
 #endif
 
+#if SUPPORT_ASYNC_MOVES
+constexpr unsigned int AuxDdaRingLength = 8;										// the ring for the secondary motion channel needs only a little lookahead
+#endif
+
 constexpr uint32_t MovementStartDelayClocks = StepTimer::StepClockRate/100;			// 10ms delay between preparing the first move and starting it
 
 // This is the master movement class.  It controls all movement in the machine.
@@ -56,6 +60,7 @@ public:
 	int32_t GetEndPoint(size_t drive) const;					 	// Get the current position of a motor
 	void LiveCoordinates(float m[MaxTotalDrivers], const Tool *tool);	// Gives the last point at the end of the last complete DDA transformed to user coords
 	void Interrupt() __attribute__ ((hot));							// The hardware's (i.e. platform's)  interrupt should call this.
+	void ScheduleNextStepInterrupt() __attribute__ ((hot));			// Schedule the step interrupt for the earliest step due in any ring
 	bool AllMovesAreFinished();										// Is the look-ahead ring empty?  Stops more moves being added as well.
 	void DoLookAhead() __attribute__ ((hot));						// Run the look-ahead procedure
 	void SetNewPosition(const float positionNow[MaxTotalDrivers], bool doBedCompensation); // Set the current position to be this
@@ -123,9 +128,18 @@ public:
 
 	bool NoLiveMovement() const { return mainDDARing.IsIdle(); }					// Is a move running, or are there any queued?
 
+#if SUPPORT_ASYNC_MOVES
+	bool NoLiveAuxMovement() const { return auxDDARing.IsIdle(); }					// Is a move of the secondary motion channel running, or are there any queued?
+	void GetAuxMachinePosition(float m[MaxAxes]) const { auxDDARing.GetCurrentMachinePosition(m, false); }	// Get the position of the secondary motion channel
+	void CopyPositionToAuxRing();													// Make the position of the secondary motion channel the same as the main one
+	void CopyAxesFromAuxRing(AxesBitmap axes);										// Hand some axes back from the secondary motion channel to the main one
+#endif
+
 	uint32_t GetScheduledMoves() const { return mainDDARing.GetScheduledMoves(); }	// How many moves have been scheduled?
 	uint32_t GetCompletedMoves() const { return mainDDARing.GetCompletedMoves(); }	// How many moves have been completed?
 	void ResetMoveCounters() { mainDDARing.ResetMoveCounters(); }
+	FilePosition GetCompletedFilePosition() const { return mainDDARing.GetCompletedFilePosition(); }	// File position of the last completed move from a file
+	void ClearCompletedFilePosition() { mainDDARing.ClearCompletedFilePosition(); }
 
 	HeightMap& AccessHeightMap() { return heightMap; }								// Access the bed probing grid
 	const GridDefinition& GetGrid() const { return heightMap.GetGrid(); }			// Get the grid definition
@@ -175,8 +189,12 @@ private:
 	void InverseAxisTransform(float move[MaxAxes], const Tool *tool) const;	// Go from an axis transformed point back to user coordinates
 	void SetPositions(const float move[MaxTotalDrivers]) { return mainDDARing.SetPositions(move); }	// Force the machine coordinates to be these;
 	float GetInterpolatedHeightError(float xCoord, float yCoord) const;		// Get the height error at an XY position
+	std::optional<uint32_t> GetNextStepTime() const;						// Return the time that the next step is due in any ring
 
 	DDARing mainDDARing;								// The DDA ring used for regular moves
+#if SUPPORT_ASYNC_MOVES
+	DDARing auxDDARing;									// The DDA ring used for moves from the secondary motion channel
+#endif
 
 	bool active;										// Are we live and running?
 	uint8_t simulationMode;								// Are we simulating, or really printing?
@@ -190,6 +208,9 @@ private:
 
 	unsigned int jerkPolicy;							// When we allow jerk
 	unsigned int idleCount;								// The number of times Spin was called and had no new moves to process
+#if SUPPORT_ASYNC_MOVES
+	unsigned int auxIdleCount;							// The same for the secondary motion channel
+#endif
 	uint32_t longestGcodeWaitInterval;					// the longest we had to wait for a new GCode
 	uint32_t numHiccups;								// How many times we delayed an interrupt to avoid using too much CPU time in interrupts
 
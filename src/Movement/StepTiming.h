@@ -0,0 +1,34 @@
+/*
+ * StepTiming.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Timing rules that the step ISR uses to decide which steps of a DDA ring are due. They don't depend on anything else in the firmware,
+ *  so that Tools/HostTests/StepRingTest.cpp can run two rings through them.
+ */
+
+#ifndef SRC_MOVEMENT_STEPTIMING_H_
+#define SRC_MOVEMENT_STEPTIMING_H_
+
+#include <cstdint>
+
+namespace StepTiming
+{
+	// Return true if a step or the end of a move that is due at 'dueTime' should be handled by a step interrupt at time 'now'.
+	// The step ISR serves all the DDA rings, so it is often called when nothing in a particular ring is due, for example while the first move
+	// of that ring is waiting for its start time. Anything due within 'minInterval' is handled now, because the interrupt can't be scheduled that soon.
+	inline bool IsDue(uint32_t now, uint32_t dueTime, uint32_t minInterval)
+	{
+		return (int32_t)(dueTime - now) <= (int32_t)minInterval;
+	}
+
+	// Return the time since the start of a move up to which a step interrupt at time 'now' should generate steps.
+	// This is only meaningful when IsDue is true for the next step of the move, otherwise it wraps round if the move hasn't started yet.
+	inline uint32_t StepHorizon(uint32_t now, uint32_t moveStartTime, uint32_t minInterval)
+	{
+		return (now - moveStartTime) + minInterval;
+	}
+}
+
+#endif /* SRC_MOVEMENT_STEPTIMING_H_ */
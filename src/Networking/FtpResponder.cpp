@@ -98,13 +98,14 @@ bool FtpResponder::Spin()
 		return false;
 
 	case ResponderState::uploading:
-		DoUpload();
-
-		if (!uploadError && skt->CanRead())
 		{
-			ReadData();			// check for incoming ABOR requests
+			bool didSomething = DoUpload();
+			if (!uploadError && skt->CanRead())
+			{
+				didSomething = ReadData() || didSomething;		// check for incoming ABOR requests
+			}
+			return didSomething;
 		}
-		return true;
 
 	case ResponderState::sendingPasvData:
 		SendPassiveData();
@@ -269,70 +270,32 @@ void FtpResponder::SendPassiveData()
 
 	// If we get here then there are no output buffers left to send
 	// If we have a file to send, send it
-	if (fileBeingSent != nullptr && fileBuffer == nullptr)
+	switch (SendFileData(dataSocket))
 	{
-		fileBuffer = NetworkBuffer::Allocate();
-		if (fileBuffer == nullptr)
-		{
-			return;					// no buffer available, try again later
-		}
-	}
+	case FileSendStatus::sending:
+		return;
 
-	// If we have a file buffer here, we must be in the process of sending a file
-	while (fileBuffer != nullptr)
-	{
-		if (fileBuffer->IsEmpty() && fileBeingSent != nullptr)
+	case FileSendStatus::connectionLost:
+		if (reprap.Debug(moduleWebserver))
 		{
-			const int bytesRead = fileBuffer->ReadFromFile(fileBeingSent);
-			if (bytesRead != (int)NetworkBuffer::bufferSize)
-			{
-				// We had a read error or we reached the end of the file
-				fileBeingSent->Close();
-				fileBeingSent = nullptr;
-			}
+			debugPrintf("Can't send anymore\n");
 		}
 
-		if (fileBuffer->IsEmpty())
+		sendError = true;
+		dataSocket->Terminate();						// so that it no longer refers to our file buffers
+		dataSocket = nullptr;
+		if (fileBeingSent != nullptr)
 		{
-			// Must have sent the whole file
-			fileBuffer->Release();
-			fileBuffer = nullptr;
+			fileBeingSent->Close();
+			fileBeingSent = nullptr;
 		}
-		else
-		{
-			const size_t remaining = fileBuffer->Remaining();
-			const size_t sent = dataSocket->Send(fileBuffer->UnreadData(), remaining);
-			if (sent == 0)
-			{
-				// Check whether the connection has been closed
-				if (!dataSocket->CanSend())
-				{
-					if (reprap.Debug(moduleWebserver))
-					{
-						debugPrintf("Can't send anymore\n");
-					}
+		ReleaseFileBuffers();
 
-					sendError = true;
-					dataSocket = nullptr;
-					if (fileBeingSent != nullptr)
-					{
-						fileBeingSent->Close();
-						fileBeingSent = nullptr;
-					}
-					fileBuffer->Release();
-					fileBuffer = nullptr;
-
-					responderState = ResponderState::pasvTransferComplete;
-				}
-				return;
-			}
+		responderState = ResponderState::pasvTransferComplete;
+		return;
 
-			fileBuffer->Taken(sent);
-			if (sent < remaining)
-			{
-				return;
-			}
-		}
+	case FileSendStatus::finished:
+		break;
 	}
 
 	// If we get here then there is nothing left to send. Close it as well
@@ -343,29 +306,36 @@ void FtpResponder::SendPassiveData()
 	responderState = ResponderState::pasvTransferComplete;
 }
 
-// Write some more upload data
-void FtpResponder::DoUpload()
+// Write some more upload data, returning true if we wrote some or the upload finished
+bool FtpResponder::DoUpload()
 {
 	// Write incoming data to the file
 	const uint8_t *buffer;
 	size_t len;
 	if (dataSocket->ReadBuffer(buffer, len))
 	{
+		// If the storage task is still writing the data we received earlier, leave this data in the socket so that the TCP window closes and the client waits
+		if (!fileBeingUploaded.CanWriteWithoutWaiting(len))
+		{
+			return false;
+		}
+
 		if (reprap.Debug(moduleWebserver))
 		{
 			GetPlatform().MessageF(UsbMessage, "Writing %u bytes of upload data\n", len);
 		}
 
+		const bool ok = fileBeingUploaded.Write(buffer, len);
 		dataSocket->Taken(len);
-		if (!fileBeingUploaded.Write(buffer, len))
+		if (!ok)
 		{
 			uploadError = true;
 			GetPlatform().Message(ErrorMessage, "FTP: could not write upload data\n");
 			CancelUpload();
 
 			responderState = ResponderState::pasvTransferComplete;
-			return;
 		}
+		return true;
 	}
 
 	// Upload has finished if the connection is closed
@@ -375,7 +345,9 @@ void FtpResponder::DoUpload()
 		responderState = ResponderState::pasvTransferComplete;
 
 		FinishUpload(0, 0, false, 0);
+		return true;
 	}
+	return false;
 }
 
 // Try to read some data from the main FTP port and return true
@@ -892,7 +864,14 @@ void FtpResponder::CloseDataPort()
 
 	if (dataSocket != nullptr)
 	{
-		dataSocket->Close();								// close it gracefully
+		if (sentFileBuffers != nullptr || fileBuffer != nullptr)
+		{
+			dataSocket->Terminate();						// the socket may still refer to file data that we are about to release
+		}
+		else
+		{
+			dataSocket->Close();							// close it gracefully
+		}
 		dataSocket = nullptr;
 	}
 	else if (skt != nullptr)
@@ -907,6 +886,7 @@ void FtpResponder::CloseDataPort()
 		fileBeingSent->Close();
 		fileBeingSent = nullptr;
 	}
+	ReleaseFileBuffers();
 }
 
 /*static*/ void FtpResponder::InitStatic()
@@ -39,7 +39,7 @@ protected:
 	bool sendError;
 	void SendPassiveData();
 
-	void DoUpload();
+	bool DoUpload();
 
 	bool ReadData();
 	void CharFromClient(char c);
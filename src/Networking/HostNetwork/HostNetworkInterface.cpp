@@ -0,0 +1,395 @@
+/*
+ * HostNetworkInterface.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ */
+
+#include "HostNetworkInterface.h"
+
+#if HAS_HOST_NETWORKING
+
+#include "HostSocket.h"
+#include "Platform.h"
+#include "RepRap.h"
+#include "General/IP4String.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+HostNetworkInterface::HostNetworkInterface(Platform& p)
+	: platform(p), ftpDataSocket(0), connectionsAccepted(0), state(NetworkState::disabled), activated(false)
+{
+	// Create the sockets
+	for (HostSocket*& skt : sockets)
+	{
+		skt = new HostSocket(this);
+	}
+
+	for (int& fd : listeners)
+	{
+		fd = -1;
+	}
+
+	for (size_t i = 0; i < NumProtocols; ++i)
+	{
+		portNumbers[i] = DefaultPortNumbers[i];
+		protocolEnabled[i] = (i == HttpProtocol);
+	}
+}
+
+#if SUPPORT_OBJECT_MODEL
+
+// Object model table and functions
+// Note: if using GCC version 7.3.1 20180622 and lambda functions are used in this table, you must compile this file with option -std=gnu++17.
+// Otherwise the table will be allocated in RAM instead of flash, which wastes too much RAM.
+
+// Macro to build a standard lambda function that includes the necessary type conversions
+#define OBJECT_MODEL_FUNC(_ret) OBJECT_MODEL_FUNC_BODY(HostNetworkInterface, _ret)
+
+const ObjectModelTableEntry HostNetworkInterface::objectModelTable[] =
+{
+	// These entries must be in alphabetical order
+	{ "ip", OBJECT_MODEL_FUNC(&(self->ipAddress)), TYPE_OF(IPAddress), ObjectModelTableEntry::none },
+	{ "name", OBJECT_MODEL_FUNC_NOSELF("loopback"), TYPE_OF(const char *), ObjectModelTableEntry::none },
+};
+
+DEFINE_GET_OBJECT_MODEL_TABLE(HostNetworkInterface)
+
+#endif
+
+void HostNetworkInterface::Init()
+{
+	interfaceMutex.Create("HostNet");
+
+	const uint8_t loopback[4] = { 127, 0, 0, 1 };
+	ipAddress.SetV4(loopback);
+	memcpy(macAddress, platform.GetDefaultMacAddress(), sizeof(macAddress));
+}
+
+GCodeResult HostNetworkInterface::EnableProtocol(NetworkProtocol protocol, int port, int secure, const StringRef& reply)
+{
+	if (secure != 0 && secure != -1)
+	{
+		reply.copy("this firmware does not support TLS");
+		return GCodeResult::error;
+	}
+
+	if (protocol < NumProtocols)
+	{
+		MutexLocker lock(interfaceMutex);
+
+		const Port portToUse = (port < 0) ? DefaultPortNumbers[protocol] : port;
+		if (portToUse != portNumbers[protocol] || !protocolEnabled[protocol])
+		{
+			portNumbers[protocol] = portToUse;
+			protocolEnabled[protocol] = true;
+			if (state == NetworkState::active)
+			{
+				ResetSockets();
+			}
+		}
+		ReportOneProtocol(protocol, reply);
+		return GCodeResult::ok;
+	}
+
+	reply.copy("Invalid protocol parameter");
+	return GCodeResult::error;
+}
+
+GCodeResult HostNetworkInterface::DisableProtocol(NetworkProtocol protocol, const StringRef& reply)
+{
+	if (protocol < NumProtocols)
+	{
+		MutexLocker lock(interfaceMutex);
+
+		protocolEnabled[protocol] = false;
+		if (state == NetworkState::active)
+		{
+			ResetSockets();
+		}
+		ReportOneProtocol(protocol, reply);
+		return GCodeResult::ok;
+	}
+
+	reply.copy("Invalid protocol parameter");
+	return GCodeResult::error;
+}
+
+// Report the protocols and ports in use
+GCodeResult HostNetworkInterface::ReportProtocols(const StringRef& reply) const
+{
+	reply.Clear();
+	for (size_t i = 0; i < NumProtocols; ++i)
+	{
+		ReportOneProtocol(i, reply);
+	}
+	return GCodeResult::ok;
+}
+
+void HostNetworkInterface::ReportOneProtocol(NetworkProtocol protocol, const StringRef& reply) const
+{
+	if (protocolEnabled[protocol])
+	{
+		reply.lcatf("%s is enabled on port %u", ProtocolNames[protocol], portNumbers[protocol]);
+	}
+	else
+	{
+		reply.lcatf("%s is disabled", ProtocolNames[protocol]);
+	}
+}
+
+// This is called at the end of config.g processing.
+// Start the network if it was enabled
+void HostNetworkInterface::Activate()
+{
+	if (!activated)
+	{
+		activated = true;
+		if (state == NetworkState::enabled)
+		{
+			Start();
+		}
+		else
+		{
+			platform.Message(NetworkInfoMessage, "Network disabled.\n");
+		}
+	}
+}
+
+void HostNetworkInterface::Exit()
+{
+	Stop();
+}
+
+// Get the network state into the reply buffer, returning true if there is some sort of error
+GCodeResult HostNetworkInterface::GetNetworkState(const StringRef& reply)
+{
+	reply.printf("Network is %s, IP address: %s", (EnableState() == 0) ? "disabled" : "enabled", IP4String(ipAddress).c_str());
+	return GCodeResult::ok;
+}
+
+// Update the MAC address
+void HostNetworkInterface::SetMacAddress(const uint8_t mac[])
+{
+	memcpy(macAddress, mac, sizeof(macAddress));
+}
+
+// Start up the network. There is no link to wait for and no address to obtain, so we start listening straight away.
+void HostNetworkInterface::Start()
+{
+	MutexLocker lock(interfaceMutex);
+
+	ResetSockets();
+	state = NetworkState::active;
+	platform.MessageF(NetworkInfoMessage, "Network running, IP address = %s\n", IP4String(ipAddress).c_str());
+}
+
+// Stop the network
+void HostNetworkInterface::Stop()
+{
+	if (state != NetworkState::disabled)
+	{
+		MutexLocker lock(interfaceMutex);
+
+		TerminateSockets();
+		state = NetworkState::disabled;
+	}
+}
+
+// Main spin loop. If 'full' is true then we are being called from the main spin loop. If false then we are being called during HSMCI idle time.
+// Polling a socket that has nothing to do costs only a system call, so we poll all of them every time.
+void HostNetworkInterface::Spin(bool full)
+{
+	if (state == NetworkState::active)
+	{
+		for (HostSocket *skt : sockets)
+		{
+			skt->Poll(full);
+		}
+	}
+}
+
+void HostNetworkInterface::Diagnostics(MessageType mtype)
+{
+	platform.MessageF(mtype, "Interface state %d, %" PRIu32 " connections accepted\n", (int)state, connectionsAccepted);
+}
+
+// Enable or disable the network
+GCodeResult HostNetworkInterface::EnableInterface(int mode, const StringRef& ssid, const StringRef& reply)
+{
+	if (!activated)
+	{
+		state = (mode <= 0) ? NetworkState::disabled : NetworkState::enabled;
+	}
+	else if (mode <= 0)
+	{
+		if (state != NetworkState::disabled)
+		{
+			Stop();
+			platform.Message(NetworkInfoMessage, "Network stopped\n");
+		}
+	}
+	else if (state == NetworkState::disabled)
+	{
+		state = NetworkState::enabled;
+		Start();
+	}
+	return GCodeResult::ok;
+}
+
+int HostNetworkInterface::EnableState() const
+{
+	return (state == NetworkState::disabled) ? 0 : 1;
+}
+
+void HostNetworkInterface::OpenDataPort(Port port)
+{
+	MutexLocker lock(interfaceMutex);
+
+	OpenListener(FtpDataProtocol, port);
+	sockets[ftpDataSocket]->Init(port, FtpDataProtocol);
+}
+
+// Close FTP data port and purge associated resources
+void HostNetworkInterface::TerminateDataPort()
+{
+	MutexLocker lock(interfaceMutex);
+
+	sockets[ftpDataSocket]->Terminate();
+	CloseListener(FtpDataProtocol);
+}
+
+// Accept a pending connection for a protocol, returning the file descriptor of the new host socket or -1 if there is none.
+// The mutex is already owned.
+int HostNetworkInterface::AcceptConnection(NetworkProtocol protocol, IPAddress& remoteIp, Port& remotePort)
+{
+	if (protocol >= NumTcpPorts || listeners[protocol] < 0)
+	{
+		return -1;
+	}
+
+	sockaddr_in addr;
+	socklen_t addrLength = sizeof(addr);
+	const int fd = accept4(listeners[protocol], reinterpret_cast<sockaddr*>(&addr), &addrLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (fd >= 0)
+	{
+		// The responders flush their output with Socket::Send() when they have finished a reply, so don't let the host hold back partly filled segments
+		const int noDelay = 1;
+		(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+		remoteIp.SetV4(reinterpret_cast<const uint8_t*>(&addr.sin_addr.s_addr));
+		remotePort = ntohs(addr.sin_port);
+		++connectionsAccepted;
+	}
+	return fd;
+}
+
+// Start listening for connections to a port on the loopback interface. The mutex is already owned.
+void HostNetworkInterface::OpenListener(NetworkProtocol protocol, Port port)
+{
+	CloseListener(protocol);
+
+	const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		platform.MessageF(ErrorMessage, "Failed to create host socket: %s\n", strerror(errno));
+		return;
+	}
+
+	const int reuse = 1;
+	(void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, NumHostTcpSockets) != 0)
+	{
+		platform.MessageF(ErrorMessage, "Failed to listen on port %u: %s\n", port, strerror(errno));
+		close(fd);
+		return;
+	}
+	listeners[protocol] = fd;
+}
+
+// Stop listening for connections for a protocol. Connections that have already been accepted are not affected. The mutex is already owned.
+void HostNetworkInterface::CloseListener(NetworkProtocol protocol)
+{
+	if (listeners[protocol] >= 0)
+	{
+		close(listeners[protocol]);
+		listeners[protocol] = -1;
+	}
+}
+
+// Note, the following is called to initialise the sockets as well as to reset them. Therefore it must work with sockets that have never been initialised.
+// The mutex is already owned.
+void HostNetworkInterface::ResetSockets()
+{
+	// See how many sockets are available
+	const size_t numFtpSockets = protocolEnabled[FtpProtocol] ? 2 : 0;
+	const size_t numTelnetSockets = protocolEnabled[TelnetProtocol] ? 1 : 0;
+	const size_t numHttpSockets = protocolEnabled[HttpProtocol] ? NumHostTcpSockets - numFtpSockets - numTelnetSockets : 0;
+
+	// Terminate every connection and reinitialize them if applicable
+	TerminateSockets();
+	for (size_t skt = 0; skt < NumHostTcpSockets; ++skt)
+	{
+		if (skt < numHttpSockets)
+		{
+			// HTTP
+			sockets[skt]->Init(portNumbers[HttpProtocol], HttpProtocol);
+		}
+		else if (skt < numHttpSockets + numFtpSockets)
+		{
+			if (skt == numHttpSockets)
+			{
+				// FTP
+				sockets[skt]->Init(portNumbers[FtpProtocol], FtpProtocol);
+			}
+			else
+			{
+				// FTP DATA is initialised during runtime
+				ftpDataSocket = skt;
+			}
+		}
+		else if (skt < numHttpSockets + numFtpSockets + numTelnetSockets)
+		{
+			// Telnet
+			sockets[skt]->Init(portNumbers[TelnetProtocol], TelnetProtocol);
+		}
+	}
+
+	for (size_t protocol = 0; protocol < NumProtocols; ++protocol)
+	{
+		if (protocolEnabled[protocol])
+		{
+			OpenListener(protocol, portNumbers[protocol]);
+		}
+	}
+}
+
+// Terminate every connection and stop listening. The mutex is already owned.
+void HostNetworkInterface::TerminateSockets()
+{
+	for (HostSocket *skt : sockets)
+	{
+		skt->TerminateAndDisable();
+	}
+
+	for (size_t protocol = 0; protocol < NumTcpPorts; ++protocol)
+	{
+		CloseListener(protocol);
+	}
+}
+
+#endif
+
+// End
@@ -0,0 +1,89 @@
+/*
+ * HostNetworkInterface.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Network interface that serves HTTP, FTP and Telnet on the loopback interface of a Linux host using the host's TCP sockets,
+ *  so that the responders can be run and load tested on a PC with standard tools before the firmware is built for a board.
+ *  It is used instead of the board's interface by host builds, which define HAS_HOST_NETWORKING.
+ */
+
+#ifndef SRC_NETWORKING_HOSTNETWORK_HOSTNETWORKINTERFACE_H_
+#define SRC_NETWORKING_HOSTNETWORK_HOSTNETWORKINTERFACE_H_
+
+#include "NetworkInterface.h"
+
+class HostSocket;
+class Platform;
+
+const size_t NumHostTcpSockets = 8;
+
+class HostNetworkInterface : public NetworkInterface
+{
+public:
+	HostNetworkInterface(Platform& p);
+
+	void Init() override;
+	void Activate() override;
+	void Exit() override;
+	void Spin(bool full) override;
+	void Diagnostics(MessageType mtype) override;
+
+	GCodeResult EnableInterface(int mode, const StringRef& ssid, const StringRef& reply) override;			// enable or disable the network
+	GCodeResult EnableProtocol(NetworkProtocol protocol, int port, int secure, const StringRef& reply) override;
+	GCodeResult DisableProtocol(NetworkProtocol protocol, const StringRef& reply) override;
+	GCodeResult ReportProtocols(const StringRef& reply) const override;
+
+	GCodeResult GetNetworkState(const StringRef& reply) override;
+	int EnableState() const override;
+	bool InNetworkStack() const override { return false; }
+	bool IsWiFiInterface() const override { return false; }
+
+	void UpdateHostname(const char *name) override { }
+	IPAddress GetIPAddress() const override { return ipAddress; }
+	void SetIPAddress(IPAddress p_ipAddress, IPAddress p_netmask, IPAddress p_gateway) override { }		// we always use the loopback address
+	void SetMacAddress(const uint8_t mac[]) override;
+	const uint8_t *GetMacAddress() const override { return macAddress; }
+
+	void OpenDataPort(Port port) override;
+	void TerminateDataPort() override;
+
+	int AcceptConnection(NetworkProtocol protocol, IPAddress& remoteIp, Port& remotePort);		// called by sockets that are listening
+
+protected:
+	DECLARE_OBJECT_MODEL
+
+private:
+	enum class NetworkState
+	{
+		disabled,					// Network disabled
+		enabled,					// Network enabled but not started yet
+		active						// network running
+	};
+
+	void Start();
+	void Stop();
+	void ResetSockets();
+	void TerminateSockets();
+	void OpenListener(NetworkProtocol protocol, Port port);
+	void CloseListener(NetworkProtocol protocol);
+
+	void ReportOneProtocol(NetworkProtocol protocol, const StringRef& reply) const
+	pre(protocol < NumProtocols);
+
+	Platform& platform;
+
+	HostSocket *sockets[NumHostTcpSockets];
+	size_t ftpDataSocket;							// number of the socket for FTP DATA connections
+	int listeners[NumTcpPorts];						// file descriptor of the listening host socket for each protocol including FTP DATA, or -1
+	uint32_t connectionsAccepted;
+
+	NetworkState state;
+	bool activated;
+
+	IPAddress ipAddress;
+	uint8_t macAddress[6];
+};
+
+#endif /* SRC_NETWORKING_HOSTNETWORK_HOSTNETWORKINTERFACE_H_ */
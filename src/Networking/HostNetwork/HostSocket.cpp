@@ -0,0 +1,307 @@
+/*
+ * HostSocket.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ */
+
+#include "HostSocket.h"
+
+#if HAS_HOST_NETWORKING
+
+#include "HostNetworkInterface.h"
+#include "Network.h"
+#include "NetworkBuffer.h"
+#include "RepRap.h"
+
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+
+const unsigned int MaxBuffersPerSocket = 4;
+
+HostSocket::HostSocket(NetworkInterface *iface)
+	: Socket(iface), receivedData(nullptr), whenConnected(0), connection(-1)
+{
+}
+
+// Initialise a TCP socket
+void HostSocket::Init(Port serverPort, NetworkProtocol p)
+{
+	localPort = serverPort;
+	protocol = p;
+	ReInit();
+}
+
+void HostSocket::TerminateAndDisable()
+{
+	MutexLocker lock(interface->interfaceMutex);
+
+	Terminate();
+	state = SocketState::disabled;
+}
+
+void HostSocket::ReInit()
+{
+	MutexLocker lock(interface->interfaceMutex);
+
+	DiscardReceivedData();
+	CloseConnection(true);
+	state = SocketState::inactive;
+}
+
+// Close the host socket of the connection, if we have one. If 'reset' is true then the client gets a RST instead of having any unsent data delivered.
+void HostSocket::CloseConnection(bool reset)
+{
+	if (connection >= 0)
+	{
+		if (reset)
+		{
+			const linger lingerOption = { 1, 0 };
+			(void)setsockopt(connection, SOL_SOCKET, SO_LINGER, &lingerOption, sizeof(lingerOption));
+		}
+		close(connection);
+		connection = -1;
+	}
+}
+
+// Close a connection when the last packet has been sent. The host finishes sending the data after we close the host socket.
+void HostSocket::Close()
+{
+	MutexLocker lock(interface->interfaceMutex);
+
+	if (state != SocketState::disabled && state != SocketState::inactive)
+	{
+		CloseConnection(false);
+		state = SocketState::closing;
+		DiscardReceivedData();
+		if (protocol == FtpDataProtocol)
+		{
+			localPort = 0;					// don't re-listen automatically
+		}
+	}
+}
+
+// Terminate a connection immediately
+void HostSocket::Terminate()
+{
+	MutexLocker lock(interface->interfaceMutex);
+
+	if (state != SocketState::disabled)
+	{
+		CloseConnection(true);
+		state = SocketState::inactive;
+		DiscardReceivedData();
+	}
+}
+
+// Return true if there is or may soon be more data to read
+bool HostSocket::CanRead() const
+{
+	return (state == SocketState::connected)
+		|| (state == SocketState::clientDisconnecting && receivedData != nullptr && receivedData->TotalRemaining() != 0);
+}
+
+bool HostSocket::CanSend() const
+{
+	return state == SocketState::connected;
+}
+
+// Read 1 character from the receive buffers, returning true if successful
+bool HostSocket::ReadChar(char& c)
+{
+	if (receivedData != nullptr)
+	{
+		MutexLocker lock(interface->interfaceMutex);
+
+		const bool ret = receivedData->ReadChar(c);
+		if (receivedData->IsEmpty())
+		{
+			receivedData = receivedData->Release();
+		}
+		return ret;
+	}
+
+	c = 0;
+	return false;
+}
+
+// Return a pointer to data in a buffer and a length available
+bool HostSocket::ReadBuffer(const uint8_t *&buffer, size_t &len)
+{
+	if (receivedData != nullptr)
+	{
+		len = receivedData->Remaining();
+		buffer = receivedData->UnreadData();
+		return true;
+	}
+
+	return false;
+}
+
+// Flag some data as taken from the receive buffers. We never take data from more than one buffer at a time.
+void HostSocket::Taken(size_t len)
+{
+	if (receivedData != nullptr)
+	{
+		receivedData->Taken(len);
+		if (receivedData->IsEmpty())
+		{
+			receivedData = receivedData->Release();		// discard empty buffer at head of chain
+		}
+	}
+}
+
+// Poll a socket to see if it needs to be serviced
+void HostSocket::Poll(bool full)
+{
+	if (state != SocketState::disabled)
+	{
+		MutexLocker lock(interface->interfaceMutex);
+
+		switch (state)
+		{
+		case SocketState::inactive:
+			if (localPort != 0)			// localPort for the FTP data socket is 0 until we have decided what port number to use
+			{
+				state = SocketState::listening;
+			}
+			break;
+
+		case SocketState::listening:
+			if (connection < 0)
+			{
+				connection = static_cast<HostNetworkInterface*>(interface)->AcceptConnection(protocol, remoteIPAddress, remotePort);
+				if (connection < 0)
+				{
+					break;
+				}
+				whenConnected = millis();
+			}
+
+			if (full)
+			{
+				if (reprap.GetNetwork().FindResponder(this, protocol))
+				{
+					state = SocketState::connected;
+					ReceiveData();
+				}
+				else if (millis() - whenConnected >= FindResponderTimeout)
+				{
+					if (reprap.Debug(moduleNetwork))
+					{
+						debugPrintf("Timed out waiting for responder for port %u\n", localPort);
+					}
+					Terminate();
+				}
+			}
+			break;
+
+		case SocketState::connected:
+			ReceiveData();
+			break;
+
+		case SocketState::closing:
+		case SocketState::aborted:
+			ReInit();
+			break;
+
+		case SocketState::clientDisconnecting:
+		default:
+			break;
+		}
+	}
+}
+
+// Try to receive more incoming data from the host socket. The mutex is already owned.
+// We only read as much as we have buffers for, so that the host applies TCP flow control to the client when the responder isn't taking the data.
+void HostSocket::ReceiveData()
+{
+	for (;;)
+	{
+		NetworkBuffer *buf = NetworkBuffer::FindLast(receivedData);
+		const bool newBuffer = (buf == nullptr || buf->SpaceLeft() == 0);
+		if (newBuffer)
+		{
+			if (NetworkBuffer::Count(receivedData) >= MaxBuffersPerSocket)
+			{
+				return;
+			}
+			buf = NetworkBuffer::Allocate();
+			if (buf == nullptr)
+			{
+				return;
+			}
+		}
+
+		const ssize_t len = recv(connection, buf->UnwrittenData(), buf->SpaceLeft(), MSG_DONTWAIT);
+		if (len > 0)
+		{
+			buf->DataWritten((size_t)len);
+			if (newBuffer)
+			{
+				NetworkBuffer::AppendToList(&receivedData, buf);
+			}
+			if (reprap.Debug(moduleNetwork))
+			{
+				debugPrintf("Received %u bytes\n", (unsigned int)len);
+			}
+			continue;
+		}
+
+		if (newBuffer)
+		{
+			buf->Release();
+		}
+
+		if (len == 0)
+		{
+			state = SocketState::clientDisconnecting;		// the client has asked to disconnect
+		}
+		else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		{
+			CloseConnection(true);
+			state = SocketState::aborted;
+		}
+		return;
+	}
+}
+
+// Discard any received data for this transaction. The mutex is already owned.
+void HostSocket::DiscardReceivedData()
+{
+	while (receivedData != nullptr)
+	{
+		receivedData = receivedData->Release();
+	}
+}
+
+// Send the data, returning the length buffered. The host copies the data, so we never refer to it after returning.
+size_t HostSocket::Send(const uint8_t *data, size_t length)
+{
+	MutexLocker lock(interface->interfaceMutex);
+
+	if (CanSend() && length != 0)
+	{
+		const ssize_t sent = send(connection, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (sent >= 0)
+		{
+			return (size_t)sent;
+		}
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		{
+			CloseConnection(true);
+			state = SocketState::aborted;
+		}
+	}
+	return 0;
+}
+
+// Tell the interface to send the outstanding data. Nagle's algorithm is disabled on the connection, so the host has already started sending it.
+void HostSocket::Send()
+{
+}
+
+#endif
+
+// End
@@ -0,0 +1,45 @@
+/*
+ * HostSocket.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ */
+
+#ifndef SRC_NETWORKING_HOSTNETWORK_HOSTSOCKET_H_
+#define SRC_NETWORKING_HOSTNETWORK_HOSTSOCKET_H_
+
+#include "RepRapFirmware.h"
+#include "NetworkDefs.h"
+#include "Socket.h"
+
+// Socket that tracks a TCP connection made to the loopback interface of a Linux host
+class HostSocket : public Socket
+{
+public:
+	HostSocket(NetworkInterface *iface);
+	void Init(Port serverPort, NetworkProtocol p);
+
+	void Poll(bool full) override;
+	void Close() override;
+	void Terminate() override;
+	void TerminateAndDisable() override;
+	bool ReadChar(char& c) override;
+	bool ReadBuffer(const uint8_t *&buffer, size_t &len) override;
+	void Taken(size_t len) override;
+	bool CanRead() const override;
+	bool CanSend() const override;
+	size_t Send(const uint8_t *data, size_t length) override;
+	void Send() override;
+
+private:
+	void ReInit();
+	void ReceiveData();
+	void DiscardReceivedData();
+	void CloseConnection(bool reset);
+
+	NetworkBuffer *receivedData;						// List of buffers holding received data
+	uint32_t whenConnected;
+	int connection;										// File descriptor of the connected host socket, or -1 if there is no connection
+};
+
+#endif /* SRC_NETWORKING_HOSTNETWORK_HOSTSOCKET_H_ */
@@ -0,0 +1,419 @@
+/*
+ * HttpRequestParser.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ */
+
+#include "HttpRequestParser.h"
+
+const char* const overflowResponse = "overflow";
+const char* const badEscapeResponse = "bad escape";
+
+// Reset the parse state variables ready to receive a request
+void HttpRequestParser::Reset()
+{
+	clientPointer = 0;
+	parseState = HttpParseState::doingCommandWord;
+	numCommandWords = 0;
+	numQualKeys = 0;
+	numHeaderKeys = 0;
+	commandWords[0] = clientMessage;
+	rejectReason = nullptr;
+}
+
+// Process a block of characters from the client, setting 'consumed' to the number of characters used.
+// Return the status as CharFromClient does. When the request is complete, the characters after the end of it are not consumed.
+// Most of a request is header keys and values, so we find the end of each of these with memchr and copy it in one go. Everything else goes to CharFromClient.
+HttpRequestParser::Status HttpRequestParser::CharsFromClient(const char *data, size_t len, size_t& consumed)
+{
+	const char * const end = data + len;
+	const char *p = data;
+	while (p != end)
+	{
+		if (parseState == HttpParseState::doingHeaderKey || parseState == HttpParseState::doingHeaderValue)
+		{
+			const char *runEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+			if (runEnd == nullptr)
+			{
+				runEnd = end;
+			}
+			if (parseState == HttpParseState::doingHeaderKey)
+			{
+				const char * const colon = static_cast<const char*>(memchr(p, ':', runEnd - p));
+				if (colon != nullptr)
+				{
+					runEnd = colon;
+				}
+			}
+			const char * const cr = static_cast<const char*>(memchr(p, '\r', runEnd - p));
+			if (cr != nullptr)
+			{
+				runEnd = cr;									// leave the '\r' to CharFromClient, which ignores it
+			}
+
+			const size_t runLength = runEnd - p;
+			if (runLength != 0)
+			{
+				if (runLength >= ARRAY_SIZE(clientMessage) - clientPointer)
+				{
+					consumed = len;
+					return Reject(overflowResponse);
+				}
+				memcpy(clientMessage + clientPointer, p, runLength);
+				clientPointer += runLength;
+				p = runEnd;
+				continue;
+			}
+		}
+
+		const Status status = CharFromClient(*p++);
+		if (status != Status::needMore)
+		{
+			consumed = p - data;
+			return status;
+		}
+	}
+
+	consumed = len;
+	return Status::needMore;
+}
+
+// Process a character from the client
+// Rewritten as a state machine by dc42 to increase capability and speed, and reduce RAM requirement.
+// On entry:
+//  There is space for at least 1 character in clientMessage.
+// On return:
+//	If we return needMore:
+//		We want more characters. There is space for at least 1 character in clientMessage.
+//	If we return complete:
+//		We have received the whole request. No more characters may be read from this message.
+//		The first line has been split up into words. Variables numCommandWords and commandWords give the number of words we found
+//		and the pointers to each word. The second word is treated specially. It is assumed to be a filename followed by an optional
+//		qualifier comprising key/value pairs. Both may include %xx escapes, and the qualifier may include + to mean space. We store
+//		a pointer to the filename without qualifier in commandWords[1]. We store the qualifier key/value pointers in array 'qualifiers'
+//		and the number of them in numQualKeys.
+//		The remaining lines have been parsed as header name/value pairs. Pointers to them are stored in array 'headers' and the number
+//		of them in numHeaderKeys.
+//	If we return rejected:
+//		One of our arrays was about to overflow, or the message is not in a format we expect. GetRejectReason returns the reason.
+HttpRequestParser::Status HttpRequestParser::CharFromClient(char c)
+{
+	switch (parseState)
+	{
+	case HttpParseState::doingCommandWord:
+		switch(c)
+		{
+		case '\n':
+			clientMessage[clientPointer++] = 0;
+			++numCommandWords;
+			numHeaderKeys = 0;
+			headers[0].key = clientMessage + clientPointer;
+			parseState = HttpParseState::doingHeaderKey;
+			break;
+		case '\r':
+			break;
+		case ' ':
+		case '\t':
+			clientMessage[clientPointer++] = 0;
+			{
+				++numCommandWords;
+				if (numCommandWords < MaxCommandWords)
+				{
+					commandWords[numCommandWords] = clientMessage + clientPointer;
+					if (numCommandWords == 1)
+					{
+						parseState = HttpParseState::doingFilename;
+					}
+				}
+				else
+				{
+					return Reject("too many command words");
+				}
+			}
+			break;
+		default:
+			clientMessage[clientPointer++] = c;
+			break;
+		}
+		break;
+
+	case HttpParseState::doingFilename:
+		switch(c)
+		{
+		case '\n':
+			clientMessage[clientPointer++] = 0;
+			++numCommandWords;
+			numQualKeys = 0;
+			numHeaderKeys = 0;
+			headers[0].key = clientMessage + clientPointer;
+			parseState = HttpParseState::doingHeaderKey;
+			break;
+		case '?':
+			clientMessage[clientPointer++] = 0;
+			++numCommandWords;
+			numQualKeys = 0;
+			qualifiers[0].key = clientMessage + clientPointer;
+			parseState = HttpParseState::doingQualifierKey;
+			break;
+		case '%':
+			parseState = HttpParseState::doingFilenameEsc1;
+			break;
+		case '\r':
+			break;
+		case ' ':
+		case '\t':
+			clientMessage[clientPointer++] = 0;
+			{
+				++numCommandWords;
+				if (numCommandWords < MaxCommandWords)
+				{
+					commandWords[numCommandWords] = clientMessage + clientPointer;
+					parseState = HttpParseState::doingCommandWord;
+				}
+				else
+				{
+					return Reject("too many command words");
+				}
+			}
+			break;
+		default:
+			clientMessage[clientPointer++] = c;
+			break;
+		}
+		break;
+
+	case HttpParseState::doingQualifierKey:
+		switch(c)
+		{
+		case '=':
+			clientMessage[clientPointer++] = 0;
+			qualifiers[numQualKeys].value = clientMessage + clientPointer;
+			++numQualKeys;
+			parseState = HttpParseState::doingQualifierValue;
+			break;
+		case '\n':	// key with no value
+		case ' ':
+		case '\t':
+		case '\r':
+			// IE11 sometimes puts a trailing '?' at the end of a GET request e.g. "GET /fonts/glyphicons.eot? HTTP/1.1"
+			if (numQualKeys == 0 && qualifiers[0].key == clientMessage + clientPointer)
+			{
+				commandWords[numCommandWords] = clientMessage + clientPointer;	// we have only 2 command words so far, so no need to check numCommandWords here
+				parseState = HttpParseState::doingCommandWord;
+				break;
+			}
+			// no break
+		case '%':	// none of our keys needs escaping, so treat an escape within a key as an error
+		case '&':	// key with no value
+			return Reject("bad qualifier key");
+		default:
+			clientMessage[clientPointer++] = c;
+			break;
+		}
+		break;
+
+	case HttpParseState::doingQualifierValue:
+		switch(c)
+		{
+		case '\n':
+			clientMessage[clientPointer++] = 0;
+			qualifiers[numQualKeys].key = clientMessage + clientPointer;	// so that we can read the whole value even if it contains a null
+			numHeaderKeys = 0;
+			headers[0].key = clientMessage + clientPointer;
+			parseState = HttpParseState::doingHeaderKey;
+			break;
+		case ' ':
+		case '\t':
+			clientMessage[clientPointer++] = 0;
+			qualifiers[numQualKeys].key = clientMessage + clientPointer;	// so that we can read the whole value even if it contains a null
+			commandWords[numCommandWords] = clientMessage + clientPointer;
+			parseState = HttpParseState::doingCommandWord;
+			break;
+		case '\r':
+			break;
+		case '%':
+			parseState = HttpParseState::doingQualifierValueEsc1;
+			break;
+		case '&':
+			// Another variable is coming
+			clientMessage[clientPointer++] = 0;
+			qualifiers[numQualKeys].key = clientMessage + clientPointer;	// so that we can read the whole value even if it contains a null
+			if (numQualKeys < MaxQualKeys)
+			{
+				parseState = HttpParseState::doingQualifierKey;
+			}
+			else
+			{
+				return Reject("too many keys in qualifier");
+			}
+			break;
+		case '+':
+			clientMessage[clientPointer++] = ' ';
+			break;
+		default:
+			clientMessage[clientPointer++] = c;
+			break;
+		}
+		break;
+
+	case HttpParseState::doingFilenameEsc1:
+	case HttpParseState::doingQualifierValueEsc1:
+		if (c >= '0' && c <= '9')
+		{
+			decodeChar = (c - '0') << 4;
+			parseState = (HttpParseState)((int)parseState + 1);
+		}
+		else if (c >= 'A' && c <= 'F')
+		{
+			decodeChar = (c - ('A' - 10)) << 4;
+			parseState = (HttpParseState)((int)parseState + 1);
+		}
+		else
+		{
+			return Reject(badEscapeResponse);
+		}
+		break;
+
+	case HttpParseState::doingFilenameEsc2:
+	case HttpParseState::doingQualifierValueEsc2:
+		if (c >= '0' && c <= '9')
+		{
+			clientMessage[clientPointer++] = decodeChar | (c - '0');
+			parseState = (HttpParseState)((int)parseState - 2);
+		}
+		else if (c >= 'A' && c <= 'F')
+		{
+			clientMessage[clientPointer++] = decodeChar | (c - ('A' - 10));
+			parseState = (HttpParseState)((int)parseState - 2);
+		}
+		else
+		{
+			return Reject(badEscapeResponse);
+		}
+		break;
+
+	case HttpParseState::doingHeaderKey:
+		switch(c)
+		{
+		case '\n':
+			if (clientMessage + clientPointer == headers[numHeaderKeys].key)	// if the key hasn't started yet, then this is the blank line at the end
+			{
+				return Status::complete;
+			}
+			else
+			{
+				return Reject("unexpected newline");
+			}
+			break;
+		case '\r':
+			break;
+		case ':':
+			if (numHeaderKeys == MaxHeaders - 1)
+			{
+				return Reject("too many header key-value pairs");
+			}
+			clientMessage[clientPointer++] = 0;
+			headers[numHeaderKeys].value = clientMessage + clientPointer;
+			++numHeaderKeys;
+			parseState = HttpParseState::expectingHeaderValue;
+			break;
+		default:
+			clientMessage[clientPointer++] = c;
+			break;
+		}
+		break;
+
+	case HttpParseState::expectingHeaderValue:
+		if (c == ' ' || c == '\t')
+		{
+			break;		// ignore spaces between header key and value
+		}
+		parseState = HttpParseState::doingHeaderValue;
+		// no break
+
+	case HttpParseState::doingHeaderValue:
+		if (c == '\n')
+		{
+			parseState = HttpParseState::doingHeaderContinuation;
+		}
+		else if (c != '\r')
+		{
+			clientMessage[clientPointer++] = c;
+		}
+		break;
+
+	case HttpParseState::doingHeaderContinuation:
+		switch(c)
+		{
+		case ' ':
+		case '\t':
+			// It's a continuation of the previous value
+			clientMessage[clientPointer++] = c;
+			parseState = HttpParseState::doingHeaderValue;
+			break;
+		case '\n':
+			// It's the blank line
+			clientMessage[clientPointer] = 0;
+			return Status::complete;
+		case '\r':
+			break;
+		default:
+			// It's a new key
+			if (clientPointer + 3 <= ARRAY_SIZE(clientMessage))
+			{
+				clientMessage[clientPointer++] = 0;
+				headers[numHeaderKeys].key = clientMessage + clientPointer;
+				clientMessage[clientPointer++] = c;
+				parseState = HttpParseState::doingHeaderKey;
+			}
+			else
+			{
+				return Reject(overflowResponse);
+			}
+			break;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	if (clientPointer == ARRAY_SIZE(clientMessage))
+	{
+		return Reject(overflowResponse);
+	}
+	return Status::needMore;
+}
+
+const char* HttpRequestParser::GetKeyValue(const char *key) const
+{
+	for (size_t i = 0; i < numQualKeys; ++i)
+	{
+		if (StringEqualsIgnoreCase(qualifiers[i].key, key))
+		{
+			return qualifiers[i].value;
+		}
+	}
+	return nullptr;
+}
+
+const char* HttpRequestParser::GetHeaderValue(const char *key) const
+{
+	for (size_t i = 0; i < numHeaderKeys; ++i)
+	{
+		if (StringEqualsIgnoreCase(headers[i].key, key))
+		{
+			return headers[i].value;
+		}
+	}
+	return nullptr;
+}
+
+// Return true if the request is an HTTP/1.1 request
+bool HttpRequestParser::IsHttp11Request() const
+{
+	return numCommandWords >= 3 && StringEqualsIgnoreCase(commandWords[2], "HTTP/1.1");
+}
+
+// End
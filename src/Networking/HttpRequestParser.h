@@ -0,0 +1,93 @@
+/*
+ * HttpRequestParser.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Parser for the request line and headers of an HTTP request, split out of HttpResponder so that it depends on nothing but the characters it is given.
+ *  The request is stored in a single buffer, and the command words, qualifier key/value pairs and header key/value pairs point into it.
+ */
+
+#ifndef SRC_NETWORKING_HTTPREQUESTPARSER_H_
+#define SRC_NETWORKING_HTTPREQUESTPARSER_H_
+
+#include "RepRapFirmware.h"
+
+class HttpRequestParser
+{
+public:
+	static const uint16_t WebMessageLength = 1460;		// maximum length of the web message we accept after decoding
+	static const size_t MaxCommandWords = 4;			// max number of space-separated words in the command
+	static const size_t MaxQualKeys = 5;				// max number of key/value pairs in the qualifier
+	static const size_t MaxHeaders = 30;				// max number of key/value pairs in the headers
+
+	enum class Status : uint8_t
+	{
+		needMore,					// we want more characters
+		complete,					// we have received the blank line at the end of the headers
+		rejected					// the request is malformed or too long, and GetRejectReason says why
+	};
+
+	HttpRequestParser() { Reset(); }
+
+	void Reset();												// get ready to receive a new request
+	bool IsEmpty() const { return clientPointer == 0; }			// true if no part of the request has arrived
+	Status CharsFromClient(const char *data, size_t len, size_t& consumed);
+	Status CharFromClient(char c);
+	const char *GetRejectReason() const { return rejectReason; }
+
+	size_t GetNumCommandWords() const { return numCommandWords; }
+	const char *GetCommandWord(size_t n) const { return commandWords[n]; }
+	size_t GetNumQualifiers() const { return numQualKeys; }
+	const char *GetQualifierKey(size_t n) const { return qualifiers[n].key; }
+	const char *GetQualifierValue(size_t n) const { return qualifiers[n].value; }
+	size_t GetNumHeaders() const { return numHeaderKeys; }
+	const char *GetHeaderKey(size_t n) const { return headers[n].key; }
+	const char *GetHeaderValue(size_t n) const { return headers[n].value; }
+
+	const char* GetKeyValue(const char *key) const;				// return the value of the specified qualifier key, or nullptr if not present
+	const char* GetHeaderValue(const char *key) const;			// return the value of the specified header, or nullptr if not present
+	bool IsHttp11Request() const;
+
+private:
+	enum class HttpParseState
+	{
+		doingCommandWord,			// receiving a word in the first line of the HTTP request
+		doingFilename,				// receiving the filename (second word in the command line)
+		doingFilenameEsc1,			// received '%' in the filename (e.g. we are being asked for a filename with spaces in it)
+		doingFilenameEsc2,			// received '%' and one hex digit in the filename
+		doingQualifierKey,			// receiving a key name in the HTTP request
+		doingQualifierValue,		// receiving a key value in the HTTP request
+		doingQualifierValueEsc1,	// received '%' in the qualifier
+		doingQualifierValueEsc2,	// received '%' and one hex digit in the qualifier
+		doingHeaderKey,				// receiving a header key
+		expectingHeaderValue,		// expecting a header value
+		doingHeaderValue,			// receiving a header value
+		doingHeaderContinuation		// received a newline after a header value
+	};
+
+	struct KeyValueIndices
+	{
+		const char* key;
+		const char* value;
+	};
+
+	Status Reject(const char *reason) { rejectReason = reason; return Status::rejected; }
+
+	HttpParseState parseState;
+
+	// Buffer for processing HTTP input
+	char clientMessage[WebMessageLength + 3];		// holds the command, qualifier, and headers
+	size_t clientPointer;							// current index into clientMessage
+	char decodeChar;								// the character we are decoding in a URL-encoded argument
+
+	const char* commandWords[MaxCommandWords];
+	KeyValueIndices qualifiers[MaxQualKeys + 1];	// offsets into clientQualifier of the key/value pairs, the +1 is needed so that values can contain nulls
+	KeyValueIndices headers[MaxHeaders];			// offsets into clientHeader of the key/value pairs
+	size_t numCommandWords;
+	size_t numQualKeys;								// number of qualifier keys we have found, <= maxQualKeys
+	size_t numHeaderKeys;							// number of keys we have found, <= maxHeaders
+	const char *rejectReason;
+};
+
+#endif /* SRC_NETWORKING_HTTPREQUESTPARSER_H_ */
@@ -7,14 +7,13 @@
 
 #include "HttpResponder.h"
 #include "Socket.h"
+#include "Network.h"
 #include "GCodes/GCodes.h"
 #include "General/IP4String.h"
 
 #define KO_START "rr_"
 const size_t KoFirst = 3;
 
-const char* const overflowResponse = "overflow";
-const char* const badEscapeResponse = "bad escape";
 const char serviceUnavailableResponse[] = "HTTP/1.1 503 Service Unavailable\r\n\r\n";
 static_assert(ARRAY_SIZE(serviceUnavailableResponse) <= OUTPUT_BUFFER_SIZE, "OUTPUT_BUFFER_SIZE too small");
 
@@ -32,7 +31,7 @@ const char* const ErrorPagePart2 =
 	"</p>\n"
 	"</body>\n";
 
-HttpResponder::HttpResponder(NetworkResponder *n) : UploadingNetworkResponder(n)
+HttpResponder::HttpResponder(NetworkResponder *n) : UploadingNetworkResponder(n), eventToSend(nullptr), eventPart(nullptr), eventOffset(0)
 {
 }
 
@@ -44,14 +43,8 @@ bool HttpResponder::Accept(Socket *s, NetworkProtocol protocol)
 		responderState = ResponderState::reading;
 		skt = s;
 		timer = millis();
-
-		// Reset the parse state variables
-		clientPointer = 0;
-		parseState = HttpParseState::doingCommandWord;
-		numCommandWords = 0;
-		numQualKeys = 0;
-		numHeaderKeys = 0;
-		commandWords[0] = clientMessage;
+		keepAlive = awaitingNextRequest = false;
+		parser.Reset();
 
 		if (reprap.Debug(moduleWebserver))
 		{
@@ -62,6 +55,23 @@ bool HttpResponder::Accept(Socket *s, NetworkProtocol protocol)
 	return false;
 }
 
+// If we are keeping a connection open but the client hasn't started sending another request on it, close it so that this responder can serve a new connection
+bool HttpResponder::ReleaseIdleConnection(NetworkProtocol protocol)
+{
+	if (responderState == ResponderState::reading && protocol == HttpProtocol && IsIdle())
+	{
+		skt->Close();
+		skt = nullptr;
+		responderState = ResponderState::free;
+		if (reprap.Debug(moduleWebserver))
+		{
+			debugPrintf("HTTP idle connection released\n");
+		}
+		return true;
+	}
+	return false;
+}
+
 // Do some work, returning true if we did anything significant
 bool HttpResponder::Spin()
 {
@@ -73,11 +83,23 @@ bool HttpResponder::Spin()
 	case ResponderState::reading:
 		{
 			bool readSomething = false;
-			char c;
-			while (skt->ReadChar(c))
+			const uint8_t *buffer;
+			size_t len;
+			while (skt->ReadBuffer(buffer, len))
 			{
-				if (CharFromClient(c))
+				size_t consumed;
+				const HttpRequestParser::Status status = parser.CharsFromClient(reinterpret_cast<const char*>(buffer), len, consumed);
+				skt->Taken(consumed);		// leave anything after the end of the message, which may be the next pipelined request
+				if (status != HttpRequestParser::Status::needMore)
 				{
+					if (status == HttpRequestParser::Status::complete)
+					{
+						ProcessMessage();
+					}
+					else
+					{
+						RejectMessage(parser.GetRejectReason());
+					}
 					timer = millis();		// restart the timeout
 					return true;
 				}
@@ -91,7 +113,18 @@ bool HttpResponder::Spin()
 				return true;
 			}
 
-			if (!skt->CanRead() || millis() - timer >= HttpReceiveTimeout)
+			if (IsIdle())
+			{
+				// We are keeping the connection open for another request
+				if (!skt->CanRead() || millis() - timer >= HttpKeepAliveTimeout)
+				{
+					skt->Close();
+					skt = nullptr;
+					responderState = ResponderState::free;
+					return true;
+				}
+			}
+			else if (!skt->CanRead() || millis() - timer >= HttpReceiveTimeout)
 			{
 				ConnectionLost();
 				return true;
@@ -109,345 +142,26 @@ bool HttpResponder::Spin()
 		return true;
 
 	case ResponderState::uploading:
-		DoUpload();
-		return true;
+		return DoUpload();
 
 	case ResponderState::sending:
 		SendData();
 		return true;
 
+	case ResponderState::streamingEvents:
+		return SendEvents();
+
 	default:	// should not happen
 		return false;
 	}
 }
 
-// Process a character from the client
-// Rewritten as a state machine by dc42 to increase capability and speed, and reduce RAM requirement.
-// On entry:
-//  There is space for at least 1 character in clientMessage.
-// On return:
-//	If we return false:
-//		We want more characters. There is space for at least 1 character in clientMessage.
-//	If we return true:
-//		We have processed the message and sent the reply. No more characters may be read from this message.
-// Whenever this calls ProcessMessage:
-//	The first line has been split up into words. Variables numCommandWords and commandWords give the number of words we found
-//  and the pointers to each word. The second word is treated specially. It is assumed to be a filename followed by an optional
-//  qualifier comprising key/value pairs. Both may include %xx escapes, and the qualifier may include + to mean space. We store
-//  a pointer to the filename without qualifier in commandWords[1]. We store the qualifier key/value pointers in array 'qualifiers'
-//  and the number of them in numQualKeys.
-//  The remaining lines have been parsed as header name/value pairs. Pointers to them are stored in array 'headers' and the number
-//  of them in numHeaders.
-// If one of our arrays is about to overflow, or the message is not in a format we expect, then we call RejectMessage with an
-// appropriate error code and string.
-bool HttpResponder::CharFromClient(char c)
-{
-	switch (parseState)
-	{
-	case HttpParseState::doingCommandWord:
-		switch(c)
-		{
-		case '\n':
-			clientMessage[clientPointer++] = 0;
-			++numCommandWords;
-			numHeaderKeys = 0;
-			headers[0].key = clientMessage + clientPointer;
-			parseState = HttpParseState::doingHeaderKey;
-			break;
-		case '\r':
-			break;
-		case ' ':
-		case '\t':
-			clientMessage[clientPointer++] = 0;
-			{
-				++numCommandWords;
-				if (numCommandWords < MaxCommandWords)
-				{
-					commandWords[numCommandWords] = clientMessage + clientPointer;
-					if (numCommandWords == 1)
-					{
-						parseState = HttpParseState::doingFilename;
-					}
-				}
-				else
-				{
-					RejectMessage("too many command words");
-					return true;
-				}
-			}
-			break;
-		default:
-			clientMessage[clientPointer++] = c;
-			break;
-		}
-		break;
-
-	case HttpParseState::doingFilename:
-		switch(c)
-		{
-		case '\n':
-			clientMessage[clientPointer++] = 0;
-			++numCommandWords;
-			numQualKeys = 0;
-			numHeaderKeys = 0;
-			headers[0].key = clientMessage + clientPointer;
-			parseState = HttpParseState::doingHeaderKey;
-			break;
-		case '?':
-			clientMessage[clientPointer++] = 0;
-			++numCommandWords;
-			numQualKeys = 0;
-			qualifiers[0].key = clientMessage + clientPointer;
-			parseState = HttpParseState::doingQualifierKey;
-			break;
-		case '%':
-			parseState = HttpParseState::doingFilenameEsc1;
-			break;
-		case '\r':
-			break;
-		case ' ':
-		case '\t':
-			clientMessage[clientPointer++] = 0;
-			{
-				++numCommandWords;
-				if (numCommandWords < MaxCommandWords)
-				{
-					commandWords[numCommandWords] = clientMessage + clientPointer;
-					parseState = HttpParseState::doingCommandWord;
-				}
-				else
-				{
-					RejectMessage("too many command words");
-					return true;
-				}
-			}
-			break;
-		default:
-			clientMessage[clientPointer++] = c;
-			break;
-		}
-		break;
-
-	case HttpParseState::doingQualifierKey:
-		switch(c)
-		{
-		case '=':
-			clientMessage[clientPointer++] = 0;
-			qualifiers[numQualKeys].value = clientMessage + clientPointer;
-			++numQualKeys;
-			parseState = HttpParseState::doingQualifierValue;
-			break;
-		case '\n':	// key with no value
-		case ' ':
-		case '\t':
-		case '\r':
-			// IE11 sometimes puts a trailing '?' at the end of a GET request e.g. "GET /fonts/glyphicons.eot? HTTP/1.1"
-			if (numQualKeys == 0 && qualifiers[0].key == clientMessage + clientPointer)
-			{
-				commandWords[numCommandWords] = clientMessage + clientPointer;	// we have only 2 command words so far, so no need to check numCommandWords here
-				parseState = HttpParseState::doingCommandWord;
-				break;
-			}
-			// no break
-		case '%':	// none of our keys needs escaping, so treat an escape within a key as an error
-		case '&':	// key with no value
-			RejectMessage("bad qualifier key");
-			return true;
-		default:
-			clientMessage[clientPointer++] = c;
-			break;
-		}
-		break;
-
-	case HttpParseState::doingQualifierValue:
-		switch(c)
-		{
-		case '\n':
-			clientMessage[clientPointer++] = 0;
-			qualifiers[numQualKeys].key = clientMessage + clientPointer;	// so that we can read the whole value even if it contains a null
-			numHeaderKeys = 0;
-			headers[0].key = clientMessage + clientPointer;
-			parseState = HttpParseState::doingHeaderKey;
-			break;
-		case ' ':
-		case '\t':
-			clientMessage[clientPointer++] = 0;
-			qualifiers[numQualKeys].key = clientMessage + clientPointer;	// so that we can read the whole value even if it contains a null
-			commandWords[numCommandWords] = clientMessage + clientPointer;
-			parseState = HttpParseState::doingCommandWord;
-			break;
-		case '\r':
-			break;
-		case '%':
-			parseState = HttpParseState::doingQualifierValueEsc1;
-			break;
-		case '&':
-			// Another variable is coming
-			clientMessage[clientPointer++] = 0;
-			qualifiers[numQualKeys].key = clientMessage + clientPointer;	// so that we can read the whole value even if it contains a null
-			if (numQualKeys < MaxQualKeys)
-			{
-				parseState = HttpParseState::doingQualifierKey;
-			}
-			else
-			{
-				RejectMessage("too many keys in qualifier");
-				return true;
-			}
-			break;
-		case '+':
-			clientMessage[clientPointer++] = ' ';
-			break;
-		default:
-			clientMessage[clientPointer++] = c;
-			break;
-		}
-		break;
-
-	case HttpParseState::doingFilenameEsc1:
-	case HttpParseState::doingQualifierValueEsc1:
-		if (c >= '0' && c <= '9')
-		{
-			decodeChar = (c - '0') << 4;
-			parseState = (HttpParseState)((int)parseState + 1);
-		}
-		else if (c >= 'A' && c <= 'F')
-		{
-			decodeChar = (c - ('A' - 10)) << 4;
-			parseState = (HttpParseState)((int)parseState + 1);
-		}
-		else
-		{
-			RejectMessage(badEscapeResponse);
-			return true;
-		}
-		break;
-
-	case HttpParseState::doingFilenameEsc2:
-	case HttpParseState::doingQualifierValueEsc2:
-		if (c >= '0' && c <= '9')
-		{
-			clientMessage[clientPointer++] = decodeChar | (c - '0');
-			parseState = (HttpParseState)((int)parseState - 2);
-		}
-		else if (c >= 'A' && c <= 'F')
-		{
-			clientMessage[clientPointer++] = decodeChar | (c - ('A' - 10));
-			parseState = (HttpParseState)((int)parseState - 2);
-		}
-		else
-		{
-			RejectMessage(badEscapeResponse);
-			return true;
-		}
-		break;
-
-	case HttpParseState::doingHeaderKey:
-		switch(c)
-		{
-		case '\n':
-			if (clientMessage + clientPointer == headers[numHeaderKeys].key)	// if the key hasn't started yet, then this is the blank line at the end
-			{
-				ProcessMessage();
-				return true;
-			}
-			else
-			{
-				RejectMessage("unexpected newline");
-				return true;
-			}
-			break;
-		case '\r':
-			break;
-		case ':':
-			if (numHeaderKeys == MaxHeaders - 1)
-			{
-				RejectMessage("too many header key-value pairs");
-				return true;
-			}
-			clientMessage[clientPointer++] = 0;
-			headers[numHeaderKeys].value = clientMessage + clientPointer;
-			++numHeaderKeys;
-			parseState = HttpParseState::expectingHeaderValue;
-			break;
-		default:
-			clientMessage[clientPointer++] = c;
-			break;
-		}
-		break;
-
-	case HttpParseState::expectingHeaderValue:
-		if (c == ' ' || c == '\t')
-		{
-			break;		// ignore spaces between header key and value
-		}
-		parseState = HttpParseState::doingHeaderValue;
-		// no break
-
-	case HttpParseState::doingHeaderValue:
-		if (c == '\n')
-		{
-			parseState = HttpParseState::doingHeaderContinuation;
-		}
-		else if (c != '\r')
-		{
-			clientMessage[clientPointer++] = c;
-		}
-		break;
-
-	case HttpParseState::doingHeaderContinuation:
-		switch(c)
-		{
-		case ' ':
-		case '\t':
-			// It's a continuation of the previous value
-			clientMessage[clientPointer++] = c;
-			parseState = HttpParseState::doingHeaderValue;
-			break;
-		case '\n':
-			// It's the blank line
-			clientMessage[clientPointer] = 0;
-			ProcessMessage();
-			return true;
-		case '\r':
-			break;
-		default:
-			// It's a new key
-			if (clientPointer + 3 <= ARRAY_SIZE(clientMessage))
-			{
-				clientMessage[clientPointer++] = 0;
-				headers[numHeaderKeys].key = clientMessage + clientPointer;
-				clientMessage[clientPointer++] = c;
-				parseState = HttpParseState::doingHeaderKey;
-			}
-			else
-			{
-				RejectMessage(overflowResponse);
-				return true;
-			}
-			break;
-		}
-		break;
-
-	default:
-		break;
-	}
-
-	if (clientPointer == ARRAY_SIZE(clientMessage))
-	{
-		RejectMessage(overflowResponse);
-		return true;
-	}
-	return false;
-}
-
 // Get the Json response for this command.
 // 'value' is null-terminated, but we also pass its length in case it contains embedded nulls, which matters when uploading files.
 // Return true if we generated a json response to send, false if we didn't and changed the state instead.
 // This may also return true with response == nullptr if we tried to generate a response but ran out of buffers.
-bool HttpResponder::GetJsonResponse(const char* request, OutputBuffer *&response, bool& keepOpen)
+bool HttpResponder::GetJsonResponse(const char* request, OutputBuffer *&response)
 {
-	keepOpen = false;	// assume we don't want to persist the connection
 	if (StringEqualsIgnoreCase(request, "connect") && GetKeyValue("password") != nullptr)
 	{
 		if (!CheckAuthenticated())
@@ -506,8 +220,12 @@ bool HttpResponder::GetJsonResponse(const char* request, OutputBuffer *&response
 				type = 1;
 			}
 
+			// If the client gives the sequence number from its last response, send only the fields that have changed since then
+			const char * const sinceString = GetKeyValue("since");
 			OutputBuffer::Release(response);
-			response = reprap.GetStatusResponse(type, ResponseSource::HTTP);		// this may return nullptr
+			response = (sinceString != nullptr)
+						? reprap.GetStatusDeltaResponse(type, SafeStrtoul(sinceString))
+							: reprap.GetStatusResponse(type, ResponseSource::HTTP);		// this may return nullptr
 		}
 		else
 		{
@@ -599,6 +317,15 @@ bool HttpResponder::GetJsonResponse(const char* request, OutputBuffer *&response
 		OutputBuffer::Release(response);
 		response = reprap.GetConfigResponse();
 	}
+#if SUPPORT_OBJECT_MODEL
+	else if (StringEqualsIgnoreCase(request, "modelpaths") && (GetKeyValue("paths") != nullptr || GetKeyValue("reset") != nullptr))
+	{
+		OutputBuffer::Release(response);
+		const char* const resetVal = GetKeyValue("reset");
+		const bool reset = resetVal != nullptr && SafeStrtol(resetVal) == 1;
+		response = reprap.GetModelPathsResponse(GetKeyValue("paths"), reset);	// this may return nullptr
+	}
+#endif
 	else
 	{
 		RejectMessage("Unknown request", 500);
@@ -608,18 +335,6 @@ bool HttpResponder::GetJsonResponse(const char* request, OutputBuffer *&response
 	return true;
 }
 
-const char* HttpResponder::GetKeyValue(const char *key) const
-{
-	for (size_t i = 0; i < numQualKeys; ++i)
-	{
-		if (StringEqualsIgnoreCase(qualifiers[i].key, key))
-		{
-			return qualifiers[i].value;
-		}
-	}
-	return nullptr;
-}
-
 // Called to process a FileInfo request, which may take several calls
 // Return true if complete
 bool HttpResponder::SendFileInfo(bool quitEarly)
@@ -637,7 +352,7 @@ bool HttpResponder::SendFileInfo(bool quitEarly)
 						"Content-Type: application/json\r\n"
 					);
 		outBuf->catf("Content-Length: %u\r\n", (jsonResponse != nullptr) ? jsonResponse->Length() : 0);
-		outBuf->cat("Connection: close\r\n\r\n");
+		AddConnectionHeader();
 		outBuf->Append(jsonResponse);
 		if (outBuf->HadOverflow())
 		{
@@ -648,12 +363,92 @@ bool HttpResponder::SendFileInfo(bool quitEarly)
 		else
 		{
 			filenameBeingProcessed.Clear();
-			Commit();
+			CommitResponse();
 		}
 	}
 	return gotFileInfo;
 }
 
+// Start sending the file list for rr_files or rr_filelist. We send the listing from the requested first entry to the end of the directory
+// using chunked transfer encoding, generating each chunk when the previous one has been sent. So the length of the listing isn't limited
+// by the number of output buffers, and the client doesn't need to ask for the next page. Only HTTP/1.1 clients support chunked encoding.
+void HttpResponder::StartFileList(bool detailed)
+{
+	const char *dir = GetKeyValue("dir");
+	if (dir == nullptr)
+	{
+		dir = GetPlatform().GetGCodeDir();
+	}
+	filenameBeingProcessed.copy(dir);
+	const char* const firstVal = GetKeyValue("first");
+	const unsigned int startAt = (firstVal == nullptr) ? 0 : (unsigned int)SafeStrtol(firstVal);
+	const char* const flagDirsVal = GetKeyValue("flagDirs");
+	const bool flagDirs = !detailed && flagDirsVal != nullptr && SafeStrtol(flagDirsVal) == 1;
+	fileList.Start(filenameBeingProcessed.c_str(), startAt, detailed, flagDirs);
+
+	outBuf->copy(	"HTTP/1.1 200 OK\r\n"
+					"Cache-Control: no-cache, no-store, must-revalidate\r\n"
+					"Pragma: no-cache\r\n"
+					"Expires: 0\r\n"
+					"Access-Control-Allow-Origin: *\r\n"
+					"Content-Type: application/json\r\n"
+					"Transfer-Encoding: chunked\r\n"
+				);
+	AddConnectionHeader();
+	CommitResponse();
+}
+
+// This overrides the version in class NetworkResponder. Generate the next chunk of the file list that we are sending.
+bool HttpResponder::GenerateMoreData(OutputBuffer *&buf)
+{
+	if (fileList.IsFinished())
+	{
+		return false;
+	}
+
+	buf = nullptr;
+	OutputBuffer *chunk;
+	if (!OutputBuffer::Allocate(chunk))
+	{
+		return true;						// try again later
+	}
+
+	// The chunk starts with its length in hex. We don't know it yet, so we write zeros and fill them in later. Leading zeros are allowed.
+	static_assert(MaxFileListChunkLength < 0x10000, "Chunk length doesn't fit in 4 hex digits");
+	chunk->copy("0000\r\n");
+	const size_t headerLength = chunk->Length();
+	const size_t ChunkTrailerLength = 7;		// "\r\n" at the end of the chunk and "0\r\n\r\n" if it is the last one
+	const size_t maxBytes = min<size_t>(MaxFileListChunkLength, OutputBuffer::GetBytesLeft(chunk));
+	const bool finished = fileList.Generate(chunk, (maxBytes > ChunkTrailerLength) ? maxBytes - ChunkTrailerLength : 0, false);
+	const size_t dataLength = chunk->Length() - headerLength;
+	if (dataLength == 0)
+	{
+		// There wasn't enough buffer space for the next entry. We mustn't send an empty chunk, because that marks the end of the response.
+		OutputBuffer::Release(chunk);
+		return true;
+	}
+
+	static const char hexDigits[] = "0123456789abcdef";
+	for (size_t i = 0; i < 4; ++i)
+	{
+		(*chunk)[i] = hexDigits[(dataLength >> (12 - 4 * i)) & 0x0F];
+	}
+	chunk->cat((finished) ? "\r\n0\r\n\r\n" : "\r\n");
+
+	if (chunk->HadOverflow())
+	{
+		// We lost part of the listing, so the best we can do is to close the connection so that the client knows that the response is incomplete
+		OutputBuffer::ReleaseAll(chunk);
+		ReportOutputBufferExhaustion(__FILE__, __LINE__);
+		fileList.Abandon();
+		stateAfterSending = ResponderState::free;
+		return false;
+	}
+
+	buf = chunk;
+	return true;
+}
+
 // Authenticate current IP and return true on success
 bool HttpResponder::Authenticate()
 {
@@ -717,6 +512,7 @@ void HttpResponder::SendFile(const char* nameOfFileToSend, bool isWebFile)
 {
 	FileStore *fileToSend = nullptr;
 	bool zip = false;
+	String<StringLength20> etag;
 
 	if (isWebFile)
 	{
@@ -731,26 +527,28 @@ void HttpResponder::SendFile(const char* nameOfFileToSend, bool isWebFile)
 			nameOfFileToSend = INDEX_PAGE_FILE;
 		}
 
+		// Find the file without opening it, so that if the browser already has the current version we can tell it so without reading the file
+		String<MaxFilenameLength> gzName;
+		FileInfo info;
+		bool found = false;
 		for (;;)
 		{
-			// Try to open a gzipped version of the file first
+			// Try a gzipped version of the file first
 			if (!StringEndsWithIgnoreCase(nameOfFileToSend, ".gz") && strlen(nameOfFileToSend) + 3 <= MaxFilenameLength)
 			{
-				String<MaxFilenameLength> nameBuf;
-				nameBuf.copy(nameOfFileToSend);
-				nameBuf.cat(".gz");
-				fileToSend = GetPlatform().OpenFile(GetPlatform().GetWebDir(), nameBuf.c_str(), OpenMode::read);
-				if (fileToSend != nullptr)
+				gzName.copy(nameOfFileToSend);
+				gzName.cat(".gz");
+				if (GetWebFileInfo(gzName.c_str(), info))
 				{
-					zip = true;
+					zip = found = true;
 					break;
 				}
 			}
 
-			// That failed, so try to open the normal version of the file
-			fileToSend = GetPlatform().OpenFile(GetPlatform().GetWebDir(), nameOfFileToSend, OpenMode::read);
-			if (fileToSend != nullptr)
+			// That failed, so try the normal version of the file
+			if (GetWebFileInfo(nameOfFileToSend, info))
 			{
+				found = true;
 				break;
 			}
 
@@ -768,11 +566,30 @@ void HttpResponder::SendFile(const char* nameOfFileToSend, bool isWebFile)
 			}
 		}
 
+		if (found)
+		{
+			// The entity tag is made from the size and date of the file. If the browser sent us the same one then its cached copy is current.
+			etag.printf("\"%08" PRIx32 "%08" PRIx32 "%s\"", info.size, (uint32_t)info.lastModified, (zip) ? "z" : "");
+			const char * const ifNoneMatch = GetHeaderValue("If-None-Match");
+			if (ifNoneMatch != nullptr && strstr(ifNoneMatch, etag.c_str()) != nullptr)
+			{
+				outBuf->copy("HTTP/1.1 304 Not Modified\r\n");
+				AddWebCacheHeaders(nameOfFileToSend, etag.c_str());
+				AddConnectionHeader();
+				CommitResponse();
+				return;
+			}
+
+			fileToSend = GetPlatform().OpenFile(GetPlatform().GetWebDir(), (zip) ? gzName.c_str() : nameOfFileToSend, OpenMode::read);
+		}
+
 		// If we still couldn't find the file and it was an HTML file, return the 404 error page
 		if (fileToSend == nullptr && (StringEndsWithIgnoreCase(nameOfFileToSend, ".html") || StringEndsWithIgnoreCase(nameOfFileToSend, ".htm")))
 		{
 			nameOfFileToSend = FOUR04_PAGE_FILE;
 			fileToSend = GetPlatform().OpenFile(GetPlatform().GetWebDir(), nameOfFileToSend, OpenMode::read);
+			zip = false;
+			etag.Clear();
 		}
 
 		if (fileToSend == nullptr)
@@ -795,7 +612,14 @@ void HttpResponder::SendFile(const char* nameOfFileToSend, bool isWebFile)
 	outBuf->copy("HTTP/1.1 200 OK\r\n");
 
 	// Don't cache files served by rr_download
-	if (!isWebFile)
+	if (isWebFile)
+	{
+		if (!etag.IsEmpty())
+		{
+			AddWebCacheHeaders(nameOfFileToSend, etag.c_str());
+		}
+	}
+	else
 	{
 		outBuf->cat(	"Cache-Control: no-cache, no-store, must-revalidate\r\n"
 						"Pragma: no-cache\r\n"
@@ -846,8 +670,32 @@ void HttpResponder::SendFile(const char* nameOfFileToSend, bool isWebFile)
 	}
 
 	outBuf->catf("Content-Length: %lu\r\n", fileToSend->Length());
-	outBuf->cat("Connection: close\r\n\r\n");
-	Commit();
+	AddConnectionHeader();
+	CommitResponse();
+}
+
+// Get the size and date of a file in the web directory. Return false if it doesn't exist or is a directory.
+bool HttpResponder::GetWebFileInfo(const char *filename, FileInfo& info) const
+{
+	String<MaxFilenameLength> path;
+	return MassStorage::CombineName(path.GetRef(), GetPlatform().GetWebDir(), filename)
+		&& GetPlatform().GetMassStorage()->StatFile(path.c_str(), info)
+		&& !info.isDirectory;
+}
+
+// Add the entity tag and caching headers for a web file. HTML pages must be checked with us each time they are used, so that a new version
+// of the web interface is picked up, but other files can be used from the browser cache for a while without checking them.
+void HttpResponder::AddWebCacheHeaders(const char *filename, const char *etag)
+{
+	outBuf->catf("ETag: %s\r\n", etag);
+	if (StringEndsWithIgnoreCase(filename, ".htm") || StringEndsWithIgnoreCase(filename, ".html"))
+	{
+		outBuf->cat("Cache-Control: no-cache\r\n");
+	}
+	else
+	{
+		outBuf->catf("Cache-Control: max-age=%" PRIu32 "\r\n", WebFileMaxAge);
+	}
 }
 
 void HttpResponder::SendGCodeReply()
@@ -887,7 +735,7 @@ void HttpResponder::SendGCodeReply()
 						"Content-Type: text/plain\r\n"
 					);
 		outBuf->catf("Content-Length: %u\r\n", gcodeReply.DataLength());
-		outBuf->cat("Connection: close\r\n\r\n");
+		AddConnectionHeader();
 		outStack.Append(gcodeReply);
 
 		// Possibly clean up the G-code reply once again
@@ -897,9 +745,48 @@ void HttpResponder::SendGCodeReply()
 		}
 	}
 
-	Commit();
+	CommitResponse();
 }
 
+#if SUPPORT_OBJECT_MODEL
+
+// Handle rr_modelvalues. The client gets the handles by registering object model paths with rr_modelpaths, and we send the values in the binary form
+// described in RepRap::GetModelValuesResponse, which costs much less to generate and to parse than the JSON status responses.
+void HttpResponder::SendModelValues()
+{
+	OutputBuffer *values = reprap.GetModelValuesResponse(GetKeyValue("handles"));
+	if (values == nullptr || values->HadOverflow())
+	{
+		OutputBuffer::ReleaseAll(values);
+		if (millis() - startedProcessingRequestAt >= MaxBufferWaitTime)
+		{
+			ReportOutputBufferExhaustion(__FILE__, __LINE__);
+			outBuf->copy(serviceUnavailableResponse);
+			Commit(ResponderState::free, false);
+		}
+		return;									// else try again later
+	}
+
+	outBuf->copy(	"HTTP/1.1 200 OK\r\n"
+					"Cache-Control: no-cache, no-store, must-revalidate\r\n"
+					"Pragma: no-cache\r\n"
+					"Expires: 0\r\n"
+					"Access-Control-Allow-Origin: *\r\n"
+					"Content-Type: application/octet-stream\r\n"
+				);
+	outBuf->catf("Content-Length: %u\r\n", values->Length());
+	AddConnectionHeader();
+	outBuf->Append(values);
+	if (outBuf->HadOverflow())
+	{
+		OutputBuffer::ReleaseAll(outBuf);		// we ran out of buffers, so try again later
+		return;
+	}
+	CommitResponse(false);
+}
+
+#endif
+
 // Send a JSON response to the current command. outBuf is non-null on entry.
 void HttpResponder::SendJsonResponse(const char* command)
 {
@@ -918,6 +805,30 @@ void HttpResponder::SendJsonResponse(const char* command)
 			return;
 		}
 
+		if (StringEqualsIgnoreCase(command, "events"))		// rr_events
+		{
+			StartEvents();
+			return;
+		}
+
+#if SUPPORT_OBJECT_MODEL
+		if (StringEqualsIgnoreCase(command, "modelvalues") && GetKeyValue("handles") != nullptr)
+		{
+			SendModelValues();
+			return;
+		}
+#endif
+
+		if (   IsHttp11Request()
+			&& (   StringEqualsIgnoreCase(command, "files")
+				|| (StringEqualsIgnoreCase(command, "filelist") && GetKeyValue("dir") != nullptr)
+			   )
+		   )
+		{
+			StartFileList(StringEqualsIgnoreCase(command, "filelist"));
+			return;
+		}
+
 		if (StringEqualsIgnoreCase(command, "download"))
 		{
 			const char* const filename = GetKeyValue("name");
@@ -931,10 +842,9 @@ void HttpResponder::SendJsonResponse(const char* command)
 
 	// Try to process a request for JSON responses
 	OutputBuffer *jsonResponse;
-	bool mayKeepOpen;
 	if (OutputBuffer::Allocate(jsonResponse))
 	{
-		const bool gotResponse = GetJsonResponse(command, jsonResponse, mayKeepOpen);
+		const bool gotResponse = GetJsonResponse(command, jsonResponse);
 		if (!gotResponse)
 		{
 			// GetJsonResponse() changed the state instead of returning a response
@@ -979,26 +889,11 @@ void HttpResponder::SendJsonResponse(const char* command)
 	}
 
 	// Send the JSON response
-	bool keepOpen = false;
-	if (mayKeepOpen)
-	{
-		// Check that the browser wants to persist the connection too
-		for (size_t i = 0; i < numHeaderKeys; ++i)
-		{
-			if (StringEqualsIgnoreCase(headers[i].key, "Connection"))
-			{
-				// Comment out the following line to disable persistent connections
-				keepOpen = StringEqualsIgnoreCase(headers[i].value, "keep-alive");
-				break;
-			}
-		}
-	}
-
 	// Note that when using RTOS the following response should preferably be small enough to fit in a single buffer.
 	// This is because the current task may get suspended e.g. when reading from SD card to build a file list,
 	// so other tasks may allocate buffers meanwhile, and the previous mechanism for ensuring that there is sufficient
 	// buffer space remaining don't work.
-	// This response is currently about 230 bytes long in the worst case.
+	// This response is currently about 250 bytes long in the worst case.
 	outBuf->copy(	"HTTP/1.1 200 OK\r\n"
 					"Cache-Control: no-cache, no-store, must-revalidate\r\n"
 					"Pragma: no-cache\r\n"
@@ -1008,7 +903,7 @@ void HttpResponder::SendJsonResponse(const char* command)
 				);
 	const unsigned int replyLength = (jsonResponse != nullptr) ? jsonResponse->Length() : 0;
 	outBuf->catf("Content-Length: %u\r\n", replyLength);
-	outBuf->catf("Connection: %s\r\n\r\n", keepOpen ? "keep-alive" : "close");
+	AddConnectionHeader();
 	outBuf->Append(jsonResponse);
 
 	if (outBuf->HadOverflow())
@@ -1043,7 +938,7 @@ void HttpResponder::SendJsonResponse(const char* command)
 	}
 
 	// Here if everything is OK
-	Commit(keepOpen ? ResponderState::reading : ResponderState::free, false);
+	CommitResponse(false);
 	if (reprap.Debug(moduleWebserver))
 	{
 		debugPrintf("Sending JSON reply, length %u\n", replyLength);
@@ -1057,19 +952,26 @@ void HttpResponder::ProcessMessage()
 	{
 		Platform& p = GetPlatform();
 		p.MessageF(UsbMessage, "HTTP req, command words {");
-		for (size_t i = 0; i < numCommandWords; ++i)
+		for (size_t i = 0; i < parser.GetNumCommandWords(); ++i)
 		{
-			p.MessageF(UsbMessage, " %s", commandWords[i]);
+			p.MessageF(UsbMessage, " %s", parser.GetCommandWord(i));
 		}
 		p.Message(UsbMessage, " }, parameters {");
 
-		for (size_t i = 0; i < numQualKeys; ++i)
+		for (size_t i = 0; i < parser.GetNumQualifiers(); ++i)
 		{
-			p.MessageF(UsbMessage, " %s=%s", qualifiers[i].key, qualifiers[i].value);
+			p.MessageF(UsbMessage, " %s=%s", parser.GetQualifierKey(i), parser.GetQualifierValue(i));
 		}
 		p.Message(UsbMessage, " }\n");
 	}
 
+	// HTTP/1.1 connections are persistent unless the client asks us to close them. HTTP/1.0 connections are persistent only if the client asks for it.
+	const char * const connection = GetHeaderValue("Connection");
+	keepAlive = (connection != nullptr && StringEqualsIgnoreCase(connection, "close")) ? false
+				: (connection != nullptr && StringEqualsIgnoreCase(connection, "keep-alive")) ? true
+					: IsHttp11Request();
+	awaitingNextRequest = false;
+
 	responderState = ResponderState::processingRequest;
 	startedProcessingRequestAt = millis();
 }
@@ -1077,7 +979,7 @@ void HttpResponder::ProcessMessage()
 // Process the message received. We have reached the end of the headers.
 void HttpResponder::ProcessRequest()
 {
-	if (numCommandWords < 2)
+	if (parser.GetNumCommandWords() < 2)
 	{
 		RejectMessage("too few command words");
 		return;
@@ -1086,24 +988,24 @@ void HttpResponder::ProcessRequest()
 	// Reserve an output buffer before we process the request, or we won't be able to reply
 	if (outBuf != nullptr || OutputBuffer::Allocate(outBuf))
 	{
-		if (StringEqualsIgnoreCase(commandWords[0], "GET"))
+		if (StringEqualsIgnoreCase(parser.GetCommandWord(0), "GET"))
 		{
-			if (StringStartsWith(commandWords[1], KO_START))
+			if (StringStartsWith(parser.GetCommandWord(1), KO_START))
 			{
-				SendJsonResponse(commandWords[1] + KoFirst);
+				SendJsonResponse(parser.GetCommandWord(1) + KoFirst);
 			}
-			else if (commandWords[1][0] == '/' && StringStartsWith(commandWords[1] + 1, KO_START))
+			else if (parser.GetCommandWord(1)[0] == '/' && StringStartsWith(parser.GetCommandWord(1) + 1, KO_START))
 			{
-				SendJsonResponse(commandWords[1] + 1 + KoFirst);
+				SendJsonResponse(parser.GetCommandWord(1) + 1 + KoFirst);
 			}
 			else
 			{
-				SendFile(commandWords[1], true);
+				SendFile(parser.GetCommandWord(1), true);
 			}
 			return;
 		}
 
-		if (StringEqualsIgnoreCase(commandWords[0], "OPTIONS"))
+		if (StringEqualsIgnoreCase(parser.GetCommandWord(0), "OPTIONS"))
 		{
 			outBuf->copy(	"HTTP/1.1 200 OK\r\n"
 							"Allow: OPTIONS, GET, POST\r\n"
@@ -1113,8 +1015,8 @@ void HttpResponder::ProcessRequest()
 							"Access-Control-Allow-Origin: *\r\n"
 							"Access-Control-Allow-Headers: Content-Type\r\n"
 							"Content-Length: 0\r\n"
-							"\r\n"
 						);
+			AddConnectionHeader();
 			if (outBuf->HadOverflow())
 			{
 				OutputBuffer::ReleaseAll(outBuf);
@@ -1122,38 +1024,28 @@ void HttpResponder::ProcessRequest()
 			}
 			else
 			{
-				Commit();
+				CommitResponse();
 			}
 			return;
 		}
 
-		if (CheckAuthenticated() && StringEqualsIgnoreCase(commandWords[0], "POST"))
+		if (CheckAuthenticated() && StringEqualsIgnoreCase(parser.GetCommandWord(0), "POST"))
 		{
-			const bool isUploadRequest = (StringEqualsIgnoreCase(commandWords[1], KO_START "upload"))
-									  || (commandWords[1][0] == '/' && StringEqualsIgnoreCase(commandWords[1] + 1, KO_START "upload"));
+			const bool isUploadRequest = (StringEqualsIgnoreCase(parser.GetCommandWord(1), KO_START "upload"))
+									  || (parser.GetCommandWord(1)[0] == '/' && StringEqualsIgnoreCase(parser.GetCommandWord(1) + 1, KO_START "upload"));
 			if (isUploadRequest)
 			{
 				const char* const filename = GetKeyValue("name");
 				if (filename != nullptr)
 				{
 					// See how many bytes we expect to read
-					bool contentLengthFound = false;
-					for (size_t i = 0; i < numHeaderKeys; i++)
-					{
-						if (StringEqualsIgnoreCase(headers[i].key, "Content-Length"))
-						{
-							postFileLength = atoi(headers[i].value);
-							contentLengthFound = true;
-							break;
-						}
-					}
-
-					// Start POST file upload
-					if (!contentLengthFound)
+					const char * const contentLength = GetHeaderValue("Content-Length");
+					if (contentLength == nullptr)
 					{
 						RejectMessage("invalid POST upload request");
 						return;
 					}
+					postFileLength = atoi(contentLength);
 
 					// Try to get the expected CRC
 					const char* const expectedCrc = GetKeyValue("crc32");
@@ -1252,32 +1144,47 @@ void HttpResponder::RejectMessage(const char* response, unsigned int code)
 
 // This function overrides the one in class NetworkResponder.
 // It tries to process a chunk of uploaded data and changes the state if finished.
-void HttpResponder::DoUpload()
+// Return true if we did anything significant.
+bool HttpResponder::DoUpload()
 {
 	const uint8_t *buffer;
 	size_t len;
 	if (skt->ReadBuffer(buffer, len))
 	{
-		skt->Taken(len);
-		uploadedBytes += len;
-
+		len = min<size_t>(len, postFileLength - uploadedBytes);		// leave any data that follows the upload for the next request
 		(void)CheckAuthenticated();							// uploading may take a long time, so make sure the requester IP is not timed out
-		timer = millis();									// reset the timer
 
-		if (!fileBeingUploaded.Write(buffer, len))
+		// If the storage task is still writing the data we received earlier, leave this data in the socket so that the TCP window closes and the client waits.
+		// Meanwhile the other responders get served, instead of all of them waiting while we wait for the SD card.
+		if (!fileBeingUploaded.CanWriteWithoutWaiting(len))
+		{
+			if (millis() - timer < HttpSessionTimeout)
+			{
+				return false;
+			}
+			ConnectionLost();								// the SD card hasn't accepted any data for too long
+			return true;
+		}
+
+		const bool ok = fileBeingUploaded.Write(buffer, len);
+		skt->Taken(len);									// the data may be released when we have taken it, so don't do this until we have written it
+		uploadedBytes += len;
+		timer = millis();									// reset the timer
+		if (!ok)
 		{
 			uploadError = true;
+			keepAlive = false;								// the rest of the upload data is still to come, so we must close the connection after replying
 			GetPlatform().Message(ErrorMessage, "HTTP: could not write upload data\n");
 			CancelUpload();
 			SendJsonResponse("upload");
-			return;
+			return true;
 		}
 	}
 	else if (!skt->CanRead() || millis() - timer >= HttpSessionTimeout)
 	{
 		// Sometimes uploads can get stuck; make sure they are cancelled when that happens
 		ConnectionLost();
-		return;
+		return true;
 	}
 
 	// See if the upload has finished
@@ -1298,6 +1205,7 @@ void HttpResponder::DoUpload()
 		FinishUpload(postFileLength, fileLastModified, postFileGotCrc, postFileExpectedCrc);
 		SendJsonResponse("upload");
 	}
+	return true;
 }
 
 // This is called to force termination if we implement the specified protocol
@@ -1333,8 +1241,228 @@ void HttpResponder::SendData()
 	NetworkResponder::SendData();
 	if (responderState == ResponderState::reading)
 	{
+		// We have sent the response and kept the connection open, so get ready for the next request. The client may already have sent it.
 		timer = millis();				// restart the timer
+		awaitingNextRequest = true;
+		parser.Reset();
+	}
+}
+
+// This overrides the version in class UploadingNetworkResponder
+void HttpResponder::ConnectionLost()
+{
+	if (responderState == ResponderState::streamingEvents)
+	{
+		--numEventStreams;
 	}
+	ReleaseEvent();
+	fileList.Abandon();
+	UploadingNetworkResponder::ConnectionLost();
+}
+
+// Handle rr_events. The client receives the status every statusPushInterval milliseconds as a server-sent event of type "status",
+// and new G-code replies as events of type "reply", until it closes the connection. The optional "interval" parameter sets statusPushInterval,
+// which is shared by all the clients because they are all sent the same status document.
+// An event stream holds its responder for as long as the client is connected, so we always keep one responder free for other requests.
+void HttpResponder::StartEvents()
+{
+	if (numEventStreams >= NumHttpResponders - 1)
+	{
+		outBuf->copy(serviceUnavailableResponse);
+		Commit(ResponderState::free, false);
+		return;
+	}
+
+	const char * const intervalString = GetKeyValue("interval");
+	if (intervalString != nullptr)
+	{
+		statusPushInterval = max<uint32_t>(SafeStrtoul(intervalString), MinStatusPushInterval);
+	}
+
+	outBuf->copy(	"HTTP/1.1 200 OK\r\n"
+					"Cache-Control: no-cache\r\n"
+					"Access-Control-Allow-Origin: *\r\n"
+					"Content-Type: text/event-stream\r\n"
+					"Connection: keep-alive\r\n"
+					"\r\n"
+				);
+	statusSeqSent = pushedStatusSeq - 1;						// so that we send the current status straight away
+	replySeqSent = seq;											// send only the replies that arrive from now on
+	++numEventStreams;
+	Commit(ResponderState::streamingEvents);
+}
+
+// Send the next event to a client that has subscribed to events, returning true if we did anything significant
+bool HttpResponder::SendEvents()
+{
+	if (eventToSend == nullptr)
+	{
+		if (!skt->CanSend() || !CheckAuthenticated())				// this also stops the session timing out
+		{
+			ConnectionLost();
+			return true;
+		}
+
+		if (!QueueReplyEvents())
+		{
+			UpdatePushedStatus();
+			if (pushedStatus == nullptr || statusSeqSent == pushedStatusSeq)
+			{
+				return false;
+			}
+			pushedStatus->IncreaseReferences(1);
+			eventToSend = pushedStatus;
+			statusSeqSent = pushedStatusSeq;
+		}
+		eventPart = eventToSend;
+		eventOffset = 0;
+	}
+
+	// We can't send an event with NetworkResponder::SendData because the status event is shared with other responders, so we can't use its read pointer
+	while (eventPart != nullptr)
+	{
+		const size_t remaining = eventPart->DataLength() - eventOffset;
+		if (remaining != 0)
+		{
+			const size_t sent = skt->Send(reinterpret_cast<const uint8_t *>(eventPart->Data() + eventOffset), remaining);
+			if (sent == 0)
+			{
+				if (!skt->CanSend())
+				{
+					ConnectionLost();
+					return true;
+				}
+				return false;
+			}
+			eventOffset += sent;
+			if (sent < remaining)
+			{
+				return true;
+			}
+		}
+		eventPart = eventPart->Next();
+		eventOffset = 0;
+	}
+
+	skt->Send();													// tell the socket there is no more data for now
+	ReleaseEvent();
+	return true;
+}
+
+// If there are G-code replies that we haven't sent, make them the next event to send and return true. The replies are shared by all clients
+// in the same way as for rr_reply, so a client that subscribes to events should not also fetch rr_reply.
+bool HttpResponder::QueueReplyEvents()
+{
+	if (replySeqSent == seq)
+	{
+		return false;
+	}
+
+	OutputBuffer *buf;
+	if (!OutputBuffer::Allocate(buf))
+	{
+		return false;													// try again later
+	}
+
+	volatile OutputStack replies;
+	{
+		MutexLocker lock(gcodeReplyMutex);
+		if (!gcodeReply.IsEmpty())
+		{
+			clientsServed++;
+			if (clientsServed < numSessions)
+			{
+				gcodeReply.IncreaseReferences(1);						// other clients need the replies too
+				replies.Append(gcodeReply);
+			}
+			else
+			{
+				replies.Append(gcodeReply);
+				gcodeReply.Clear();
+			}
+		}
+		replySeqSent = seq;
+	}
+
+	// Send each reply as a JSON string, which has its newlines escaped so that it fits on a single data line
+	for (OutputBuffer *reply = replies.Pop(); reply != nullptr; reply = replies.Pop())
+	{
+		buf->cat("event: reply\ndata: ");
+		buf->EncodeReply(reply);										// this releases the reply
+		buf->cat("\n\n");
+	}
+
+	if (buf->HadOverflow() || buf->Length() == 0)
+	{
+		OutputBuffer::ReleaseAll(buf);
+		return false;
+	}
+	eventToSend = buf;
+	return true;
+}
+
+// Release the event we were sending, if any
+void HttpResponder::ReleaseEvent()
+{
+	OutputBuffer::ReleaseAll(eventToSend);
+	eventPart = nullptr;
+	eventOffset = 0;
+}
+
+// Generate a new status for the clients that have subscribed to events, if the one we have is old enough. This is called by the responders
+// that are streaming events, so the status is only generated when someone wants it, and only once however many clients there are.
+/*static*/ void HttpResponder::UpdatePushedStatus()
+{
+	if (pushedStatus != nullptr && millis() - pushedStatusTime < statusPushInterval)
+	{
+		return;
+	}
+
+	OutputBuffer *buf;
+	if (!OutputBuffer::Allocate(buf))
+	{
+		return;
+	}
+
+	// The status response has no newlines, so it can be sent as a single data line
+	buf->copy("event: status\ndata: ");
+	OutputBuffer * const status = reprap.GetStatusResponse(PushedStatusType, ResponseSource::HTTP);
+	if (status == nullptr)
+	{
+		OutputBuffer::Release(buf);
+		return;
+	}
+	buf->Append(status);
+	buf->cat("\n\n");
+	if (buf->HadOverflow())
+	{
+		OutputBuffer::ReleaseAll(buf);
+		return;
+	}
+
+	OutputBuffer::ReleaseAll(pushedStatus);								// responders that are still sending the old one hold their own references to it
+	pushedStatus = buf;
+	pushedStatusTime = millis();
+	++pushedStatusSeq;
+}
+
+// Finish the headers of a response by telling the client whether we will keep the connection open after it
+void HttpResponder::AddConnectionHeader()
+{
+	if (keepAlive)
+	{
+		outBuf->catf("Connection: keep-alive\r\nKeep-Alive: timeout=%" PRIu32 "\r\n\r\n", HttpKeepAliveTimeout/1000);
+	}
+	else
+	{
+		outBuf->cat("Connection: close\r\n\r\n");
+	}
+}
+
+// Send the response, then wait for another request on the same connection if we are keeping it open
+void HttpResponder::CommitResponse(bool report)
+{
+	Commit((keepAlive) ? ResponderState::reading : ResponderState::free, report);
 }
 
 void HttpResponder::Diagnostics(MessageType mt) const
@@ -1355,6 +1483,7 @@ void HttpResponder::Diagnostics(MessageType mt) const
 	clientsServed = 0;
 	numSessions = 0;
 	gcodeReply.ReleaseAll();
+	OutputBuffer::ReleaseAll(pushedStatus);
 }
 
 // This is called from the GCodes task to store a response, which is picked up by the Network task
@@ -1481,4 +1610,10 @@ volatile uint32_t HttpResponder::seq = 0;
 volatile OutputStack HttpResponder::gcodeReply;
 Mutex HttpResponder::gcodeReplyMutex;
 
+OutputBuffer *HttpResponder::pushedStatus = nullptr;
+uint32_t HttpResponder::pushedStatusTime = 0;
+uint32_t HttpResponder::pushedStatusSeq = 0;
+uint32_t HttpResponder::statusPushInterval = DefaultStatusPushInterval;
+unsigned int HttpResponder::numEventStreams = 0;
+
 // End
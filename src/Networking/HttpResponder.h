@@ -9,6 +9,8 @@
 #define SRC_NETWORKING_HTTPRESPONDER_H_
 
 #include "UploadingNetworkResponder.h"
+#include "Storage/FileListGenerator.h"
+#include "HttpRequestParser.h"
 
 class HttpResponder : public UploadingNetworkResponder
 {
@@ -17,6 +19,7 @@ public:
 	bool Spin() override;								// do some work, returning true if we did anything significant
 	bool Accept(Socket *s, NetworkProtocol protocol) override;	// ask the responder to accept this connection, returns true if it did
 	void Terminate(NetworkProtocol protocol, NetworkInterface *interface) override;	// terminate the responder if it is serving the specified protocol on the specified interface
+	bool ReleaseIdleConnection(NetworkProtocol protocol) override;	// close a persistent connection that is waiting for a request, returning true if we did
 	void Diagnostics(MessageType mtype) const override;
 
 	static void InitStatic();
@@ -30,38 +33,20 @@ public:
 protected:
 	void CancelUpload() override;
 	void SendData() override;
+	bool GenerateMoreData(OutputBuffer *&buf) override;
+	void ConnectionLost() override;
 
 private:
 	static const size_t MaxHttpSessions = 8;			// maximum number of simultaneous HTTP sessions
-	static const uint16_t WebMessageLength = 1460;		// maximum length of the web message we accept after decoding
-	static const size_t MaxCommandWords = 4;			// max number of space-separated words in the command
-	static const size_t MaxQualKeys = 5;				// max number of key/value pairs in the qualifier
-	static const size_t MaxHeaders = 30;				// max number of key/value pairs in the headers
 	static const uint32_t HttpSessionTimeout = 8000;	// HTTP session timeout in milliseconds
+	static const uint32_t HttpKeepAliveTimeout = 5000;	// how long in milliseconds we keep a persistent connection open waiting for the next request
+	static const uint32_t DefaultStatusPushInterval = 250;	// how often in milliseconds we send the status to clients that have subscribed to events
+	static const uint32_t MinStatusPushInterval = 100;
+	static const uint8_t PushedStatusType = 3;			// the type of status response that we push, as for rr_status
 	static const uint32_t MaxFileInfoGetTime = 2000;	// maximum length of time we spend getting file info, to avoid the client timing out (actual time will be a little longer than this)
 	static const uint32_t MaxBufferWaitTime = 1000;		// maximum length of time we spend waiting for a buffer before we discard gcodeReply buffers
-
-	enum class HttpParseState
-	{
-		doingCommandWord,			// receiving a word in the first line of the HTTP request
-		doingFilename,				// receiving the filename (second word in the command line)
-		doingFilenameEsc1,			// received '%' in the filename (e.g. we are being asked for a filename with spaces in it)
-		doingFilenameEsc2,			// received '%' and one hex digit in the filename
-		doingQualifierKey,			// receiving a key name in the HTTP request
-		doingQualifierValue,		// receiving a key value in the HTTP request
-		doingQualifierValueEsc1,	// received '%' in the qualifier
-		doingQualifierValueEsc2,	// received '%' and one hex digit in the qualifier
-		doingHeaderKey,				// receiving a header key
-		expectingHeaderValue,		// expecting a header value
-		doingHeaderValue,			// receiving a header value
-		doingHeaderContinuation		// received a newline after a header value
-	};
-
-	struct KeyValueIndices
-	{
-		const char* key;
-		const char* value;
-	};
+	static const uint32_t WebFileMaxAge = 86400;		// how long in seconds a browser may use its cached copy of a web file other than an HTML page without checking it
+	static const size_t MaxFileListChunkLength = 1024;	// maximum length of each chunk of a file list that we send using chunked transfer encoding
 
 	// HTTP sessions
 	struct HttpSession
@@ -76,34 +61,39 @@ private:
 	bool CheckAuthenticated();
 	bool RemoveAuthentication();
 
-	bool CharFromClient(char c);
+	bool IsIdle() const { return awaitingNextRequest && parser.IsEmpty(); }	// true if we are keeping the connection open and no part of the next request has arrived
 	void SendFile(const char* nameOfFileToSend, bool isWebFile);
 	void SendGCodeReply();
+#if SUPPORT_OBJECT_MODEL
+	void SendModelValues();
+#endif
 	void SendJsonResponse(const char* command);
-	bool GetJsonResponse(const char* request, OutputBuffer *&response, bool& keepOpen);
+	bool GetJsonResponse(const char* request, OutputBuffer *&response);
 	void ProcessMessage();
 	void ProcessRequest();
 	void RejectMessage(const char* s, unsigned int code = 500);
+	void AddConnectionHeader();
+	void CommitResponse(bool report = true);
 	bool SendFileInfo(bool quitEarly);
+	bool IsHttp11Request() const { return parser.IsHttp11Request(); }
+	void StartFileList(bool detailed);
 
-	void DoUpload();
-
-	const char* GetKeyValue(const char *key) const;	// return the value of the specified key, or nullptr if not present
+	bool DoUpload();
 
-	HttpParseState parseState;
+	void StartEvents();
+	bool SendEvents();
+	bool QueueReplyEvents();
+	void ReleaseEvent();
+	static void UpdatePushedStatus();
 
-	// Buffers for processing HTTP input
-	char clientMessage[WebMessageLength + 3];		// holds the command, qualifier, and headers
-	size_t clientPointer;							// current index into clientMessage
-	char decodeChar;								// the character we are decoding in a URL-encoded argument
+	const char* GetKeyValue(const char *key) const { return parser.GetKeyValue(key); }			// return the value of the specified key, or nullptr if not present
+	const char* GetHeaderValue(const char *key) const { return parser.GetHeaderValue(key); }	// return the value of the specified header, or nullptr if not present
+	bool GetWebFileInfo(const char *filename, FileInfo& info) const;
+	void AddWebCacheHeaders(const char *filename, const char *etag);
 
-	// Parser state
-	const char* commandWords[MaxCommandWords];
-	KeyValueIndices qualifiers[MaxQualKeys + 1];	// offsets into clientQualifier of the key/value pairs, the +1 is needed so that values can contain nulls
-	KeyValueIndices headers[MaxHeaders];			// offsets into clientHeader of the key/value pairs
-	size_t numCommandWords;
-	size_t numQualKeys;								// number of qualifier keys we have found, <= maxQualKeys
-	size_t numHeaderKeys;							// number of keys we have found, <= maxHeaders
+	HttpRequestParser parser;						// holds the request we are receiving or processing
+	bool keepAlive;									// true if we keep the connection open after sending the response to the current request
+	bool awaitingNextRequest;						// true if we have sent a response and kept the connection open
 
 	// rr_fileinfo requests
 	uint32_t startedProcessingRequestAt;			// when we started processing the current HTTP request
@@ -114,6 +104,16 @@ private:
 	time_t fileLastModified;
 	bool postFileGotCrc;
 
+	// rr_files and rr_filelist requests that we send using chunked transfer encoding. They use filenameBeingProcessed to hold the directory name.
+	FileListGenerator fileList;
+
+	// Server-sent events
+	OutputBuffer *eventToSend;						// the event we are sending, on which we hold a reference
+	const OutputBuffer *eventPart;					// the buffer of it that we are sending
+	size_t eventOffset;								// how much of that buffer we have sent
+	uint32_t statusSeqSent;							// the sequence number of the last status we sent
+	uint32_t replySeqSent;							// the G-code reply sequence number when we last sent the replies
+
 	// Keeping track of HTTP sessions
 	static HttpSession sessions[MaxHttpSessions];
 	static unsigned int numSessions;
@@ -123,6 +123,13 @@ private:
 	static volatile uint32_t seq;					// Sequence number for G-Code replies
 	static volatile OutputStack gcodeReply;
 	static Mutex gcodeReplyMutex;
+
+	// Status pushed to clients that have subscribed to events. It is generated once for all of them.
+	static OutputBuffer *pushedStatus;
+	static uint32_t pushedStatusTime;
+	static uint32_t pushedStatusSeq;
+	static uint32_t statusPushInterval;
+	static unsigned int numEventStreams;			// number of responders in the streamingEvents state
 };
 
 #endif /* SRC_NETWORKING_HTTPRESPONDER_H_ */
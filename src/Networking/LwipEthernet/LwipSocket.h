@@ -45,6 +45,7 @@ public:
 	bool CanSend() const override;
 	size_t Send(const uint8_t *data, size_t length) override;
 	void Send() override { }
+	size_t SentDataReferenced() const override { return unAcked; }	// tcp_write refers to the data until it has been acknowledged
 
 private:
 	enum class SocketState : uint8_t
@@ -28,6 +28,10 @@
 #include "RTOSPlusTCPEthernet/RTOSPlusTCPEthernetInterface.h"
 #endif
 
+#if HAS_HOST_NETWORKING
+#include "HostNetwork/HostNetworkInterface.h"
+#endif
+
 #include "Platform.h"
 #include "RepRap.h"
 #include "HttpResponder.h"
@@ -51,7 +55,9 @@ static Task<NetworkStackWords> networkTask;
 
 Network::Network(Platform& p) : platform(p), responders(nullptr), nextResponderToPoll(nullptr)
 {
-#if defined(DUET3_V03)
+#if HAS_HOST_NETWORKING
+	interfaces[0] = new HostNetworkInterface(p);
+#elif defined(DUET3_V03)
 	interfaces[0] = new LwipEthernetInterface(p);
 	interfaces[1] = new WiFiInterface(p);
 #elif defined(SAME70XPLD) || defined(DUET3_V05) || defined(DUET3_V06)
@@ -99,7 +105,7 @@ void Network::Init()
 	telnetMutex.Create("Telnet");
 #endif
 
-#if defined(DUET_NG)
+#if defined(DUET_NG) && !HAS_HOST_NETWORKING
 	interfaces[0] = (platform.IsDuetWiFi()) ? static_cast<NetworkInterface*>(new WiFiInterface(platform)) : static_cast<NetworkInterface*>(new W5500Interface(platform));
 #endif
 
@@ -542,6 +548,15 @@ bool Network::FindResponder(Socket *skt, NetworkProtocol protocol)
 			return true;
 		}
 	}
+
+	// No responder is free, so if one is keeping an idle connection open, close that connection and give the responder the new one
+	for (NetworkResponder *r = responders; r != nullptr; r = r->GetNext())
+	{
+		if (r->ReleaseIdleConnection(protocol) && r->Accept(skt, protocol))
+		{
+			return true;
+		}
+	}
 	return false;
 }
 
@@ -15,7 +15,9 @@
 #include "RTOSIface/RTOSIface.h"
 #include "ObjectModel/ObjectModel.h"
 
-#if defined(DUET3_V03)
+#if HAS_HOST_NETWORKING
+const size_t NumNetworkInterfaces = 1;
+#elif defined(DUET3_V03)
 const size_t NumNetworkInterfaces = 2;
 #elif defined(SAME70XPLD) || defined(DUET3_V05) || defined(DUET3_V06) || defined(DUET_NG) || defined(DUET_M) || defined(__LPC17xx__)
 const size_t NumNetworkInterfaces = 1;
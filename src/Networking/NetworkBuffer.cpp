@@ -61,10 +61,11 @@ size_t NetworkBuffer::AppendData(const uint8_t *source, size_t length)
 	return length;
 }
 
-// Read into the buffer from a file returning the number of bytes read
+// Read into the buffer from a file returning the number of bytes read. The buffer is 32-bit aligned, so after the first read of a file
+// the SD card transfers whole sectors directly into it. The first read may be short so that the following ones start on a sector boundary.
 int NetworkBuffer::ReadFromFile(FileStore *f)
 {
-	const int ret = f->Read(reinterpret_cast<char*>(data32), bufferSize);
+	const int ret = f->ReadSectors(data32, bufferSize);
 	dataLength = (ret > 0) ? (size_t)ret : 0;
 	readPointer = 0;
 	return ret;
@@ -103,6 +104,23 @@ void NetworkBuffer::Empty()
 	return list;
 }
 
+// Release buffers from the start of a list of buffers whose data has been taken, keeping the most recent ones that hold the last bytesStillNeeded bytes
+/*static*/ NetworkBuffer *NetworkBuffer::ReleaseSent(NetworkBuffer *list, size_t bytesStillNeeded)
+{
+	size_t total = 0;
+	for (const NetworkBuffer *b = list; b != nullptr; b = b->next)
+	{
+		total += b->readPointer;
+	}
+
+	while (list != nullptr && total - list->readPointer >= bytesStillNeeded)
+	{
+		total -= list->readPointer;
+		list = list->Release();
+	}
+	return list;
+}
+
 /*static*/ NetworkBuffer *NetworkBuffer::Allocate()
 {
 	NetworkBuffer *ret = freelist;
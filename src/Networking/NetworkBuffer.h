@@ -41,16 +41,22 @@ public:
 	// Mark some data as taken
 	void Taken(size_t amount) { readPointer += amount; }
 
+	// Return the amount of data that has been taken
+	size_t TakenLength() const { return readPointer; }
+
 	// Return the length available for writing
 	size_t SpaceLeft() const { return bufferSize - dataLength; }
 
 	// Return a pointer to the space available for writing
 	uint8_t* UnwrittenData() { return Data() + dataLength; }
 
+	// Record that some data has been written directly into the space returned by UnwrittenData()
+	void DataWritten(size_t amount) { dataLength += amount; }
+
 	// Append some data, returning the amount appended
 	size_t AppendData(const uint8_t *source, size_t length);
 
-	// Read into the buffer from a file
+	// Read into the buffer from a file, ending the read on a sector boundary if possible
 	int ReadFromFile(FileStore *f);
 
 	// Clear this buffer and release any successors
@@ -62,6 +68,9 @@ public:
 	// Find the last buffer in a list
 	static NetworkBuffer *FindLast(NetworkBuffer *list);
 
+	// Release buffers from the start of a list of buffers whose data has been taken, keeping the most recent ones that hold the last bytesStillNeeded bytes
+	static NetworkBuffer *ReleaseSent(NetworkBuffer *list, size_t bytesStillNeeded);
+
 	// Allocate a buffer
 	static NetworkBuffer *Allocate();
 
@@ -71,6 +80,9 @@ public:
 	// Count how many buffers there are in a chain
 	static unsigned int Count(NetworkBuffer*& ptr);
 
+	// Count how many buffers are free
+	static unsigned int CountFree() { return Count(freelist); }
+
 	static const size_t bufferSize =
 #ifdef USE_3K_BUFFERS
 									 3 * 1024;
@@ -13,7 +13,7 @@
 
 NetworkResponder::NetworkResponder(NetworkResponder *n)
 	: next(n), responderState(ResponderState::free), skt(nullptr),
-	  outBuf(nullptr), fileBeingSent(nullptr), fileBuffer(nullptr)
+	  outBuf(nullptr), fileBeingSent(nullptr), fileBuffer(nullptr), readAheadBuffer(nullptr), sentFileBuffers(nullptr)
 {
 }
 
@@ -29,7 +29,7 @@ void NetworkResponder::Commit(ResponderState nextState, bool report)
 }
 
 // Send our data.
-// We send outBuf first, then outStack, and finally fileBeingSent.
+// We send outBuf first, then outStack, then any data that GenerateMoreData provides, and finally fileBeingSent.
 void NetworkResponder::SendData()
 {
 	// Send our output buffer and output stack
@@ -40,7 +40,14 @@ void NetworkResponder::SendData()
 			outBuf = outStack.Pop();
 			if (outBuf == nullptr)
 			{
-				break;
+				if (!GenerateMoreData(outBuf))
+				{
+					break;
+				}
+				if (outBuf == nullptr)
+				{
+					return;				// the data isn't available yet, try again later
+				}
 			}
 		}
 		const size_t bytesLeft = outBuf->BytesLeft();
@@ -77,74 +84,148 @@ void NetworkResponder::SendData()
 
 	// If we get here then there are no output buffers left to send
 	// If we have a file to send, send it
-	if (fileBeingSent != nullptr && fileBuffer == nullptr)
+	switch (SendFileData(skt))
 	{
-		fileBuffer = NetworkBuffer::Allocate();
-		if (fileBuffer == nullptr)
+	case FileSendStatus::sending:
+		return;
+
+	case FileSendStatus::connectionLost:
+		if (reprap.Debug(moduleWebserver))
 		{
-			return;					// no buffer available, try again later
+			debugPrintf("Can't send anymore\n");
 		}
+		ConnectionLost();
+		return;
+
+	case FileSendStatus::finished:
+		break;
 	}
 
-	// If we have a file buffer here, we must be in the process of sending a file
-	while (fileBuffer != nullptr)
+	// If we get here then there is nothing left to send
+	skt->Send();						// tell the socket there is no more data
+
+	// If we are going to free up this responder after sending, then we must close the connection
+	if (stateAfterSending == ResponderState::free)
 	{
-		if (fileBuffer->IsEmpty() && fileBeingSent != nullptr)
+		skt->Close();
+		skt = nullptr;
+	}
+	responderState = stateAfterSending;
+}
+
+// Send data from fileBeingSent over socket s. The file is read into network buffers a whole number of sectors at a time, so that FatFS can read it
+// using multi-sector DMA transfers directly into the buffers, and we pass the buffers to the socket without copying them.
+// Some sockets refer to the data we give them until the other end has acknowledged it instead of copying it, so we keep the buffers we have sent until then.
+// If the socket can't accept any more data then we read the next buffer of the file while we wait, if there is a network buffer to spare.
+NetworkResponder::FileSendStatus NetworkResponder::SendFileData(Socket *s)
+{
+	ReleaseSentFileBuffers(s);
+	for (;;)
+	{
+		if (fileBuffer == nullptr && fileBeingSent != nullptr)
 		{
-			const int bytesRead = fileBuffer->ReadFromFile(fileBeingSent);
-			if (bytesRead != (int)NetworkBuffer::bufferSize)
+			fileBuffer = ReadFileBuffer();
+			if (fileBuffer == nullptr && fileBeingSent != nullptr)
 			{
-				// We had a read error or we reached the end of the file
-				fileBeingSent->Close();
-				fileBeingSent = nullptr;
+				return FileSendStatus::sending;			// no buffer available, try again later
 			}
 		}
+		if (fileBuffer == nullptr)
+		{
+			break;
+		}
 
-		if (fileBuffer->IsEmpty())
+		const size_t remaining = fileBuffer->Remaining();
+		const size_t sent = s->Send(fileBuffer->UnreadData(), remaining);
+		if (sent == 0 && !s->CanSend())
 		{
-			// Must have sent the whole file
-			fileBuffer->Release();
-			fileBuffer = nullptr;
+			return FileSendStatus::connectionLost;		// the connection has been lost or the other end has closed it
 		}
-		else
+
+		fileBuffer->Taken(sent);
+		if (sent < remaining)
 		{
-			const size_t remaining = fileBuffer->Remaining();
-			const size_t sent = skt->Send(fileBuffer->UnreadData(), remaining);
-			if (sent == 0)
+			// The socket can't accept any more data for now, so read the next part of the file while we wait
+			if (readAheadBuffer == nullptr)
 			{
-				// Check whether the connection has been closed
-				if (!skt->CanSend())
-				{
-					if (reprap.Debug(moduleWebserver))
-					{
-						debugPrintf("Can't send anymore\n");
-					}
-					ConnectionLost();
-				}
-				return;
+				readAheadBuffer = ReadFileBuffer();
 			}
+			return FileSendStatus::sending;
+		}
 
-			fileBuffer->Taken(sent);
+		// We have sent the whole buffer
+		NetworkBuffer::AppendToList(&sentFileBuffers, fileBuffer);
+		fileBuffer = readAheadBuffer;
+		readAheadBuffer = nullptr;
+		ReleaseSentFileBuffers(s);
+		if (fileBuffer != nullptr || fileBeingSent != nullptr)
+		{
+			return FileSendStatus::sending;				// return to allow other sockets to be polled
+		}
+	}
 
-			if (   sent < remaining				// if we couldn't send it all...
-				|| fileBuffer->IsEmpty()		// ...or if we've sent the whole buffer, return to allow other sockets to be polled
-			   )
-			{
-				return;
-			}
+	// We have sent the whole file, but we can't finish until the socket has finished with the buffers
+	if (sentFileBuffers != nullptr)
+	{
+		s->Send();
+		return (s->CanSend()) ? FileSendStatus::sending : FileSendStatus::connectionLost;
+	}
+	return FileSendStatus::finished;
+}
+
+// Allocate a network buffer and read the next part of fileBeingSent into it, closing the file if we reach the end or get a read error.
+// When reading ahead, we leave some network buffers free for receiving data.
+// Return the buffer, or nullptr if there was no buffer available or no data to read.
+NetworkBuffer *NetworkResponder::ReadFileBuffer()
+{
+	if (fileBeingSent == nullptr || (fileBuffer != nullptr && NetworkBuffer::CountFree() <= MinFreeBuffersForReadAhead))
+	{
+		return nullptr;
+	}
+
+	NetworkBuffer *buf = NetworkBuffer::Allocate();
+	if (buf != nullptr)
+	{
+		const int bytesRead = buf->ReadFromFile(fileBeingSent);
+		if (bytesRead <= 0 || fileBeingSent->Position() >= fileBeingSent->Length())
+		{
+			// We had a read error or we reached the end of the file
+			fileBeingSent->Close();
+			fileBeingSent = nullptr;
+		}
+		if (bytesRead <= 0)
+		{
+			buf->Release();
+			buf = nullptr;
 		}
 	}
+	return buf;
+}
 
-	// If we get here then there is nothing left to send
-	skt->Send();						// tell the socket there is no more data
+// Release the buffers of file data that we have sent and that the socket no longer refers to
+void NetworkResponder::ReleaseSentFileBuffers(const Socket *s)
+{
+	if (sentFileBuffers != nullptr)
+	{
+		// The data that the socket still refers to is the data we sent most recently, which may include the start of fileBuffer
+		const size_t referenced = s->SentDataReferenced();
+		const size_t referencedInCurrentBuffer = (fileBuffer == nullptr) ? 0 : fileBuffer->TakenLength();
+		sentFileBuffers = NetworkBuffer::ReleaseSent(sentFileBuffers, (referenced > referencedInCurrentBuffer) ? referenced - referencedInCurrentBuffer : 0);
+	}
+}
 
-	// If we are going to free up this responder after sending, then we must close the connection
-	if (stateAfterSending == ResponderState::free)
+// Release all the buffers used to send a file. Call this only when we are not going to send any more data on the connection.
+void NetworkResponder::ReleaseFileBuffers()
+{
+	NetworkBuffer * const buffers[] = { fileBuffer, readAheadBuffer, sentFileBuffers };
+	for (NetworkBuffer *b : buffers)
 	{
-		skt->Close();
-		skt = nullptr;
+		while (b != nullptr)
+		{
+			b = b->Release();
+		}
 	}
-	responderState = stateAfterSending;
+	fileBuffer = readAheadBuffer = sentFileBuffers = nullptr;
 }
 
 // This is called when we lose a connection or when we are asked to terminate. Overridden in some derived classes.
@@ -159,18 +240,14 @@ void NetworkResponder::ConnectionLost()
 		fileBeingSent = nullptr;
 	}
 
-	if (fileBuffer != nullptr)
-	{
-		fileBuffer->Release();
-		fileBuffer = nullptr;
-	}
-
 	if (skt != nullptr)
 	{
 		skt->Terminate();
 		skt = nullptr;
 	}
 
+	ReleaseFileBuffers();								// after terminating the connection, because the socket may refer to the data we sent
+
 	responderState = ResponderState::free;
 }
 
@@ -28,6 +28,7 @@ public:
 	virtual bool Spin() = 0;							// do some work, returning true if we did anything significant
 	virtual bool Accept(Socket *s, NetworkProtocol protocol) = 0;	// ask the responder to accept this connection, returns true if it did
 	virtual void Terminate(NetworkProtocol protocol, NetworkInterface *interface) = 0;	// terminate the responder if it is serving the specified protocol on the specified interface
+	virtual bool ReleaseIdleConnection(NetworkProtocol protocol) { return false; }	// close an idle persistent connection so that a new one can be accepted, returning true if we did
 	virtual void Diagnostics(MessageType mtype) const = 0;
 
 protected:
@@ -42,6 +43,7 @@ protected:
 		// HTTP responder additional states
 		processingRequest,
 		gettingFileInfo,								// getting file info
+		streamingEvents,								// sending server-sent events
 
 		// FTP responder additional states
 		waitingForPasvPort,
@@ -54,11 +56,22 @@ protected:
 		authenticating
 	};
 
+	// Result of sending part of a file
+	enum class FileSendStatus
+	{
+		sending,										// there is more to send, or the socket still refers to some of the data we sent
+		finished,										// we have sent the whole file, or there was no file to send
+		connectionLost
+	};
+
 	NetworkResponder(NetworkResponder *n);
 
 	void Commit(ResponderState nextState = ResponderState::free, bool report = true);
 	virtual void SendData();
+	virtual bool GenerateMoreData(OutputBuffer *&buf) { return false; }	// for responses generated while they are being sent: return true and set buf to the next part or to nullptr if it isn't ready yet, or return false if there is no more
 	virtual void ConnectionLost();
+	FileSendStatus SendFileData(Socket *s);
+	void ReleaseFileBuffers();
 
 	IPAddress GetRemoteIP() const;
 	void ReportOutputBufferExhaustion(const char *sourceFile, int line);
@@ -77,7 +90,15 @@ protected:
 	OutputBuffer *outBuf;
 	OutputStack outStack;								// not volatile because only one task accesses it
 	FileStore *fileBeingSent;
-	NetworkBuffer *fileBuffer;
+	NetworkBuffer *fileBuffer;							// the part of fileBeingSent that we are sending
+	NetworkBuffer *readAheadBuffer;						// the next part of fileBeingSent, if we have already read it
+	NetworkBuffer *sentFileBuffers;						// buffers of file data that we have sent but the socket may still refer to
+
+private:
+	static constexpr unsigned int MinFreeBuffersForReadAhead = 2;	// don't read ahead unless it leaves this many network buffers free for receiving data
+
+	NetworkBuffer *ReadFileBuffer();
+	void ReleaseSentFileBuffers(const Socket *s);
 };
 
 #endif /* SRC_NETWORKING_NETWORKRESPONDER_H_ */
@@ -41,6 +41,7 @@ public:
 	virtual bool CanSend() const = 0;
 	virtual size_t Send(const uint8_t *data, size_t length) = 0;
 	virtual void Send() = 0;
+	virtual size_t SentDataReferenced() const { return 0; }	// how many of the bytes most recently sent the socket still refers to in the caller's memory, because it didn't copy them
 
 protected:
 	enum class SocketState : uint8_t
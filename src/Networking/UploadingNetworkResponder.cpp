@@ -105,6 +105,9 @@ void UploadingNetworkResponder::FinishUpload(uint32_t fileLength, time_t fileLas
 			// Rename the uploaded file to it's original name
 			GetPlatform().GetMassStorage()->Rename(uploadFilename, origFilename.c_str());
 
+			// Any file info we cached for a previous file of that name is out of date
+			GetPlatform().GetMassStorage()->InvalidateFileInfo(origFilename.c_str());
+
 			if (fileLastModified != 0)
 			{
 				// Update the file timestamp if it was specified
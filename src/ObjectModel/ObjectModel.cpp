@@ -267,11 +267,18 @@ TypeCode ObjectModel::GetObjectValue(ExpressionValue& val, const char *idString)
 		param = arr->GetElement(this, val);		// fetch the pointer to the array element
 	}
 
-	switch (tc)
+	if (tc == TYPE_OF(ObjectModel))
 	{
-	case TYPE_OF(ObjectModel):
 		return ((ObjectModel*)param)->GetObjectValue(val, idString);
+	}
+	return GetPrimitiveValue(val, param, tc);
+}
 
+// Get the value of a primitive type given a pointer to it
+/*static*/ TypeCode ObjectModel::GetPrimitiveValue(ExpressionValue& val, const void *param, TypeCode tc)
+{
+	switch (tc)
+	{
 	case TYPE_OF(float):
 	case TYPE_OF(Float2):
 	case TYPE_OF(Float3):
@@ -376,6 +383,111 @@ bool ObjectModel::GetObjectValue(int32_t& val, const char *idString)
 	}
 }
 
+// Look up an ID string, returning true if it identifies a value of one of the primitive types that GetPrimitiveValue can fetch
+bool ObjectModelPath::Compile(ObjectModel *root, const char *idString)
+{
+	numSteps = 0;
+	ObjectModel *om = root;
+	while (numSteps < MaxSteps && idString[0] != 0 && idString[0] != '*')	// an empty or wildcard ID would match any table entry
+	{
+		const ObjectModelTableEntry * const e = om->FindObjectModelTableEntry(idString);
+		if (e == nullptr)
+		{
+			break;
+		}
+
+		Step& step = steps[numSteps++];
+		step.entry = e;
+		step.arrayIndex = 0;
+		idString = ObjectModel::GetNextElement(idString);
+		void *param = e->param(om);
+		TypeCode tc = e->type;
+		if ((tc & IsArray) != 0)
+		{
+			if (*idString != '[')
+			{
+				break;								// we don't allow an entire array to be returned
+			}
+			const char *endptr;
+			const unsigned long index = SafeStrtoul(idString + 1, &endptr);
+			const ObjectModelArrayDescriptor *arr = (const ObjectModelArrayDescriptor*)param;
+			if (endptr == idString + 1 || *endptr != ']' || index >= arr->GetNumElements(om))
+			{
+				break;
+			}
+
+			idString = endptr + 1;
+			if (*idString == '.')
+			{
+				++idString;
+			}
+			tc &= ~IsArray;
+			step.arrayIndex = index;
+			param = arr->GetElement(om, index);
+		}
+
+		if (tc != TYPE_OF(ObjectModel))
+		{
+			ExpressionValue val;
+			if (*idString == 0 && ObjectModel::GetPrimitiveValue(val, param, tc) != NoType)
+			{
+				return true;
+			}
+			break;									// there is more of the ID string after a primitive value, or it is a type that we can't fetch
+		}
+		om = (ObjectModel*)param;
+	}
+
+	numSteps = 0;
+	return false;
+}
+
+// Get the value, returning NoType if the path is not valid or an array index is now out of range
+TypeCode ObjectModelPath::GetValue(ObjectModel *root, ExpressionValue& val) const
+{
+	ObjectModel *om = root;
+	for (size_t i = 0; i < numSteps; ++i)
+	{
+		const ObjectModelTableEntry * const e = steps[i].entry;
+		void *param = e->param(om);
+		TypeCode tc = e->type;
+		if ((tc & IsArray) != 0)
+		{
+			const ObjectModelArrayDescriptor *arr = (const ObjectModelArrayDescriptor*)param;
+			if (steps[i].arrayIndex >= arr->GetNumElements(om))
+			{
+				return NoType;
+			}
+			tc &= ~IsArray;
+			param = arr->GetElement(om, steps[i].arrayIndex);
+		}
+
+		if (i + 1 == numSteps)
+		{
+			return ObjectModel::GetPrimitiveValue(val, param, tc);
+		}
+		om = (ObjectModel*)param;
+	}
+	return NoType;
+}
+
+// Return true if two paths lead to the same value
+bool ObjectModelPath::SameAs(const ObjectModelPath& other) const
+{
+	if (numSteps != other.numSteps)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < numSteps; ++i)
+	{
+		if (steps[i].entry != other.steps[i].entry || steps[i].arrayIndex != other.steps[i].arrayIndex)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 #endif
 
 // End
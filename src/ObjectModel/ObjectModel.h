@@ -74,6 +74,11 @@ protected:
 	virtual const ObjectModelTableEntry *GetObjectModelTable(size_t& numEntries) const = 0;
 
 private:
+	friend class ObjectModelPath;
+
+	// Get the value of a primitive type given a pointer to it
+	static TypeCode GetPrimitiveValue(ExpressionValue& val, const void *param, TypeCode tc);
+
 	// Get pointers to various types from the object model, returning null if failed
 	template<class T> T* GetObjectPointer(const char* idString);
 
@@ -150,6 +155,36 @@ public:
 	static void ReportItemAsJson(OutputBuffer *buf, const char *filter, ObjectModel::ReportFlags flags, void *nParam, TypeCode type);
 };
 
+// A path to a value in the object model that has been looked up once, so that the value can be fetched repeatedly without parsing the ID string
+// and searching the object model tables each time. We store the table entries and array indices rather than a pointer to the value,
+// because the objects that the path passes through may change, e.g. when a tool is deleted.
+class ObjectModelPath
+{
+public:
+	ObjectModelPath() : numSteps(0) { }
+
+	// Look up an ID string of the form accepted by ObjectModel::GetObjectValue, returning true if it identifies a value of a primitive type
+	bool Compile(ObjectModel *root, const char *idString);
+
+	// Get the value, returning NoType if the path is not valid or an array index is now out of range
+	TypeCode GetValue(ObjectModel *root, ExpressionValue& val) const;
+
+	bool IsValid() const { return numSteps != 0; }
+	bool SameAs(const ObjectModelPath& other) const;
+
+private:
+	static constexpr size_t MaxSteps = 8;
+
+	struct Step
+	{
+		const ObjectModelTableEntry *entry;
+		uint32_t arrayIndex;						// only used if the entry is an array
+	};
+
+	Step steps[MaxSteps];
+	size_t numSteps;
+};
+
 // Use this macro to inherit form ObjectModel
 #define INHERIT_OBJECT_MODEL	: public ObjectModel
 
@@ -52,6 +52,10 @@
 # define SUPPORT_WORKPLACE_COORDINATES		0
 #endif
 
+#ifndef SUPPORT_ASYNC_MOVES
+# define SUPPORT_ASYNC_MOVES				0
+#endif
+
 #ifndef SUPPORT_LASER
 # define SUPPORT_LASER			0
 #endif
@@ -121,7 +125,12 @@
 # define HAS_ESP32_NETWORKING    0
 #endif
 
-#define HAS_NETWORKING			(HAS_LWIP_NETWORKING || HAS_WIFI_NETWORKING || HAS_W5500_NETWORKING || HAS_LEGACY_NETWORKING || HAS_RTOSPLUSTCP_NETWORKING || HAS_ESP32_NETWORKING)
+// Host builds that run the network code on a PC using its TCP sockets define HAS_HOST_NETWORKING instead of the networking of a board
+#ifndef HAS_HOST_NETWORKING
+# define HAS_HOST_NETWORKING	0
+#endif
+
+#define HAS_NETWORKING			(HAS_LWIP_NETWORKING || HAS_WIFI_NETWORKING || HAS_W5500_NETWORKING || HAS_LEGACY_NETWORKING || HAS_RTOSPLUSTCP_NETWORKING || HAS_ESP32_NETWORKING || HAS_HOST_NETWORKING)
 
 #ifndef SUPPORT_FTP
 # define SUPPORT_FTP			HAS_NETWORKING
@@ -1717,7 +1717,7 @@ void Platform::Spin()
 	}
 #endif
 
-	// Flush the log file it it is time. This may take some time, so do it last.
+	// Hand the buffered log messages to the storage task, and flush the log file if it is time. This only waits for the SD card when the file is rotated.
 	if (logger != nullptr)
 	{
 		logger->Flush(false);
@@ -2295,7 +2295,12 @@ void Platform::Diagnostics(MessageType mtype)
 #endif
 
 	// Show the longest SD card write time
-	MessageF(mtype, "SD card longest block write time: %.1fms, max retries %u\n", (double)FileStore::GetAndClearLongestWriteTime(), FileStore::GetAndClearMaxRetryCount());
+	MessageF(mtype, "SD card longest block write time: %.1fms, longest wait for queued writes %.1fms, max retries %u\n",
+				(double)FileStore::GetAndClearLongestWriteTime(), (double)FileStore::GetAndClearLongestWriteWait(), FileStore::GetAndClearMaxRetryCount());
+	if (logger != nullptr && logger->IsActive())
+	{
+		logger->Diagnostics(mtype);
+	}
 
 #if HAS_CPU_TEMP_SENSOR
 	// Show the MCU temperatures
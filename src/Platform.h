@@ -209,6 +209,7 @@ enum class DiagnosticTestType : int
 	TimeSinCos = 103,				// do a timing test on the trig functions
 	TimeSDWrite = 104,				// do a write timing test on the SD card
 	PrintObjectSizes = 105,			// print the sizes of various objects
+	PrintCodeStatistics = 106,		// print, enable or disable per-code execution statistics (handled by class GCodes)
 
 	TestWatchdog = 1001,			// test that we get a watchdog reset if the tick interrupt stops
 	TestSpinLockup = 1002,			// test that we get a software reset if a Spin() function takes too long
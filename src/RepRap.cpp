@@ -13,6 +13,8 @@
 #include "Tools/Filament.h"
 #include "Tasks.h"
 #include "Version.h"
+#include "StatusDelta.h"
+#include "Storage/FileListGenerator.h"
 
 #ifdef DUET_NG
 # include "DueXn.h"
@@ -205,6 +207,18 @@ RepRap::RepRap() : toolList(nullptr), currentTool(nullptr), lastWarningMillis(0)
 	SetPassword(DEFAULT_PASSWORD);
 	message.Clear();
 	messageSequence = 0;
+
+	for (StatusDelta*& sd : statusDeltas)
+	{
+		sd = nullptr;
+	}
+
+#if SUPPORT_OBJECT_MODEL
+	for (ObjectModelPath*& mp : modelPaths)
+	{
+		mp = nullptr;
+	}
+#endif
 }
 
 void RepRap::Init()
@@ -1517,6 +1531,148 @@ OutputBuffer *RepRap::GetStatusResponse(uint8_t type, ResponseSource source)
 	return response;
 }
 
+// Get a status response that has only the fields that have changed since the sequence number 'since'. See StatusDelta.h.
+// The objects that track the changes are only created when a client asks for one of these.
+OutputBuffer *RepRap::GetStatusDeltaResponse(uint8_t type, uint32_t since)
+{
+	if (type < 1 || type > ARRAY_SIZE(statusDeltas))
+	{
+		return nullptr;
+	}
+
+	StatusDelta *& sd = statusDeltas[type - 1];
+	if (sd == nullptr)
+	{
+		sd = new StatusDelta();
+	}
+
+	OutputBuffer * const status = GetStatusResponse(type, ResponseSource::HTTP);
+	return (status == nullptr) ? nullptr : sd->MakeDelta(status, since);
+}
+
+#if SUPPORT_OBJECT_MODEL
+
+// Register a comma-separated list of object model paths and return the handle for each one, or -1 if the path doesn't identify a value or there are no free handles.
+// Handles are shared between clients, so a path that has already been registered gets the same handle again. If reset is true then all the handles
+// are freed first. A client that is given -1 because the handles have run out can do this, after which every client must register its paths again.
+// The paths may be null if we are only resetting.
+OutputBuffer *RepRap::GetModelPathsResponse(const char *paths, bool reset)
+{
+	OutputBuffer *response;
+	if (!OutputBuffer::Allocate(response))
+	{
+		return nullptr;
+	}
+
+	if (reset)
+	{
+		for (ObjectModelPath*& mp : modelPaths)
+		{
+			delete mp;
+			mp = nullptr;
+		}
+	}
+
+	response->copy("{\"handles\":[");
+	bool first = true;
+	while (paths != nullptr)
+	{
+		String<ShortScratchStringLength> id;
+		size_t idLength = 0;
+		while (*paths != 0 && *paths != ',')
+		{
+			id.cat(*paths++);
+			++idLength;
+		}
+
+		int handle = -1;
+		ObjectModelPath path;
+		if (idLength <= ShortScratchStringLength && path.Compile(this, id.c_str()))				// don't look up a path that we truncated
+		{
+			for (size_t i = 0; i < MaxModelPaths; ++i)
+			{
+				if (modelPaths[i] == nullptr)
+				{
+					modelPaths[i] = new ObjectModelPath(path);
+				}
+				else if (!modelPaths[i]->SameAs(path))
+				{
+					continue;
+				}
+				handle = (int)i;
+				break;
+			}
+		}
+
+		response->catf((first) ? "%d" : ",%d", handle);
+		first = false;
+		paths = (*paths == 0) ? nullptr : paths + 1;
+	}
+	response->cat("]}");
+	return response;
+}
+
+// Get the values for a comma-separated list of handles returned by GetModelPathsResponse, packed in binary.
+// For each handle there is the type code of the value as given by TypeOf<T>(), followed by:
+//  nothing for NoType, which we return if the handle is invalid or an array index in its path is now out of range;
+//  1 byte for bool;
+//  a 2-byte length followed by the characters for a string;
+//  4 bytes for all other types, which is the IEEE single precision value for float, Float2 and Float3.
+// All multi-byte values are little-endian.
+OutputBuffer *RepRap::GetModelValuesResponse(const char *handles)
+{
+	OutputBuffer *response;
+	if (!OutputBuffer::Allocate(response))
+	{
+		return nullptr;
+	}
+
+	while (*handles != 0)
+	{
+		const char *endptr;
+		const unsigned long handle = SafeStrtoul(handles, &endptr);
+		if (endptr == handles)
+		{
+			break;
+		}
+
+		ExpressionValue val;
+		const TypeCode tc = (handle < MaxModelPaths && modelPaths[handle] != nullptr) ? modelPaths[handle]->GetValue(this, val) : NoType;
+		response->cat((char)tc);
+		switch (tc)
+		{
+		case NoType:
+			break;
+
+		case TYPE_OF(bool):
+			response->cat((char)((val.bVal) ? 1 : 0));
+			break;
+
+		case TYPE_OF(const char*):
+			{
+				const uint16_t len = (uint16_t)min<size_t>(strlen(val.sVal), 0xFFFF);
+				const char lenBytes[2] = { (char)(len & 0xFF), (char)(len >> 8) };
+				response->cat(lenBytes, sizeof(lenBytes));
+				response->cat(val.sVal, len);
+			}
+			break;
+
+		default:
+			{
+				const uint32_t u = val.uVal;			// the same bits as fVal or iVal
+				const char valBytes[4] = { (char)(u & 0xFF), (char)((u >> 8) & 0xFF), (char)((u >> 16) & 0xFF), (char)(u >> 24) };
+				response->cat(valBytes, sizeof(valBytes));
+			}
+			break;
+		}
+
+		handles = (*endptr == ',') ? endptr + 1 : endptr;
+	}
+	return response;
+}
+
+#endif
+
 OutputBuffer *RepRap::GetConfigResponse()
 {
 	// We need some resources to return a valid config response...
@@ -1876,66 +2032,9 @@ OutputBuffer *RepRap::GetFilesResponse(const char *dir, unsigned int startAt, bo
 		return nullptr;
 	}
 
-	response->copy("{\"dir\":");
-	response->EncodeString(dir, false);
-	response->catf(",\"first\":%u,\"files\":[", startAt);
-	unsigned int err;
-	unsigned int nextFile = 0;
-
-	if (!platform->GetMassStorage()->CheckDriveMounted(dir))
-	{
-		err = 1;
-	}
-	else if (!platform->GetMassStorage()->DirectoryExists(dir))
-	{
-		err = 2;
-	}
-	else
-	{
-		err = 0;
-		FileInfo fileInfo;
-		unsigned int filesFound = 0;
-		bool gotFile = platform->GetMassStorage()->FindFirst(dir, fileInfo);
-
-		size_t bytesLeft = OutputBuffer::GetBytesLeft(response);	// don't write more bytes than we can
-
-		while (gotFile)
-		{
-			if (fileInfo.fileName[0] != '.')						// ignore Mac resource files and Linux hidden files
-			{
-				if (filesFound >= startAt)
-				{
-					// Make sure we can end this response properly
-					if (bytesLeft < fileInfo.fileName.strlen() * 2 + 20)
-					{
-						// No more space available - stop here
-						platform->GetMassStorage()->AbandonFindNext();
-						nextFile = filesFound;
-						break;
-					}
-
-					// Write separator and filename
-					if (filesFound != startAt)
-					{
-						bytesLeft -= response->cat(',');
-					}
-
-					bytesLeft -= response->EncodeString(fileInfo.fileName, false, flagsDirs && fileInfo.isDirectory);
-				}
-				++filesFound;
-			}
-			gotFile = platform->GetMassStorage()->FindNext(fileInfo);
-		}
-	}
-
-	if (err != 0)
-	{
-		response->catf("],\"err\":%u}", err);
-	}
-	else
-	{
-		response->catf("],\"next\":%u,\"err\":%u}", nextFile, err);
-	}
+	FileListGenerator generator;
+	generator.Start(dir, startAt, false, flagsDirs);
+	(void)generator.Generate(response, OutputBuffer::GetBytesLeft(response), true);		// don't write more bytes than we can
 	return response;
 }
 
@@ -1949,83 +2048,9 @@ OutputBuffer *RepRap::GetFilelistResponse(const char *dir, unsigned int startAt)
 		return nullptr;
 	}
 
-	response->copy("{\"dir\":");
-	response->EncodeString(dir, false);
-	response->catf(",\"first\":%u,\"files\":[", startAt);
-	unsigned int err;
-	unsigned int nextFile = 0;
-
-	if (!platform->GetMassStorage()->CheckDriveMounted(dir))
-	{
-		err = 1;
-	}
-	else if (!platform->GetMassStorage()->DirectoryExists(dir))
-	{
-		err = 2;
-	}
-	else
-	{
-		err = 0;
-		FileInfo fileInfo;
-		unsigned int filesFound = 0;
-		bool gotFile = platform->GetMassStorage()->FindFirst(dir, fileInfo);
-		size_t bytesLeft = OutputBuffer::GetBytesLeft(response);	// don't write more bytes than we can
-
-		while (gotFile)
-		{
-			if (fileInfo.fileName[0] != '.')			// ignore Mac resource files and Linux hidden files
-			{
-				if (filesFound >= startAt)
-				{
-					// Make sure we can end this response properly
-					if (bytesLeft < fileInfo.fileName.strlen() * 2 + 50)
-					{
-						// No more space available - stop here
-						platform->GetMassStorage()->AbandonFindNext();
-						nextFile = filesFound;
-						break;
-					}
-
-					// Write delimiter
-					if (filesFound != startAt)
-					{
-						bytesLeft -= response->cat(',');
-					}
-
-					// Write another file entry
-					bytesLeft -= response->catf("{\"type\":\"%c\",\"name\":", fileInfo.isDirectory ? 'd' : 'f');
-					bytesLeft -= response->EncodeString(fileInfo.fileName, false);
-					bytesLeft -= response->catf(",\"size\":%" PRIu32, fileInfo.size);
-
-					const struct tm * const timeInfo = gmtime(&fileInfo.lastModified);
-					if (timeInfo->tm_year <= /*19*/80)
-					{
-						// Don't send the last modified date if it is invalid
-						bytesLeft -= response->cat('}');
-					}
-					else
-					{
-						bytesLeft -= response->catf(",\"date\":\"%04u-%02u-%02uT%02u:%02u:%02u\"}",
-								timeInfo->tm_year + 1900, timeInfo->tm_mon + 1, timeInfo->tm_mday,
-								timeInfo->tm_hour, timeInfo->tm_min, timeInfo->tm_sec);
-					}
-				}
-				++filesFound;
-			}
-			gotFile = platform->GetMassStorage()->FindNext(fileInfo);
-		}
-	}
-
-	// If there is no error, don't append "err":0 because if we do then DWC thinks there has been an error - looks like it doesn't check the value
-	if (err != 0)
-	{
-		response->catf("],\"err\":%u}", err);
-	}
-	else
-	{
-		response->catf("],\"next\":%u}", nextFile);
-	}
-
+	FileListGenerator generator;
+	generator.Start(dir, startAt, true, false);
+	(void)generator.Generate(response, OutputBuffer::GetBytesLeft(response), true);		// don't write more bytes than we can
 	return response;
 }
 
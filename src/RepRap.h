@@ -116,11 +116,16 @@ public:
 	uint16_t GetToolHeatersInUse() const;
 
 	OutputBuffer *GetStatusResponse(uint8_t type, ResponseSource source);
+	OutputBuffer *GetStatusDeltaResponse(uint8_t type, uint32_t since);
 	OutputBuffer *GetConfigResponse();
 	OutputBuffer *GetLegacyStatusResponse(uint8_t type, int seq);
 	OutputBuffer *GetFilesResponse(const char* dir, unsigned int startAt, bool flagsDirs);
 	OutputBuffer *GetFilelistResponse(const char* dir, unsigned int startAt);
 	bool GetFileInfoResponse(const char *filename, OutputBuffer *&response, bool quitEarly);
+#if SUPPORT_OBJECT_MODEL
+	OutputBuffer *GetModelPathsResponse(const char *paths, bool reset);
+	OutputBuffer *GetModelValuesResponse(const char *handles);
+#endif
 
 	void Beep(unsigned int freq, unsigned int ms);
 	void SetMessage(const char *msg);
@@ -198,6 +203,13 @@ private:
 
 	MessageBox mbox;					// message box data
 
+	StatusDelta *statusDeltas[3];		// change tracking for status response types 1 to 3, created when first needed
+
+#if SUPPORT_OBJECT_MODEL
+	static constexpr size_t MaxModelPaths = 32;
+	ObjectModelPath *modelPaths[MaxModelPaths];	// object model paths registered by clients, indexed by handle and created when first needed
+#endif
+
 	// Deferred diagnostics
 	MessageType diagnosticsDestination;
 	bool justSentDiagnostics;
@@ -92,6 +92,7 @@ class GCodeQueue;
 class FilamentMonitor;
 class RandomProbePointSet;
 class Logger;
+class StatusDelta;
 
 #if SUPPORT_IOBITS
 class PortControl;
@@ -278,6 +279,7 @@ const FilePosition noFilePosition = 0xFFFFFFFF;
 namespace TaskPriority
 {
 	static constexpr int SpinPriority = 1;							// priority for tasks that rarely block
+	static constexpr int StoragePriority = 1;						// same as the spinning tasks so that they get time slices while the storage task waits for the SD card
 	static constexpr int HeatPriority = 2;
 	static constexpr int DhtPriority = 2;
 	static constexpr int TmcPriority = 2;
@@ -0,0 +1,198 @@
+/*
+ * StatusDelta.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ */
+
+#include "StatusDelta.h"
+#include "OutputMemory.h"
+#include "Storage/CRC32.h"
+
+uint32_t StatusDelta::seq = 0;
+
+StatusDelta::StatusDelta() : numFields(0), layoutSeq(0), lastFullSnapshotTime(0)
+{
+}
+
+// Return the next character, or -1 at the end of the chain
+int StatusDelta::Reader::Next()
+{
+	while (current != nullptr && index == current->DataLength())
+	{
+		current = current->Next();
+		index = 0;
+	}
+	return (current == nullptr) ? -1 : current->Data()[index++];
+}
+
+// Read one "key":value member of the top-level object, starting after the '{' or ',' before it, and optionally copy it to a buffer.
+// Return the character that ended it, which is ',' or '}', 0 if there was no member because the object is empty, or -1 if the JSON is malformed.
+/*static*/ int StatusDelta::ReadField(Reader& r, uint32_t& keyCrc, uint32_t& valueCrc, OutputBuffer *copyTo)
+{
+	CRC32 crc;
+	bool inKey = true, inString = false, escaped = false, empty = true;
+	unsigned int depth = 0;
+	for (;;)
+	{
+		const int c = r.Next();
+		if (c < 0)
+		{
+			return -1;
+		}
+		if (!inString && depth == 0 && (c == ',' || c == '}'))
+		{
+			if (inKey)
+			{
+				return (empty && c == '}') ? 0 : -1;			// either "{}" or a member with no value
+			}
+			valueCrc = crc.Get();
+			return c;
+		}
+		empty = false;
+
+		if (copyTo != nullptr)
+		{
+			copyTo->cat((char)c);
+		}
+
+		if (inKey && !inString && c == ':')
+		{
+			keyCrc = crc.Get();
+			crc.Reset();
+			inKey = false;
+			continue;
+		}
+
+		crc.Update((char)c);
+		if (inString)
+		{
+			if (escaped)
+			{
+				escaped = false;
+			}
+			else if (c == '\\')
+			{
+				escaped = true;
+			}
+			else if (c == '"')
+			{
+				inString = false;
+			}
+		}
+		else if (c == '"')
+		{
+			inString = true;
+		}
+		else if (c == '{' || c == '[')
+		{
+			++depth;
+		}
+		else if (c == '}' || c == ']')
+		{
+			if (depth == 0)
+			{
+				return -1;
+			}
+			--depth;
+		}
+	}
+}
+
+// Make a response that has only the fields that have changed since 'since', and release the full status
+OutputBuffer *StatusDelta::MakeDelta(OutputBuffer *status, uint32_t since)
+{
+	// First record which fields have changed
+	const uint32_t newSeq = seq + 1;
+	bool changed = false, layoutChanged = false;
+	size_t n = 0;
+	Reader reader(status);
+	if (reader.Next() != '{')
+	{
+		return status;											// we can't make a delta of this, so send it unchanged
+	}
+
+	int term;
+	do
+	{
+		uint32_t keyCrc, valueCrc;
+		term = ReadField(reader, keyCrc, valueCrc, nullptr);
+		if (term < 0 || (term == 0 && n != 0))
+		{
+			return status;
+		}
+		if (term == 0)
+		{
+			break;												// the object is empty
+		}
+
+		if (n < MaxFields)
+		{
+			FieldInfo& f = fields[n];
+			if (layoutChanged || n >= numFields || f.keyCrc != keyCrc)
+			{
+				layoutChanged = true;
+				f.keyCrc = keyCrc;
+				f.valueCrc = valueCrc;
+				f.changedSeq = newSeq;
+			}
+			else if (f.valueCrc != valueCrc)
+			{
+				f.valueCrc = valueCrc;
+				f.changedSeq = newSeq;
+				changed = true;
+			}
+		}
+		++n;
+	} while (term == ',');
+
+	if (n != numFields)
+	{
+		layoutChanged = true;
+		numFields = n;											// the count of all the fields, so that a change after the first MaxFields is seen
+	}
+
+	const uint32_t now = millis();
+	if (layoutChanged || now - lastFullSnapshotTime >= FullSnapshotInterval)
+	{
+		layoutSeq = newSeq;
+		lastFullSnapshotTime = now;
+		changed = true;
+	}
+	if (changed)
+	{
+		seq = newSeq;
+	}
+
+	// Now copy the fields that the client needs
+	OutputBuffer *response;
+	if (!OutputBuffer::Allocate(response))
+	{
+		OutputBuffer::ReleaseAll(status);
+		return nullptr;
+	}
+
+	const bool full = (since < layoutSeq || since > seq);		// a sequence number from the future must be from before we were reset
+	response->printf("{\"seq\":%" PRIu32 ",\"full\":%d", seq, (full) ? 1 : 0);
+	Reader copier(status);
+	(void)copier.Next();
+	for (size_t i = 0; i < n; ++i)
+	{
+		const bool include = full || i >= MaxFields || fields[i].changedSeq > since;
+		if (include)
+		{
+			response->cat(',');
+		}
+		uint32_t keyCrc, valueCrc;
+		if (ReadField(copier, keyCrc, valueCrc, (include) ? response : nullptr) != ',')
+		{
+			break;
+		}
+	}
+	response->cat('}');
+
+	OutputBuffer::ReleaseAll(status);
+	return response;
+}
+
+// End
@@ -0,0 +1,58 @@
+/*
+ * StatusDelta.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Turns a JSON status response into one that contains only the top-level fields that have changed since a sequence number that the client gives us.
+ *  We keep a CRC of each top-level field of the last response of the same type, and the sequence number at which it last changed.
+ *  The response starts with "seq", which the client passes back next time, and "full", which is 1 if the response has all the fields.
+ *  A client gets all the fields when it passes 0, when the set of fields has changed since its sequence number, and at least once every FullSnapshotInterval.
+ */
+
+#ifndef SRC_STATUSDELTA_H_
+#define SRC_STATUSDELTA_H_
+
+#include "RepRapFirmware.h"
+
+class StatusDelta
+{
+public:
+	StatusDelta();
+
+	OutputBuffer *MakeDelta(OutputBuffer *status, uint32_t since);		// takes ownership of the status, returns nullptr if we ran out of buffers
+
+private:
+	static constexpr size_t MaxFields = 32;						// fields after this many are always sent
+	static constexpr uint32_t FullSnapshotInterval = 60000;		// milliseconds
+
+	// Read the top-level fields of a status response one character at a time, across the buffers of the chain
+	class Reader
+	{
+	public:
+		Reader(const OutputBuffer *buf) : current(buf), index(0) { }
+		int Next();
+
+	private:
+		const OutputBuffer *current;
+		size_t index;
+	};
+
+	struct FieldInfo
+	{
+		uint32_t keyCrc;
+		uint32_t valueCrc;
+		uint32_t changedSeq;
+	};
+
+	static int ReadField(Reader& r, uint32_t& keyCrc, uint32_t& valueCrc, OutputBuffer *copyTo);
+
+	FieldInfo fields[MaxFields];
+	size_t numFields;											// including any after the first MaxFields, which have no FieldInfo
+	uint32_t layoutSeq;											// when the set of fields last changed, or we last forced a full response
+	uint32_t lastFullSnapshotTime;
+
+	static uint32_t seq;										// shared by all response types, so that a sequence number means the same to all of them
+};
+
+#endif /* SRC_STATUSDELTA_H_ */
@@ -11,7 +11,8 @@ private:
 public:
 	CRC32();
 	void Update(char c);
-	void Update(const char *c, size_t len);
+	void Update(const uint8_t *c, size_t len);
+	void Update(const char *c, size_t len) { Update(reinterpret_cast<const uint8_t*>(c), len); }
 	void Reset();
 	uint32_t Get() const;
 };
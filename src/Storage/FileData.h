@@ -66,11 +66,26 @@ public:
 		return f->Write(s, len);
 	}
 
+	bool CanWriteWithoutWaiting(size_t len) const
+	{
+		return f->CanWriteWithoutWaiting(len);
+	}
+
 	bool Write(const uint8_t *s, size_t len)
 	{
 		return f->Write(s, len);
 	}
 
+	bool WriteInBackground(const char *s, size_t len, bool sync)
+	{
+		return f->WriteInBackground(s, len, sync);
+	}
+
+	bool CanWriteInBackground() const
+	{
+		return f->CanWriteInBackground();
+	}
+
 	// This returns the CRC32 of data written to a newly-created file. It does not calculate the CRC of an existing file.
 	uint32_t GetCrc32() const
 	{
@@ -0,0 +1,175 @@
+/*
+ * FileInfoCache.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ */
+
+#include "FileInfoCache.h"
+#include "FileInfoParser.h"
+#include "MassStorage.h"
+#include "CRC32.h"
+#include "Platform.h"
+#include "RepRap.h"
+
+// Return the position in the index file of the record for the specified file. FatFS file names are not case sensitive, so neither is the hash.
+/*static*/ FilePosition FileInfoCache::GetRecordPosition(const char *filePath)
+{
+	CRC32 crc;
+	while (*filePath != 0)
+	{
+		crc.Update((char)tolower(*filePath++));
+	}
+	return (FilePosition)((crc.Get() % NumRecords) * RecordSize);
+}
+
+/*static*/ uint32_t FileInfoCache::GetRecordCrc(const Record& r)
+{
+	CRC32 crc;
+	crc.Update(reinterpret_cast<const char*>(&r), offsetof(Record, crc));
+	return crc.Get();
+}
+
+// Open the index file and read the record slot for the specified file into 'record'. If the slot doesn't hold a valid record for that file, clear the magic number.
+// If successful, return the open file, which the caller must close.
+FileStore *FileInfoCache::ReadRecord(const char *filePath, bool forWriting)
+{
+	FileStore * const f = reprap.GetPlatform().OpenSysFile(IndexFileName, (forWriting) ? OpenMode::append : OpenMode::read);
+	if (f == nullptr)
+	{
+		return nullptr;
+	}
+
+	if (   !f->Seek(GetRecordPosition(filePath))
+		|| f->Read(reinterpret_cast<char*>(&record), sizeof(record)) != (int)sizeof(record)
+		|| record.magic != RecordMagic
+		|| record.crc != GetRecordCrc(record)
+		|| !StringEqualsIgnoreCase(record.filePath, filePath)
+	   )
+	{
+		record.magic = 0;
+	}
+	return f;
+}
+
+// Write 'record' to the slot for the specified file and close the index file
+bool FileInfoCache::WriteRecord(FileStore *f, const char *filePath)
+{
+	record.crc = GetRecordCrc(record);
+	bool ok = f->Seek(GetRecordPosition(filePath)) && f->Write(reinterpret_cast<const char*>(&record), sizeof(record));
+	if (!f->Close())
+	{
+		ok = false;
+	}
+	return ok;
+}
+
+// Look up the information for a file. The caller must already have set up the size and last modified time in 'info'.
+bool FileInfoCache::Lookup(const char *filePath, GCodeFileInfo& info)
+{
+	FileStore * const f = ReadRecord(filePath, false);
+	if (f == nullptr)
+	{
+		return false;
+	}
+	f->Close();
+
+	if (record.magic != RecordMagic || record.fileSize != info.fileSize || record.lastModifiedTime != (uint32_t)info.lastModifiedTime)
+	{
+		return false;
+	}
+
+	info.printTime = record.printTime;
+	info.simulatedTime = record.simulatedTime;
+	info.layerHeight = record.layerHeight;
+	info.firstLayerHeight = record.firstLayerHeight;
+	info.objectHeight = record.objectHeight;
+	info.numFilaments = min<unsigned int>(record.numFilaments, MaxExtruders);
+	for (size_t extr = 0; extr < MaxExtruders; ++extr)
+	{
+		info.filamentNeeded[extr] = record.filamentNeeded[extr];
+	}
+	record.generatedBy[sizeof(record.generatedBy) - 1] = 0;
+	info.generatedBy.copy(record.generatedBy);
+	info.isValid = true;
+	info.incomplete = false;
+	return true;
+}
+
+// Record the information for a file that we have finished parsing
+void FileInfoCache::Store(const char *filePath, const GCodeFileInfo& info)
+{
+	if (strlen(filePath) >= sizeof(record.filePath))
+	{
+		return;
+	}
+
+	FileStore * const f = reprap.GetPlatform().OpenSysFile(IndexFileName, OpenMode::append);
+	if (f == nullptr)
+	{
+		return;
+	}
+
+	memset(&record, 0, sizeof(record));									// so that the padding bytes don't vary
+	record.magic = RecordMagic;
+	record.fileSize = info.fileSize;
+	record.lastModifiedTime = (uint32_t)info.lastModifiedTime;
+	record.printTime = info.printTime;
+	record.simulatedTime = info.simulatedTime;
+	record.layerHeight = info.layerHeight;
+	record.firstLayerHeight = info.firstLayerHeight;
+	record.objectHeight = info.objectHeight;
+	record.numFilaments = (uint8_t)info.numFilaments;
+	for (size_t extr = 0; extr < MaxExtruders; ++extr)
+	{
+		record.filamentNeeded[extr] = info.filamentNeeded[extr];
+	}
+	SafeStrncpy(record.generatedBy, info.generatedBy.c_str(), sizeof(record.generatedBy));
+	SafeStrncpy(record.filePath, filePath, sizeof(record.filePath));
+	(void)WriteRecord(f, filePath);
+}
+
+// Forget the information for a file, for example because a new version of it has been uploaded
+void FileInfoCache::Invalidate(const char *filePath)
+{
+	FileStore * const f = ReadRecord(filePath, false);
+	if (f == nullptr)
+	{
+		return;																// no index file, so nothing to invalidate
+	}
+	f->Close();
+
+	if (record.magic == RecordMagic)
+	{
+		FileStore * const wf = reprap.GetPlatform().OpenSysFile(IndexFileName, OpenMode::append);
+		if (wf != nullptr)
+		{
+			record.magic = 0;
+			(void)WriteRecord(wf, filePath);
+		}
+	}
+}
+
+// Update the record for a file after the simulated print time has been written to the end of it.
+// Writing the simulated time changes the size of the file but its last modified time is restored afterwards, so the record remains valid if it matched the old size.
+void FileInfoCache::UpdateSimulatedTime(const char *filePath, FilePosition oldSize, FilePosition newSize, uint32_t simSeconds)
+{
+	FileStore * const f = ReadRecord(filePath, true);
+	if (f == nullptr)
+	{
+		return;
+	}
+
+	if (record.magic == RecordMagic && record.fileSize == oldSize)
+	{
+		record.fileSize = newSize;
+		record.simulatedTime = simSeconds;
+		(void)WriteRecord(f, filePath);
+	}
+	else
+	{
+		f->Close();
+	}
+}
+
+// End
@@ -0,0 +1,65 @@
+/*
+ * FileInfoCache.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Persistent index of the results of parsing G-code files, so that repeat requests for file info don't have to read the header and footer of the file again.
+ *  The index is a file on the SD card that holds a fixed number of records. Each record occupies its own 512-byte sector, so a lookup is a single sector read.
+ *  A record is found by hashing the path of the file, and it is only used if the size and last modified time of the file still match it.
+ *  Two files whose paths hash to the same record evict each other, which costs a parse but never returns wrong information.
+ */
+
+#ifndef SRC_STORAGE_FILEINFOCACHE_H_
+#define SRC_STORAGE_FILEINFOCACHE_H_
+
+#include "RepRapFirmware.h"
+
+struct GCodeFileInfo;
+
+class FileInfoCache
+{
+public:
+	FileInfoCache() { }
+
+	bool Lookup(const char *filePath, GCodeFileInfo& info);									// fill in 'info' and return true if we have a valid record for this file
+	void Store(const char *filePath, const GCodeFileInfo& info);							// record the information for a file whose parsing completed
+	void Invalidate(const char *filePath);													// forget anything we have recorded about a file
+	void UpdateSimulatedTime(const char *filePath, FilePosition oldSize, FilePosition newSize, uint32_t simSeconds);	// record a new simulated time after it was appended to the file
+
+	static constexpr const char* IndexFileName = "fileinfo.idx";		// in the system directory
+	static constexpr size_t NumRecords = 256;
+	static constexpr size_t RecordSize = 512;
+
+private:
+	static constexpr uint32_t RecordMagic = 0x31494652;					// "RFI1" - change this if the record layout changes
+
+	// This is what we write in each record slot of the index file. It must be 32-bit aligned because we read it directly from the SD card.
+	struct Record
+	{
+		uint32_t magic;
+		uint32_t fileSize;
+		uint32_t lastModifiedTime;
+		uint32_t printTime;
+		uint32_t simulatedTime;
+		float layerHeight;
+		float firstLayerHeight;
+		float objectHeight;
+		float filamentNeeded[MaxExtruders];
+		uint8_t numFilaments;
+		char generatedBy[51];
+		char filePath[MaxFilenameLength + 1];
+		uint32_t crc;													// CRC of all the preceding fields
+	};
+
+	static_assert(sizeof(Record) <= RecordSize, "File info cache record is too big");
+
+	static FilePosition GetRecordPosition(const char *filePath);
+	static uint32_t GetRecordCrc(const Record& r);
+	FileStore *ReadRecord(const char *filePath, bool forWriting);
+	bool WriteRecord(FileStore *f, const char *filePath);
+
+	Record record;														// static buffer so that we don't need a large stack in the calling tasks
+};
+
+#endif /* SRC_STORAGE_FILEINFOCACHE_H_ */
@@ -11,6 +11,58 @@
 #include "Platform.h"
 #include "PrintMonitor.h"
 #include "GCodes/GCodes.h"
+#include "KeywordScanner.h"
+
+// The keys that we look for in the header and footer of a G-code file. They are all found by a single pass of the keyword scanner over each chunk of the file.
+// The layer height, slicer and print time keys are each tried in table order, so if a key is a leading or embedded substring of another, the longer one must come first.
+constexpr size_t LayerHeightKeys = 0, NumLayerHeightKeys = 5;
+constexpr size_t GeneratedByKeys = LayerHeightKeys + NumLayerHeightKeys, NumGeneratedByKeys = 5;
+constexpr size_t PrintTimeKeys = GeneratedByKeys + NumGeneratedByKeys, NumPrintTimeKeys = 5;
+constexpr size_t SimulatedTimeKey = PrintTimeKeys + NumPrintTimeKeys;
+constexpr size_t FilamentUsedKey = SimulatedTimeKey + 1;
+constexpr size_t MaterialUsedKey = FilamentUsedKey + 1;
+constexpr size_t FilamentLengthKey = MaterialUsedKey + 1;
+constexpr size_t KisslicerExtruderKey = FilamentLengthKey + 1;
+constexpr size_t KisslicerVolumeKey = KisslicerExtruderKey + 1;
+
+static constexpr const char *FileInfoKeys[] =
+{
+	// Layer height
+	"layer_height",									// slic3r
+	"Layer height",									// Cura
+	"layerHeight",									// S3D
+	"layer_thickness_mm",							// Kisslicer
+	"layerThickness",								// Matter Control
+
+	// Slicer
+	"generated by ",								// slic3r and S3D
+	";Sliced by ",									// ideaMaker
+	"; KISSlicer",									// KISSlicer
+	";Sliced at: ",									// Cura (old)
+	";Generated with ",								// Cura (new)
+
+	// Estimated print time
+	" estimated printing time (normal mode)",		// slic3r PE later versions	"; estimated printing time (normal mode) = 1h 5m 24s"
+	" estimated printing time",						// slic3r PE older versions	"; estimated printing time = 1h 5m 24s"
+	";TIME",										// Cura						";TIME:38846"
+	" Build time",									// S3D						";   Build time: 0 hours 42 minutes"
+	" Build Time",									// KISSlicer				"; Estimated Build Time:   332.83 minutes"
+													// also KISSSlicer 2 alpha	"; Calculated-during-export Build Time: 130.62 minutes"
+	// Simulated print time
+	FileInfoParser::SimulatedTimeString,
+
+	// Filament used
+	"ilament used",									// slic3r and Cura, followed by filament used and "mm"
+	";Material#",									// Ideamaker, e.g. ";Material#1 Used: 868.0"
+	"ilament length",								// S3D
+	";    Ext ",									// recent KISSlicer versions
+	"; Estimated Build Volume: "					// old KISSlicer, which only generates the filament volume
+};
+
+static_assert(ARRAY_SIZE(FileInfoKeys) == KisslicerVolumeKey + 1, "Incorrect FileInfoKeys table");
+static_assert(ARRAY_SIZE(FileInfoKeys) == FileInfoParser::NumFileInfoKeys, "Incorrect NumFileInfoKeys");
+
+static constexpr KeywordScanner<ARRAY_SIZE(FileInfoKeys), TotalKeywordLength(FileInfoKeys) + 1> fileInfoScanner(FileInfoKeys);
 
 void GCodeFileInfo::Init()
 {
@@ -100,6 +152,16 @@ bool FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& info, bool
 			info = parsedFileInfo;
 			return true;
 		}
+
+		// If we parsed this version of the file before, use the results from last time
+		if (infoCache.Lookup(filePath, parsedFileInfo))
+		{
+			fileBeingParsed->Close();
+			info = parsedFileInfo;
+			return true;
+		}
+
+		(void)fileBeingParsed->EnableFastSeek();				// so that we can seek straight to the footer
 		parseState = parsingHeader;
 	}
 
@@ -144,6 +206,8 @@ bool FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& info, bool
 				accumulatedReadTime += now - startTime;
 				startTime = now;
 
+				ScanForKeys(buf, sizeToScan);
+
 				// Search for filament usage (Cura puts it at the beginning of a G-code file)
 				if (parsedFileInfo.numFilaments == 0)
 				{
@@ -216,9 +280,9 @@ bool FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& info, bool
 					currentPos = 0;
 				}
 
-				// Seek at most 512 clusters at a time
+				// Seek at most 512 clusters at a time, unless the file has a cluster map in which case the seek doesn't depend on the distance
 				const FilePosition maxSeekDistance = 512 * (FilePosition)clsize;
-				const bool doFullSeek = (nextSeekPos <= currentPos + maxSeekDistance);
+				const bool doFullSeek = fileBeingParsed->HasFastSeek() || (nextSeekPos <= currentPos + maxSeekDistance);
 				const FilePosition thisSeekPos = (doFullSeek) ? nextSeekPos : currentPos + maxSeekDistance;
 
 				const uint32_t startTime = millis();
@@ -271,6 +335,7 @@ bool FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& info, bool
 				startTime = now;
 
 				bool footerInfoComplete = true;
+				ScanForKeys(buf, sizeToScan);
 
 				// Search for filament used
 				if (parsedFileInfo.numFilaments == 0)
@@ -333,6 +398,7 @@ bool FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& info, bool
 					parseState = notParsing;
 					fileBeingParsed->Close();
 					parsedFileInfo.incomplete = false;
+					infoCache.Store(filePath, parsedFileInfo);
 					info = parsedFileInfo;
 					return true;
 				}
@@ -364,6 +430,37 @@ bool FileInfoParser::GetFileInfo(const char *filePath, GCodeFileInfo& info, bool
 	return false;
 }
 
+// Forget any cached information about a file, e.g. because it has just been replaced
+void FileInfoParser::InvalidateCachedInfo(const char *filePath)
+{
+	MutexLocker lock(parserMutex);
+	infoCache.Invalidate(filePath);
+}
+
+// Update the cached information about a file after its simulated print time has been rewritten
+void FileInfoParser::UpdateCachedSimulatedTime(const char *filePath, FilePosition oldSize, FilePosition newSize, uint32_t simSeconds)
+{
+	MutexLocker lock(parserMutex);
+	infoCache.UpdateSimulatedTime(filePath, oldSize, newSize, simSeconds);
+}
+
+// Find the first occurrence of each key in the buffer, so that the functions that search for each item of information don't all have to scan the whole buffer.
+// The buffer is null-terminated, so those functions can use strstr to look for further occurrences of a key after the first one.
+void FileInfoParser::ScanForKeys(const char *buf, size_t len)
+{
+	for (const char *& p : keyPositions)
+	{
+		p = nullptr;
+	}
+	fileInfoScanner.Scan(buf, len, [this](size_t key, const char *pos)
+								{
+									if (keyPositions[key] == nullptr)
+									{
+										keyPositions[key] = pos;
+									}
+								});
+}
+
 // Scan the buffer for a G1 Zxxx command. The buffer is null-terminated.
 bool FileInfoParser::FindFirstLayerHeight(const char* buf, size_t len)
 {
@@ -537,31 +634,20 @@ bool FileInfoParser::FindHeight(const char* buf, size_t len)
 // Scan the buffer for the layer height. The buffer is null-terminated.
 bool FileInfoParser::FindLayerHeight(const char *buf, size_t len)
 {
-	static const char* const layerHeightStrings[] =
-	{
-		"layer_height",			// slic3r
-		"Layer height",			// Cura
-		"layerHeight",			// S3D
-		"layer_thickness_mm",	// Kisslicer
-		"layerThickness"		// Matter Control
-	};
-
 	if (*buf != 0)
 	{
-		++buf;														// make sure we can look back 1 character after we find a match
-		for (const char * lhStr : layerHeightStrings)				// search for each string in turn
+		for (size_t key = LayerHeightKeys; key < LayerHeightKeys + NumLayerHeightKeys; ++key)	// try each string in turn
 		{
-			const char *pos = buf;
-			for(;;)													// loop until success or strstr returns null
+			const char * const lhStr = FileInfoKeys[key];
+			const char *pos = keyPositions[key];
+			if (pos == buf)
+			{
+				pos = strstr(buf + 1, lhStr);						// make sure we can look back 1 character after we find a match
+			}
+			while (pos != nullptr)									// loop until success or there are no more occurrences of this string
 			{
-				pos = strstr(pos, lhStr);
-				if (pos == nullptr)
-				{
-					break;											// didn't find this string in the buffer, so try the next string
-				}
-
 				const char c = pos[-1];								// fetch the previous character
-				pos += strlen(lhStr);				// skip the string we matched
+				pos += strlen(lhStr);								// skip the string we matched
 				if (c == ' ' || c == ';' || c == '\t')				// check we are not in the middle of a word
 				{
 					while (strchr(" \t=:,", *pos) != nullptr)		// skip the possible separators
@@ -576,6 +662,7 @@ bool FileInfoParser::FindLayerHeight(const char *buf, size_t len)
 						return true;
 					}
 				}
+				pos = strstr(pos, lhStr);
 			}
 		}
 	}
@@ -585,26 +672,17 @@ bool FileInfoParser::FindLayerHeight(const char *buf, size_t len)
 
 bool FileInfoParser::FindSlicerInfo(const char* buf, size_t len)
 {
-	static const char * const GeneratedByStrings[] =
-	{
-		"generated by ",	// slic3r and S3D
-		";Sliced by ",		// ideaMaker
-		"; KISSlicer",		// KISSlicer
-		";Sliced at: ",		// Cura (old)
-		";Generated with "	// Cura (new)
-	};
-
 	size_t index = 0;
 	const char* pos;
 	do
 	{
-		pos = strstr(buf, GeneratedByStrings[index]);
+		pos = keyPositions[GeneratedByKeys + index];
 		if (pos != nullptr)
 		{
 			break;
 		}
 		++index;
-	} while (index < ARRAY_SIZE(GeneratedByStrings));
+	} while (index < NumGeneratedByKeys);
 
 	if (pos != nullptr)
 	{
@@ -612,7 +690,7 @@ bool FileInfoParser::FindSlicerInfo(const char* buf, size_t len)
 		switch (index)
 		{
 		default:
-			pos += strlen(GeneratedByStrings[index]);
+			pos += strlen(FileInfoKeys[GeneratedByKeys + index]);
 			break;
 
 		case 2:		// KISSlicer
@@ -621,7 +699,7 @@ bool FileInfoParser::FindSlicerInfo(const char* buf, size_t len)
 
 		case 3:		// Cura (old)
 			introString = "Cura at ";
-			pos += strlen(GeneratedByStrings[index]);
+			pos += strlen(FileInfoKeys[GeneratedByKeys + index]);
 			break;
 		}
 
@@ -643,9 +721,8 @@ unsigned int FileInfoParser::FindFilamentUsed(const char* buf, size_t len)
 	const size_t maxFilaments = reprap.GetGCodes().GetNumExtruders();
 
 	// Look for filament usage as generated by Slic3r and Cura
-	const char* const filamentUsedStr1 = "ilament used";			// comment string used by slic3r and Cura, followed by filament used and "mm"
-	const char* p = buf;
-	while (filamentsFound < maxFilaments &&	(p = strstr(p, filamentUsedStr1)) != nullptr)
+	const char* const filamentUsedStr1 = FileInfoKeys[FilamentUsedKey];
+	for (const char *p = keyPositions[FilamentUsedKey]; filamentsFound < maxFilaments && p != nullptr; p = strstr(p, filamentUsedStr1))
 	{
 		p += strlen(filamentUsedStr1);
 		while(strchr(" [m]:=\t", *p) != nullptr)					// Prusa slicer now uses "; filament used [mm] = 4235.9"
@@ -678,9 +755,8 @@ unsigned int FileInfoParser::FindFilamentUsed(const char* buf, size_t len)
 	}
 
 	// Look for filament usage string generated by Ideamaker
-	const char* const filamentUsedStr2 = ";Material#";			// comment string used by Ideamaker, e.g. ";Material#1 Used: 868.0"
-	p = buf;
-	while (filamentsFound < maxFilaments &&	(p = strstr(p, filamentUsedStr2)) != nullptr)
+	const char* const filamentUsedStr2 = FileInfoKeys[MaterialUsedKey];
+	for (const char *p = keyPositions[MaterialUsedKey]; filamentsFound < maxFilaments && p != nullptr; p = strstr(p, filamentUsedStr2))
 	{
 		p += strlen(filamentUsedStr2);
 		const char *q;
@@ -703,9 +779,8 @@ unsigned int FileInfoParser::FindFilamentUsed(const char* buf, size_t len)
 	// Look for filament usage as generated by S3D
 	if (filamentsFound == 0)
 	{
-		const char *filamentLengthStr = "ilament length";	// comment string used by S3D
-		p = buf;
-		while (filamentsFound < maxFilaments &&	(p = strstr(p, filamentLengthStr)) != nullptr)
+		const char *filamentLengthStr = FileInfoKeys[FilamentLengthKey];
+		for (const char *p = keyPositions[FilamentLengthKey]; filamentsFound < maxFilaments && p != nullptr; p = strstr(p, filamentLengthStr))
 		{
 			p += strlen(filamentLengthStr);
 			while(strchr(" :=\t", *p) != nullptr)
@@ -723,9 +798,8 @@ unsigned int FileInfoParser::FindFilamentUsed(const char* buf, size_t len)
 	// Look for filament usage as generated by recent KISSlicer versions
 	if (filamentsFound == 0)
 	{
-		const char *filamentLengthStr = ";    Ext ";
-		p = buf;
-		while (filamentsFound < maxFilaments && (p = strstr(p, filamentLengthStr)) != nullptr)
+		const char *filamentLengthStr = FileInfoKeys[KisslicerExtruderKey];
+		for (const char *p = keyPositions[KisslicerExtruderKey]; filamentsFound < maxFilaments && p != nullptr; p = strstr(p, filamentLengthStr))
 		{
 			p += strlen(filamentLengthStr);
 			if (*p == '#')
@@ -752,8 +826,8 @@ unsigned int FileInfoParser::FindFilamentUsed(const char* buf, size_t len)
 	// Special case: Old KISSlicer only generates the filament volume, so we need to calculate the length from it
 	if (filamentsFound == 0)
 	{
-		const char *filamentVolumeStr = "; Estimated Build Volume: ";
-		p = strstr(buf, filamentVolumeStr);
+		const char *filamentVolumeStr = FileInfoKeys[KisslicerVolumeKey];
+		const char * const p = keyPositions[KisslicerVolumeKey];
 		if (p != nullptr)
 		{
 			const float filamentCMM = SafeStrtof(p + strlen(filamentVolumeStr), nullptr) * 1000.0;
@@ -767,23 +841,12 @@ unsigned int FileInfoParser::FindFilamentUsed(const char* buf, size_t len)
 // Scan the buffer for the estimated print time
 bool FileInfoParser::FindPrintTime(const char* buf, size_t len)
 {
-	static const char* const PrintTimeStrings[] =
-	{
-		// Note: if a string in this table is a leading or embedded substring of another, the longer one must come first
-		" estimated printing time (normal mode)",	// slic3r PE later versions	"; estimated printing time (normal mode) = 1h 5m 24s"
-		" estimated printing time",					// slic3r PE older versions	"; estimated printing time = 1h 5m 24s"
-		";TIME",									// Cura						";TIME:38846"
-		" Build time",								// S3D						";   Build time: 0 hours 42 minutes"
-		" Build Time"								// KISSlicer				"; Estimated Build Time:   332.83 minutes"
-													// also KISSSlicer 2 alpha	"; Calculated-during-export Build Time: 130.62 minutes"
-	};
-
-	for (const char * ptStr : PrintTimeStrings)
+	for (size_t key = PrintTimeKeys; key < PrintTimeKeys + NumPrintTimeKeys; ++key)
 	{
-		const char* pos = strstr(buf, ptStr);
+		const char* pos = keyPositions[key];
 		if (pos != nullptr)
 		{
-			pos += strlen(ptStr);
+			pos += strlen(FileInfoKeys[key]);
 			while (strchr(" \t=:", *pos))
 			{
 				++pos;
@@ -838,7 +901,7 @@ bool FileInfoParser::FindPrintTime(const char* buf, size_t len)
 // Scan the buffer for the simulated print time
 bool FileInfoParser::FindSimulatedTime(const char* buf, size_t len)
 {
-	const char* pos = strstr(buf, SimulatedTimeString);
+	const char* pos = keyPositions[SimulatedTimeKey];
 	if (pos != nullptr)
 	{
 		pos += strlen(SimulatedTimeString);
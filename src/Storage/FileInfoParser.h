@@ -10,6 +10,7 @@
 
 #include "RepRapFirmware.h"
 #include "RTOSIface/RTOSIface.h"
+#include "FileInfoCache.h"
 
 const FilePosition GCODE_HEADER_SIZE = 20000uL;		// How many bytes to read from the header - I (DC) have a Kisslicer file with a layer height comment 14Kb from the start
 const FilePosition GCODE_FOOTER_SIZE = 400000uL;	// How many bytes to read from the footer
@@ -63,11 +64,16 @@ public:
 	// The following method needs to be called until it returns true - this may take a few runs
 	bool GetFileInfo(const char *filePath, GCodeFileInfo& info, bool quitEarly);
 
+	void InvalidateCachedInfo(const char *filePath);
+	void UpdateCachedSimulatedTime(const char *filePath, FilePosition oldSize, FilePosition newSize, uint32_t simSeconds);
+
 	static constexpr const char* SimulatedTimeString = "\n; Simulated print time";	// used by FileInfoParser and MassStorage
+	static constexpr size_t NumFileInfoKeys = 21;										// number of strings that we search G-code files for
 
 private:
 
 	// G-Code parser methods
+	void ScanForKeys(const char *buf, size_t len);
 	bool FindHeight(const char* buf, size_t len);
 	bool FindFirstLayerHeight(const char* buf, size_t len);
 	bool FindLayerHeight(const char* buf, size_t len);
@@ -87,6 +93,8 @@ private:
 	uint32_t lastFileParseTime;
 	uint32_t accumulatedParseTime, accumulatedReadTime, accumulatedSeekTime;
 	size_t fileOverlapLength;
+	FileInfoCache infoCache;
+	const char *keyPositions[NumFileInfoKeys];								// where each key first occurs in the buffer, or nullptr if it doesn't
 
 	// We used to allocate the following buffer on the stack; but now that this is called by more than one task
 	// it is more economical to allocate it permanently because that lets us use smaller stacks.
@@ -0,0 +1,128 @@
+/*
+ * FileListGenerator.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ */
+
+#include "FileListGenerator.h"
+#include "MassStorage.h"
+#include "Platform.h"
+#include "RepRap.h"
+
+// Start a listing of the specified directory beginning at entry startAt, not counting hidden files
+void FileListGenerator::Start(const char *directory, unsigned int startAt, bool isDetailed, bool flagDirectories)
+{
+	MassStorage * const ms = reprap.GetPlatform().GetMassStorage();
+	dir = directory;
+	firstEntry = nextEntry = startAt;
+	err = (!ms->CheckDriveMounted(directory)) ? 1
+			: (!ms->DirectoryExists(directory)) ? 2
+				: 0;
+	detailed = isDetailed;
+	flagDirs = flagDirectories;
+	phase = Phase::start;
+}
+
+// Append the next part of the listing to buf, writing at most about maxBytes. Return true if we have written the end of the listing.
+// If paged is true then we end the listing when we run out of space and tell the client which entry the next page starts at.
+// Otherwise we stop when we run out of space and carry on from the same entry on the next call. If we can't fit even one entry in, we write nothing.
+bool FileListGenerator::Generate(OutputBuffer *buf, size_t maxBytes, bool paged)
+{
+	size_t bytesLeft = maxBytes;
+	if (phase == Phase::start)
+	{
+		size_t written = buf->cat("{\"dir\":");
+		written += buf->EncodeString(dir, false);
+		written += buf->catf(",\"first\":%u,\"files\":[", firstEntry);
+		bytesLeft = (written < bytesLeft) ? bytesLeft - written : 0;
+		phase = (err == 0) ? Phase::entries : Phase::end;
+	}
+
+	if (phase == Phase::entries)
+	{
+		MassStorage * const ms = reprap.GetPlatform().GetMassStorage();
+		FileInfo fileInfo;
+		bool gotFile = ms->FindFirstVisible(dir, nextEntry, fileInfo);	// this skips hidden files, and continues from where the previous part or page stopped
+		for (;;)
+		{
+			if (!gotFile)
+			{
+				nextEntry = 0;
+				phase = Phase::end;
+				break;
+			}
+
+			// Make sure we can end this response properly
+			if (bytesLeft < fileInfo.fileName.strlen() * 2 + ((detailed) ? 50 : 20))
+			{
+				// No more space available - stop here, so that the next part or page can continue from this file
+				ms->SuspendListing();
+				if (paged)
+				{
+					phase = Phase::end;
+				}
+				break;
+			}
+
+			// Write delimiter
+			if (nextEntry != firstEntry)
+			{
+				bytesLeft -= buf->cat(',');
+			}
+
+			bytesLeft -= WriteEntry(buf, fileInfo);
+			++nextEntry;
+			gotFile = ms->FindNextVisible(fileInfo);
+		}
+	}
+
+	if (phase == Phase::end)
+	{
+		// If there is no error, don't append "err":0 to the detailed list because if we do then DWC thinks there has been an error - looks like it doesn't check the value
+		if (err != 0)
+		{
+			buf->catf("],\"err\":%u}", err);
+		}
+		else if (detailed)
+		{
+			buf->catf("],\"next\":%u}", nextEntry);
+		}
+		else
+		{
+			buf->catf("],\"next\":%u,\"err\":%u}", nextEntry, err);
+		}
+		phase = Phase::finished;
+	}
+
+	return phase == Phase::finished;
+}
+
+// Write a file list entry, returning the number of characters written
+size_t FileListGenerator::WriteEntry(OutputBuffer *buf, const FileInfo& fileInfo) const
+{
+	if (!detailed)
+	{
+		return buf->EncodeString(fileInfo.fileName, false, flagDirs && fileInfo.isDirectory);
+	}
+
+	size_t written = buf->catf("{\"type\":\"%c\",\"name\":", fileInfo.isDirectory ? 'd' : 'f');
+	written += buf->EncodeString(fileInfo.fileName, false);
+	written += buf->catf(",\"size\":%" PRIu32, fileInfo.size);
+
+	const struct tm * const timeInfo = gmtime(&fileInfo.lastModified);
+	if (timeInfo->tm_year <= /*19*/80)
+	{
+		// Don't send the last modified date if it is invalid
+		written += buf->cat('}');
+	}
+	else
+	{
+		written += buf->catf(",\"date\":\"%04u-%02u-%02uT%02u:%02u:%02u\"}",
+				timeInfo->tm_year + 1900, timeInfo->tm_mon + 1, timeInfo->tm_mday,
+				timeInfo->tm_hour, timeInfo->tm_min, timeInfo->tm_sec);
+	}
+	return written;
+}
+
+// End
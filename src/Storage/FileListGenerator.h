@@ -0,0 +1,50 @@
+/*
+ * FileListGenerator.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Generator for the JSON directory listings returned by rr_files, rr_filelist and M20 S2/S3.
+ *  The listing can be generated a part at a time, so that the web server can send a listing of any length using HTTP chunked transfer encoding
+ *  while using only a few output buffers. Between parts the directory listing is suspended, so we don't hold the directory mutex while a part is
+ *  being sent, and MassStorage carries on from where the previous part stopped instead of reading the directory from the start again.
+ */
+
+#ifndef SRC_STORAGE_FILELISTGENERATOR_H_
+#define SRC_STORAGE_FILELISTGENERATOR_H_
+
+#include "RepRapFirmware.h"
+
+struct FileInfo;
+
+class FileListGenerator
+{
+public:
+	FileListGenerator() : dir(nullptr), firstEntry(0), nextEntry(0), err(0), detailed(false), flagDirs(false), phase(Phase::finished) { }
+
+	void Start(const char *directory, unsigned int startAt, bool isDetailed, bool flagDirectories);	// the directory name must remain valid until the listing is finished
+	bool Generate(OutputBuffer *buf, size_t maxBytes, bool paged);		// append the next part of the listing to buf, returning true if it is complete
+	bool IsFinished() const { return phase == Phase::finished; }
+	void Abandon() { phase = Phase::finished; }
+
+private:
+	enum class Phase : uint8_t
+	{
+		start,
+		entries,
+		end,
+		finished
+	};
+
+	size_t WriteEntry(OutputBuffer *buf, const FileInfo& fileInfo) const;
+
+	const char *dir;
+	unsigned int firstEntry;						// the index of the first entry that was asked for
+	unsigned int nextEntry;							// the index of the next entry to list, or 0 if we have listed the last one
+	unsigned int err;
+	bool detailed;									// true for rr_filelist style entries that include the type, size and date
+	bool flagDirs;									// true to prefix the names of directories with '*' in entries that are not detailed
+	Phase phase;
+};
+
+#endif /* SRC_STORAGE_FILELISTGENERATOR_H_ */
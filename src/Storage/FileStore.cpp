@@ -9,8 +9,13 @@
 #include "Movement/StepTimer.h"
 
 uint32_t FileStore::longestWriteTime = 0;
+uint32_t FileStore::longestWriteWait = 0;
 
-FileStore::FileStore() : writeBuffer(nullptr)
+#ifdef RTOS
+constexpr uint32_t MaxWriteWaitMillis = 10000;			// how long we wait for queued writes before giving up, in case the SD card has failed
+#endif
+
+FileStore::FileStore() : writeBuffer(nullptr), clusterMap(nullptr), readAheadBuffer(nullptr)
 {
 	Init();
 }
@@ -19,6 +24,9 @@ void FileStore::Init()
 {
 	usageMode = FileUseMode::free;
 	openCount = 0;
+	pendingWrites = 0;
+	queuedWriteStatus = FR_OK;
+	openGeneration = 0;
 	closeRequested = false;
 }
 
@@ -39,6 +47,8 @@ bool FileStore::Invalidate(const FATFS *fs, bool doClose)
 				reprap.GetPlatform().GetMassStorage()->ReleaseWriteBuffer(writeBuffer);
 				writeBuffer = nullptr;
 			}
+			ReleaseClusterMap();
+			ReleaseReadAheadBuffer();
 		}
 		usageMode = FileUseMode::invalidated;
 		return true;
@@ -58,6 +68,21 @@ bool FileStore::Open(const char* filePath, OpenMode mode, uint32_t preAllocSize)
 {
 	const bool writing = (mode == OpenMode::write || mode == OpenMode::writeWithCrc || mode == OpenMode::append);
 	writeBuffer = nullptr;
+	clusterMap = nullptr;
+	readAheadBuffer = nullptr;
+	readAheadStart = readAheadEnd = 0;
+	gcodeFormat = GCodeFileFormat::unknown;
+
+	// Buffers that were queued when this object was last used may still be waiting for the storage task, if waiting for them timed out.
+	// Starting a new generation makes the storage task discard them instead of writing them to the new file.
+	{
+#ifdef RTOS
+		TaskCriticalSectionLocker lock;
+#endif
+		++openGeneration;
+		pendingWrites = 0;
+		queuedWriteStatus = FR_OK;
+	}
 
 	if (writing)
 	{
@@ -193,6 +218,10 @@ bool FileStore::Close()
 	case FileUseMode::invalidated:
 	default:
 		{
+			if (openCount <= 1 && !inInterrupt())
+			{
+				WaitForPendingWrites();							// the storage task may still have buffers that refer to this file object
+			}
 			const irqflags_t flags = cpu_irq_save();
 			if (openCount > 1)
 			{
@@ -221,8 +250,15 @@ bool FileStore::ForceClose()
 		reprap.GetPlatform().GetMassStorage()->ReleaseWriteBuffer(writeBuffer);
 		writeBuffer = nullptr;
 	}
+	ReleaseClusterMap();
+	ReleaseReadAheadBuffer();
 
+	// If waiting for the queued writes timed out, the storage task may still be writing to the file object, in which case we must leave it open
+#ifdef RTOS
+	const FRESULT fr = (reprap.GetPlatform().GetMassStorage()->IsStoringQueuedBuffer(this)) ? FR_TIMEOUT : f_close(&file);
+#else
 	const FRESULT fr = f_close(&file);
+#endif
 	usageMode = FileUseMode::free;
 	closeRequested = false;
 	openCount = 0;
@@ -239,6 +275,21 @@ bool FileStore::Seek(FilePosition pos)
 
 	case FileUseMode::readOnly:
 	case FileUseMode::readWrite:
+		if (!WaitForPendingWrites())
+		{
+			return false;
+		}
+		if (readAheadBuffer != nullptr)
+		{
+			// If the new position is within the data in the read-ahead buffer, e.g. because a G-code input is giving back the data it cached, we don't need to read it again
+			const FilePosition bufferStart = file.fptr - readAheadEnd;
+			if (pos >= bufferStart && pos <= file.fptr)
+			{
+				readAheadStart = (uint16_t)(pos - bufferStart);
+				return true;
+			}
+			readAheadStart = readAheadEnd = 0;
+		}
 		return f_lseek(&file, pos) == FR_OK;
 
 	case FileUseMode::invalidated:
@@ -249,7 +300,8 @@ bool FileStore::Seek(FilePosition pos)
 
 FilePosition FileStore::Position() const
 {
-	return (usageMode == FileUseMode::readOnly || usageMode == FileUseMode::readWrite) ? file.fptr : 0;
+	WaitForPendingWrites();
+	return (usageMode == FileUseMode::readOnly || usageMode == FileUseMode::readWrite) ? file.fptr - (readAheadEnd - readAheadStart) : 0;
 }
 
 uint32_t FileStore::ClusterSize() const
@@ -276,6 +328,7 @@ FilePosition FileStore::Length() const
 		return f_size(&file);
 
 	case FileUseMode::readWrite:
+		WaitForPendingWrites();
 		return (writeBuffer != nullptr) ? f_size(&file) + writeBuffer->BytesStored() : f_size(&file);
 
 	case FileUseMode::invalidated:
@@ -301,16 +354,11 @@ int FileStore::Read(char* extBuf, size_t nBytes)
 
 	case FileUseMode::readOnly:
 	case FileUseMode::readWrite:
+		if (!WaitForPendingWrites())
 		{
-			UINT bytes_read;
-			FRESULT readStatus = f_read(&file, extBuf, nBytes, &bytes_read);
-			if (readStatus != FR_OK)
-			{
-				reprap.GetPlatform().MessageF(ErrorMessage, "Cannot read file, error code %d\n", (int)readStatus);
-				return -1;
-			}
-			return (int)bytes_read;
+			return -1;
 		}
+		return (readAheadBuffer != nullptr) ? ReadBuffered(extBuf, nBytes) : ReadFile(extBuf, nBytes);
 
 	case FileUseMode::invalidated:
 	default:
@@ -318,6 +366,65 @@ int FileStore::Read(char* extBuf, size_t nBytes)
 	}
 }
 
+// Read into a 32-bit aligned buffer. If the read would cross a sector boundary then we stop at the last sector boundary instead, so that the next read starts
+// on a sector boundary. When it does, FatFS reads the whole sectors directly into the buffer using multi-sector reads, instead of transferring them one at a time
+// via its sector buffer and copying them. The SD card DMA needs the buffer to be 32-bit aligned.
+// Returns the number of bytes read or -1 if the read process failed.
+int FileStore::ReadSectors(uint32_t *buf, size_t maxBytes)
+{
+	if (readAheadBuffer != nullptr || usageMode != FileUseMode::readOnly)
+	{
+		return Read(reinterpret_cast<char*>(buf), maxBytes);
+	}
+
+	const size_t offsetInSector = file.fptr % FF_MAX_SS;
+	const size_t end = offsetInSector + maxBytes;
+	return ReadFile(reinterpret_cast<char*>(buf), (end >= FF_MAX_SS) ? (end & ~(FF_MAX_SS - 1)) - offsetInSector : maxBytes);
+}
+
+// Read directly from the file. Returns the number of bytes read or -1 if the read process failed.
+int FileStore::ReadFile(char *buf, size_t nBytes)
+{
+	UINT bytes_read;
+	const FRESULT readStatus = f_read(&file, buf, nBytes, &bytes_read);
+	if (readStatus != FR_OK)
+	{
+		reprap.GetPlatform().MessageF(ErrorMessage, "Cannot read file, error code %d\n", (int)readStatus);
+		return -1;
+	}
+	return (int)bytes_read;
+}
+
+// Read via the read-ahead buffer, refilling it from the file when it is empty. Returns the number of bytes read or -1 if the read process failed.
+int FileStore::ReadBuffered(char *buf, size_t nBytes)
+{
+	size_t bytesRead = 0;
+	while (bytesRead < nBytes)
+	{
+		if (readAheadStart == readAheadEnd)
+		{
+			readAheadStart = readAheadEnd = 0;
+			const size_t offsetInSector = file.fptr % FF_MAX_SS;
+			const int n = ReadFile(reinterpret_cast<char*>(readAheadBuffer), ReadAheadBufferSize - offsetInSector);	// end the read on a sector boundary
+			if (n < 0)
+			{
+				return -1;
+			}
+			if (n == 0)
+			{
+				break;														// end of file
+			}
+			readAheadEnd = (uint16_t)n;
+		}
+
+		const size_t bytesToCopy = min<size_t>(nBytes - bytesRead, readAheadEnd - readAheadStart);
+		memcpy(buf + bytesRead, reinterpret_cast<const char*>(readAheadBuffer) + readAheadStart, bytesToCopy);
+		readAheadStart += bytesToCopy;
+		bytesRead += bytesToCopy;
+	}
+	return (int)bytesRead;
+}
+
 // As Read but stop after '\n' or '\r\n' and null-terminate the string.
 // If the next line is too long to fit in the buffer then the line will be split.
 // Return the number of characters in the line excluding the null terminator, or -1 if end of file or a read error occurs.
@@ -394,7 +501,8 @@ bool FileStore::Write(const char *s, size_t len)
 			FRESULT writeStatus = FR_OK;
 			if (writeBuffer == nullptr)
 			{
-				writeStatus = Store(s, len, &totalBytesWritten);
+				(void)WaitForPendingWrites();								// WriteAndSync may have queued some data
+				writeStatus = (queuedWriteStatus != FR_OK) ? queuedWriteStatus : Store(s, len, &totalBytesWritten);
 			}
 			else
 			{
@@ -403,12 +511,8 @@ bool FileStore::Write(const char *s, size_t len)
 					size_t bytesStored = writeBuffer->Store(s + totalBytesWritten, len - totalBytesWritten);
 					if (writeBuffer->BytesLeft() == 0)
 					{
-						const size_t bytesToWrite = writeBuffer->BytesStored();
-						size_t bytesWritten;
-						writeStatus = Store(writeBuffer->Data(), bytesToWrite, &bytesWritten);
-						writeBuffer->DataTaken();
-
-						if (bytesToWrite != bytesWritten)
+						writeStatus = EmptyWriteBuffer();
+						if (writeStatus != FR_OK)
 						{
 							// Something went wrong
 							break;
@@ -416,7 +520,7 @@ bool FileStore::Write(const char *s, size_t len)
 					}
 					totalBytesWritten += bytesStored;
 				}
-				while (writeStatus == FR_OK && totalBytesWritten != len);
+				while (totalBytesWritten != len);
 			}
 
 			if ((writeStatus != FR_OK) || (totalBytesWritten != len))
@@ -433,6 +537,159 @@ bool FileStore::Write(const char *s, size_t len)
 	}
 }
 
+// Return true if writing len bytes won't have to wait for the SD card, because they fit in the write buffer or there is a free write buffer to carry on
+// with while the storage task writes the full one. This lets a task that receives data from elsewhere leave it where it is until the storage task catches up.
+// If there are no free buffers and none are queued for the storage task, then none will be freed by waiting, so we return true and the write goes straight to the card.
+bool FileStore::CanWriteWithoutWaiting(size_t len) const
+{
+#ifdef RTOS
+	if (usageMode == FileUseMode::readWrite && writeBuffer != nullptr && len >= writeBuffer->BytesLeft())
+	{
+		const MassStorage * const ms = reprap.GetPlatform().GetMassStorage();
+		return ms->HasFreeWriteBuffer() || (pendingWrites == 0 && !ms->HasQueuedWrites());
+	}
+#endif
+	return true;
+}
+
+// Write out the full write buffer. With RTOS we hand it to the storage task and carry on with another buffer, so that the caller doesn't have to wait
+// for the SD card. If all the buffers are in use, we wait for the ones already queued for this file. Only when none are queued for this file do we
+// write the buffer ourselves, so the data always reaches the file in order.
+FRESULT FileStore::EmptyWriteBuffer()
+{
+#ifdef RTOS
+	MassStorage * const ms = reprap.GetPlatform().GetMassStorage();
+	FileWriteBuffer *newBuffer = ms->AllocateWriteBuffer();
+	if (newBuffer == nullptr && pendingWrites != 0)
+	{
+		if (!WaitForPendingWrites())
+		{
+			return queuedWriteStatus;
+		}
+		newBuffer = ms->AllocateWriteBuffer();
+	}
+
+	if (queuedWriteStatus != FR_OK)
+	{
+		if (newBuffer != nullptr)
+		{
+			ms->ReleaseWriteBuffer(newBuffer);
+		}
+		return queuedWriteStatus;
+	}
+
+	if (newBuffer != nullptr)
+	{
+		ms->QueueWriteBuffer(this, writeBuffer);
+		writeBuffer = newBuffer;
+		return FR_OK;
+	}
+#endif
+
+	const size_t bytesToWrite = writeBuffer->BytesStored();
+	size_t bytesWritten;
+	const FRESULT writeStatus = Store(writeBuffer->Data(), bytesToWrite, &bytesWritten);
+	writeBuffer->DataTaken();
+	return (writeStatus == FR_OK && bytesWritten != bytesToWrite) ? FR_DENIED : writeStatus;		// a short write means the card is full
+}
+
+// Wait until the storage task has written all the buffers that we queued for this file. If that takes too long, the SD card has probably failed.
+// In that case we fail the file and start a new generation so that the storage task discards the rest of its buffers, and return false.
+// We never write to the file ourselves while buffers are still queued for it, because the data would reach the file out of order.
+bool FileStore::WaitForPendingWrites() const
+{
+#ifdef RTOS
+	if (pendingWrites != 0)
+	{
+		const uint32_t startClocks = StepTimer::GetInterruptClocks();
+		const uint32_t startMillis = millis();
+		do
+		{
+			reprap.GetPlatform().GetMassStorage()->WaitForQueuedWrite();
+		} while (pendingWrites != 0 && millis() - startMillis < MaxWriteWaitMillis);
+
+		const uint32_t waitClocks = StepTimer::GetInterruptClocks() - startClocks;
+		if (waitClocks > longestWriteWait)
+		{
+			longestWriteWait = waitClocks;
+		}
+
+		TaskCriticalSectionLocker lock;
+		if (pendingWrites != 0)
+		{
+			++openGeneration;
+			pendingWrites = 0;
+			if (queuedWriteStatus == FR_OK)
+			{
+				queuedWriteStatus = FR_TIMEOUT;
+			}
+			return false;
+		}
+	}
+#endif
+	return true;
+}
+
+// This is called by the storage task to write a buffer that was queued for the current generation of this file.
+// If the file has been invalidated or a previous write failed, discard the data. Return the result of the write.
+FRESULT FileStore::StoreQueuedBuffer(FileWriteBuffer *buffer)
+{
+	FRESULT result = FR_OK;
+	if (usageMode == FileUseMode::readWrite && queuedWriteStatus == FR_OK)
+	{
+		const size_t bytesToWrite = buffer->BytesStored();
+		size_t bytesWritten;
+		const FRESULT writeStatus = Store(buffer->Data(), bytesToWrite, &bytesWritten);
+		result = (writeStatus == FR_OK && bytesWritten != bytesToWrite) ? FR_DENIED
+					: (writeStatus == FR_OK && buffer->SyncAfterWrite()) ? f_sync(&file)
+						: writeStatus;
+	}
+	buffer->DataTaken();
+	return result;
+}
+
+// Write a block of up to FileWriteBufLen bytes to a file that doesn't have a write buffer, for example a record in a journal or a sector of the event log,
+// and optionally flush it to the SD card. With RTOS we copy the data to a free write buffer and queue it for the storage task, so that the caller
+// doesn't have to wait for the SD card. If no buffer is free we write it ourselves. A block of zero bytes with sync set just flushes the file.
+// The data is only known to have reached the card after a later call to Flush or Close returns true.
+bool FileStore::WriteInBackground(const char *s, size_t len, bool sync)
+{
+#ifdef RTOS
+	if (usageMode == FileUseMode::readWrite && writeBuffer == nullptr && len <= FileWriteBufLen)
+	{
+		if (queuedWriteStatus != FR_OK)
+		{
+			reprap.GetPlatform().MessageF(ErrorMessage, "Failed to write to file, error code %d. Card may be full.\n", (int)queuedWriteStatus);
+			return false;
+		}
+
+		MassStorage * const ms = reprap.GetPlatform().GetMassStorage();
+		FileWriteBuffer * const buffer = ms->AllocateWriteBuffer();
+		if (buffer != nullptr)
+		{
+			(void)buffer->Store(s, len);
+			if (sync)
+			{
+				buffer->SetSyncAfterWrite();
+			}
+			ms->QueueWriteBuffer(this, buffer);
+			return true;
+		}
+	}
+#endif
+	return Write(s, len) && (!sync || Flush());
+}
+
+// Return true if a call to WriteInBackground now would queue the data instead of waiting for the SD card
+bool FileStore::CanWriteInBackground() const
+{
+#ifdef RTOS
+	return usageMode == FileUseMode::readWrite && writeBuffer == nullptr && reprap.GetPlatform().GetMassStorage()->HasFreeWriteBuffer();
+#else
+	return true;
+#endif
+}
+
 bool FileStore::Flush()
 {
 	switch (usageMode)
@@ -445,6 +702,13 @@ bool FileStore::Flush()
 		return true;
 
 	case FileUseMode::readWrite:
+		WaitForPendingWrites();
+		if (queuedWriteStatus != FR_OK)
+		{
+			reprap.GetPlatform().MessageF(ErrorMessage, "Failed to write to file, error code %d. Card may be full.\n", (int)queuedWriteStatus);
+			return false;
+		}
+
 		if (writeBuffer != nullptr)
 		{
 			const size_t bytesToWrite = writeBuffer->BytesStored();
@@ -492,6 +756,27 @@ bool FileStore::Truncate()
 	}
 }
 
+// Find a contiguous block of free clusters big enough for an empty file to grow to the specified size, and make it the place where FatFS allocates
+// the next cluster. This keeps a file that we append to over a long time from being fragmented. The file size is not changed and the clusters
+// are not marked as used, so writing other files may still take some of them.
+bool FileStore::ReserveContiguousSpace(FilePosition size)
+{
+	switch (usageMode)
+	{
+	case FileUseMode::free:
+	case FileUseMode::readOnly:
+		INTERNAL_ERROR;
+		return false;
+
+	case FileUseMode::readWrite:
+		return f_size(&file) == 0 && f_expand(&file, size, 0) == FR_OK;
+
+	case FileUseMode::invalidated:
+	default:
+		return false;
+	}
+}
+
 // Return the file write time in milliseconds, and clear it
 float FileStore::GetAndClearLongestWriteTime()
 {
@@ -500,17 +785,24 @@ float FileStore::GetAndClearLongestWriteTime()
 	return ret;
 }
 
+// Return the longest time that a task waited for queued blocks to be written, in milliseconds, and clear it
+float FileStore::GetAndClearLongestWriteWait()
+{
+	const float ret = (float)longestWriteWait * StepTimer::StepClocksToMillis;
+	longestWriteWait = 0;
+	return ret;
+}
+
 // Return the highest SD card retry count that resulted in a successful transfer
 unsigned int FileStore::GetAndClearMaxRetryCount()
 {
 	return DiskioGetAndClearMaxRetryCount();
 }
 
-#if 0	// not currently used
-
-// Provide a cluster map for fast seeking. Needs _USE_FASTSEEK defined as 1 in conf_fatfs to make any difference.
-// The first element of the table must be set to the total number of 32-bit entries in the table before calling this.
-bool FileStore::SetClusterMap(uint32_t tbl[])
+// Set up a cluster map for fast seeking, taking it from the pool that MassStorage keeps. This costs one pass along the cluster chain now,
+// after which any seek takes the same time however far into the file it goes. FatFS doesn't let files that have a cluster map grow,
+// so this is only allowed for files that are open for reading. Return true if the file has a cluster map.
+bool FileStore::EnableFastSeek()
 {
 	switch (usageMode)
 	{
@@ -519,20 +811,83 @@ bool FileStore::SetClusterMap(uint32_t tbl[])
 		return false;
 
 	case FileUseMode::readOnly:
-	case FileUseMode::readWrite:
+		if (clusterMap == nullptr)
 		{
-			file.cltbl = tbl;
+			clusterMap = reprap.GetPlatform().GetMassStorage()->AllocateClusterMap();
+			if (clusterMap == nullptr)
+			{
+				return false;
+			}
+
+			clusterMap[0] = ClusterMapLength;
+			file.cltbl = clusterMap;
 			const FRESULT ret = f_lseek(&file, CREATE_LINKMAP);
-//			debugPrintf("ret %d need %u\n", (int)ret, tbl[0]);
-			return ret == FR_OK;
+			if (ret != FR_OK)
+			{
+				// Most likely the file has too many fragments to fit in the map, in which case we just use normal seeks
+				if (reprap.Debug(moduleStorage))
+				{
+					debugPrintf("Cluster map not created, error %d, needed %" PRIu32 " entries\n", (int)ret, clusterMap[0]);
+				}
+				file.cltbl = nullptr;
+				ReleaseClusterMap();
+				return false;
+			}
 		}
+		return true;
 
+	case FileUseMode::readWrite:
 	case FileUseMode::invalidated:
 	default:
 		return false;
 	}
 }
 
-#endif
+// Return the cluster map to the pool, if we have one
+void FileStore::ReleaseClusterMap()
+{
+	if (clusterMap != nullptr)
+	{
+		reprap.GetPlatform().GetMassStorage()->ReleaseClusterMap(clusterMap);
+		clusterMap = nullptr;
+	}
+}
+
+// Set up a read-ahead buffer, taking it from the pool that MassStorage keeps. A file being printed is read by the G-code input a few hundred bytes at a time,
+// which FatFS would serve one sector at a time via its sector buffer. With a read-ahead buffer we read several sectors with a single SD card command instead.
+// Only files that are open for reading can have one. Return true if the file has a read-ahead buffer.
+bool FileStore::EnableReadAhead()
+{
+	switch (usageMode)
+	{
+	case FileUseMode::free:
+		INTERNAL_ERROR;
+		return false;
+
+	case FileUseMode::readOnly:
+		if (readAheadBuffer == nullptr)
+		{
+			readAheadBuffer = reprap.GetPlatform().GetMassStorage()->AllocateReadAheadBuffer();
+			readAheadStart = readAheadEnd = 0;
+		}
+		return readAheadBuffer != nullptr;
+
+	case FileUseMode::readWrite:
+	case FileUseMode::invalidated:
+	default:
+		return false;
+	}
+}
+
+// Return the read-ahead buffer to the pool, if we have one
+void FileStore::ReleaseReadAheadBuffer()
+{
+	if (readAheadBuffer != nullptr)
+	{
+		reprap.GetPlatform().GetMassStorage()->ReleaseReadAheadBuffer(readAheadBuffer);
+		readAheadBuffer = nullptr;
+		readAheadStart = readAheadEnd = 0;
+	}
+}
 
 // End
@@ -18,6 +18,20 @@ enum class OpenMode : uint8_t
 	append			// append to an existing file, or create a new file if it is not found
 };
 
+#if SAM4E || SAM4S || SAME70
+const size_t NumClusterMaps = 3;					// Number of cluster maps for fast seeking, enough for the file being printed, the secondary motion channel and the file info parser
+#else
+const size_t NumClusterMaps = 2;
+#endif
+const size_t ClusterMapLength = 64;					// Number of 32-bit entries in each cluster map, which allows for up to 30 fragments
+
+#if SAM4E || SAM4S || SAME70
+const size_t ReadAheadBufferSize = 2048;			// Size of the buffers used to read files being printed several sectors at a time, must be a multiple of 512
+#else
+const size_t ReadAheadBufferSize = 1024;
+#endif
+const size_t NumReadAheadBuffers = 2;				// Enough for the file being printed and the secondary motion channel
+
 enum class FileUseMode : uint8_t
 {
 	free,			// file object is free
@@ -26,6 +40,15 @@ enum class FileUseMode : uint8_t
 	invalidated		// file object is in use but file system has been invalidated
 };
 
+// The format of a file that is read as G-code. FileGCodeInput finds it the first time it reads the file, so that it doesn't have to read the header again.
+enum class GCodeFileFormat : uint8_t
+{
+	unknown,		// the file hasn't been read as G-code since it was opened
+	text,
+	binary,			// binary format without block CRCs
+	binaryWithCrcs	// binary format with a CRC after each block
+};
+
 class FileStore
 {
 public:
@@ -39,11 +62,17 @@ public:
 	int Read(uint8_t* buf, size_t nBytes)
 		{ return Read((char*)buf, nBytes); }		// Read a block of nBytes length
 	int ReadLine(char* buf, size_t nBytes);			// As Read but stop after '\n' or '\r\n' and null-terminate
+	int ReadSectors(uint32_t *buf, size_t maxBytes);	// Read up to maxBytes into a 32-bit aligned buffer, stopping at a sector boundary if possible
 	FileWriteBuffer *GetWriteBuffer() const;		// Return a pointer to the remaining space for writing
 	bool Write(char b);								// Write 1 byte
 	bool Write(const char *s, size_t len);			// Write a block of len bytes
 	bool Write(const uint8_t *s, size_t len);		// Write a block of len bytes
 	bool Write(const char* s);						// Write a string
+	bool WriteInBackground(const char *s, size_t len, bool sync);	// Write a small block and optionally flush it, in the background if possible
+	bool WriteAndSync(const char *s, size_t len)
+		{ return WriteInBackground(s, len, true); }	// Write a small block and flush it to the card, in the background if possible
+	bool CanWriteInBackground() const;				// Return true if WriteInBackground can queue a block without waiting for the SD card
+	bool CanWriteWithoutWaiting(size_t len) const;	// Return true if we can write a block of len bytes without waiting for the SD card
 	bool Close();									// Shut the file and tidy up
 	bool ForceClose();
 	bool Seek(FilePosition pos);					// Jump to pos in the file
@@ -57,31 +86,51 @@ public:
 	void Duplicate();								// Create a second reference to this file
 	bool Flush();									// Write remaining buffer data
 	bool Truncate();								// Truncate file at current file pointer
+	bool ReserveContiguousSpace(FilePosition size);	// Find contiguous free space for an empty file that we are about to append to
 	bool Invalidate(const FATFS *fs, bool doClose);	// Invalidate the file if it uses the specified FATFS object
 	bool IsOpenOn(const FATFS *fs) const;			// Return true if the file is open on the specified file system
 	uint32_t GetCRC32() const;
 
-#if 0	// not currently used
-	bool SetClusterMap(uint32_t[]);					// Provide a cluster map for fast seeking
-#endif
+	bool EnableFastSeek();							// Try to set up a cluster map so that seeks don't have to follow the cluster chain
+	bool HasFastSeek() const { return clusterMap != nullptr; }
+	bool EnableReadAhead();							// Try to set up a buffer so that small reads are served from multi-sector reads
+	GCodeFileFormat GetGCodeFormat() const { return gcodeFormat; }
+	void SetGCodeFormat(GCodeFileFormat format) { gcodeFormat = format; }
 	static float GetAndClearLongestWriteTime();		// Return the longest time it took to write a block to a file, in milliseconds
+	static float GetAndClearLongestWriteWait();		// Return the longest time we waited for queued blocks to be written, in milliseconds
 	static unsigned int GetAndClearMaxRetryCount();	// Return the highest SD card retry count that resulted in a successful transfer
 	friend class MassStorage;
 
 private:
 	void Init();
+	void ReleaseClusterMap();
+	void ReleaseReadAheadBuffer();
+	int ReadFile(char *buf, size_t nBytes);			// Read directly from the file, bypassing the read-ahead buffer
+	int ReadBuffered(char *buf, size_t nBytes);		// Read via the read-ahead buffer
 	FRESULT Store(const char *s, size_t len, size_t *bytesWritten); // Write data to the non-volatile storage
+	FRESULT EmptyWriteBuffer();						// Write out or queue the data in the write buffer
+	bool WaitForPendingWrites() const;				// Wait until the storage task has written all the buffers queued for this file, false if it timed out
+	FRESULT StoreQueuedBuffer(FileWriteBuffer *buffer);	// Called by the storage task to write a queued buffer
 
     FIL file;
 	FileWriteBuffer *writeBuffer;
+	uint32_t *clusterMap;
+	uint32_t *readAheadBuffer;
+	uint16_t readAheadStart, readAheadEnd;			// the unread data in the read-ahead buffer
 	volatile unsigned int openCount;
+	// The state of the queued writes is mutable because waiting for them can fail the file, even in functions that don't otherwise change it
+	mutable volatile unsigned int pendingWrites;	// number of buffers of the current generation queued for the storage task to write to this file
+	mutable volatile FRESULT queuedWriteStatus;		// the first error from writing a queued buffer
+	mutable volatile uint32_t openGeneration;		// incremented when the file is opened and when its queued writes are abandoned
 	volatile bool closeRequested;
 	bool calcCrc;
 	FileUseMode usageMode;
+	GCodeFileFormat gcodeFormat;
 
 	CRC32 crc;
 
 	static uint32_t longestWriteTime;
+	static uint32_t longestWriteWait;
 };
 
 inline FileWriteBuffer *FileStore::GetWriteBuffer() const { return writeBuffer; }
@@ -10,7 +10,10 @@
 
 #include "RepRapFirmware.h"
 
-#if SAM4E || SAM4S || SAME70
+#if SAME70
+const size_t NumFileWriteBuffers = 4;					// Number of write buffers. With RTOS, a file being written keeps filling one while others are being written to the SD card.
+const size_t FileWriteBufLen = 8192;					// Size of each write buffer
+#elif SAM4E || SAM4S
 const size_t NumFileWriteBuffers = 2;					// Number of write buffers
 const size_t FileWriteBufLen = 8192;					// Size of each write buffer
 #elif defined(__LPC17xx__)
@@ -27,10 +30,15 @@ const size_t FileWriteBufLen = 4096;
 class FileWriteBuffer
 {
 public:
-	FileWriteBuffer(FileWriteBuffer *n) : next(n), index(0) { }
+	FileWriteBuffer(FileWriteBuffer *n) : next(n), file(nullptr), generation(0), index(0), syncAfterWrite(false) { }
 
 	FileWriteBuffer *Next() const { return next; }
 	void SetNext(FileWriteBuffer *n) { next = n; }
+	FileStore *GetFile() const { return file; }				// Return the file that a queued buffer is to be written to
+	uint32_t GetGeneration() const { return generation; }	// Return the open generation of that file when the buffer was queued
+	void SetFile(FileStore *f, uint32_t gen) { file = f; generation = gen; }
+	bool SyncAfterWrite() const { return syncAfterWrite; }	// Return true if the file must be synced after a queued buffer has been written
+	void SetSyncAfterWrite() { syncAfterWrite = true; }
 
 	char *Data() { return reinterpret_cast<char *>(data32); }
 	const char *Data() const { return reinterpret_cast<const char *>(data32); }
@@ -38,13 +46,16 @@ public:
 	const size_t BytesLeft() const { return FileWriteBufLen - index; }
 
 	size_t Store(const char *data, size_t length);			// Stores some data and returns how much could be stored
-	void DataTaken() { index = 0; }							// Called to indicate that the buffer has been written to the SD card
+	void DataTaken() { index = 0; syncAfterWrite = false; }	// Called to indicate that the buffer has been written to the SD card
 	void DataStored(size_t numBytes) { index += numBytes; }	// Called when more data has been stored directly in the buffer
 
 private:
 	FileWriteBuffer *next;
+	FileStore *file;
+	uint32_t generation;
 
 	size_t index;
+	bool syncAfterWrite;
 	uint32_t data32[FileWriteBufLen / sizeof(uint32_t)];	// 32-bit aligned buffer for better HSMCI performance
 };
 
@@ -0,0 +1,162 @@
+/*
+ * KeywordScanner.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Aho-Corasick multi-pattern matcher that finds every occurrence of a set of keywords in a single pass over a buffer.
+ *  The automaton is built by the constexpr constructor, so when the scanner is declared constexpr it is generated by the compiler and lives in flash memory.
+ *  Transitions are stored as child/sibling lists to keep the tables small, except that the transitions from the root state have a full lookup table,
+ *  because most characters of a G-code file don't start a keyword and take the scanner straight back to the root.
+ */
+
+#ifndef SRC_STORAGE_KEYWORDSCANNER_H_
+#define SRC_STORAGE_KEYWORDSCANNER_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Return the total length of a set of keywords. One more than this is the maximum number of states that a scanner for them needs.
+template<size_t NumKeys> constexpr size_t TotalKeywordLength(const char * const (&keys)[NumKeys])
+{
+	size_t total = 0;
+	for (const char *key : keys)
+	{
+		while (*key != 0)
+		{
+			++key;
+			++total;
+		}
+	}
+	return total;
+}
+
+template<size_t NumKeys, size_t MaxStates> class KeywordScanner
+{
+public:
+	static_assert(NumKeys < 128, "Too many keywords");
+	static_assert(MaxStates < 65536, "Keywords too long");
+
+	constexpr KeywordScanner(const char * const (&keys)[NumKeys]);
+
+	// Call callback(keyIndex, matchStart) for every occurrence of every keyword in the buffer, in order of the position of the end of the match
+	template<class F> void Scan(const char *buf, size_t len, F callback) const;
+
+private:
+	constexpr uint16_t FindChild(uint16_t state, char c) const;
+	uint16_t NextState(uint16_t state, char c) const;
+
+	uint16_t numStates = 1;						// state 0 is the root
+	uint16_t rootNext[256] = {};				// transitions from the root, 0 if a character doesn't start any keyword
+	uint16_t firstChild[MaxStates] = {};		// 0 if there are no children, because the root is never a child
+	uint16_t nextSibling[MaxStates] = {};
+	uint16_t failState[MaxStates] = {};			// state to continue from when there is no transition for the next character
+	uint16_t outputLink[MaxStates] = {};		// nearest state on the failure chain that ends a keyword, 0 if none
+	char stateChar[MaxStates] = {};				// the character that leads to this state from its parent
+	int8_t keyIndex[MaxStates] = {};			// the keyword that ends at this state, or -1 if none
+	uint8_t keyLength[NumKeys] = {};
+};
+
+template<size_t NumKeys, size_t MaxStates> constexpr KeywordScanner<NumKeys, MaxStates>::KeywordScanner(const char * const (&keys)[NumKeys])
+{
+	for (size_t i = 0; i < MaxStates; ++i)
+	{
+		keyIndex[i] = -1;
+	}
+
+	// Build the trie
+	for (size_t k = 0; k < NumKeys; ++k)
+	{
+		uint16_t state = 0;
+		const char *p = keys[k];
+		while (*p != 0)
+		{
+			uint16_t next = FindChild(state, *p);
+			if (next == 0)
+			{
+				next = numStates++;
+				stateChar[next] = *p;
+				nextSibling[next] = firstChild[state];
+				firstChild[state] = next;
+			}
+			state = next;
+			++p;
+		}
+		keyIndex[state] = (int8_t)k;
+		keyLength[k] = (uint8_t)(p - keys[k]);
+	}
+
+	// Set up the failure and output links in breadth-first order, so that the links of shallower states are always ready when we need them
+	uint16_t queue[MaxStates] = {};
+	size_t queueHead = 0, queueTail = 0;
+	for (uint16_t child = firstChild[0]; child != 0; child = nextSibling[child])
+	{
+		queue[queueTail++] = child;				// failure and output links of the children of the root are already 0
+	}
+
+	while (queueHead < queueTail)
+	{
+		const uint16_t state = queue[queueHead++];
+		for (uint16_t child = firstChild[state]; child != 0; child = nextSibling[child])
+		{
+			const char c = stateChar[child];
+			uint16_t fs = failState[state];
+			while (fs != 0 && FindChild(fs, c) == 0)
+			{
+				fs = failState[fs];
+			}
+			fs = FindChild(fs, c);
+			failState[child] = fs;
+			outputLink[child] = (keyIndex[fs] >= 0) ? fs : outputLink[fs];
+			queue[queueTail++] = child;
+		}
+	}
+
+	for (size_t c = 0; c < 256; ++c)
+	{
+		rootNext[c] = FindChild(0, (char)c);
+	}
+}
+
+template<size_t NumKeys, size_t MaxStates> constexpr uint16_t KeywordScanner<NumKeys, MaxStates>::FindChild(uint16_t state, char c) const
+{
+	uint16_t child = firstChild[state];
+	while (child != 0 && stateChar[child] != c)
+	{
+		child = nextSibling[child];
+	}
+	return child;
+}
+
+template<size_t NumKeys, size_t MaxStates> inline uint16_t KeywordScanner<NumKeys, MaxStates>::NextState(uint16_t state, char c) const
+{
+	for (;;)
+	{
+		if (state == 0)
+		{
+			return rootNext[(uint8_t)c];
+		}
+		const uint16_t next = FindChild(state, c);
+		if (next != 0)
+		{
+			return next;
+		}
+		state = failState[state];
+	}
+}
+
+template<size_t NumKeys, size_t MaxStates> template<class F> void KeywordScanner<NumKeys, MaxStates>::Scan(const char *buf, size_t len, F callback) const
+{
+	uint16_t state = 0;
+	for (size_t i = 0; i < len; ++i)
+	{
+		state = NextState(state, buf[i]);
+		for (uint16_t out = (keyIndex[state] >= 0) ? state : outputLink[state]; out != 0; out = outputLink[out])
+		{
+			const size_t k = (size_t)keyIndex[out];
+			callback(k, buf + i + 1 - keyLength[k]);
+		}
+	}
+}
+
+#endif /* SRC_STORAGE_KEYWORDSCANNER_H_ */
@@ -2,6 +2,12 @@
 #include "Platform.h"
 #include "RepRap.h"
 #include "sd_mmc.h"
+#include "GCodes/BinaryGCode.h"
+
+#ifdef RTOS
+# include "FreeRTOS.h"
+# include "task.h"
+#endif
 
 // Check that the LFN configuration in FatFS is sufficient
 static_assert(FF_MAX_LFN >= MaxFilenameLength, "FF_MAX_LFN too small");
@@ -14,6 +20,25 @@ static_assert(FF_MAX_LFN >= MaxFilenameLength, "FF_MAX_LFN too small");
 // No function should need to take both the file table mutex and the find buffer mutex.
 // No function in here should be called when the caller already owns the shared SPI mutex.
 
+#ifdef RTOS
+
+// The storage task writes the buffers of files that are being written with a write buffer, so that the tasks that write those files
+// can carry on receiving data while the SD card is busy. Files opened for appending have no write buffer, so they are written directly.
+constexpr size_t StorageTaskStackWords = 300;
+static Task<StorageTaskStackWords> storageTask;
+constexpr uint32_t WriteWaitPollMillis = 10;			// we don't rely on being notified when a queued write completes because several tasks may be waiting
+
+extern "C" [[noreturn]] void StorageLoop(void *)
+{
+	for (;;)
+	{
+		TaskBase::Take();
+		reprap.GetPlatform().GetMassStorage()->WriteQueuedBuffers();
+	}
+}
+
+#endif
+
 // Static helper functions - not declared as class members to avoid having to include sd_mmc.h everywhere
 static const char* TranslateCardType(card_type_t ct)
 {
@@ -59,8 +84,13 @@ static const char* TranslateCardError(sd_mmc_err_t err)
 }
 
 // Mass Storage class
-MassStorage::MassStorage(Platform* p) : freeWriteBuffers(nullptr)
+MassStorage::MassStorage(Platform* p) : visibleEntriesRead(0), directoryGeneration(0), freeWriteBuffers(nullptr),
+#ifdef RTOS
+	writeQueueHead(nullptr), writeQueueTail(nullptr), writeWaiter(nullptr), fileBeingWritten(nullptr),
+#endif
+	freeClusterMaps((1u << NumClusterMaps) - 1), freeReadAheadBuffers((1u << NumReadAheadBuffers) - 1)
 {
+	listingPosition.valid = false;
 }
 
 void MassStorage::Init()
@@ -77,6 +107,10 @@ void MassStorage::Init()
 		freeWriteBuffers = new FileWriteBuffer(freeWriteBuffers);
 	}
 
+#ifdef RTOS
+	storageTask.Create(StorageLoop, "STORAGE", nullptr, TaskPriority::StoragePriority);
+#endif
+
 	for (size_t card = 0; card < NumSdCards; ++card)
 	{
 		SdCardInfo& inf = info[card];
@@ -92,9 +126,15 @@ void MassStorage::Init()
 	// We no longer mount the SD card here because it may take a long time if it fails
 }
 
+// The write buffer functions use a critical section rather than the file system mutex because the storage task releases buffers,
+// and it must never wait for a task that may be holding that mutex while waiting for it.
 FileWriteBuffer *MassStorage::AllocateWriteBuffer()
 {
+#ifdef RTOS
+	TaskCriticalSectionLocker lock;
+#else
 	MutexLocker lock(fsMutex);
+#endif
 	if (freeWriteBuffers == nullptr)
 	{
 		return nullptr;
@@ -108,19 +148,155 @@ FileWriteBuffer *MassStorage::AllocateWriteBuffer()
 
 void MassStorage::ReleaseWriteBuffer(FileWriteBuffer *buffer)
 {
+#ifdef RTOS
+	TaskCriticalSectionLocker lock;
+#else
 	MutexLocker lock(fsMutex);
+#endif
 	buffer->SetNext(freeWriteBuffers);
 	freeWriteBuffers = buffer;
 }
 
+#ifdef RTOS
+
+// Add a full write buffer to the end of the queue for the storage task
+void MassStorage::QueueWriteBuffer(FileStore *file, FileWriteBuffer *buffer)
+{
+	buffer->SetNext(nullptr);
+	{
+		TaskCriticalSectionLocker lock;
+		buffer->SetFile(file, file->openGeneration);
+		++file->pendingWrites;
+		if (writeQueueHead == nullptr)
+		{
+			writeQueueHead = buffer;
+		}
+		else
+		{
+			writeQueueTail->SetNext(buffer);
+		}
+		writeQueueTail = buffer;
+	}
+	storageTask.Give();
+}
+
+void MassStorage::WaitForQueuedWrite()
+{
+	writeWaiter = xTaskGetCurrentTaskHandle();
+	(void)TaskBase::Take(WriteWaitPollMillis);
+}
+
+// Write all the queued buffers in the order they were queued. A buffer whose file has started a new generation since it was queued is discarded,
+// because the file has been reopened or has given up waiting for it.
+void MassStorage::WriteQueuedBuffers()
+{
+	for (;;)
+	{
+		FileWriteBuffer *buffer;
+		FileStore *file;
+		{
+			TaskCriticalSectionLocker lock;
+			buffer = writeQueueHead;
+			if (buffer == nullptr)
+			{
+				break;
+			}
+			writeQueueHead = buffer->Next();
+			file = (buffer->GetGeneration() == buffer->GetFile()->openGeneration) ? buffer->GetFile() : nullptr;
+			fileBeingWritten = file;
+		}
+
+		const uint32_t generation = buffer->GetGeneration();
+		FRESULT result = FR_OK;
+		if (file != nullptr)
+		{
+			result = file->StoreQueuedBuffer(buffer);
+		}
+		else
+		{
+			buffer->DataTaken();
+		}
+		ReleaseWriteBuffer(buffer);					// release the buffer first so that a task waiting for a free buffer can have it
+
+		if (file != nullptr)
+		{
+			TaskCriticalSectionLocker lock;
+			fileBeingWritten = nullptr;
+			if (generation == file->openGeneration)
+			{
+				if (file->queuedWriteStatus == FR_OK)
+				{
+					file->queuedWriteStatus = result;
+				}
+				--file->pendingWrites;
+			}
+		}
+
+		const TaskHandle waiter = writeWaiter;
+		if (waiter != nullptr)
+		{
+			writeWaiter = nullptr;
+			xTaskNotifyGive(waiter);
+		}
+	}
+}
+
+#endif
+
+uint32_t *MassStorage::AllocateClusterMap()
+{
+	MutexLocker lock(fsMutex);
+	if (freeClusterMaps == 0)
+	{
+		return nullptr;
+	}
+
+	const unsigned int index = LowestSetBit(freeClusterMaps);
+	ClearBit(freeClusterMaps, index);
+	return clusterMaps[index];
+}
+
+void MassStorage::ReleaseClusterMap(uint32_t *map)
+{
+	MutexLocker lock(fsMutex);
+	SetBit(freeClusterMaps, (size_t)(map - clusterMaps[0])/ClusterMapLength);
+}
+
+uint32_t *MassStorage::AllocateReadAheadBuffer()
+{
+	MutexLocker lock(fsMutex);
+	if (freeReadAheadBuffers == 0)
+	{
+		return nullptr;
+	}
+
+	const unsigned int index = LowestSetBit(freeReadAheadBuffers);
+	ClearBit(freeReadAheadBuffers, index);
+	return readAheadBuffers[index];
+}
+
+void MassStorage::ReleaseReadAheadBuffer(uint32_t *buf)
+{
+	MutexLocker lock(fsMutex);
+	SetBit(freeReadAheadBuffers, (size_t)(buf - readAheadBuffers[0])/ARRAY_SIZE(readAheadBuffers[0]));
+}
+
 FileStore* MassStorage::OpenFile(const char* filePath, OpenMode mode, uint32_t preAllocSize)
 {
 	{
 		MutexLocker lock(fsMutex);
 		for (size_t i = 0; i < MAX_FILES; i++)
 		{
+#ifdef RTOS
+			if (files[i].usageMode == FileUseMode::free && !IsStoringQueuedBuffer(&files[i]))	// the storage task may still be writing to a file that timed out
+#else
 			if (files[i].usageMode == FileUseMode::free)
+#endif
 			{
+				if (mode != OpenMode::read && !FileExists(filePath))
+				{
+					DirectoryChanged();							// we are about to create a new file
+				}
 				return (files[i].Open(filePath, mode, preAllocSize)) ? &files[i]: nullptr;
 			}
 		}
@@ -256,6 +432,103 @@ void MassStorage::AbandonFindNext()
 	}
 }
 
+// Find the first file or directory in a listing that starts at the specified entry, not counting entries whose names start with '.'.
+// If the last listing was suspended at that entry of the same directory and no directory entries have been created or deleted since then,
+// we carry on from where it stopped instead of reading all the entries before it again. This makes listing a large directory a page at a time much faster.
+// If it returns false then it also releases the mutex.
+bool MassStorage::FindFirstVisible(const char *directory, unsigned int startAt, FileInfo &file_info)
+{
+	// Remove any trailing '/' from the directory name, it sometimes (but not always) confuses f_opendir
+	String<MaxFilenameLength> loc;
+	loc.copy(directory);
+	const size_t len = loc.strlen();
+	if (len != 0 && (loc[len - 1] == '/' || loc[len - 1] == '\\'))
+	{
+		loc.Truncate(len - 1);
+	}
+
+	if (!dirMutex.Take(10000))
+	{
+		return false;
+	}
+
+	if (   listingPosition.valid
+		&& listingPosition.index == startAt
+		&& listingPosition.generation == directoryGeneration
+		&& StringEqualsIgnoreCase(listingPosition.directory.c_str(), loc.c_str())
+	   )
+	{
+		findDir = listingPosition.dirState;
+		visibleEntriesRead = startAt;
+	}
+	else if (f_opendir(&findDir, loc.c_str()) == FR_OK)
+	{
+		visibleEntriesRead = 0;
+	}
+	else
+	{
+		dirMutex.Release();
+		return false;
+	}
+
+	listingPosition.valid = false;
+	listingPosition.directory.copy(loc.c_str());
+	while (ReadVisibleEntry(file_info))
+	{
+		if (visibleEntriesRead > startAt)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Find the next entry in a listing started by FindFirstVisible. If it returns false then it also releases the mutex.
+bool MassStorage::FindNextVisible(FileInfo &file_info)
+{
+	if (dirMutex.GetHolder() != RTOSIface::GetCurrentTask())
+	{
+		return false;		// error, we don't hold the mutex
+	}
+	return ReadVisibleEntry(file_info);
+}
+
+// Stop a listing started by FindFirstVisible. The caller hasn't used the last entry returned, so the next page starts with it.
+void MassStorage::SuspendListing()
+{
+	if (dirMutex.GetHolder() == RTOSIface::GetCurrentTask())
+	{
+		listingPosition.dirState = previousFindDir;
+		listingPosition.index = visibleEntriesRead - 1;
+		listingPosition.generation = directoryGeneration;
+		listingPosition.valid = true;
+		dirMutex.Release();
+	}
+}
+
+// Read the next directory entry whose name doesn't start with '.'. If there are no more, close the directory and release the mutex.
+bool MassStorage::ReadVisibleEntry(FileInfo &file_info)
+{
+	FILINFO entry;
+	do
+	{
+		previousFindDir = findDir;
+		if (f_readdir(&findDir, &entry) != FR_OK || entry.fname[0] == 0)
+		{
+			f_closedir(&findDir);
+			dirMutex.Release();
+			return false;
+		}
+	} while (entry.fname[0] == '.');		// ignore Mac resource files and Linux hidden files
+
+	++visibleEntriesRead;
+	file_info.isDirectory = (entry.fattrib & AM_DIR);
+	file_info.size = entry.fsize;
+	file_info.fileName.copy(entry.fname);
+	file_info.lastModified = ConvertTimeStamp(entry.fdate, entry.ftime);
+	return true;
+}
+
 // Month names. The first entry is used for invalid month numbers.
 static const char *monthNames[13] = { "???", "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
 
@@ -294,6 +567,7 @@ bool MassStorage::Delete(const char* filePath)
 		if (!isOpen)
 		{
 			unlinkReturn = f_unlink(filePath);
+			DirectoryChanged();
 		}
 	}
 
@@ -323,6 +597,7 @@ bool MassStorage::MakeDirectory(const char *parentDir, const char *dirName)
 	{
 		return false;
 	}
+	DirectoryChanged();
 	if (f_mkdir(location.c_str()) != FR_OK)
 	{
 		reprap.GetPlatform().MessageF(ErrorMessage, "Failed to create directory %s\n", location.c_str());
@@ -333,6 +608,7 @@ bool MassStorage::MakeDirectory(const char *parentDir, const char *dirName)
 
 bool MassStorage::MakeDirectory(const char *directory)
 {
+	DirectoryChanged();
 	if (f_mkdir(directory) != FR_OK)
 	{
 		reprap.GetPlatform().MessageF(ErrorMessage, "Failed to create directory %s\n", directory);
@@ -351,6 +627,7 @@ bool MassStorage::Rename(const char *oldFilename, const char *newFilename)
 		// We are assuming that the user isn't really trying to rename across volumes. This is a safe assumption when the client is DWC.
 		newFilename += 2;
 	}
+	DirectoryChanged();
 	if (f_rename(oldFilename, newFilename) != FR_OK)
 	{
 		reprap.GetPlatform().MessageF(ErrorMessage, "Failed to rename file or directory %s to %s\n", oldFilename, newFilename);
@@ -366,6 +643,22 @@ bool MassStorage::FileExists(const char *filePath) const
 	return (f_stat(filePath, &fil) == FR_OK);
 }
 
+// Get the details of a file or directory. Return false if it doesn't exist.
+bool MassStorage::StatFile(const char *filePath, FileInfo& file_info) const
+{
+	FILINFO fil;
+	if (f_stat(filePath, &fil) != FR_OK)
+	{
+		return false;
+	}
+
+	file_info.isDirectory = (fil.fattrib & AM_DIR);
+	file_info.size = fil.fsize;
+	file_info.fileName.copy(fil.fname);
+	file_info.lastModified = ConvertTimeStamp(fil.fdate, fil.ftime);
+	return true;
+}
+
 // Check if the specified directory exists
 // Warning: if 'path' has a trailing '/' or '\\' character, it will be removed!
 bool MassStorage::DirectoryExists(const StringRef& path) const
@@ -493,6 +786,7 @@ GCodeResult MassStorage::Mount(size_t card, const StringRef& reply, bool reportS
 	}
 
 	inf.isMounted = true;
+	DirectoryChanged();
 	if (reportSuccess)
 	{
 		float capacity = ((float)sd_mmc_get_capacity(card) * 1024) / 1000000;		// get capacity and convert from Kib to Mbytes
@@ -594,6 +888,13 @@ bool MassStorage::IsCardDetected(size_t card) const
 unsigned int MassStorage::InternalUnmount(size_t card, bool doClose)
 {
 	SdCardInfo& inf = info[card];
+#ifdef RTOS
+	// Let the storage task finish writing any queued buffers, because it needs the volume mutex to do that
+	for (const FileStore& fil : files)
+	{
+		fil.WaitForPendingWrites();
+	}
+#endif
 	MutexLocker lock1(fsMutex);
 	MutexLocker lock2(inf.volMutex);
 	const unsigned int invalidated = InvalidateFiles(&inf.fileSystem, doClose);
@@ -692,20 +993,38 @@ void MassStorage::Spin()
 	}
 }
 
-// Append the simulated printing time to the end of the file
+// Calculate the CRC of a block in a binary G-code file
+static uint32_t BinaryBlockCrc(const uint8_t *data, size_t length)
+{
+	CRC32 crc;
+	crc.Update(reinterpret_cast<const char*>(data), length);
+	return crc.Get();
+}
+
+// Append the simulated printing time to the end of the file.
+// In a binary G-code file it must be framed as a block holding a text record, otherwise the reader would take the text as a block.
 void MassStorage::RecordSimulationTime(const char *printingFilePath, uint32_t simSeconds)
 {
 	FileStore * const file = OpenFile(printingFilePath, OpenMode::append, 0);
 	bool ok = (file != nullptr);
 	if (ok)
 	{
+		const FilePosition oldLength = file->Length();
+		char header[BinaryGCode::HeaderLength];
+		const bool isBinary = oldLength >= BinaryGCode::HeaderLength
+								&& file->Seek(0)
+								&& file->Read(header, BinaryGCode::HeaderLength) == (int)BinaryGCode::HeaderLength
+								&& memcmp(header, BinaryGCode::Magic, sizeof(BinaryGCode::Magic)) == 0;
+		const bool hasBlockCrcs = isBinary && (header[5] & BinaryGCode::FlagBlockCrc) != 0;
+
 		// Check whether there is already simulation info at the end of the file, in which case we should replace it
 		constexpr size_t BufferSize = 100;
 		String<BufferSize> buffer;
-		const size_t bytesToRead = (size_t)min<FilePosition>(file->Length(), BufferSize);
-		const FilePosition seekPos = file->Length() - bytesToRead;
+		const size_t bytesToRead = (size_t)min<FilePosition>(oldLength, BufferSize);
+		const FilePosition seekPos = oldLength - bytesToRead;
 		ok = file->Seek(seekPos);
 		time_t lastModtime = 0;
+		FilePosition newLength = 0;
 		if (ok)
 		{
 			ok = (file->Read(buffer.GetRef().Pointer(), bytesToRead) == (int)bytesToRead);
@@ -713,20 +1032,40 @@ void MassStorage::RecordSimulationTime(const char *printingFilePath, uint32_t si
 			{
 				lastModtime = GetLastModifiedTime(printingFilePath);			// save the last modified time to that we can restore it later
 				buffer[bytesToRead] = 0;										// this is OK because String<N> has N+1 bytes of storage
-				const char* const pos = strstr(buffer.c_str(), FileInfoParser::SimulatedTimeString);
-				if (pos != nullptr)
+				if (isBinary)
 				{
-					ok = file->Seek(seekPos + (pos - buffer.c_str()));			// overwrite previous simulation time
+					String<ShortScratchStringLength> text;
+					text.printf("%s: %" PRIu32 "\n", FileInfoParser::SimulatedTimeString, simSeconds);
+					uint8_t block[BinaryGCode::MaxBlockLength];
+					const size_t blockLength = BinaryGCode::EncodeTextBlock(text.c_str(), text.strlen(), (hasBlockCrcs) ? BinaryBlockCrc : nullptr, block);
+					size_t padding;
+					const FilePosition writePos = BinaryGCode::PlaceFinalTextBlock(reinterpret_cast<const uint8_t*>(buffer.c_str()), bytesToRead, oldLength,
+																					FileInfoParser::SimulatedTimeString, hasBlockCrcs, blockLength, padding);
+					ok = blockLength != 0 && file->Seek(writePos);
+					for (size_t i = 0; ok && i < padding; ++i)
+					{
+						ok = file->Write((char)0);
+					}
+					ok = ok && file->Write(block, blockLength);
 				}
-				if (ok)
+				else
 				{
-					buffer.printf("%s: %" PRIu32 "\n", FileInfoParser::SimulatedTimeString, simSeconds);
-					ok = file->Write(buffer.c_str());
+					const char* const pos = strstr(buffer.c_str(), FileInfoParser::SimulatedTimeString);
+					if (pos != nullptr)
+					{
+						ok = file->Seek(seekPos + (pos - buffer.c_str()));			// overwrite previous simulation time
+					}
 					if (ok)
 					{
-						ok = file->Truncate();									// truncate file in case we overwrote a previous longer simulation time
+						buffer.printf("%s: %" PRIu32 "\n", FileInfoParser::SimulatedTimeString, simSeconds);
+						ok = file->Write(buffer.c_str());
 					}
 				}
+				if (ok)
+				{
+					ok = file->Truncate();										// truncate file in case we overwrote a previous longer simulation time
+					newLength = file->Length();
+				}
 			}
 		}
 		if (!file->Close())
@@ -736,6 +1075,10 @@ void MassStorage::RecordSimulationTime(const char *printingFilePath, uint32_t si
 		if (ok && lastModtime != 0)
 		{
 			ok = SetLastModifiedTime(printingFilePath, lastModtime);
+			if (ok)
+			{
+				infoParser.UpdateCachedSimulatedTime(printingFilePath, oldLength, newLength, simSeconds);
+			}
 		}
 	}
 
@@ -31,11 +31,15 @@ public:
 	bool FindFirst(const char *directory, FileInfo &file_info);
 	bool FindNext(FileInfo &file_info);
 	void AbandonFindNext();
+	bool FindFirstVisible(const char *directory, unsigned int startAt, FileInfo &file_info);	// Start a paged listing, skipping hidden files
+	bool FindNextVisible(FileInfo &file_info);
+	void SuspendListing();															// Stop a paged listing before the last entry returned, so that the next page can start there
 	bool Delete(const char* filePath);
 	bool MakeDirectory(const char *parentDir, const char *dirName);
 	bool MakeDirectory(const char *directory);
 	bool Rename(const char *oldFilePath, const char *newFilePath);
 	bool FileExists(const char *filePath) const;
+	bool StatFile(const char *filePath, FileInfo& file_info) const;					// Get the size and date of a file without opening it
 	bool DirectoryExists(const StringRef& path) const;								// Warning: if 'path' has a trailing '/' or '\\' character, it will be removed!
 	bool DirectoryExists(const char *path) const;
 	time_t GetLastModifiedTime(const char *filePath) const;
@@ -53,6 +57,7 @@ public:
 	const Mutex& GetVolumeMutex(size_t vol) const { return info[vol].volMutex; }
 	bool GetFileInfo(const char *filePath, GCodeFileInfo& info, bool quitEarly) { return infoParser.GetFileInfo(filePath, info, quitEarly); }
 	void RecordSimulationTime(const char *printingFilePath, uint32_t simSeconds);	// Append the simulated printing time to the end of the file
+	void InvalidateFileInfo(const char *filePath) { infoParser.InvalidateCachedInfo(filePath); }	// Forget the cached file info for a file that has been replaced
 
 	enum class InfoResult : uint8_t
 	{
@@ -63,6 +68,10 @@ public:
 
 	InfoResult GetCardInfo(size_t slot, uint64_t& capacity, uint64_t& freeSpace, uint32_t& speed, uint32_t& clSize);
 
+#ifdef RTOS
+	void WriteQueuedBuffers();										// Called by the storage task
+#endif
+
 friend class Platform;
 friend class FileStore;
 
@@ -72,6 +81,17 @@ protected:
 
 	FileWriteBuffer *AllocateWriteBuffer();
 	void ReleaseWriteBuffer(FileWriteBuffer *buffer);
+#ifdef RTOS
+	void QueueWriteBuffer(FileStore *file, FileWriteBuffer *buffer);	// Queue a full buffer for the storage task to write
+	void WaitForQueuedWrite();										// Wait until the storage task has written a buffer, or a short timeout
+	bool HasFreeWriteBuffer() const { return freeWriteBuffers != nullptr; }
+	bool HasQueuedWrites() const { return writeQueueHead != nullptr; }
+	bool IsStoringQueuedBuffer(const FileStore *file) const { return fileBeingWritten == file; }	// True if the storage task is writing to this file now
+#endif
+	uint32_t *AllocateClusterMap();
+	void ReleaseClusterMap(uint32_t *map);
+	uint32_t *AllocateReadAheadBuffer();
+	void ReleaseReadAheadBuffer(uint32_t *buf);
 
 private:
 	enum class CardDetectState : uint8_t
@@ -96,6 +116,18 @@ private:
 
 	unsigned int InternalUnmount(size_t card, bool doClose);
 	static time_t ConvertTimeStamp(uint16_t fdate, uint16_t ftime);
+	bool ReadVisibleEntry(FileInfo &file_info);
+	void DirectoryChanged() { ++directoryGeneration; }
+
+	// Where a paged directory listing was suspended, so that listing the next page doesn't have to read all the entries before it again
+	struct ListingPosition
+	{
+		String<MaxFilenameLength> directory;
+		DIR dirState;						// the state of the directory object before the first entry of the next page was read
+		unsigned int index;					// the index of that entry, not counting hidden files
+		uint32_t generation;				// the value of directoryGeneration when the position was saved
+		bool valid;
+	};
 
 	SdCardInfo info[NumSdCards];
 
@@ -103,7 +135,21 @@ private:
 
 	FileInfoParser infoParser;
 	DIR findDir;
+	DIR previousFindDir;					// the state of findDir before the last entry was read by ReadVisibleEntry
+	unsigned int visibleEntriesRead;		// how many non-hidden entries have been read in the current paged listing
+	ListingPosition listingPosition;
+	volatile uint32_t directoryGeneration;	// incremented whenever directory entries may have been created, deleted or renamed, but not when an existing file is rewritten
 	FileWriteBuffer *freeWriteBuffers;
+#ifdef RTOS
+	FileWriteBuffer *volatile writeQueueHead;						// buffers waiting for the storage task to write them
+	FileWriteBuffer *writeQueueTail;								// only valid when writeQueueHead is not null
+	volatile TaskHandle writeWaiter;								// task waiting for a queued buffer to be written
+	const FileStore *volatile fileBeingWritten;						// the file that the storage task is writing a buffer to, or null
+#endif
+	uint32_t clusterMaps[NumClusterMaps][ClusterMapLength];
+	uint32_t freeClusterMaps;									// bitmap of the cluster maps that are not in use
+	uint32_t readAheadBuffers[NumReadAheadBuffers][ReadAheadBufferSize/sizeof(uint32_t)];
+	uint32_t freeReadAheadBuffers;								// bitmap of the read-ahead buffers that are not in use
 	FileStore files[MAX_FILES];
 };
 
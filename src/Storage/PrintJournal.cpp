@@ -0,0 +1,156 @@
+/*
+ * PrintJournal.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ */
+
+#include "PrintJournal.h"
+#include "FileStore.h"
+#include "CRC32.h"
+#include "Platform.h"
+#include "RepRap.h"
+
+// Return the CRC of a header or record, excluding the CRC field at the end
+template<class T> /*static*/ uint32_t PrintJournal::GetCrc(const T& item)
+{
+	CRC32 crc;
+	crc.Update(reinterpret_cast<const uint8_t*>(&item), offsetof(T, crc));
+	return crc.Get();
+}
+
+// Create a new journal for a print that is starting, replacing any previous journal
+bool PrintJournal::Start(const char *printingFilename)
+{
+	Finish(false);
+
+	Header header;
+	memset(&header, 0, sizeof(header));									// so that the bytes after the file name don't vary
+	header.magic = HeaderMagic;
+	SafeStrncpy(header.fileName, printingFilename, sizeof(header.fileName));
+	header.crc = GetCrc(header);
+
+	// Open the file in append mode so that it doesn't tie up a write buffer for the whole print
+	Platform& platform = reprap.GetPlatform();
+	platform.DeleteSysFile(JournalFileName);
+	journalFile = platform.OpenSysFile(JournalFileName, OpenMode::append);
+	if (journalFile == nullptr)
+	{
+		platform.MessageF(WarningMessage, "Failed to create print job journal %s\n", JournalFileName);
+		return false;
+	}
+
+	if (!journalFile->Write(reinterpret_cast<const char*>(&header), sizeof(header)) || !journalFile->Flush())
+	{
+		Finish(true);
+		return false;
+	}
+
+	nextSequence = 0;
+	recordPending = false;
+	return true;
+}
+
+// Hold a record until the move that starts at its file position has been executed. A record that is still pending is replaced,
+// because the move it belongs to can't have been executed if we are already at the next layer.
+void PrintJournal::SetPendingRecord(const Record& r)
+{
+	pendingRecord = r;
+	recordPending = (journalFile != nullptr);
+}
+
+// This is called from GCodes::Spin with the file position of the last move that the main motion system has completed
+void PrintJournal::MoveCompleted(FilePosition completedFilePos)
+{
+	if (recordPending && completedFilePos != noFilePosition && completedFilePos >= pendingRecord.filePos)
+	{
+		recordPending = false;
+		Add(pendingRecord);
+	}
+}
+
+// Append a marker record to say that resurrect.g was saved after the previous record, so it supersedes that record
+void PrintJournal::AddResumeFileMarker()
+{
+	if (journalFile != nullptr)
+	{
+		Record r;
+		memset(&r, 0, sizeof(r));
+		r.filePos = noFilePosition;
+		r.toolNumber = -1;
+		r.flags = ResumeFileSavedFlag;
+		Add(r);
+	}
+}
+
+// Append a record to the journal. The storage task writes it, so the caller doesn't wait for the SD card.
+void PrintJournal::Add(Record& r)
+{
+	if (journalFile != nullptr)
+	{
+		r.magic = RecordMagic;
+		r.sequence = nextSequence++;
+		r.crc = GetCrc(r);
+		if (!journalFile->WriteAndSync(reinterpret_cast<const char*>(&r), sizeof(r)))
+		{
+			Finish(false);														// stop journaling this print, but keep the records we already have
+		}
+	}
+}
+
+// Close the journal if we have one open. If the print completed then the journal is no longer needed, so delete it.
+// A journal left by a print that was interrupted isn't ours to delete, for example when a simulation finishes.
+void PrintJournal::Finish(bool deleteJournal)
+{
+	recordPending = false;
+	if (journalFile != nullptr)
+	{
+		journalFile->Close();
+		journalFile = nullptr;
+		if (deleteJournal)
+		{
+			reprap.GetPlatform().DeleteSysFile(JournalFileName);
+		}
+	}
+}
+
+// Read the journal back and return the last complete record and the name of the file being printed. Return false if there is no valid journal or it has no records.
+// The record returned may be a marker record with the ResumeFileSavedFlag set.
+// The records must have consecutive sequence numbers, so we stop at the first one that is out of sequence or corrupt.
+/*static*/ bool PrintJournal::ReadLastRecord(const StringRef& printingFilename, Record& r)
+{
+	FileStore * const f = reprap.GetPlatform().OpenSysFile(JournalFileName, OpenMode::read);
+	if (f == nullptr)
+	{
+		return false;
+	}
+
+	Header header;
+	if (f->Read(reinterpret_cast<char*>(&header), sizeof(header)) != (int)sizeof(header) || header.magic != HeaderMagic || header.crc != GetCrc(header))
+	{
+		f->Close();
+		return false;
+	}
+	header.fileName[MaxFilenameLength] = 0;
+	printingFilename.copy(header.fileName);
+
+	bool found = false;
+	Record next;
+	while (f->Read(reinterpret_cast<char*>(&next), sizeof(next)) == (int)sizeof(next))
+	{
+		if (   next.magic != RecordMagic
+			|| next.crc != GetCrc(next)
+			|| next.sequence != ((found) ? r.sequence + 1 : 0)
+		   )
+		{
+			break;
+		}
+		r = next;
+		found = true;
+	}
+
+	f->Close();
+	return found;
+}
+
+// End
@@ -0,0 +1,79 @@
+/*
+ * PrintJournal.h
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: ricky3350
+ *
+ *  Append-only journal of the state of the print in progress, so that a print can be resumed after the power fails even if we didn't get the chance to save resurrect.g.
+ *  The journal file starts with a header that names the file being printed. A fixed-size record is appended each time the print starts a new layer,
+ *  and it is written in the background by the storage task. The record is made when the first move of the layer is read, but it is held back until
+ *  the move has started executing, so that the journal never gets ahead of the head. Each record carries a sequence number and a CRC, so that on
+ *  reading the journal back we use the last complete record and ignore one that was only partly written when the power failed.
+ *  When resurrect.g is saved during the print we append a marker record, so that M916 can tell whether resurrect.g or the journal is more recent
+ *  without relying on file times.
+ */
+
+#ifndef SRC_STORAGE_PRINTJOURNAL_H_
+#define SRC_STORAGE_PRINTJOURNAL_H_
+
+#include "RepRapFirmware.h"
+
+class PrintJournal
+{
+public:
+	// The state of the print at the start of a layer. The file position is the start of the first printing move of the layer,
+	// and the coordinates and virtual extruder position are the values before that move.
+	struct Record
+	{
+		uint32_t magic;
+		uint32_t sequence;
+		FilePosition filePos;
+		float coords[3];									// user X, Y and Z coordinates
+		float virtualExtruderPosition;
+		float feedRate;										// in mm/sec
+		float toolTemperature;								// active temperature of the first heater of the current tool
+		float bedTemperature;								// active temperature of the first bed heater, 0 if none
+		float fanSpeed;										// speed of the print cooling fan, 0 to 1
+		int16_t toolNumber;									// -1 if no tool is selected
+		uint16_t flags;
+		uint32_t crc;										// CRC of all the preceding fields
+	};
+
+	static constexpr uint16_t DrivesRelativeFlag = 0x0001;
+	static constexpr uint16_t UsingInchesFlag = 0x0002;
+	static constexpr uint16_t ResumeFileSavedFlag = 0x0004;	// this is a marker record, resurrect.g was saved after the previous record
+	static constexpr const char* JournalFileName = "printjob.jnl";		// in the system directory
+
+	PrintJournal() : journalFile(nullptr), nextSequence(0), recordPending(false) { }
+
+	bool Start(const char *printingFilename);				// create a new journal for a print that is starting
+	void SetPendingRecord(const Record& r);					// hold a record until the move at its file position has been executed
+	void MoveCompleted(FilePosition completedFilePos);		// append the pending record if the move it belongs to has been executed
+	void AddResumeFileMarker();								// record that resurrect.g has just been saved
+	void Finish(bool deleteJournal);						// close the journal if it is open, and optionally delete it
+	bool IsActive() const { return journalFile != nullptr; }
+
+	static bool ReadLastRecord(const StringRef& printingFilename, Record& r);	// read the last complete record and the name of the file it belongs to
+
+private:
+	static constexpr uint32_t HeaderMagic = 0x484A5052;		// "RPJH" - change this if the header layout changes
+	static constexpr uint32_t RecordMagic = 0x524A5052;		// "RPJR" - change this if the record layout changes
+
+	struct Header
+	{
+		uint32_t magic;
+		char fileName[MaxFilenameLength + 1];
+		uint32_t crc;										// CRC of all the preceding fields
+	};
+
+	template<class T> static uint32_t GetCrc(const T& item);
+
+	void Add(Record& r);									// fill in the sequence number and CRC of a record and append it to the journal
+
+	FileStore *journalFile;
+	uint32_t nextSequence;
+	Record pendingRecord;
+	bool recordPending;
+};
+
+#endif /* SRC_STORAGE_PRINTJOURNAL_H_ */